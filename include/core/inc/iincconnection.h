@@ -19,6 +19,7 @@
 #include <core/inc/iincmessage.h>
 #include <core/inc/iincoperation.h>
 #include <core/kernel/iobject.h>
+#include <core/thread/imutex.h>
 #include <core/utils/ibytearray.h>
 #include <core/utils/istring.h>
 
@@ -104,6 +105,10 @@ public:
     /// Check if connection is to local
     bool isLocal() const;
 
+    /// Peer process credentials authenticated by the transport (Unix sockets only)
+    /// @return false if the transport cannot provide them
+    bool peerCredentials(xint64* pid, xint64* uid) const;
+
     /// Check if channel is allocated call from IO thread
     bool isChannelAllocated(xuint32 channelId) const;
 
@@ -174,6 +179,26 @@ private:
 
     void setConnectionId(xuint32 connId) { m_connId = connId; }
 
+    /// Enable interned method ids (client-side, after CAP_METHOD_ID negotiation)
+    void setMethodIdsEnabled(bool enable) { m_methodIdsEnabled = enable; }
+
+    /// Enable batched method calls (client-side, after CAP_METHOD_BATCH negotiation)
+    void setBatchCallsEnabled(bool enable) { m_batchCallsEnabled = enable; }
+    bool batchCallsEnabled() const { return m_batchCallsEnabled; }
+
+    /// Look up the interned id of a method (client-side, thread-safe)
+    /// @return Bound id, or 0 if not bound yet; the first miss sends METHOD_BIND
+    xuint32 methodId(iStringView method);
+
+    static void onMethodBound(iINCOperation* op, void* userData);
+
+    /// Bind a method name to a connection-local index (server-side, IO thread)
+    /// @return 1-based index, or 0 once \a limit names are bound on this connection
+    xuint32 bindLocalMethod(const iString& method, xuint32 limit);
+
+    /// Name bound to a connection-local index, empty if \a index was never bound
+    iString localMethod(xuint32 index) const;
+
     void onErrorOccurred(xint32 errorCode);
     void onMessageReceived(const iINCMessage& msg);
     void onBinaryDataReceived(xuint32 channelId, xuint32 seqNum, bool broadcast, xint64 pos, iByteArray data);
@@ -184,6 +209,26 @@ private:
     xuint32                 m_peerProtocol;
     iINCHandshake*          m_handshake;        // Handshake handler (server-side only)
 
+    // Interned method ids (client-side), keyed by iKeyHashFunc(name) so lookups
+    // from an iStringView do not build a temporary iString
+    struct MethodBinding {
+        iString name;
+        xuint32 id;                             // 0 while METHOD_BIND is in flight
+    };
+    #if __cplusplus >= 201103L
+    typedef std::unordered_multimap<size_t, MethodBinding> MethodIdMap;
+    #else
+    typedef std::multimap<size_t, MethodBinding> MethodIdMap;
+    #endif
+    bool                    m_methodIdsEnabled;
+    bool                    m_batchCallsEnabled;
+    iMutex                  m_methodLock;       // caller thread vs. IO thread
+    MethodIdMap             m_methodIds;
+
+    // Names bound by this peer (server-side), index N lives at N - 1 and is
+    // released with the connection, so one client cannot exhaust the others
+    std::vector<iString>    m_localMethods;
+
     // Event subscription patterns
     std::vector<iString>    m_subscriptions;
 
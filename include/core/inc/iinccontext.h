@@ -14,6 +14,8 @@
 #ifndef IINCCONTEXT_H
 #define IINCCONTEXT_H
 
+#include <vector>
+
 #include <core/inc/iinccontextconfig.h>
 #include <core/inc/iincconnection.h>
 #include <core/thread/ithread.h>
@@ -36,6 +38,28 @@ class IX_CORE_EXPORT iINCContext : public iObject
 {
     IX_OBJECT(iINCContext)
 public:
+    /// One invocation of a batched call
+    struct MethodCall {
+        iString     method;
+        xuint16     version;
+        iByteArray  args;
+
+        MethodCall() : version(1) {}
+        MethodCall(const iString& m, xuint16 v, const iByteArray& a) : method(m), version(v), args(a) {}
+    };
+
+    /// Per-call outcome of a batched call, in call order
+    struct MethodResult {
+        xint32      errorCode;
+        iByteArray  data;
+    };
+
+    /// Decode the reply of callMethods()
+    /// @param op Finished batch operation
+    /// @param results Receives one entry per call
+    /// @return false if the operation failed as a whole or the reply is malformed
+    static bool batchResults(const iINCOperation* op, std::vector<MethodResult>& results);
+
     /// Connection state
     enum State {
         STATE_READY,          ///< ready
@@ -117,6 +141,14 @@ protected:
     /// @note Subclasses should wrap this with typed method calls
     iSharedDataPointer<iINCOperation> callMethod(iStringView method, xuint16 version, const iByteArray& args, xint64 timeout = 1000);
 
+    /// Call several remote methods with one request frame and one reply (protected - for subclass use)
+    /// @param calls Invocations, executed by the server strictly in order
+    /// @param timeout Timeout for the whole batch in ms (0 = no timeout)
+    /// @return One operation for the batch, decode it with batchResults();
+    ///         null if not connected, batches are disabled on either side, or the
+    ///         encoded calls exceed one frame (MAX_MESSAGE_SIZE)
+    iSharedDataPointer<iINCOperation> callMethods(const std::vector<MethodCall>& calls, xint64 timeout = 1000);
+
 private:
     void onMessageReceived(iINCConnection* conn, const iINCMessage& msg);
     void onErrorOccurred(iINCConnection* conn, xint32 errorCode);
@@ -71,6 +71,41 @@ public:
     iByteArray sharedMemoryName() const { return m_sharedMemoryName; }
     void setSharedMemoryName(const iByteArray& prefix) { m_sharedMemoryName = prefix; }
 
+    /// Pre-fault the segment when it is created (default: false)
+    bool sharedMemoryPrefault() const { return m_sharedMemoryPrefault; }
+    void setSharedMemoryPrefault(bool enable) { m_sharedMemoryPrefault = enable; }
+
+    /// Back the segment with huge pages, transparent huge pages when none are reserved (default: false)
+    bool sharedMemoryHugePages() const { return m_sharedMemoryHugePages; }
+    void setSharedMemoryHugePages(bool enable) { m_sharedMemoryHugePages = enable; }
+
+    /// Preferred NUMA node of the segment (default: -1, no binding)
+    int sharedMemoryNumaNode() const { return m_sharedMemoryNumaNode; }
+    void setSharedMemoryNumaNode(int node) { m_sharedMemoryNumaNode = node; }
+
+    /// iShareMem::CreateOption flags matching the settings above
+    uint sharedMemoryOptions() const;
+
+    /// Call methods by interned 32-bit id once the server has bound the name (default: true)
+    /// @note Only used when the server advertises CAP_METHOD_ID; name-based calls remain the fallback
+    bool enableMethodIds() const { return m_enableMethodIds; }
+    void setEnableMethodIds(bool enable) { m_enableMethodIds = enable; }
+
+    /// Allow callMethods() to send several calls in one frame (default: true)
+    /// @note Only used when the server advertises CAP_METHOD_BATCH
+    bool enableMethodBatch() const { return m_enableMethodBatch; }
+    void setEnableMethodBatch(bool enable) { m_enableMethodBatch = enable; }
+
+    /// Drive TCP connections through io_uring instead of epoll (default: false)
+    /// @note Linux only; falls back to epoll when the kernel lacks multishot receive
+    bool enableIOUring() const { return m_enableIOUring; }
+    void setEnableIOUring(bool enable) { m_enableIOUring = enable; }
+
+    /// Register the stream socket edge-triggered, reads drain it in one go (default: false)
+    /// @note Needs the generic dispatcher on epoll or kqueue, otherwise stays level-triggered
+    bool enableEdgeTriggered() const { return m_enableEdgeTriggered; }
+    void setEnableEdgeTriggered(bool enable) { m_enableEdgeTriggered = enable; }
+
     // ===== Encryption Settings =====
 
     EncryptionMethod encryptionMethod() const { return m_encryptionMethod; }
@@ -120,6 +155,13 @@ private:
     xuint16 m_sharedMemoryType;
     xuint32 m_sharedMemorySize;
     iByteArray m_sharedMemoryName;
+    bool m_sharedMemoryPrefault;
+    bool m_sharedMemoryHugePages;
+    int m_sharedMemoryNumaNode;
+    bool m_enableMethodIds;
+    bool m_enableMethodBatch;
+    bool m_enableIOUring;
+    bool m_enableEdgeTriggered;
 
     // Encryption settings
     EncryptionMethod m_encryptionMethod;
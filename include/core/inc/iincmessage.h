@@ -38,7 +38,9 @@ enum iINCMessageType {
     INC_MSG_BINARY_DATA     = ((1 + 8) << 1),     ///< Binary data with optional SHM reference
     INC_MSG_BINARY_DATA_ACK = ((1 + 8) << 1) + 1, ///< Binary data with optional SHM reference acknowledgement
     INC_MSG_PING            = ((1 + 9) << 1),     ///< Keepalive ping
-    INC_MSG_PONG            = ((1 + 9) << 1) + 1  ///< Keepalive pong
+    INC_MSG_PONG            = ((1 + 9) << 1) + 1, ///< Keepalive pong
+    INC_MSG_METHOD_BIND     = ((1 + 10) << 1),    ///< Intern method name, reply carries its 32-bit id
+    INC_MSG_METHOD_BIND_ACK = ((1 + 10) << 1) + 1 ///< Method bind acknowledgement
 };
 
 /// @brief Message flags for binary data transfer
@@ -46,7 +48,9 @@ enum iINCMessageFlags {
     INC_MSG_FLAG_NONE       = 0x00,     ///< No special flags
     INC_MSG_FLAG_SHM_DATA   = 0x01,     ///< Payload contains SHM reference instead of data
     INC_MSG_FLAG_COMPRESSED = 0x02,     ///< Payload is compressed (future use)
-    INC_MSG_FLAG_NOACK      = 0x04      ///< Fire-and-forget message; receiver must not reply
+    INC_MSG_FLAG_NOACK      = 0x04,     ///< Fire-and-forget message; receiver must not reply
+    INC_MSG_FLAG_METHOD_ID  = 0x08,     ///< METHOD_CALL carries an interned method id instead of its name
+    INC_MSG_FLAG_BATCH      = 0x10      ///< METHOD_CALL/METHOD_REPLY carries a batch of calls/results
 };
 
 /// @brief Message header structure (32 bytes, fixed size)
@@ -65,6 +69,7 @@ struct iINCMessageHeader {
     /// Magic number for INC messages: "INC\0"
     static const xuint32 MAGIC;
     static const xint32 MAX_MESSAGE_SIZE;
+    static const xuint32 MAX_BATCH_CALLS;     ///< Upper bound of calls in one INC_MSG_FLAG_BATCH frame
 };
 #pragma pack(pop)
 
@@ -25,11 +25,13 @@
 #include <core/thread/ithread.h>
 #include <core/utils/ibytearray.h>
 #include <core/utils/istring.h>
+#include <core/utils/ihashfunctions.h>
 #include <core/io/imemblock.h>
 
 namespace iShell {
 
 class iINCEngine;
+class iINCPoolCache;
 class iINCDevice;
 class iINCServer;
 
@@ -130,6 +132,18 @@ protected:
     ///       2. Return empty iByteArray immediately
     ///       3. When done, call sendMethodReply(conn, seqNum, result)
     virtual void handleMethod(iINCConnection* conn, xuint32 seqNum, const iString& method, xuint16 version, const iByteArray& args) = 0;
+
+    /// Dedicated handler for one method, dispatched by interned id in O(1)
+    typedef void (*MethodHandler)(iINCServer* server, iINCConnection* conn, xuint32 seqNum, xuint16 version, const iByteArray& args, void* userData);
+
+    /// Intern a method name and optionally attach a dedicated handler
+    /// @param method Method name
+    /// @param handler Handler to call instead of handleMethod() (IX_NULLPTR keeps handleMethod())
+    /// @param userData User data passed to handler
+    /// @return Interned method id (stable for the server lifetime), 0 on failure
+    /// @note Must be called before listenOn(); clients bind further names on demand
+    xuint32 registerMethod(const iStringView& method, MethodHandler handler, void* userData = IX_NULLPTR);
+
     void sendMethodReply(iINCConnection* conn, xuint32 seqNum, xint32 errorCode, const iByteArray& result);
 
     /// Override this to handle binary data received from a client on a channel
@@ -175,6 +189,12 @@ private:
     void onClientDisconnected(iINCConnection* conn);
     void handleHandshake(iINCConnection* conn, const iINCMessage& msg);
     void handleMethodCall(iINCConnection* conn, const iINCMessage& msg);
+    void handleMethodBatch(iINCConnection* conn, const iINCMessage& msg);
+    void dispatchMethod(iINCConnection* conn, xuint32 seqNum, xuint16 version, bool byId, xuint32 methodId, const iString& method, const iByteArray& args);
+    void runMethodBatch(xuint64 key);
+    bool recordBatchReply(iINCConnection* conn, xuint32 seqNum, xint32 errorCode, const iByteArray& result);
+    void handleMethodBind(iINCConnection* conn, const iINCMessage& msg);
+    xuint32 internMethod(const iString& method);
     void handleStreamOpen(iINCConnection* conn, const iINCMessage& msg);
     void handleStreamClose(iINCConnection* conn, const iINCMessage& msg);
     void handleSubscribeRequest(iINCConnection* conn, const iINCMessage& msg);
@@ -197,7 +217,53 @@ private:
     #endif
     ConnectionMap m_connections;  ///< work in ioThread
 
+    // Registered methods: id N lives at m_methodTable[N - 1]. Names bound by a
+    // client but never registered are interned per connection instead.
+    struct MethodEntry {
+        iString         name;
+        MethodHandler   handler;
+        void*           userData;
+    };
+    #if __cplusplus >= 201103L
+    typedef std::unordered_map<iString, xuint32, iKeyHashFunc> MethodIdMap;
+    #else
+    typedef std::map<iString, xuint32> MethodIdMap;
+    #endif
+    std::vector<MethodEntry> m_methodTable;   ///< read-only after listenOn()
+    MethodIdMap     m_methodIds;              ///< name -> id
+
+    // Batched METHOD_CALL frames, keyed by (connection id << 32 | sequence number).
+    // Calls run strictly in order, the next one is dispatched once the previous replied.
+    struct MethodBatch {
+        struct Call {
+            xuint16     version;
+            bool        byId;
+            xuint32     methodId;
+            iString     method;
+            iByteArray  args;
+        };
+
+        iINCConnection*     conn;
+        std::vector<Call>   calls;
+        iINCMessage         reply;      ///< aggregated METHOD_REPLY, filled as results arrive
+        xuint32             dispatched; ///< calls handed to handlers
+        xuint32             replied;    ///< results recorded
+        bool                running;    ///< runMethodBatch() active or queued on the IO thread
+
+        MethodBatch(iINCConnection* c, xuint32 seqNum)
+            : conn(c), reply(INC_MSG_METHOD_REPLY, c->connectionId(), seqNum)
+            , dispatched(0), replied(0), running(false) { reply.setFlags(INC_MSG_FLAG_BATCH); }
+    };
+    #if __cplusplus >= 201103L
+    typedef std::unordered_map<xuint64, MethodBatch*> MethodBatchMap;
+    #else
+    typedef std::map<xuint64, MethodBatch*> MethodBatchMap;
+    #endif
+    iMutex          m_batchLock;              ///< IO thread vs. async repliers
+    MethodBatchMap  m_methodBatches;
+
     iSharedDataPointer<iMemPool> m_globalPool;
+    iINCPoolCache*  m_poolCache;              ///< per-client segments, work in ioThread
 
     friend class _iINCPStream;
     IX_DISABLE_COPY(iINCServer)
@@ -81,6 +81,44 @@ public:
     iByteArray sharedMemoryName() const { return m_sharedMemoryName; }
     void setSharedMemoryName(const iByteArray& name) { m_sharedMemoryName = name; }
 
+    /// Idle per-client segments kept for reuse by reconnecting clients (default: 4, 0 = disabled)
+    int sharedMemoryCacheSize() const { return m_sharedMemoryCacheSize; }
+    void setSharedMemoryCacheSize(int count) { m_sharedMemoryCacheSize = count; }
+
+    /// Pre-fault per-client segments when they are created or reused (default: false)
+    bool sharedMemoryPrefault() const { return m_sharedMemoryPrefault; }
+    void setSharedMemoryPrefault(bool enable) { m_sharedMemoryPrefault = enable; }
+
+    /// Back segments with huge pages, transparent huge pages when none are reserved (default: false)
+    bool sharedMemoryHugePages() const { return m_sharedMemoryHugePages; }
+    void setSharedMemoryHugePages(bool enable) { m_sharedMemoryHugePages = enable; }
+
+    /// Preferred NUMA node of the segments (default: -1, no binding)
+    int sharedMemoryNumaNode() const { return m_sharedMemoryNumaNode; }
+    void setSharedMemoryNumaNode(int node) { m_sharedMemoryNumaNode = node; }
+
+    /// iShareMem::CreateOption flags matching the settings above
+    uint sharedMemoryOptions() const;
+
+    // ===== Method Dispatch =====
+    /// Advertise CAP_METHOD_ID and accept METHOD_BIND requests (default: true)
+    bool enableMethodIds() const { return m_enableMethodIds; }
+    void setEnableMethodIds(bool enable) { m_enableMethodIds = enable; }
+
+    /// Advertise CAP_METHOD_BATCH and execute batched METHOD_CALL frames (default: true)
+    bool enableMethodBatch() const { return m_enableMethodBatch; }
+    void setEnableMethodBatch(bool enable) { m_enableMethodBatch = enable; }
+
+    /// Serve TCP connections through io_uring instead of epoll (default: false)
+    /// @note Linux only; falls back to epoll when the kernel lacks multishot receive
+    bool enableIOUring() const { return m_enableIOUring; }
+    void setEnableIOUring(bool enable) { m_enableIOUring = enable; }
+
+    /// Register stream sockets edge-triggered, reads drain them in one go (default: false)
+    /// @note Needs the generic dispatcher on epoll or kqueue, otherwise stays level-triggered
+    bool enableEdgeTriggered() const { return m_enableEdgeTriggered; }
+    void setEnableEdgeTriggered(bool enable) { m_enableEdgeTriggered = enable; }
+
     // ===== Security =====
     EncryptionRequirement encryptionRequirement() const { return m_encryptionRequirement; }
     void setEncryptionRequirement(EncryptionRequirement req) { m_encryptionRequirement = req; }
@@ -129,6 +167,16 @@ private:
     xuint16 m_sharedMemoryType;
     xuint32 m_sharedMemorySize;  // 4 MB
     iByteArray m_sharedMemoryName;  // Default shared memory name
+    int m_sharedMemoryCacheSize;
+    bool m_sharedMemoryPrefault;
+    bool m_sharedMemoryHugePages;
+    int m_sharedMemoryNumaNode;
+
+    // Method dispatch
+    bool m_enableMethodIds;
+    bool m_enableMethodBatch;
+    bool m_enableIOUring;
+    bool m_enableEdgeTriggered;
 
     // Security
     EncryptionRequirement m_encryptionRequirement;
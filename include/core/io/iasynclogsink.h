@@ -0,0 +1,58 @@
+/////////////////////////////////////////////////////////////////
+/// Copyright 2018-2020
+/// All rights reserved.
+/////////////////////////////////////////////////////////////////
+/// @file    iasynclogsink.h
+/// @brief   log target writing from a background thread
+/// @version 1.0
+/// @author  ncjiakechong@gmail.com
+/////////////////////////////////////////////////////////////////
+#ifndef IASYNCLOGSINK_H
+#define IASYNCLOGSINK_H
+
+#include <core/io/ilog.h>
+
+namespace iShell {
+
+/// @brief Moves log output off the logging threads
+/// @details Once installed, a log line is formatted into a slot of a bounded lock-free ring by
+///          the thread that logs it, and a writer thread drains the ring with one writev() per
+///          batch. When the ring is full a line is either dropped or the logging thread waits
+///          for room, as the OverflowPolicy says; both are counted.
+///          Filtering and thresholds stay with the target that was installed before.
+///          Queued lines are written at exit() and, from the signal handler, when the process
+///          crashes on SIGSEGV, SIGBUS, SIGILL, SIGFPE or SIGABRT.
+class IX_CORE_EXPORT iAsyncLogSink
+{
+public:
+    enum OverflowPolicy {
+        DropNewest,     ///< lose the line that does not fit
+        Block           ///< wait for the writer to make room
+    };
+
+    struct Stats {
+        xint64 written;     ///< lines handed to the descriptor
+        xint64 dropped;     ///< lines lost to a full ring
+        xint64 blocked;     ///< times a logging thread waited for room
+        xint64 batches;     ///< writev() calls
+    };
+
+    /// @param fd where lines go, stays owned by the caller
+    /// @param records ring slots, rounded up to a power of two
+    /// @return false if already installed
+    static bool install(int fd = 1, int records = 4096, OverflowPolicy policy = DropNewest);
+    /// Writes what is queued, stops the writer and puts the previous target back
+    static void uninstall();
+    static bool isInstalled();
+
+    /// Blocks until every line queued before the call is written
+    static void flush();
+    static Stats stats();
+
+private:
+    iAsyncLogSink();
+};
+
+} // namespace iShell
+
+#endif // IASYNCLOGSINK_H
@@ -0,0 +1,154 @@
+/////////////////////////////////////////////////////////////////
+/// Copyright 2018-2020
+/// All rights reserved.
+/////////////////////////////////////////////////////////////////
+/// @file    ibinarylog.h
+/// @brief   compact binary log records, rendered to text offline
+/// @version 1.0
+/// @author  ncjiakechong@gmail.com
+/////////////////////////////////////////////////////////////////
+#ifndef IBINARYLOG_H
+#define IBINARYLOG_H
+
+#include <string>
+
+#include <core/io/ilog.h>
+#include <core/thread/iatomiccounter.h>
+
+/* Same filtering as ilog_*: while a binary log is open the arguments are stored raw,
+ * otherwise the line goes to the text target. */
+#ifdef IX_HAVE_CXX11
+#define ILOG_TRACE_CALL(level, ...) \
+    do { \
+        if (((level) <= ILOG_MIN_LEVEL) && iShell::iLogger::isEnabled(ILOG_TAG, level)) { \
+            static iShell::iBinaryLogSite ix_log_site = {ILOG_TAG, __FILE__, __FUNCTION__, __LINE__, level, 0, 0}; \
+            if (iShell::iBinaryLog::isActive()) \
+                iShell::iBinaryLog::record(&ix_log_site, __VA_ARGS__); \
+            else \
+                iShell::iLogMeta(ILOG_TAG, level, __FILE__, __FUNCTION__, __LINE__, __VA_ARGS__); \
+        } \
+    } while (0)
+#else
+#define ILOG_TRACE_CALL(level, ...) ILOG_META_CALL(level, __VA_ARGS__)
+#endif
+
+#define ilog_trace_verbose(...) ILOG_TRACE_CALL(iShell::ILOG_VERBOSE, __VA_ARGS__)
+#define ilog_trace_debug(...)   ILOG_TRACE_CALL(iShell::ILOG_DEBUG, __VA_ARGS__)
+#define ilog_trace_info(...)    ILOG_TRACE_CALL(iShell::ILOG_INFO, __VA_ARGS__)
+#define ilog_trace_notice(...)  ILOG_TRACE_CALL(iShell::ILOG_NOTICE, __VA_ARGS__)
+#define ilog_trace_warn(...)    ILOG_TRACE_CALL(iShell::ILOG_WARN, __VA_ARGS__)
+#define ilog_trace_error(...)   ILOG_TRACE_CALL(iShell::ILOG_ERROR, __VA_ARGS__)
+
+namespace iShell {
+
+/// One log statement: written to the stream once, records refer to it by id.
+/// An aggregate, so that the static one of each statement needs no guard.
+struct iBinaryLogSite
+{
+    const char* tag;
+    const char* file;
+    const char* function;
+    int line;
+    iLogLevel level;
+
+    int id;                 ///< assigned under the log lock
+    int generation;         ///< log file the site was last written to, published after id
+};
+
+/// Arguments of one record, encoded with a type tag each
+class IX_CORE_EXPORT iBinaryLogRecord
+{
+public:
+    explicit iBinaryLogRecord(iBinaryLogSite* site);
+    ~iBinaryLogRecord();
+
+    void append(bool value);
+    void append(char value);
+    void append(unsigned char value);
+    void append(long long value);
+    void append(unsigned long long value);
+    void appendHex(unsigned long long value);
+    void append(double value);
+    void append(const void* value);
+    void append(const char* value, int size);
+
+private:
+    bool reserve(int size);
+    void putVarint(unsigned long long value);
+
+    iBinaryLogSite* m_site;
+    xint64 m_timestamp;
+    int m_len;
+    char m_buf[512];
+
+    IX_DISABLE_COPY(iBinaryLogRecord)
+};
+
+IX_CORE_EXPORT iBinaryLogRecord& operator<<(iBinaryLogRecord&, bool);
+IX_CORE_EXPORT iBinaryLogRecord& operator<<(iBinaryLogRecord&, char);
+IX_CORE_EXPORT iBinaryLogRecord& operator<<(iBinaryLogRecord&, unsigned char);
+IX_CORE_EXPORT iBinaryLogRecord& operator<<(iBinaryLogRecord&, short);
+IX_CORE_EXPORT iBinaryLogRecord& operator<<(iBinaryLogRecord&, unsigned short);
+IX_CORE_EXPORT iBinaryLogRecord& operator<<(iBinaryLogRecord&, int);
+IX_CORE_EXPORT iBinaryLogRecord& operator<<(iBinaryLogRecord&, unsigned int);
+IX_CORE_EXPORT iBinaryLogRecord& operator<<(iBinaryLogRecord&, long);
+IX_CORE_EXPORT iBinaryLogRecord& operator<<(iBinaryLogRecord&, unsigned long);
+IX_CORE_EXPORT iBinaryLogRecord& operator<<(iBinaryLogRecord&, long long);
+IX_CORE_EXPORT iBinaryLogRecord& operator<<(iBinaryLogRecord&, unsigned long long);
+IX_CORE_EXPORT iBinaryLogRecord& operator<<(iBinaryLogRecord&, iHexUInt8);
+IX_CORE_EXPORT iBinaryLogRecord& operator<<(iBinaryLogRecord&, iHexUInt16);
+IX_CORE_EXPORT iBinaryLogRecord& operator<<(iBinaryLogRecord&, iHexUInt32);
+IX_CORE_EXPORT iBinaryLogRecord& operator<<(iBinaryLogRecord&, iHexUInt64);
+IX_CORE_EXPORT iBinaryLogRecord& operator<<(iBinaryLogRecord&, float);
+IX_CORE_EXPORT iBinaryLogRecord& operator<<(iBinaryLogRecord&, double);
+IX_CORE_EXPORT iBinaryLogRecord& operator<<(iBinaryLogRecord&, const char*);
+IX_CORE_EXPORT iBinaryLogRecord& operator<<(iBinaryLogRecord&, const std::string&);
+IX_CORE_EXPORT iBinaryLogRecord& operator<<(iBinaryLogRecord&, const iString&);
+IX_CORE_EXPORT iBinaryLogRecord& operator<<(iBinaryLogRecord&, const iStringView&);
+IX_CORE_EXPORT iBinaryLogRecord& operator<<(iBinaryLogRecord&, const iLatin1StringView&);
+IX_CORE_EXPORT iBinaryLogRecord& operator<<(iBinaryLogRecord&, const void*);
+
+/// @brief Binary log file: call sites are stored once, records keep their arguments raw
+/// @details ilog_trace_* statements skip text formatting altogether while a log is open:
+///          a record is the site id, a timestamp, the thread id and the arguments with a
+///          type tag each. decode(), or the ilogdecode tool, renders the file to the lines
+///          the default target would have printed.
+///          Each thread collects its records in a buffer of its own, handed to the file when
+///          full, by flush() and close(), and when the thread exits; records of different
+///          threads are therefore grouped per thread rather than strictly in time order.
+class IX_CORE_EXPORT iBinaryLog
+{
+public:
+    /// Truncates path and starts writing to it, false if it cannot be opened
+    static bool open(const char* path);
+    static void close();
+    static void flush();
+    static inline bool isActive() { return 0 != s_active.value(); }
+
+    /// Bytes written to the current file, buffered ones included, 0 when none is open
+    static xint64 size();
+
+    /// Renders a binary log as text to outFd, a record cut short at the end is skipped
+    /// @return records decoded, -1 if path is not a binary log or is corrupt
+    static xint64 decode(const char* path, int outFd);
+
+#ifdef IX_HAVE_CXX11
+    template<typename... Args>
+    static void record(iBinaryLogSite* site, const Args&... args) {
+        iBinaryLogRecord rec(site);
+        int expand[] = {0, ((void)(rec << args), 0)...};
+        IX_UNUSED(expand);
+    }
+#endif
+
+private:
+    static void commit(iBinaryLogSite* site, xint64 timestamp, const char* args, int size);
+
+    static iAtomicCounter<int> s_active;
+
+    friend class iBinaryLogRecord;
+};
+
+} // namespace iShell
+
+#endif // IBINARYLOG_H
@@ -16,6 +16,7 @@
 #ifndef IIODEVICE_H
 #define IIODEVICE_H
 
+#include <list>
 #include <map>
 #include <memory>
 #if __cplusplus >= 201103L
@@ -72,7 +73,7 @@ public:
     virtual void close();
 
     xint64 pos() const { return m_pos; }
-    bool seek(xint64 pos);
+    virtual bool seek(xint64 pos);
     virtual xint64 size() const;
     virtual bool atEnd() const;
     virtual bool reset();
@@ -98,6 +99,10 @@ public:
     iByteArray peek(xint64 maxlen, xint64* readErr = IX_NULLPTR);
     xint64 skip(xint64 maxSize);
 
+    xint64 readChunks(std::list<iByteArray>& chunks, xint64 maxSize);
+    xint64 peekChunks(std::list<iByteArray>& chunks, xint64 maxSize);
+    xint64 writeChunks(const std::list<iByteArray>& chunks);
+
     virtual bool waitForReadyRead(int msecs);
     virtual bool waitForBytesWritten(int msecs);
 
@@ -151,6 +156,7 @@ protected:
     virtual iByteArray readData(xint64 maxlen, xint64* readErr) = 0;
     virtual iByteArray readLineData(xint64 maxlen, xint64* readErr);
     virtual xint64 writeData(const iByteArray& data) = 0;
+    virtual xint64 writeChunksData(const std::list<iByteArray>& chunks);
     virtual xint64 skipData(xint64 maxSize);
 
     void setOpenMode(OpenMode openMode);
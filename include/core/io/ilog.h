@@ -16,21 +16,37 @@
 #include <core/global/iglobal.h>
 #include <core/global/imacro.h>
 #include <core/utils/istring.h>
+#include <core/thread/iatomiccounter.h>
+#include <core/thread/iatomicpointer.h>
+
+/* Least severe level compiled in: 0 keeps errors only, 5 keeps everything.
+ * Calls above it are dead code, arguments included. */
+#ifndef ILOG_MIN_LEVEL
+#define ILOG_MIN_LEVEL 5
+#endif
+
+/* Arguments are only evaluated once the tag and level passed the filter */
+#define ILOG_META_CALL(level, ...) \
+    ((((level) > ILOG_MIN_LEVEL) || !iShell::iLogger::isEnabled(ILOG_TAG, level)) ? (void) 0 \
+        : iShell::iLogMeta(ILOG_TAG, level, __FILE__, __FUNCTION__, __LINE__, __VA_ARGS__))
+#define ILOG_DATA_CALL(level, ...) \
+    ((((level) > ILOG_MIN_LEVEL) || !iShell::iLogger::isEnabled(ILOG_TAG, level)) ? (void) 0 \
+        : iShell::iLogger::binaryData(ILOG_TAG, level, __FILE__, __FUNCTION__, __LINE__, __VA_ARGS__))
 
 /* ISO varargs available */
-#define ilog_verbose(...) iShell::iLogMeta(ILOG_TAG, iShell::ILOG_VERBOSE, __FILE__, __FUNCTION__, __LINE__, __VA_ARGS__)
-#define ilog_debug(...)   iShell::iLogMeta(ILOG_TAG, iShell::ILOG_DEBUG, __FILE__, __FUNCTION__, __LINE__, __VA_ARGS__)
-#define ilog_info(...)    iShell::iLogMeta(ILOG_TAG, iShell::ILOG_INFO, __FILE__, __FUNCTION__, __LINE__, __VA_ARGS__)
-#define ilog_notice(...)  iShell::iLogMeta(ILOG_TAG, iShell::ILOG_NOTICE, __FILE__, __FUNCTION__, __LINE__, __VA_ARGS__)
-#define ilog_warn(...)    iShell::iLogMeta(ILOG_TAG, iShell::ILOG_WARN, __FILE__, __FUNCTION__, __LINE__, __VA_ARGS__)
-#define ilog_error(...)   iShell::iLogMeta(ILOG_TAG, iShell::ILOG_ERROR, __FILE__, __FUNCTION__, __LINE__, __VA_ARGS__)
-
-#define ilog_data_verbose(...) iShell::iLogger::binaryData(ILOG_TAG, iShell::ILOG_VERBOSE, __FILE__, __FUNCTION__, __LINE__, __VA_ARGS__)
-#define ilog_data_debug(...)   iShell::iLogger::binaryData(ILOG_TAG, iShell::ILOG_DEBUG, __FILE__, __FUNCTION__, __LINE__, __VA_ARGS__)
-#define ilog_data_info(...)    iShell::iLogger::binaryData(ILOG_TAG, iShell::ILOG_INFO, __FILE__, __FUNCTION__, __LINE__, __VA_ARGS__)
-#define ilog_data_notice(...)  iShell::iLogger::binaryData(ILOG_TAG, iShell::ILOG_NOTICE, __FILE__, __FUNCTION__, __LINE__, __VA_ARGS__)
-#define ilog_data_warn(...)    iShell::iLogger::binaryData(ILOG_TAG, iShell::ILOG_WARN, __FILE__, __FUNCTION__, __LINE__, __VA_ARGS__)
-#define ilog_data_error(...)   iShell::iLogger::binaryData(ILOG_TAG, iShell::ILOG_ERROR, __FILE__, __FUNCTION__, __LINE__, __VA_ARGS__)
+#define ilog_verbose(...) ILOG_META_CALL(iShell::ILOG_VERBOSE, __VA_ARGS__)
+#define ilog_debug(...)   ILOG_META_CALL(iShell::ILOG_DEBUG, __VA_ARGS__)
+#define ilog_info(...)    ILOG_META_CALL(iShell::ILOG_INFO, __VA_ARGS__)
+#define ilog_notice(...)  ILOG_META_CALL(iShell::ILOG_NOTICE, __VA_ARGS__)
+#define ilog_warn(...)    ILOG_META_CALL(iShell::ILOG_WARN, __VA_ARGS__)
+#define ilog_error(...)   ILOG_META_CALL(iShell::ILOG_ERROR, __VA_ARGS__)
+
+#define ilog_data_verbose(...) ILOG_DATA_CALL(iShell::ILOG_VERBOSE, __VA_ARGS__)
+#define ilog_data_debug(...)   ILOG_DATA_CALL(iShell::ILOG_DEBUG, __VA_ARGS__)
+#define ilog_data_info(...)    ILOG_DATA_CALL(iShell::ILOG_INFO, __VA_ARGS__)
+#define ilog_data_notice(...)  ILOG_DATA_CALL(iShell::ILOG_NOTICE, __VA_ARGS__)
+#define ilog_data_warn(...)    ILOG_DATA_CALL(iShell::ILOG_WARN, __VA_ARGS__)
+#define ilog_data_error(...)   ILOG_DATA_CALL(iShell::ILOG_ERROR, __VA_ARGS__)
 
 namespace iShell {
 
@@ -76,15 +92,39 @@ struct iHexUInt64 {
 
 class IX_CORE_EXPORT iLogger {
  public:
-    /* Set a log target. */
+    /// Set a log target. The target is published as a whole, and the call returns once no
+    /// thread is inside a callback of the previous one, so its user_data may be freed then.
+    /// @note Must not be called from inside a target callback
     static iLogTarget setDefaultTarget(const iLogTarget& target);
+    static iLogTarget defaultTarget();
     static void setThreshold(const char* patterns, bool reset);
 
+    /// Answers like the target's filter, from a per-tag cache of the least severe enabled level.
+    /// Assumes a tag enabled at some level is enabled at every more severe one. The cache is
+    /// dropped by setDefaultTarget() and setThreshold(), a target whose filter changes on its
+    /// own calls invalidateFilterCache().
+    static inline bool isEnabled(const char* tag, iLogLevel level) {
+        const TagSlot& slot = s_tagCache[tagSlot(tag)];
+        const int state = slot.state;
+        if ((slot.tag.load() != tag) || (slot.state != state) || ((state >> 4) != s_generation))
+            return level <= cachedThreshold(tag);
+
+        return level < (state & 0xF);
+    }
+    static void invalidateFilterCache();
+
     static void asprintf(const char* tag, iLogLevel level, const char* file, const char* function, int line,
                          const char *format, ...) IX_GCC_PRINTF_ATTR(6, 7);
     static void binaryData(const char* tag, iLogLevel level, const char* file, const char* function, int line,
                            const void* data, int size);
 
+    /// The line header of the default target, "HH:MM:SS:mmm pid tid tag:L file:line:function"
+    /// @return length written, at most size - 1
+    static int formatHeader(char* buf, int size, const char* tag, iLogLevel level, const char* file, const char* function, int line);
+    /// The preview of binary data of the default target, the first and last bytes in hex
+    /// @return length written, at most size - 1
+    static int formatData(char* buf, int size, const void* data, int dataSize);
+
     iLogger();
     ~iLogger();
 
@@ -168,7 +208,21 @@ class IX_CORE_EXPORT iLogger {
     int m_line;
     iByteArray m_buff;
 
-    static iLogTarget s_target;
+    /// state is generation << 4 | (threshold + 1), -1 while being written
+    struct TagSlot {
+        iAtomicPointer<const char> tag;
+        iAtomicCounter<int> state;
+    };
+    enum { TagSlots = 64 };
+
+    static inline int tagSlot(const char* tag) {
+        const xuintptr key = reinterpret_cast<xuintptr>(tag);
+        return static_cast<int>((key ^ (key >> 7)) & (TagSlots - 1));
+    }
+    static int cachedThreshold(const char* tag);
+
+    static iAtomicCounter<int> s_generation;
+    static TagSlot s_tagCache[TagSlots];
 };
 
 IX_CORE_EXPORT iLogger& operator<<(iLogger&, bool);
@@ -0,0 +1,80 @@
+/////////////////////////////////////////////////////////////////
+/// Copyright 2018-2020
+/// All rights reserved.
+/////////////////////////////////////////////////////////////////
+/// @file    imappedfile.h
+/// @brief   read-only file device backed by a memory mapping
+/// @version 1.0
+/// @author  ncjiakechong@gmail.com
+/////////////////////////////////////////////////////////////////
+#ifndef IMAPPEDFILE_H
+#define IMAPPEDFILE_H
+
+#include <core/io/iiodevice.h>
+#include <core/utils/istring.h>
+
+namespace iShell {
+
+struct iFileMapping;
+
+/// @brief Random-access file device whose reads are slices of one mmap() of the file
+/// @details read() and peek() hand out iByteArray views of the mapping through
+///          iMemBlock::new4User(), no data is copied. A slice keeps the mapping alive
+///          after close() or destruction of the device. Slices are read-only, modifying
+///          one detaches it into a private copy. Positions and sizes are 64-bit, so files
+///          above 4 GB work wherever the address space can hold the mapping.
+/// @note Writing is not supported, open() fails for WriteOnly modes. The device is always
+///       opened Unbuffered: a read already is a view, buffering it would only add a queue hop.
+class IX_CORE_EXPORT iMappedFile : public iIODevice
+{
+    IX_OBJECT(iMappedFile)
+public:
+    /// Expected access pattern, passed to the kernel with madvise()
+    enum AccessHint {
+        NormalAccess,       ///< default readahead
+        SequentialAccess,   ///< aggressive readahead, reads also prefetch the range ahead of them
+        RandomAccess        ///< no readahead
+    };
+
+    explicit iMappedFile(iObject* parent = IX_NULLPTR);
+    explicit iMappedFile(const iString& name, iObject* parent = IX_NULLPTR);
+    virtual ~iMappedFile();
+
+    iString fileName() const { return m_fileName; }
+    /// Takes effect on the next open()
+    void setFileName(const iString& name);
+
+    /// Maps the whole file, only ReadOnly is supported
+    virtual bool open(OpenMode mode) IX_OVERRIDE;
+    virtual void close() IX_OVERRIDE;
+
+    virtual xint64 size() const IX_OVERRIDE;
+    virtual bool seek(xint64 pos) IX_OVERRIDE;
+
+    AccessHint accessHint() const { return m_accessHint; }
+    /// Can be changed while open, applies to the whole mapping
+    void setAccessHint(AccessHint hint);
+
+    /// Asks the kernel to read a range ahead of use (MADV_WILLNEED)
+    /// @return false if the device is not open or the range is outside the file
+    bool willNeed(xint64 offset, xint64 length);
+
+protected:
+    virtual iByteArray readData(xint64 maxlen, xint64* readErr) IX_OVERRIDE;
+    virtual xint64 writeData(const iByteArray& data) IX_OVERRIDE;
+
+private:
+    void applyAccessHint();
+
+    iString m_fileName;
+    iFileMapping* m_mapping;
+    xint64 m_filePos;
+    xint64 m_prefetchedEnd;     ///< end of the last SequentialAccess prefetch
+    AccessHint m_accessHint;
+
+    IX_DISABLE_COPY(iMappedFile)
+};
+
+} // namespace iShell
+
+#endif // IMAPPEDFILE_H
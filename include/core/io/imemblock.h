@@ -82,6 +82,11 @@ public:
     /// Reallocate the memory block of type MEMBLOCK_APPENDED
     static iMemBlock* reallocate(iMemBlock* block, size_t elementCount, size_t elementSize = 1, ArrayOptions options = DefaultAllocationFlags);
 
+    /// Serve small MEMBLOCK_APPENDED blocks from thread-local size-class caches instead of malloc.
+    /// Off by default, only available when built with IX_ENABLE_ARRAY_ARENA
+    static void setArenaEnabled(bool enabled);
+    static bool isArenaEnabled();
+
     inline bool isOurs() const { return m_type != MEMBLOCK_IMPORTED; }
     inline bool isReadOnly() const { return m_readOnly || (count() > 1); }
     inline bool isShared() const { return count() != 1; }
@@ -150,6 +155,7 @@ private:
 
     bool m_readOnly:1;
     bool m_isSilence:1;
+    xuint8 m_arenaClass;    ///< MEMBLOCK_APPENDED: 1 + arena size class, 0 for malloc
 
     Type m_type;
     ArrayOptions m_options;
@@ -180,6 +186,7 @@ private:
     friend class iMemImport;
     friend class iMemExport;
     friend class iMemDataWrapper;
+    friend class iMemTracker;
     IX_DISABLE_COPY(iMemBlock)
 };
 
@@ -205,15 +212,36 @@ public:
 
         int nTooLargeForPool;
         int nPoolFull;
+        int nClassFallback;     ///< slots served from a larger size class
+        int nMagazineHits;      ///< slots served from the calling thread's magazine
+        int nMagazineMisses;    ///< magazine refills from the shared free lists
+        int nReclaimed;         ///< free slots whose pages were handed back to the kernel
+        xint64 reclaimedSize;   ///< bytes handed back by trim() and vacuum()
 
         int nAllocatedByType[iMemBlock::MEMBLOCK_TYPE_MAX];
         int nAccumulatedByType[iMemBlock::MEMBLOCK_TYPE_MAX];
     };
 
-    static iMemPool* create(const char* name, const char* prefix, MemType type, size_t size, bool perClient);
+    /// @param shmOptions iShareMem::CreateOption flags of the segment
+    /// @param numaNode Preferred NUMA node of the segment, -1 for the default policy
+    static iMemPool* create(const char* name, const char* prefix, MemType type, size_t size, bool perClient, uint shmOptions = 0, int numaNode = -1);
 
     inline const Stat& getStat() const { return m_stat; }
+    /// Hands the pages of every free slot back to the kernel, same as trim(0, -1), and zeroes
+    /// what could not be handed back: slots below the page size, the partial pages at the
+    /// edges of punched slots and the slots parked in per-thread magazines. Afterwards no
+    /// free slot holds data of an earlier owner. Call it while no thread uses the pool.
     void vacuum();
+    /// Hands pages of free slots back to the kernel, largest size classes first
+    /// @param residentTarget stop once residentSize() is at or below it
+    /// @param maxBytes stop after reclaiming about this many bytes, one slot may overshoot
+    /// @return bytes reclaimed
+    /// @note Slots below the page size and slots parked in per-thread magazines are not reclaimed
+    size_t trim(size_t residentTarget, size_t maxBytes);
+    /// Estimated resident bytes: carved slots minus the reclaimed ones
+    size_t residentSize() const;
+    /// Fault in the whole segment ahead of use, e.g. after vacuum()
+    void populate();
     bool isShared() const;
     bool isMemfdBacked() const;
     inline bool isGlobal() const { return m_global; }
@@ -222,6 +250,10 @@ public:
     void setIsRemoteWritable(bool writable);
     size_t blockSizeMax() const;
 
+    /// Slot sizes carved from the segment, power-of-two multiples of the smallest one
+    inline int sizeClasses() const { return m_nClasses; }
+    inline size_t sizeClassSize(int idx) const { return m_classes[idx].size; }
+
     inline const char* name() const { return m_name; }
     inline size_t size() const { return m_memory ? m_memory->size() : 0; }
     inline int fd() const { return m_memory ? m_memory->fd() : -1; }
@@ -230,16 +262,56 @@ public:
 
 private:
     struct Slot;
+    struct Magazine;
+    struct ThreadCache;
     static iMemPool* fakeAdaptor();
 
     iMemPool(const char* prefix, iShareMem* memory, size_t block_size, xuint32 n_blocks, bool perClient);
     virtual ~iMemPool();
 
-    Slot* allocateSlot();
+    Slot* allocateSlot(size_t size);
+    void freeSlot(Slot* slot);
+    Slot* carveSlot(int sizeClass);
+    Slot* popFreeSlot(int sizeClass);
+    void scrubSlot(Slot* slot, size_t size, bool punched);
+    int sizeClassFor(size_t size) const;
+    inline size_t slotSizeMax() const { return m_nClasses > 0 ? m_classes[m_nClasses - 1].size : 0; }
     void* slotData(const Slot* slot);
     uint slotIdx(const void* ptr) const;
     Slot* slotByPtr(const void* ptr) const;
 
+    Magazine* magazine();
+    Magazine* attachMagazine(ThreadCache* cache);
+    void drainMagazine(Magazine* mag);
+    static void foldMagazineStat(Magazine* mag);
+    static ThreadCache* threadCache();
+
+    enum {
+        SizeClassesMax = 24,
+        SizeClassFallback = 2,  ///< larger classes tried when a class is exhausted
+        MagazineSize = 32,      ///< slots a thread keeps per size class
+        MagazineBatch = 16,     ///< slots moved at once between a magazine and its free list
+        MagazinePools = 4       ///< pools a thread keeps magazines for
+    };
+
+    /// Slots of one size. Classes below m_blockSize split a segment block into
+    /// several slots, larger ones span consecutive segment blocks.
+    struct SizeClass {
+        size_t size;
+        iFreeList<Slot*> freeSlots;
+        iFreeList<Slot*> reclaimedSlots;    ///< free slots whose pages were punched, used after freeSlots
+        iAtomicCounter<int> nSlots;     ///< slots carved so far, bounded by the free list
+        iAtomicCounter<int> nReclaimed; ///< slots in reclaimedSlots
+
+        SizeClass() : size(0), nSlots(0), nReclaimed(0) {}
+    };
+
+    /// Owner of each segment block, assigned when the block is carved
+    struct BlockInfo {
+        xuint32 head;       ///< first segment block of the slot
+        xuint8 sizeClass;
+    };
+
     bool m_global;
     bool m_isRemoteWritable;
 
@@ -251,10 +323,16 @@ private:
     iMemImport* m_imports;
     iMemExport* m_exports;
 
-    /* A list of free slots that may be reused */
-    iFreeList<Slot*> m_freeSlots;
+    /* Free slots that may be reused, one list per size class */
+    SizeClass m_classes[SizeClassesMax];
+    int m_nClasses;
+    BlockInfo* m_blockInfo;
     iFreeList<void*> m_cacheHeads;
 
+    /* Per-thread slot caches of the classes up to m_blockSize, guarded by a global lock */
+    int m_nMagazineClasses;
+    Magazine* m_magazines;
+
     iAtomicCounter<int> m_nInit;
     iSemaphore m_semaphore;
     iMutex m_mutex;
@@ -327,24 +405,36 @@ public:
     int put(iMemBlock* block, MemType* type, uint* blockId, uint* shmId, int* memfd_fd, size_t* offset, size_t* size);
     int processRelease(uint id);
 
-private:
-    #define IMEMEXPORT_SLOTS_MAX 128
+    /// Exported blocks not released by the peer yet
+    inline int inUse() const { return m_inUse.value(); }
+    /// Highest inUse() seen since construction
+    inline int peakInUse() const { return m_peakInUse.value(); }
+    /// Maximum number of blocks in flight, the table grows on demand up to it
+    static int capacity();
 
+private:
     void revokeBlocks(iMemImport* i);
     iMemBlock* sharedCopy(iMemPool* p, iMemBlock* b) const;
 
+    /// Block ids are (generation << SlotIndexBits) | index, so a stale id never
+    /// releases the block that reuses its slot, and an id is never 0
+    enum {
+        SlotIndexBits = 12,
+        SlotIndexMask = (1 << SlotIndexBits) - 1
+    };
+
     struct Slot {
-        Slot* _next;
-        Slot* _prev;
-        iMemBlock* block;
+        iAtomicPointer<iMemBlock> block;
+        iAtomicCounter<uint> generation;
+
+        Slot() : block(IX_NULLPTR), generation(1) {}
     };
 
-    uint m_baseIdx;
-    xuint32 m_nInit;
-    Slot* m_freeSlots;
-    Slot* m_usedSlots;
+    iFreeList<Slot> m_slots;
+    iAtomicCounter<int> m_nInit;       ///< slots ever handed out, bounds the scans
+    iAtomicCounter<int> m_inUse;
+    iAtomicCounter<int> m_peakInUse;
 
-    iMutex m_mutex;
     iSharedDataPointer<iMemPool> m_pool;
 
     /* Called whenever a client from which we imported a memory block
@@ -356,8 +446,6 @@ private:
     iMemExport* _next;
     iMemExport* _prev;
 
-    Slot m_slots[IMEMEXPORT_SLOTS_MAX];
-
     friend class iMemBlock;
     friend class iMemImport;
     IX_DISABLE_COPY(iMemExport)
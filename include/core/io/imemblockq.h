@@ -16,6 +16,7 @@ namespace iShell {
 
 class iMCAlign;
 struct iMBQListItem;
+struct iMBQStaging;
 
 struct IX_CORE_EXPORT iBufferAttr
 {
@@ -131,6 +132,7 @@ public:
     ~iMemBlockQueue();
 
     /// Push a new memory chunk into the queue.
+    /// In single-producer/single-consumer mode the chunk is staged for the consumer
     xint64 push(const iByteArray& chunk);
 
     /// Push a new memory chunk into the queue, but filter it through a
@@ -256,11 +258,26 @@ public:
     /// Check whether we currently are in prebuf state
     bool preBufActive() const;
 
+    /// Let push() and pushAlign() run on one producer thread while the other calls run on
+    /// one consumer thread, without an external lock. Pushed chunks are staged in a lock-free
+    /// ring and appended at the write index by the consumer's next peek(), drop(),
+    /// popMissing() or collectStaged(); length() and the indexes only see collected chunks.
+    /// Switch it before both threads start.
+    void setSingleProducerSingleConsumer(bool enabled);
+    inline bool isSingleProducerSingleConsumer() const { return IX_NULLPTR != m_staging; }
+
+    /// Consumer side: move the chunks staged by the producer into the queue
+    void collectStaged();
+
 private:
     void fixCurrentRead();
     void fixCurrentWrite();
     void dropBlock(iMBQListItem *q);
+    iMBQListItem* newItem();
     bool canPush(size_t l);
+    bool canStage(size_t l) const;
+    xint64 pushChunk(const iByteArray& chunk, bool checkLength = true);
+    void publishLength();
     void dropBacklog();
     bool updatePreBuf();
 
@@ -272,6 +289,8 @@ private:
     iMBQListItem* m_currentRead;
     iMBQListItem* m_currentWrite;
     xuint8     m_nBlocks;
+    xuint8     m_nFreeItems;
+    iMBQListItem* m_freeItems;  ///< dropped items kept for reuse, linked through _next
     size_t     m_maxLength;
     size_t     m_tLength;
     size_t     m_base;
@@ -285,6 +304,7 @@ private:
     iMCAlign*  m_mcalign;
     xint64     m_missing;
     xint64     m_requested;
+    iMBQStaging* m_staging;     ///< only in single-producer/single-consumer mode
 
     iLatin1StringView m_name;
 
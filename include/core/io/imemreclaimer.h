@@ -0,0 +1,93 @@
+/////////////////////////////////////////////////////////////////
+/// Copyright 2018-2020
+/// All rights reserved.
+/////////////////////////////////////////////////////////////////
+/// @file    imemreclaimer.h
+/// @brief   background trimming of iMemPool segments
+/// @version 1.0
+/// @author  ncjiakechong@gmail.com
+/////////////////////////////////////////////////////////////////
+#ifndef IMEMRECLAIMER_H
+#define IMEMRECLAIMER_H
+
+#include <list>
+
+#include <core/io/imemblock.h>
+#include <core/kernel/ieventsource.h>
+
+namespace iShell {
+
+/// @brief Hands the memory of idle iMemPool segments back to the kernel, off the allocation path
+/// @details A low-priority event source. A pool whose allocation count did not move for
+///          idleInterval() and whose residentSize() grew past its high watermark (target plus
+///          a quarter) is trimmed down to its target, batchSize() bytes per dispatch. Between
+///          the two marks nothing happens, so a pool that keeps bouncing around its target
+///          is not punched and faulted in over and over.
+///          A memory pressure notification, a PSI trigger on /proc/pressure/memory or on a
+///          cgroup v2 memory.pressure file, trims every pool down to its target right away,
+///          idle or not.
+/// @note Not thread-safe, use it from the thread of the dispatcher it is attached to.
+///       The reclaimer holds a reference to each pool and drops it once nobody else does.
+class IX_CORE_EXPORT iMemReclaimer : public iEventSource
+{
+public:
+    explicit iMemReclaimer(int priority = IX_PRIORITY_LOW);
+
+    /// @param residentTarget resident bytes the pool is trimmed down to
+    void addPool(iMemPool* pool, size_t residentTarget = 0);
+    void removePool(iMemPool* pool);
+    size_t pools() const { return m_entries.size(); }
+
+    xint64 idleInterval() const { return m_idleInterval; }
+    /// Milliseconds without allocations before a pool counts as idle
+    void setIdleInterval(xint64 msecs);
+
+    size_t batchSize() const { return m_batchSize; }
+    void setBatchSize(size_t bytes);
+
+    /// Arms a PSI trigger: notified when tasks stall on memory for stallUs within windowUs
+    /// @return false if the kernel has no PSI support or refused the trigger
+    bool watchPressure(const char* path = "/proc/pressure/memory", int stallUs = 150000, int windowUs = 1000000);
+    bool isWatchingPressure() const { return m_pressureFd.fd >= 0; }
+    int pressureEvents() const { return m_pressureEvents; }
+
+    /// Bytes reclaimed from every pool since construction
+    xint64 reclaimedSize() const { return m_reclaimedSize; }
+
+protected:
+    virtual ~iMemReclaimer();
+
+    virtual bool prepare(xint64* timeout) IX_OVERRIDE;
+    virtual bool check() IX_OVERRIDE;
+    virtual bool dispatch() IX_OVERRIDE;
+    virtual bool detectHang(xuint32 combo) IX_OVERRIDE;
+
+private:
+    struct Entry {
+        iSharedDataPointer<iMemPool> pool;
+        size_t target;
+        int lastAccumulated;    ///< pool's Stat::nAccumulated at the last tick
+        xint64 lastActive;      ///< when nAccumulated last moved
+        bool trimming;          ///< above the high watermark, not down to target yet
+    };
+
+    void unwatchPressure();
+    void tick(xint64 now);
+    void relievePressure();
+
+    std::list<Entry> m_entries;
+    xint64 m_idleInterval;
+    size_t m_batchSize;
+    xint64 m_nextTick;
+    bool m_trimming;            ///< some pool is mid-trim, dispatch again right away
+
+    iPollFD m_pressureFd;
+    int m_pressureEvents;
+    xint64 m_reclaimedSize;
+
+    IX_DISABLE_COPY(iMemReclaimer)
+};
+
+} // namespace iShell
+
+#endif // IMEMRECLAIMER_H
@@ -0,0 +1,115 @@
+/////////////////////////////////////////////////////////////////
+/// Copyright 2018-2020
+/// All rights reserved.
+/////////////////////////////////////////////////////////////////
+/// @file    imemtracker.h
+/// @brief   opt-in allocation tracking of iMemBlock
+/// @version 1.0
+/// @author  ncjiakechong@gmail.com
+/////////////////////////////////////////////////////////////////
+#ifndef IMEMTRACKER_H
+#define IMEMTRACKER_H
+
+#include <string>
+
+#include <core/global/iglobal.h>
+#include <core/thread/iatomiccounter.h>
+
+namespace iShell {
+
+class iMemBlock;
+
+/// @brief Records where memory blocks come from, how large they are and how long they live
+/// @details Once start()ed, every iMemBlock created is attributed to a site: its pool, its
+///          block type, the Scope tags active on the allocating thread and, for every
+///          sampleEvery-th allocation of a thread, its backtrace. Live bytes, peak, totals and
+///          lifetimes are kept per site, per pool, per block type and per pool and type.
+///          When stopped, the allocation path pays one predictable branch; builds without
+///          IX_ENABLE_MEM_TRACKING drop even that and start() fails.
+/// @note Dumps are returned as std::string on purpose: building them out of iByteArray would
+///       allocate tracked blocks while the tracker is locked.
+class IX_CORE_EXPORT iMemTracker
+{
+public:
+    /// Same order as the iMemBlock types
+    enum BlockType {
+        AnyType = -1,
+        PoolType,
+        PoolExternalType,
+        AppendedType,
+        UserType,
+        FixedType,
+        ImportedType,
+        BlockTypes
+    };
+
+    struct Usage {
+        xint64 liveCount;
+        xint64 liveBytes;
+        xint64 peakBytes;       ///< highest liveBytes seen
+        xint64 totalCount;
+        xint64 totalBytes;
+        xint64 freedCount;
+        xint64 lifetimeNs;      ///< summed over freed blocks
+
+        Usage() : liveCount(0), liveBytes(0), peakBytes(0), totalCount(0), totalBytes(0), freedCount(0), lifetimeNs(0) {}
+    };
+
+    /// Tags the allocations of the calling thread while in scope, scopes nest
+    class IX_CORE_EXPORT Scope
+    {
+    public:
+        explicit Scope(const char* tag);
+        ~Scope();
+
+        const char* tag() const { return m_tag; }
+        const Scope* parent() const { return m_parent; }
+
+    private:
+        const char* m_tag;      ///< not copied, use string literals
+        const Scope* m_parent;
+
+        IX_DISABLE_COPY(Scope)
+    };
+
+    /// @param sampleEvery take a backtrace every this many allocations of a thread, 0 for tags only
+    /// @return false if tracking was compiled out
+    static bool start(int sampleEvery = 0);
+    /// Stops recording new blocks, the collected data stays until reset(). Blocks recorded
+    /// before are still accounted for when they are released.
+    static void stop();
+    static void reset();
+    static inline bool isActive() { return 0 != s_active.value(); }
+
+    /// @param pool name of the pool, null for every pool
+    static Usage usage(const char* pool = IX_NULLPTR, BlockType type = AnyType);
+
+    static const char* typeName(BlockType type);
+
+    /// Folded stacks, "pool;type;tag...;frame... bytes" per line, as flamegraph.pl and
+    /// speedscope read them. Frames are listed outermost first.
+    /// @param live weigh sites by their live bytes, otherwise by all bytes they ever allocated
+    static std::string dumpFolded(bool live = true);
+    static bool dumpFolded(const char* path, bool live = true);
+
+    /// Writes dumpFolded(path) after signo arrives, on the next tracked allocation or release
+    /// so that nothing runs in the signal handler. While the tracker is stopped only releases
+    /// of blocks recorded before serve it, so the dump may wait until the next start().
+    static bool dumpOnSignal(int signo, const char* path);
+
+private:
+    static void recordAlloc(const iMemBlock* block);
+    static void recordFree(const iMemBlock* block);
+    static void serveDumpRequest();
+
+    static inline bool hasLiveBlocks() { return 0 != s_liveBlocks.value(); }
+
+    static iAtomicCounter<int> s_active;   ///< read unlocked on every allocation
+    static iAtomicCounter<int> s_liveBlocks; ///< recorded blocks not released yet, read on every release
+
+    friend class iMemBlock;
+};
+
+} // namespace iShell
+
+#endif // IMEMTRACKER_H
@@ -20,13 +20,28 @@ namespace iShell {
 class IX_CORE_EXPORT iShareMem
 {
 public:
-    static iShareMem* create(const char* prefix, MemType type, size_t size, mode_t mode);
+    /// Backing options for create(), every one of them falls back silently when unsupported
+    enum CreateOption {
+        CreatePopulate              = 0x1,  ///< pre-fault the whole mapping instead of on first touch
+        CreateHugePages             = 0x2,  ///< hugetlb pages (MFD_HUGETLB/MAP_HUGETLB), else transparent huge pages
+        CreateTransparentHugePages  = 0x4   ///< advise transparent huge pages (MADV_HUGEPAGE)
+    };
+    typedef uint CreateOptions;
+
+    /// @param options OR-ed CreateOption flags
+    /// @param numaNode Preferred NUMA node of the pages, -1 for the default policy
+    static iShareMem* create(const char* prefix, MemType type, size_t size, mode_t mode, CreateOptions options = 0, int numaNode = -1);
 
     iShareMem(const char* prefix);
     ~iShareMem();
 
     int attach(MemType type, uint id, xintptr memfd, bool writable);
-    void punch(size_t offset, size_t size);
+    /// Hands the whole pages inside [offset, offset + size) back to the kernel
+    /// @param zero Skip the lazy MADV_FREE so that private pages read back as zeroes
+    /// @return true if those pages read back as zeroes now, false if they may keep their data
+    bool punch(size_t offset, size_t size, bool zero = false);
+    /// Fault in pages of the mapping ahead of use, the counterpart of punch()
+    void populate(size_t offset, size_t size);
     int detach();
 
     inline uint id() const { return m_id; }
@@ -35,14 +50,19 @@ public:
     inline size_t size() const { return m_size; }
     inline MemType type() const { return m_type; }
     inline const char* prefix() const { return m_prefix; }
+    /// Backed by hugetlb pages, size() is then a multiple of the huge page size
+    inline bool hugePages() const { return m_hugePages; }
+    /// Granularity of punch() and populate(): the huge page size on hugetlb segments
+    size_t pageSize() const;
 
 private:
-    static iShareMem* createPrivateMem(const char* prefix, size_t size);
-    static iShareMem* createSharedMem(const char* prefix, MemType type, size_t size, mode_t mode);
+    static iShareMem* createPrivateMem(const char* prefix, size_t size, CreateOptions options, int numaNode);
+    static iShareMem* createSharedMem(const char* prefix, MemType type, size_t size, mode_t mode, CreateOptions options, int numaNode);
     static int cleanup(const char* prefix);
 
     int doAttach(MemType type, uint id, xintptr memfd, bool writable, bool for_cleanup);
     void freePrivateMem();
+    void applyOptions(CreateOptions options, int numaNode);
 
     const char  m_prefix[12];
     MemType     m_type;
@@ -52,6 +72,7 @@ private:
 
     /* Only for type = MEMTYPE_SHARED_POSIX */
     bool        m_doUnlink;
+    bool        m_hugePages;
 
     /* Only for type = PA_MEM_TYPE_SHARED_MEMFD
      *
@@ -19,6 +19,7 @@ namespace iShell {
 
 class iPostEvent;
 class iPostEventList;
+class iThreadData;
 class iEventDispatcher;
 class iCoreApplication;
 
@@ -65,6 +66,9 @@ private:
     void init();
     void execCleanup();
 
+    /// Sorts the events pushed to data's inbox into its list, the list mutex is held
+    static void takePostedEvents(iThreadData *data);
+
     static iCoreApplication* s_self;
 
     bool m_aboutToQuitEmitted;
@@ -72,6 +76,7 @@ private:
     int  m_argc;
     char** m_argv;
     friend class iEventLoop;
+    friend class iObject;
 };
 
 } // namespace iShell
@@ -14,6 +14,8 @@
 
 namespace iShell {
 
+class iObject;
+
 class IX_CORE_EXPORT iEvent
 {
 public:
@@ -52,7 +54,13 @@ protected:
     unsigned short m_accept : 1;
     unsigned short m_reserved : 14;
 
+    // link of the posted-event inbox, see iPostEventList
+    iEvent* m_nextPosted;
+    iObject* m_postReceiver;
+    int m_postPriority;
+
     friend class iCoreApplication;
+    friend class iPostEventList;
 };
 
 class IX_CORE_EXPORT iTimerEvent : public iEvent
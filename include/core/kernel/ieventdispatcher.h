@@ -41,6 +41,21 @@ public:
         {}
     };
 
+    /// Busy-poll counters, the spin/sleep ratio tells CPU burn against latency
+    struct BusyPollStats
+    {
+        xint64 spinWakeups;  ///< waits served by spinning, without sleeping
+        xint64 spinMisses;   ///< spins that ran out of window and went to sleep
+        xint64 sleeps;       ///< waits that blocked in the poller
+        xint64 spinNSecs;    ///< time spent spinning
+        xint64 sleepNSecs;   ///< time spent blocked
+        xint64 window;       ///< current adaptive spin window in nanoseconds
+
+        inline BusyPollStats()
+            : spinWakeups(0), spinMisses(0), sleeps(0), spinNSecs(0), sleepNSecs(0), window(0)
+        {}
+    };
+
     static int allocateTimerId();
     static void releaseTimerId(int timerId);
 
@@ -65,6 +80,17 @@ public:
     virtual void startingUp();
     virtual void closingDown();
 
+    /// Whether poll fds may carry IX_IO_EDGE and IX_IO_EXCLUSIVE, other
+    /// dispatchers hand the events to poll() as they are
+    virtual bool supportsPollModes() const;
+
+    /// Spin for up to nsecs with non-blocking polls before the loop sleeps, the
+    /// window adapts to how soon work arrives. 0 turns it off; returns false if
+    /// the dispatcher cannot busy-poll. May be called from any thread
+    virtual bool setBusyPollBudget(xint64 nsecs);
+    virtual xint64 busyPollBudget() const;
+    virtual BusyPollStats busyPollStats() const;
+
 protected:
     virtual int addEventSource(iEventSource* source) = 0;
     virtual int removeEventSource(iEventSource* source) = 0;
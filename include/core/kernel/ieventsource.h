@@ -23,7 +23,11 @@ typedef enum
 {
   IX_EVENT_SOURCE_READY = 1 << 0,
   IX_EVENT_SOURCE_CAN_RECURSE = 1 << 1,
-  IX_EVENT_SOURCE_BLOCKED = 1 << 2
+  IX_EVENT_SOURCE_BLOCKED = 1 << 2,
+  /* prepare() is always false and check() only looks at revents: the generic
+     dispatcher then checks the source only when one of its fds is reported.
+     Set it before attaching. */
+  IX_EVENT_SOURCE_POLL_DRIVEN = 1 << 3
 } iEventSourceFlags;
 
 /// Well-known priority levels for event sources.
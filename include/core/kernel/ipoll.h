@@ -30,7 +30,12 @@ typedef enum /*< flags >*/
        the file descriptor.  */
     IX_IO_ERR = POLLERR,     /* Error condition.  */
     IX_IO_HUP = POLLHUP,     /* Hung up.  */
-    IX_IO_NVAL = POLLNVAL    /* Invalid polling request.  */
+    IX_IO_NVAL = POLLNVAL,   /* Invalid polling request.  */
+
+    /* Registration modes, set in `events' only. Backends without them
+       (poll, win32) stay level-triggered and shared.  */
+    IX_IO_EDGE = 0x4000,     /* Report changes of readiness only (EPOLLET, EV_CLEAR).  */
+    IX_IO_EXCLUSIVE = 0x0800 /* Wake one of the pollers sharing the fd (EPOLLEXCLUSIVE).  */
 } iIOCondition;
 
 typedef struct pollfd iPollFD;
@@ -50,9 +55,17 @@ public:
     int enableFd(iPollFD* fd);
     
     // Wait for events
-    // After returning, the ready status is written directly to iPollFD->revents
+    // After returning, the ready status is written directly to iPollFD->revents of
+    // the reported fds, the others are left alone: whoever handles an event clears it
     int wait(xint64 timeout);
 
+    // Whether IX_IO_EDGE is honoured by this platform's backend
+    static bool hasEdgeTriggered();
+
+    // Fds reported by the last wait(), an entry is null if its fd was removed since
+    int readyCount() const;
+    iPollFD* readyFd(int index) const;
+
 private:
    void* m_impl;
 };
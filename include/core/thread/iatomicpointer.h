@@ -39,6 +39,8 @@ public:
     void store(Type newValue);
 
     bool testAndSet(Type expectedValue, Type newValue);
+    /// Stores newValue and returns the previous value.
+    Type fetchAndStore(Type newValue);
 
     operator Type() const {return load(); }
     Type operator->() const { return load(); }
@@ -89,6 +91,10 @@ template <typename X>
 inline bool iAtomicPointer<X>::testAndSet(Type expectedValue, Type newValue)
 { return m_pointer.compare_exchange_weak(expectedValue, newValue); }
 
+template <typename X>
+inline typename iAtomicPointer<X>::Type iAtomicPointer<X>::fetchAndStore(Type newValue)
+{ return m_pointer.exchange(newValue); }
+
 #else
 //
 // Generic implementation based on FastMutex
@@ -131,6 +137,15 @@ inline bool iAtomicPointer<X>::testAndSet(Type expectedValue, Type newValue)
     return false;
 }
 
+template <typename X>
+inline typename iAtomicPointer<X>::Type iAtomicPointer<X>::fetchAndStore(Type newValue)
+{
+    iMutex::ScopedLock lock(m_pointer.mutex);
+    Type oldValue = m_pointer.value;
+    m_pointer.value = newValue;
+    return oldValue;
+}
+
 #endif
 
 } // namespace iShell
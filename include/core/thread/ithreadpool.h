@@ -0,0 +1,374 @@
+/////////////////////////////////////////////////////////////////
+/// Copyright 2018-2020
+/// All rights reserved.
+/////////////////////////////////////////////////////////////////
+/// @file    ithreadpool.h
+/// @brief   provides a work-stealing pool of worker threads and futures
+/// @version 1.0
+/// @author  ncjiakechong@gmail.com
+/////////////////////////////////////////////////////////////////
+#ifndef ITHREADPOOL_H
+#define ITHREADPOOL_H
+
+#include <list>
+#include <vector>
+#include <utility>
+
+#include <core/kernel/iobject.h>
+#include <core/thread/imutex.h>
+#include <core/thread/icondition.h>
+#include <core/thread/isemaphore.h>
+#include <core/thread/iatomiccounter.h>
+#include <core/utils/isharedptr.h>
+
+namespace iShell {
+
+class iThreadPool;
+class iThreadPoolWorker;
+
+/// Base class for a unit of work executed by iThreadPool.
+class IX_CORE_EXPORT iRunnable
+{
+public:
+    iRunnable() : m_autoDelete(true) {}
+    virtual ~iRunnable();
+
+    virtual void run() = 0;
+
+    /// When true (the default) the pool deletes the runnable after run() returns.
+    bool autoDelete() const { return m_autoDelete; }
+    void setAutoDelete(bool autoDelete) { m_autoDelete = autoDelete; }
+
+private:
+    bool m_autoDelete;
+
+    IX_DISABLE_COPY(iRunnable)
+};
+
+/// Shared completion state behind iFuture<T>.
+class IX_CORE_EXPORT iFutureStateBase
+{
+public:
+    explicit iFutureStateBase(iThreadPool* pool);
+    virtual ~iFutureStateBase();
+
+    void ref() { ++m_ref; }
+    bool deref() { return (--m_ref) != 0; }
+
+    bool isFinished() const;
+
+    /// Blocks until the result is reported; runs pending pool tasks meanwhile.
+    void waitForFinished();
+
+    /// Marks the state finished, wakes waiters and runs the continuations.
+    void reportFinished();
+
+    /// Takes ownership of \a continuation; runs it at once when already finished.
+    void addContinuation(iRunnable* continuation);
+
+private:
+    iAtomicCounter<int> m_ref;
+    iThreadPool* m_pool;
+    bool m_finished;
+    mutable iMutex m_mutex;
+    iCondition m_cond;
+    std::list<iRunnable*> m_continuations;
+
+    IX_DISABLE_COPY(iFutureStateBase)
+};
+
+template <typename T>
+class iFutureState : public iFutureStateBase
+{
+public:
+    explicit iFutureState(iThreadPool* pool) : iFutureStateBase(pool), value() {}
+
+    T value;
+};
+
+/// Handle to the result of a task submitted through iThreadPool::run().
+template <typename T>
+class iFuture
+{
+public:
+    iFuture() : d(IX_NULLPTR) {}
+    explicit iFuture(iFutureState<T>* state) : d(state) { if (d) d->ref(); }
+    iFuture(const iFuture& other) : d(other.d) { if (d) d->ref(); }
+    ~iFuture() { if (d && !d->deref()) delete d; }
+
+    iFuture& operator=(const iFuture& other) {
+        iFuture copy(other);
+        std::swap(d, copy.d);
+        return *this;
+    }
+
+    bool isValid() const { return d != IX_NULLPTR; }
+    bool isFinished() const { return d && d->isFinished(); }
+    void waitForFinished() const { if (d) d->waitForFinished(); }
+
+    /// Waits for the task and returns its result.
+    T result() const {
+        IX_ASSERT(d);
+        d->waitForFinished();
+        return d->value;
+    }
+
+    /// Delivers the result to \a slot of \a receiver as a queued call, i.e.
+    /// through the posted-event queue of the receiver's thread. The slot must
+    /// take the result by value. Nothing is delivered if the receiver is gone.
+    template <typename Obj>
+    void then(Obj* receiver, void (Obj::*slot)(T)) const {
+        IX_ASSERT(d && receiver);
+        d->addContinuation(new Delivery<Obj>(*this, receiver, slot));
+    }
+
+private:
+    template <typename Obj>
+    class Delivery : public iRunnable
+    {
+    public:
+        Delivery(const iFuture& future, Obj* receiver, void (Obj::*slot)(T))
+            : m_future(future), m_guard(receiver), m_receiver(receiver), m_slot(slot) {}
+
+        void run() IX_OVERRIDE {
+            if (m_guard.isNull())
+                return;
+            iObject::invokeMethod(m_receiver, m_slot, m_future.d->value, QueuedConnection);
+        }
+
+    private:
+        iFuture m_future;
+        iWeakPtr<iObject> m_guard;
+        Obj* m_receiver;
+        void (Obj::*m_slot)(T);
+    };
+
+    iFutureState<T>* d;
+};
+
+/// A pool of worker threads, each owning a Chase-Lev deque. Tasks started
+/// from a worker go to its own deque; other threads feed a shared injection
+/// queue. Idle workers steal from the top of their peers' deques.
+class IX_CORE_EXPORT iThreadPool : public iObject
+{
+    IX_OBJECT(iThreadPool)
+public:
+    /// \a maxThreadCount < 1 means idealThreadCount().
+    explicit iThreadPool(int maxThreadCount = -1, iObject* parent = IX_NULLPTR);
+    virtual ~iThreadPool();
+
+    /// Process-wide pool, created on first use. It lives for the whole process
+    /// and is deliberately never deleted: joining its workers from a static
+    /// destructor could wait on tasks that use objects already torn down.
+    static iThreadPool* globalInstance();
+
+    /// Number of online processors, at least 1.
+    static int idealThreadCount();
+
+    int maxThreadCount() const { return (int)m_workers.size(); }
+
+    /// Number of workers currently running a task.
+    int activeThreadCount() const { return m_active.value(); }
+
+    /// Queues \a runnable for execution by one of the workers.
+    void start(iRunnable* runnable);
+
+    /// Runs one queued task on the calling thread, if any. Returns true if a task ran.
+    bool tryRunPendingTask();
+
+    /// Waits until every started task has finished, helping while waiting.
+    /// Must not be called from one of this pool's tasks.
+    bool waitForDone(int msecs = -1);
+
+    template <typename R>
+    iFuture<R> run(R (*func)()) {
+        return submit<R>(new FunctionTask0<R>(func));
+    }
+
+    template <typename R, typename A1, typename Arg1>
+    iFuture<R> run(R (*func)(A1), Arg1 a1) {
+        return submit<R>(new FunctionTask1<R, A1>(func, a1));
+    }
+
+    template <typename R, typename Obj>
+    iFuture<R> run(Obj* obj, R (Obj::*func)()) {
+        return submit<R>(new MemberTask0<R, Obj>(obj, func));
+    }
+
+    #ifdef IX_HAVE_CXX11
+    /// Runs any callable taking no arguments.
+    template <typename Functor>
+    iFuture<decltype(std::declval<Functor>()())> run(Functor functor) {
+        typedef decltype(std::declval<Functor>()()) R;
+        return submit<R>(new FunctorTask<R, Functor>(functor));
+    }
+    #endif
+
+    /// Calls body(i) for every i in [begin, end). The range is cut into
+    /// chunks of \a grain indices, or 4 chunks per worker when \a grain < 1.
+    /// The caller runs a chunk itself and helps until all chunks are done.
+    template <typename Index, typename Body>
+    void parallelFor(Index begin, Index end, Body body, Index grain = 0) {
+        if (end <= begin)
+            return;
+
+        int chunks = chunkCount((xint64)(end - begin), (xint64)grain);
+        std::vector<ParallelChunk*> tasks(chunks);
+        for (int i = 0; i < chunks; ++i)
+            tasks[i] = new ForChunk<Index, Body>(chunkBound(begin, end, i, chunks),
+                                                 chunkBound(begin, end, i + 1, chunks), &body);
+
+        runChunks(&tasks[0], chunks);
+        for (int i = 0; i < chunks; ++i)
+            delete tasks[i];
+    }
+
+    /// Folds [begin, end): each chunk starts from \a identity and calls
+    /// body(first, last, acc); chunk results are merged left to right with
+    /// combine(a, b), so \a combine only needs to be associative.
+    template <typename Index, typename T, typename Body, typename Combine>
+    T parallelReduce(Index begin, Index end, const T& identity, Body body, Combine combine, Index grain = 0) {
+        if (end <= begin)
+            return identity;
+
+        int chunks = chunkCount((xint64)(end - begin), (xint64)grain);
+        std::vector<ParallelChunk*> tasks(chunks);
+        for (int i = 0; i < chunks; ++i)
+            tasks[i] = new ReduceChunk<Index, T, Body>(chunkBound(begin, end, i, chunks),
+                                                       chunkBound(begin, end, i + 1, chunks), identity, &body);
+
+        runChunks(&tasks[0], chunks);
+        T result = identity;
+        for (int i = 0; i < chunks; ++i) {
+            result = combine(result, static_cast<ReduceChunk<Index, T, Body>*>(tasks[i])->acc);
+            delete tasks[i];
+        }
+        return result;
+    }
+
+private:
+    class ParallelChunk : public iRunnable
+    {
+    public:
+        ParallelChunk() : latch(IX_NULLPTR) { setAutoDelete(false); }
+        void run() IX_OVERRIDE { exec(); latch->release(); }
+        virtual void exec() = 0;
+
+        iSemaphore* latch;
+    };
+
+    template <typename Index, typename Body>
+    class ForChunk : public ParallelChunk
+    {
+    public:
+        ForChunk(Index f, Index l, Body* b) : first(f), last(l), body(b) {}
+        void exec() IX_OVERRIDE { for (Index i = first; i < last; ++i) (*body)(i); }
+
+        Index first, last;
+        Body* body;
+    };
+
+    template <typename Index, typename T, typename Body>
+    class ReduceChunk : public ParallelChunk
+    {
+    public:
+        ReduceChunk(Index f, Index l, const T& init, Body* b) : first(f), last(l), acc(init), body(b) {}
+        void exec() IX_OVERRIDE { (*body)(first, last, acc); }
+
+        Index first, last;
+        T acc;
+        Body* body;
+    };
+
+    template <typename R>
+    class ResultTask : public iRunnable
+    {
+    public:
+        ResultTask() : state(IX_NULLPTR) {}
+        ~ResultTask() { if (state && !state->deref()) delete state; }
+        void run() IX_OVERRIDE { state->value = compute(); state->reportFinished(); }
+        virtual R compute() = 0;
+
+        iFutureState<R>* state;
+    };
+
+    template <typename R>
+    class FunctionTask0 : public ResultTask<R>
+    {
+    public:
+        explicit FunctionTask0(R (*f)()) : func(f) {}
+        R compute() IX_OVERRIDE { return func(); }
+        R (*func)();
+    };
+
+    template <typename R, typename A1>
+    class FunctionTask1 : public ResultTask<R>
+    {
+    public:
+        FunctionTask1(R (*f)(A1), const A1& a) : func(f), a1(a) {}
+        R compute() IX_OVERRIDE { return func(a1); }
+        R (*func)(A1);
+        A1 a1;
+    };
+
+    template <typename R, typename Obj>
+    class MemberTask0 : public ResultTask<R>
+    {
+    public:
+        MemberTask0(Obj* o, R (Obj::*f)()) : obj(o), func(f) {}
+        R compute() IX_OVERRIDE { return (obj->*func)(); }
+        Obj* obj;
+        R (Obj::*func)();
+    };
+
+    #ifdef IX_HAVE_CXX11
+    template <typename R, typename Functor>
+    class FunctorTask : public ResultTask<R>
+    {
+    public:
+        explicit FunctorTask(const Functor& f) : functor(f) {}
+        R compute() IX_OVERRIDE { return functor(); }
+        Functor functor;
+    };
+    #endif
+
+    template <typename R>
+    iFuture<R> submit(ResultTask<R>* task) {
+        task->state = new iFutureState<R>(this);
+        task->state->ref();
+        iFuture<R> future(task->state);
+        start(task);
+        return future;
+    }
+
+    template <typename Index>
+    static Index chunkBound(Index begin, Index end, int i, int chunks)
+    { return (Index)(begin + (Index)((xint64)(end - begin) * i / chunks)); }
+
+    int chunkCount(xint64 count, xint64 grain) const;
+    void runChunks(ParallelChunk* const* chunks, int count);
+
+    iThreadPoolWorker* currentWorker() const;
+    iRunnable* takeTask(iThreadPoolWorker* self);
+    void execute(iRunnable* task);
+
+    std::vector<iThreadPoolWorker*> m_workers;
+    std::list<iRunnable*> m_injected;
+
+    iAtomicCounter<int> m_queued;   // tasks pushed but not yet taken
+    iAtomicCounter<int> m_pending;  // tasks started but not yet finished
+    iAtomicCounter<int> m_active;
+    iAtomicCounter<int> m_idle;
+
+    bool m_stopping;
+    mutable iMutex m_mutex;
+    iCondition m_wakeCond;
+    iCondition m_doneCond;
+
+    friend class iThreadPoolWorker;
+    IX_DISABLE_COPY(iThreadPool)
+};
+
+} // namespace iShell
+
+#endif // ITHREADPOOL_H
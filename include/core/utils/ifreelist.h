@@ -205,10 +205,12 @@ public:
         if (id < ConstantsType::InitialNextValue)
             return false;
 
-        const int block = this->blockfor(id);
+        // blockfor() rewrites its argument to the index inside the block
+        int at = id;
+        const int block = this->blockfor(at);
 
         IX_ASSERT(block >= 0);
-        (this->_v[block].load())[id].setT(value);
+        (this->_v[block].load())[at].setT(value);
         this->release4list(this->_stored, id);
         return true;
     }
@@ -218,9 +220,10 @@ public:
         if (id < ConstantsType::InitialNextValue)
             return defaultValue;
 
-        const int block = this->blockfor(id);
+        int at = id;
+        const int block = this->blockfor(at);
         IX_ASSERT(block >= 0);
-        T ret = (this->_v[block].load())[id].t();
+        T ret = (this->_v[block].load())[at].t();
 
         this->release4list(this->_empty, id);
         return ret;
@@ -13,6 +13,8 @@
 #include <core/inc/iincoperation.h>
 #include <core/inc/iincmessage.h>
 #include <core/inc/iincerror.h>
+#include <core/thread/iscopedlock.h>
+#include <core/utils/ihashfunctions.h>
 #include <core/io/ilog.h>
 
 #include "inc/iincdevice.h"
@@ -42,6 +44,8 @@ iINCConnection::iINCConnection(iINCDevice* device, xuint32 connId)
     , m_connId(connId)
     , m_peerProtocol(0)
     , m_handshake(IX_NULLPTR)
+    , m_methodIdsEnabled(false)
+    , m_batchCallsEnabled(false)
 {
     // Create protocol handler for this device
     m_protocol = new iINCProtocol(device, false, this);
@@ -87,6 +91,11 @@ bool iINCConnection::isLocal() const
     return m_protocol && m_protocol->device() && m_protocol->device()->isLocal();
 }
 
+bool iINCConnection::peerCredentials(xint64* pid, xint64* uid) const
+{
+    return m_protocol && m_protocol->device() && m_protocol->device()->peerCredentials(pid, uid);
+}
+
 iSharedDataPointer<iMemPool> iINCConnection::mempool() const
 {
     if (!m_protocol) return iSharedDataPointer<iMemPool>();
@@ -130,6 +139,79 @@ void iINCConnection::releaseOperation(iINCOperation* op)
     }
 }
 
+xuint32 iINCConnection::methodId(iStringView method)
+{
+    if (!m_methodIdsEnabled) return 0;
+
+    const size_t key = iKeyHashFunc()(method);
+    iScopedLock<iMutex> lock(m_methodLock);
+    std::pair<MethodIdMap::iterator, MethodIdMap::iterator> range = m_methodIds.equal_range(key);
+    for (MethodIdMap::iterator it = range.first; it != range.second; ++it) {
+        if (iStringView(it->second.name) == method) return it->second.id;
+    }
+
+    // First use: keep a pending entry so only one METHOD_BIND is sent per name
+    MethodBinding binding;
+    binding.name = method.toString();
+    binding.id = 0;
+    m_methodIds.insert(std::make_pair(key, binding));
+    lock.unlock();
+
+    iINCMessage msg(INC_MSG_METHOD_BIND, m_connId, nextSequence());
+    msg.payload().putString(method);
+    iSharedDataPointer<iINCOperation> op = sendMessage(msg);
+    if (op) op->setFinishedCallback(&iINCConnection::onMethodBound, this);
+    return 0;
+}
+
+void iINCConnection::onMethodBound(iINCOperation* op, void* userData)
+{
+    // Cancelled/failed binds leave the entry pending: that name keeps using
+    // the name-based call, and the connection may already be going away
+    if (iINCOperation::STATE_DONE != op->getState()) return;
+
+    iINCConnection* self = static_cast<iINCConnection*>(userData);
+    iINCTagStruct result = op->resultData();
+    xint32 errorCode = INC_ERROR_UNKNOWN;
+    xuint32 id = 0;
+    iString name;
+    if (!result.getInt32(errorCode) || !result.getUint32(id) || !result.getString(name)
+        || (INC_OK != errorCode) || (0 == id)) {
+        ilog_warn("[", self->m_peerName, "][", op->sequenceNumber(), "] Method bind rejected, error:", errorCode);
+        return;
+    }
+
+    const size_t key = iKeyHashFunc()(name);
+    iScopedLock<iMutex> lock(self->m_methodLock);
+    std::pair<MethodIdMap::iterator, MethodIdMap::iterator> range = self->m_methodIds.equal_range(key);
+    for (MethodIdMap::iterator it = range.first; it != range.second; ++it) {
+        if (it->second.name != name) continue;
+
+        it->second.id = id;
+        ilog_debug("[", self->m_peerName, "] Method \"", name, "\" bound to id ", id);
+        return;
+    }
+}
+
+xuint32 iINCConnection::bindLocalMethod(const iString& method, xuint32 limit)
+{
+    for (size_t idx = 0; idx < m_localMethods.size(); ++idx) {
+        if (m_localMethods[idx] == method) return static_cast<xuint32>(idx + 1);
+    }
+
+    if (m_localMethods.size() >= limit) return 0;
+
+    m_localMethods.push_back(method);
+    return static_cast<xuint32>(m_localMethods.size());
+}
+
+iString iINCConnection::localMethod(xuint32 index) const
+{
+    if ((0 == index) || (index > m_localMethods.size())) return iString();
+
+    return m_localMethods[index - 1];
+}
+
 iSharedDataPointer<iINCOperation> iINCConnection::sendMessage(const iINCMessage& msg)
 {
     IX_ASSERT(m_protocol);
@@ -120,6 +120,8 @@ int iINCContext::doConnect(const iStringView& url)
     setState(STATE_CONNECTING);
 
     // Create transport device using engine (EventSource is created but NOT attached yet)
+    m_engine->setIOUringEnabled(m_config.enableIOUring());
+    m_engine->setEdgeTriggered(m_config.enableEdgeTriggered());
     iINCDevice* device = m_engine->createClientTransport(url);
     if (!device) {
         ilog_error("[", objectName(), "] Failed to create transport device for", url);
@@ -156,6 +158,8 @@ int iINCContext::doConnect(const iStringView& url)
     localData.nodeName = objectName();
     localData.protocolVersion = m_config.protocolVersionCurrent();
     localData.capabilities = iINCHandshakeData::CAP_STREAM;
+    if (m_config.enableMethodIds()) localData.capabilities |= iINCHandshakeData::CAP_METHOD_ID;
+    if (m_config.enableMethodBatch()) localData.capabilities |= iINCHandshakeData::CAP_METHOD_BATCH;
     localData.targetServer = (m_connectMode & 0x0A) ? m_serverUrl : iString();  // 0x02|0x08 = router modes
     localData.hopCount = 0;
     handshake->setLocalData(localData);
@@ -231,10 +235,18 @@ iSharedDataPointer<iINCOperation> iINCContext::callMethod(iStringView method, xu
         return iSharedDataPointer<iINCOperation>();
     }
 
+    // Prefer the interned id; the first call of a name goes by name while it is being bound
+    xuint32 methodId = m_connection->methodId(method);
+
     // Create and send method call message
     iINCMessage msg(INC_MSG_METHOD_CALL, m_connection->connectionId(), m_connection->nextSequence());
     msg.payload().putUint16(version);
-    msg.payload().putString(method);
+    if (methodId) {
+        msg.setFlags(INC_MSG_FLAG_METHOD_ID);
+        msg.payload().putUint32(methodId);
+    } else {
+        msg.payload().putString(method);
+    }
     msg.payload().putBytes(args);
     if (timeout > 0) {
         // Create deadline timer with relative timeout (msecs from now)
@@ -250,6 +262,83 @@ iSharedDataPointer<iINCOperation> iINCContext::callMethod(iStringView method, xu
     return op;
 }
 
+iSharedDataPointer<iINCOperation> iINCContext::callMethods(const std::vector<MethodCall>& calls, xint64 timeout)
+{
+    if (STATE_CONNECTED != m_state || !m_connection) {
+        ilog_warn("[", objectName(), "] Context not ready, cannot call methods");
+        return iSharedDataPointer<iINCOperation>();
+    }
+
+    if (!m_connection->batchCallsEnabled()) {
+        ilog_warn("[", objectName(), "] Server does not support batched calls");
+        return iSharedDataPointer<iINCOperation>();
+    }
+
+    if (calls.empty() || calls.size() > iINCMessageHeader::MAX_BATCH_CALLS) {
+        ilog_warn("[", objectName(), "] Invalid batch size ", calls.size());
+        return iSharedDataPointer<iINCOperation>();
+    }
+
+    // One frame for the whole batch: count, then (version, byId, id|name, args) per call
+    iINCMessage msg(INC_MSG_METHOD_CALL, m_connection->connectionId(), m_connection->nextSequence());
+    msg.setFlags(INC_MSG_FLAG_BATCH);
+    msg.payload().putUint32(static_cast<xuint32>(calls.size()));
+    for (size_t idx = 0; idx < calls.size(); ++idx) {
+        const MethodCall& call = calls[idx];
+        xuint32 methodId = m_connection->methodId(call.method);
+
+        msg.payload().putUint16(call.version);
+        msg.payload().putBool(0 != methodId);
+        if (methodId) {
+            msg.payload().putUint32(methodId);
+        } else {
+            msg.payload().putString(call.method);
+        }
+        msg.payload().putBytes(call.args);
+    }
+
+    // The batch shares one frame, split larger call sets into several batches
+    if (!msg.isValid()) {
+        ilog_warn("[", objectName(), "] Batch of ", calls.size(), " calls needs ", msg.payload().size(),
+                    " bytes, exceeds the frame limit of ", iINCMessageHeader::MAX_MESSAGE_SIZE);
+        return iSharedDataPointer<iINCOperation>();
+    }
+
+    if (timeout > 0) {
+        iDeadlineTimer dts(timeout);
+        msg.setDTS(dts.deadlineNSecs());
+    }
+
+    iSharedDataPointer<iINCOperation> op = m_connection->sendMessage(msg);
+    if (!op) return op;
+
+    op->setTimeout(timeout);
+    return op;
+}
+
+bool iINCContext::batchResults(const iINCOperation* op, std::vector<MethodResult>& results)
+{
+    results.clear();
+    if (!op || INC_OK != op->errorCode()) return false;
+
+    // Reply: overall error, count, then (error, result) per call
+    iINCTagStruct reply = op->resultData();
+    xint32 errorCode = INC_OK;
+    xuint32 count = 0;
+    if (!reply.getInt32(errorCode) || INC_OK != errorCode) return false;
+    if (!reply.getUint32(count) || count > iINCMessageHeader::MAX_BATCH_CALLS) return false;
+
+    results.resize(count);
+    for (xuint32 idx = 0; idx < count; ++idx) {
+        if (!reply.getInt32(results[idx].errorCode) || !reply.getBytes(results[idx].data)) {
+            results.clear();
+            return false;
+        }
+    }
+
+    return true;
+}
+
 iSharedDataPointer<iINCOperation> iINCContext::subscribe(iStringView pattern)
 {
     if (STATE_CONNECTED != m_state || !m_connection) {
@@ -404,6 +493,10 @@ void iINCContext::handleHandshakeAck(iINCConnection* conn, const iINCMessage& ms
     conn->setConnectionId(msg.channelID());
     conn->setPeerName(remote.nodeName);
     conn->setPeerProtocolVersion(remote.protocolVersion);
+    conn->setMethodIdsEnabled(remote.hasCapability(iINCHandshakeData::CAP_METHOD_ID)
+                              && handshake->localData().hasCapability(iINCHandshakeData::CAP_METHOD_ID));
+    conn->setBatchCallsEnabled(remote.hasCapability(iINCHandshakeData::CAP_METHOD_BATCH)
+                               && handshake->localData().hasCapability(iINCHandshakeData::CAP_METHOD_BATCH));
 
     // Solidify connection mode
     if (m_connectMode == 0x01) m_connectMode = 0x04;
@@ -549,7 +642,8 @@ xuint32 iINCContext::registerChannel(iINCChannel* channel, MemType type, const i
         xint32 useSize = (shmSize <= 0)  ? m_config.sharedMemorySize() : shmSize;
 
         ilog_info("[", objectName(), "] Create mempool with name:", useName, " size:", useSize);
-        iMemPool* memPool = iMemPool::create((const char*)objectName().toUtf8().constData(), useName.constData(), type, useSize, true);
+        iMemPool* memPool = iMemPool::create((const char*)objectName().toUtf8().constData(), useName.constData(), type, useSize, true,
+                                                    m_config.sharedMemoryOptions(), m_config.sharedMemoryNumaNode());
         m_connection->enableMempool(iSharedDataPointer<iMemPool>(memPool));
     }
 
@@ -10,6 +10,7 @@
 
 #include <core/inc/iinccontextconfig.h>
 #include <core/io/ilog.h>
+#include <core/io/isharemem.h>
 
 #define ILOG_TAG "ix_inc"
 
@@ -27,6 +28,13 @@ iINCContextConfig::iINCContextConfig()
     #endif
     , m_sharedMemorySize(4 * 1024 * 1024)
     , m_sharedMemoryName("ix-shm")
+    , m_sharedMemoryPrefault(false)
+    , m_sharedMemoryHugePages(false)
+    , m_sharedMemoryNumaNode(-1)
+    , m_enableMethodIds(true)
+    , m_enableMethodBatch(true)
+    , m_enableIOUring(false)
+    , m_enableEdgeTriggered(false)
     , m_encryptionMethod(NoEncryption)
     , m_autoReconnect(true)
     , m_reconnectIntervalMs(500)
@@ -49,6 +57,16 @@ void iINCContextConfig::load(const iString& configFile)
     }
 }
 
+uint iINCContextConfig::sharedMemoryOptions() const
+{
+    uint options = 0;
+    if (m_sharedMemoryPrefault)
+        options |= iShareMem::CreatePopulate;
+    if (m_sharedMemoryHugePages)
+        options |= iShareMem::CreateHugePages;
+    return options;
+}
+
 iString iINCContextConfig::dump() const
 {
     iString result = "=== INC Context Configuration ===\n";
@@ -56,6 +74,13 @@ iString iINCContextConfig::dump() const
     result += iString::asprintf("Default Server: %s\n", m_defaultServer.toUtf8().constData());
     result += iString::asprintf("Disable Shared Memory: %s\n", m_disableSharedMemory ? "true" : "false");
     result += iString::asprintf("Shared Memory Size: %d bytes\n", m_sharedMemorySize);
+    result += iString::asprintf("Shared Memory Prefault: %s\n", m_sharedMemoryPrefault ? "true" : "false");
+    result += iString::asprintf("Shared Memory Huge Pages: %s\n", m_sharedMemoryHugePages ? "true" : "false");
+    result += iString::asprintf("Shared Memory NUMA Node: %d\n", m_sharedMemoryNumaNode);
+    result += iString::asprintf("Enable Method IDs: %s\n", m_enableMethodIds ? "true" : "false");
+    result += iString::asprintf("Enable Method Batches: %s\n", m_enableMethodBatch ? "true" : "false");
+    result += iString::asprintf("Enable io_uring: %s\n", m_enableIOUring ? "true" : "false");
+    result += iString::asprintf("Enable Edge Triggered: %s\n", m_enableEdgeTriggered ? "true" : "false");
     result += iString::asprintf("Auto Reconnect: %s\n", m_autoReconnect ? "true" : "false");
     result += iString::asprintf("Connect Timeout: %d ms\n", m_connectTimeoutMs);
     result += iString::asprintf("Enable IO Thread: %s\n", m_enableIOThread ? "true" : "false");
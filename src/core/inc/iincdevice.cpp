@@ -22,6 +22,13 @@ iINCDevice::~iINCDevice()
 {
 }
 
+bool iINCDevice::peerCredentials(xint64* pid, xint64* uid) const
+{
+    IX_UNUSED(pid);
+    IX_UNUSED(uid);
+    return false;
+}
+
 void iINCDevice::newConnection(iINCDevice* client) ISIGNAL(newConnection, client)
 
 void iINCDevice::messageReceived(iINCMessage msg) ISIGNAL(messageReceived, msg)
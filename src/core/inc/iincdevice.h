@@ -46,6 +46,10 @@ public:
     /// get connction is in local domain
     virtual bool isLocal() const = 0;
 
+    /// Credentials of the peer process as authenticated by the kernel
+    /// @return false if the transport cannot tell (default)
+    virtual bool peerCredentials(xint64* pid, xint64* uid) const;
+
     /// Start async event monitoring (attach EventSource to dispatcher)
     /// @details Must be called AFTER connecting signals to ensure no events are missed.
     ///          This separates device creation from event monitoring activation.
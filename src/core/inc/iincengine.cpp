@@ -24,6 +24,8 @@ namespace iShell {
 iINCEngine::iINCEngine(iObject *parent)
     : iObject(parent)
     , m_initialized(false)
+    , m_ioUringEnabled(false)
+    , m_edgeTriggered(false)
 {
 }
 
@@ -156,6 +158,8 @@ iINCEngine::ParsedUrl iINCEngine::parseUrl(const iStringView& url)
 iTcpDevice* iINCEngine::createTcpClient(const ParsedUrl& url)
 {
     iTcpDevice* device = new iTcpDevice(iINCDevice::ROLE_CLIENT);
+    device->setIOUringEnabled(m_ioUringEnabled);
+    device->setEdgeTriggered(m_edgeTriggered);
 
     if (device->connectToHost(url.host, url.port) != INC_OK) {
         delete device;
@@ -169,6 +173,8 @@ iTcpDevice* iINCEngine::createTcpClient(const ParsedUrl& url)
 iTcpDevice* iINCEngine::createTcpServer(const ParsedUrl& url)
 {
     iTcpDevice* device = new iTcpDevice(iINCDevice::ROLE_SERVER);
+    device->setIOUringEnabled(m_ioUringEnabled);
+    device->setEdgeTriggered(m_edgeTriggered);
 
     iString bindAddr = url.host.isEmpty() ? "0.0.0.0" : url.host;
     if (device->listenOn(bindAddr, url.port) != INC_OK) {
@@ -183,6 +189,7 @@ iTcpDevice* iINCEngine::createTcpServer(const ParsedUrl& url)
 iUnixDevice* iINCEngine::createUnixClient(const ParsedUrl& url)
 {
     iUnixDevice* device = new iUnixDevice(iINCDevice::ROLE_CLIENT);
+    device->setEdgeTriggered(m_edgeTriggered);
 
     if (device->connectToPath(url.path) != INC_OK) {
         delete device;
@@ -196,6 +203,7 @@ iUnixDevice* iINCEngine::createUnixClient(const ParsedUrl& url)
 iUnixDevice* iINCEngine::createUnixServer(const ParsedUrl& url)
 {
     iUnixDevice* device = new iUnixDevice(iINCDevice::ROLE_SERVER);
+    device->setEdgeTriggered(m_edgeTriggered);
 
     if (device->listenOn(url.path) != INC_OK) {
         delete device;
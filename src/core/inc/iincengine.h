@@ -63,6 +63,14 @@ public:
     /// @return Created transport device, or nullptr on error
     iINCDevice* createServerTransport(const iStringView& url);
 
+    /// Serve TCP devices created from now on through io_uring when the kernel supports it
+    void setIOUringEnabled(bool enable) { m_ioUringEnabled = enable; }
+    bool isIOUringEnabled() const { return m_ioUringEnabled; }
+
+    /// Register TCP and unix devices created from now on edge-triggered
+    void setEdgeTriggered(bool enable) { m_edgeTriggered = enable; }
+    bool isEdgeTriggered() const { return m_edgeTriggered; }
+
 private:
     struct ParsedUrl {
         iString scheme;     ///< tcp, pipe, unix
@@ -84,6 +92,8 @@ private:
     iRtpDevice* createRtpServer(const ParsedUrl& url);
 
     bool                m_initialized;  ///< Initialization state
+    bool                m_ioUringEnabled;   ///< Applied to created TCP devices
+    bool                m_edgeTriggered;    ///< Applied to created TCP and unix devices
 
     IX_DISABLE_COPY(iINCEngine)
 };
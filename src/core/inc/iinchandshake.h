@@ -44,6 +44,8 @@ struct IX_CORE_EXPORT iINCHandshakeData
         CAP_MULTIPLEXING    = 0x00000010,   ///< Supports channel multiplexing
         CAP_FILE_TRANSFER   = 0x00000020,   ///< Supports file descriptor passing
         CAP_ROUTER          = 0x00000040,   ///< Identifies this node as a Router
+        CAP_METHOD_ID       = 0x00000080,   ///< Supports interned method ids (METHOD_BIND)
+        CAP_METHOD_BATCH    = 0x00000100,   ///< Executes batched METHOD_CALL frames
         CAP_ALL             = 0xFFFFFFFF
     };
 
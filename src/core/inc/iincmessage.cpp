@@ -16,6 +16,7 @@ namespace iShell {
 // Define static constants for iINCMessageHeader
 const xuint32 iINCMessageHeader::MAGIC = 0x494E4300;
 const xint32 iINCMessageHeader::MAX_MESSAGE_SIZE = 65507 - sizeof(iINCMessageHeader);
+const xuint32 iINCMessageHeader::MAX_BATCH_CALLS = 1024;
 
 iINCMessage::iINCMessage(iINCMessageType type, xuint32 channelID, xuint32 seqNum)
     : m_type(type)
@@ -52,6 +52,8 @@ public:
         // --- Shared memory ---
         xuint64 shmHits;            ///< Binary sends that used zero-copy SHM path
         xuint64 shmMisses;          ///< Binary sends that fell back to data copy
+        xuint64 shmExportsInUse;    ///< Exported blocks not acknowledged by the peer yet
+        xuint64 shmExportsPeak;     ///< Peak export table occupancy observed
 
         // --- Operation tracking ---
         xuint64 operationsCreated;  ///< Total operations allocated
@@ -64,6 +66,7 @@ public:
             , binaryFramesSent(0), binaryFramesRecv(0)
             , sendQueueDrops(0), sendQueuePeak(0)
             , shmHits(0), shmMisses(0)
+            , shmExportsInUse(0), shmExportsPeak(0)
             , operationsCreated(0), operationsCompleted(0), operationsTimeout(0)
         {}
 
@@ -80,6 +83,8 @@ public:
             d.sendQueuePeak      = sendQueuePeak;  // Peak is absolute, not delta
             d.shmHits            = shmHits            - prev.shmHits;
             d.shmMisses          = shmMisses          - prev.shmMisses;
+            d.shmExportsInUse    = shmExportsInUse;  // Gauge, not delta
+            d.shmExportsPeak     = shmExportsPeak;   // Peak is absolute, not delta
             d.operationsCreated  = operationsCreated  - prev.operationsCreated;
             d.operationsCompleted= operationsCompleted- prev.operationsCompleted;
             d.operationsTimeout  = operationsTimeout  - prev.operationsTimeout;
@@ -102,6 +107,8 @@ public:
         s.sendQueuePeak      = m_sendQueuePeak.value();
         s.shmHits            = m_shmHits.value();
         s.shmMisses          = m_shmMisses.value();
+        s.shmExportsInUse    = m_shmExportsInUse.value();
+        s.shmExportsPeak     = m_shmExportsPeak.value();
         s.operationsCreated  = m_operationsCreated.value();
         s.operationsCompleted= m_operationsCompleted.value();
         s.operationsTimeout  = m_operationsTimeout.value();
@@ -120,6 +127,8 @@ public:
         m_sendQueuePeak      = 0;
         m_shmHits            = 0;
         m_shmMisses          = 0;
+        m_shmExportsInUse    = 0;
+        m_shmExportsPeak     = 0;
         m_operationsCreated  = 0;
         m_operationsCompleted= 0;
         m_operationsTimeout  = 0;
@@ -137,6 +146,11 @@ public:
     }
     void onShmHit()                      { ++m_shmHits; }
     void onShmMiss()                     { ++m_shmMisses; }
+    void onShmExportDepth(xuint64 depth) {
+        m_shmExportsInUse = depth;
+        xuint64 cur = m_shmExportsPeak.value();
+        while (depth > cur && !m_shmExportsPeak.testAndSet(cur, depth, cur)) {}
+    }
     void onOperationCreated()            { ++m_operationsCreated; }
     void onOperationCompleted()          { ++m_operationsCompleted; }
     void onOperationTimeout()            { ++m_operationsTimeout; }
@@ -152,6 +166,8 @@ private:
     iAtomicCounter<xuint64> m_sendQueuePeak;
     iAtomicCounter<xuint64> m_shmHits;
     iAtomicCounter<xuint64> m_shmMisses;
+    iAtomicCounter<xuint64> m_shmExportsInUse;
+    iAtomicCounter<xuint64> m_shmExportsPeak;
     iAtomicCounter<xuint64> m_operationsCreated;
     iAtomicCounter<xuint64> m_operationsCompleted;
     iAtomicCounter<xuint64> m_operationsTimeout;
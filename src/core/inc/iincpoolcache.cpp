@@ -0,0 +1,120 @@
+/////////////////////////////////////////////////////////////////
+/// Copyright 2018-2020
+/// All rights reserved.
+/////////////////////////////////////////////////////////////////
+/// @file    iincpoolcache.cpp
+/// @brief   Reuse cache for per-client shared memory pools
+/// @version 1.0
+/// @author  ncjiakechong@gmail.com
+/////////////////////////////////////////////////////////////////
+
+#include <core/kernel/ideadlinetimer.h>
+#include <core/io/ilog.h>
+
+#include "inc/iincpoolcache.h"
+
+#define ILOG_TAG "ix_inc"
+
+namespace iShell {
+
+static inline xint64 poolCacheNow()
+{
+    return iDeadlineTimer::current(PreciseTimer).deadlineNSecs();
+}
+
+iINCPoolCache::iINCPoolCache(int capacity, uint shmOptions, int numaNode)
+    : m_capacity(capacity)
+    , m_shmOptions(shmOptions)
+    , m_numaNode(numaNode)
+{
+}
+
+iINCPoolCache::~iINCPoolCache()
+{
+    clear();
+}
+
+bool iINCPoolCache::isIdle(const Entry& entry)
+{
+    // Only the cache refers to the pool: protocol, imports, exports and blocks are gone
+    return (1 == entry.pool->count()) && (0 == entry.pool->getStat().nAllocated);
+}
+
+void iINCPoolCache::vacuumIdle()
+{
+    for (std::list<Entry>::iterator it = m_entries.begin(); it != m_entries.end(); ++it) {
+        if (it->vacuumed || !isIdle(*it)) continue;
+
+        it->pool->vacuum();
+        it->vacuumed = true;
+    }
+}
+
+iSharedDataPointer<iMemPool> iINCPoolCache::acquire(const iByteArray& client, const char* prefix, MemType type, size_t size)
+{
+    const xint64 start = poolCacheNow();
+    Key key;
+    key.client = client;
+    key.prefix = iByteArray(prefix);
+    key.type = type;
+    key.size = size;
+
+    for (std::list<Entry>::iterator it = m_entries.begin(); !client.isEmpty() && (it != m_entries.end()); ++it) {
+        if (!(it->key == key) || !isIdle(*it)) continue;
+
+        // Never hand out the previous owner's data, whatever the parking path did
+        iSharedDataPointer<iMemPool> pool = it->pool;
+        if (!it->vacuumed) pool->vacuum();
+        m_entries.erase(it);
+        if (m_shmOptions & iShareMem::CreatePopulate) pool->populate();
+
+        m_leases[pool.data()] = key;
+        ++m_stats.hits;
+        m_stats.reuseNs += static_cast<xuint64>(poolCacheNow() - start);
+        ilog_debug("[", client, "] Reusing cached pool ", pool->name(), " fd ", pool->fd());
+        return pool;
+    }
+
+    iSharedDataPointer<iMemPool> pool(iMemPool::create(client.isEmpty() ? "anonymous" : client.constData(), prefix, type, size, true, m_shmOptions, m_numaNode));
+    if (!pool) return pool;
+
+    m_leases[pool.data()] = key;
+    ++m_stats.misses;
+    m_stats.setupNs += static_cast<xuint64>(poolCacheNow() - start);
+
+    // A new connection is a good moment to return memory of idle parked pools
+    vacuumIdle();
+    return pool;
+}
+
+void iINCPoolCache::release(const iSharedDataPointer<iMemPool>& pool)
+{
+    if (!pool) return;
+
+    std::map<const iMemPool*, Key>::iterator lease = m_leases.find(pool.data());
+    if (lease == m_leases.end()) return;
+
+    Entry entry;
+    entry.key = lease->second;
+    entry.pool = pool;
+    entry.vacuumed = false;
+    m_leases.erase(lease);
+
+    if (m_capacity <= 0 || !pool->isPerClient() || entry.key.client.isEmpty()) return;
+
+    m_entries.push_back(entry);
+    while (m_entries.size() > static_cast<size_t>(m_capacity)) {
+        m_entries.pop_front();
+        ++m_stats.evictions;
+    }
+
+    vacuumIdle();
+}
+
+void iINCPoolCache::clear()
+{
+    m_entries.clear();
+    m_leases.clear();
+}
+
+} // namespace iShell
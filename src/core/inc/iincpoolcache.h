@@ -0,0 +1,110 @@
+/////////////////////////////////////////////////////////////////
+/// Copyright 2018-2020
+/// All rights reserved.
+/////////////////////////////////////////////////////////////////
+/// @file    iincpoolcache.h
+/// @brief   Reuse cache for per-client shared memory pools
+/// @version 1.0
+/// @author  ncjiakechong@gmail.com
+/////////////////////////////////////////////////////////////////
+#ifndef IINCPOOLCACHE_H
+#define IINCPOOLCACHE_H
+
+#include <list>
+#include <map>
+
+#include <core/io/imemblock.h>
+#include <core/io/isharemem.h>
+#include <core/utils/ibytearray.h>
+
+namespace iShell {
+
+/// @brief Keeps the segments of disconnected clients for the next connection of the same client
+/// @details A miss creates the pool with iMemPool::create(); pools handed back with release()
+///          are vacuumed once nothing references them any more and are reused for a matching
+///          (client, type, size, prefix) key, which saves the memfd/shm_open, ftruncate and mmap.
+///          The client must be an identity the kernel vouches for (SO_PEERCRED), never a name
+///          the peer chose, since a hit hands the previous owner's segment to the caller.
+///          The oldest entry is dropped once more than capacity() pools are parked.
+/// @note Not thread-safe: every call must come from the server's IO thread
+class iINCPoolCache
+{
+public:
+    /// @brief Counters of the cache, setup times are wall-clock nanoseconds
+    struct Stats {
+        xuint64 hits;           ///< acquire() served from the cache
+        xuint64 misses;         ///< acquire() created a new segment
+        xuint64 evictions;      ///< parked pools dropped for capacity
+        xuint64 setupNs;        ///< time spent creating segments on misses
+        xuint64 reuseNs;        ///< time spent preparing reused segments on hits
+
+        Stats() : hits(0), misses(0), evictions(0), setupNs(0), reuseNs(0) {}
+
+        /// Estimated setup time avoided by hits, based on the average miss
+        xuint64 savedNs() const {
+            if (0 == misses) return 0;
+            xuint64 setup = hits * (setupNs / misses);
+            return (setup > reuseNs) ? (setup - reuseNs) : 0;
+        }
+    };
+
+    /// @param capacity Maximum number of parked pools, 0 disables caching
+    /// @param shmOptions iShareMem::CreateOption flags of new segments, CreatePopulate also pre-faults reused ones
+    /// @param numaNode Preferred NUMA node of new segments, -1 for the default policy
+    explicit iINCPoolCache(int capacity = 4, uint shmOptions = 0, int numaNode = -1);
+    ~iINCPoolCache();
+
+    int capacity() const { return m_capacity; }
+    uint shmOptions() const { return m_shmOptions; }
+    int numaNode() const { return m_numaNode; }
+
+    /// Get a per-client pool for a client, reusing a parked one when possible
+    /// @param client Authenticated peer identity, empty disables reuse for this pool
+    /// @return New reference, null if the segment cannot be created
+    iSharedDataPointer<iMemPool> acquire(const iByteArray& client, const char* prefix, MemType type, size_t size);
+
+    /// Park a pool obtained from acquire() once its connection closed; other pools are ignored
+    void release(const iSharedDataPointer<iMemPool>& pool);
+
+    /// Drop every parked pool
+    void clear();
+
+    size_t parked() const { return m_entries.size(); }
+    const Stats& stats() const { return m_stats; }
+
+private:
+    /// Lookup key, as requested from acquire()
+    struct Key {
+        iByteArray  client;
+        iByteArray  prefix;
+        MemType     type;
+        size_t      size;
+
+        bool operator==(const Key& other) const {
+            return (type == other.type) && (size == other.size)
+                && (client == other.client) && (prefix == other.prefix);
+        }
+    };
+
+    struct Entry {
+        Key                         key;
+        iSharedDataPointer<iMemPool> pool;
+        bool                        vacuumed;
+    };
+
+    static bool isIdle(const Entry& entry);
+    void vacuumIdle();
+
+    int                 m_capacity;
+    uint                m_shmOptions;
+    int                 m_numaNode;
+    std::list<Entry>    m_entries;      ///< oldest first
+    std::map<const iMemPool*, Key> m_leases;  ///< handed out, not released yet (never dereferenced)
+    Stats               m_stats;
+
+    IX_DISABLE_COPY(iINCPoolCache)
+};
+
+} // namespace iShell
+
+#endif // IINCPOOLCACHE_H
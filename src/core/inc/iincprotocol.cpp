@@ -13,6 +13,7 @@
 #include <unistd.h>
 
 #include <core/io/ilog.h>
+#include <core/io/ibinarylog.h>
 #include <core/inc/iincmessage.h>
 #include <core/inc/iincerror.h>
 #include <core/thread/imutex.h>
@@ -194,7 +195,7 @@ iSharedDataPointer<iINCOperation> iINCProtocol::sendBinaryData(xuint32 channel,
         iMemBlock* block = typedData ? const_cast<iMemBlock*>(static_cast<const iMemBlock*>(typedData)) : IX_NULLPTR;
 
         if (!m_memExport || !block || !block->isOurs()) {
-            ilog_debug("[", m_device->peerAddress(), "][", channel, "][", seqNum, "] Current data can not send via SHM");
+            ilog_trace_debug("[", m_device->peerAddress(), "][", channel, "][", seqNum, "] Current data can not send via SHM");
             break;
         }
 
@@ -218,7 +219,7 @@ iSharedDataPointer<iINCOperation> iINCProtocol::sendBinaryData(xuint32 channel,
 
         // Success - build SHM reference payload with type-safe API
         // Store FD in message for SCM_RIGHTS transmission, NOT in payload
-        ilog_verbose("[", m_device->peerAddress(), "][", channel, "][", seqNum, "] Sending binary data via SHM reference: blockId=", blockId, ", shmId=", shmId, ", memfd=", memfd_fd, ", size=", data.size());
+        ilog_trace_verbose("[", m_device->peerAddress(), "][", channel, "][", seqNum, "] Sending binary data via SHM reference: blockId=", blockId, ", shmId=", shmId, ", memfd=", memfd_fd, ", size=", data.size());
         msg.payload().putInt64(pos);
         msg.payload().putUint32(static_cast<xuint32>(memType));
         msg.payload().putUint32(blockId);
@@ -228,6 +229,7 @@ iSharedDataPointer<iINCOperation> iINCProtocol::sendBinaryData(xuint32 channel,
 
         msg.setFlags(INC_MSG_FLAG_SHM_DATA);
         m_metrics.onShmHit();
+        m_metrics.onShmExportDepth(m_memExport->inUse());
         m_metrics.onBinaryFrameSent(data.size());
         iSharedDataPointer<iINCOperation> op = sendMessage(msg);
         op->m_blockID = blockId;
@@ -246,7 +248,7 @@ iSharedDataPointer<iINCOperation> iINCProtocol::sendBinaryData(xuint32 channel,
     msg.setFlags(broadcast ? INC_MSG_FLAG_NOACK : INC_MSG_FLAG_NONE);
     msg.payload().putInt64(pos);
     msg.payload().putBytes(data);
-    ilog_verbose("[", m_device->peerAddress(), "][", channel, "][", seqNum, "] Sending binary data via copy: size=", msg.payload().size(), " bytes");
+    ilog_trace_verbose("[", m_device->peerAddress(), "][", channel, "][", seqNum, "] Sending binary data via copy: size=", msg.payload().size(), " bytes");
     return sendMessage(msg);
 }
 
@@ -262,6 +264,7 @@ void iINCProtocol::releaseOperation(iINCOperation* op)
         // Release SHM slot if held
         if (m_memExport && (0 != op->m_blockID)) {
             m_memExport->processRelease(op->m_blockID);
+            m_metrics.onShmExportDepth(m_memExport->inUse());
             op->m_blockID = 0; // Prevent double release
         }
 
@@ -335,6 +338,7 @@ void iINCProtocol::onMessageReceived(const iINCMessage& msg)
             // Special handling for BINARY_DATA_ACK: release shared memory slot
             if (m_memExport && (msg.type() == INC_MSG_BINARY_DATA_ACK) && (0 != op->m_blockID)) {
                 m_memExport->processRelease(op->m_blockID);
+                m_metrics.onShmExportDepth(m_memExport->inUse());
             }
 
             // Complete the operation
@@ -377,6 +381,7 @@ void iINCProtocol::cancelAllOperations(int errorCode)
 
         if (m_memExport && (0 != op->m_blockID)) {
             m_memExport->processRelease(op->m_blockID);
+            m_metrics.onShmExportDepth(m_memExport->inUse());
             op->m_blockID = 0;
         }
 
@@ -459,8 +464,8 @@ bool iINCProtocol::processDirectBinaryData(const iINCMessage& msg, xuint32 chann
         return true;
     } while (false);
 
-    ilog_verbose("[", m_device->peerAddress(), "][", channel, "][", seqNum,
-                "] Received binary data via copy: size=", data.size());
+    ilog_trace_verbose("[", m_device->peerAddress(), "][", channel, "][", seqNum,
+                      "] Received binary data via copy: size=", data.size());
     IEMIT binaryDataReceived(channel, seqNum, broadcast, pos, data);
     m_metrics.onBinaryFrameRecv(data.size());
     return true;
@@ -507,8 +512,8 @@ bool iINCProtocol::processSHMBinaryData(const iINCMessage& msg, xuint32 channel,
         return true;
     }
 
-    ilog_verbose("[", m_device->peerAddress(), "][", channel, "][", seqNum,
-                "] Received binary data via SHM: blockId=", blockId, ", size=", size64);
+    ilog_trace_verbose("[", m_device->peerAddress(), "][", channel, "][", seqNum,
+                      "] Received binary data via SHM: blockId=", blockId, ", size=", size64);
     iByteArray::DataPointer dp(static_cast<iTypedArrayData<char>*>(importedBlock),
                                 static_cast<char*>(importedBlock->data().value()),
                                 static_cast<xsizetype>(size64));
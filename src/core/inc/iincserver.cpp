@@ -23,6 +23,7 @@
 #include "inc/iincprotocol.h"
 #include "inc/iincmetrics.h"
 #include "inc/iinchandshake.h"
+#include "inc/iincpoolcache.h"
 #include "inc/itcpdevice.h"
 #include "inc/iunixdevice.h"
 
@@ -30,12 +31,21 @@
 
 namespace iShell {
 
+/// Upper bound on methods registered through registerMethod()
+static const xuint32 INC_METHOD_TABLE_MAX = 4096;
+
+/// Names a client binds that were not registered get connection-local ids,
+/// tagged with this bit and capped per connection
+static const xuint32 INC_LOCAL_METHOD_ID_BIT = 0x80000000u;
+static const xuint32 INC_CONN_METHOD_IDS_MAX = 256;
+
 iINCServer::iINCServer(const iStringView& name, iObject *parent)
     : iObject(iString(name), parent)
     , m_listening(false)
     , m_engine(IX_NULLPTR)
     , m_ioThread(IX_NULLPTR)
     , m_nextChannelId(0)
+    , m_poolCache(IX_NULLPTR)
 {
     // Create and initialize engine
     m_engine = new iINCEngine(this);
@@ -53,6 +63,8 @@ iINCServer::~iINCServer()
         delete m_engine;
         m_engine = IX_NULLPTR;
     }
+
+    delete m_poolCache;
 }
 
 int iINCServer::listenOn(const iStringView& url)
@@ -76,10 +88,14 @@ int iINCServer::listenOn(const iStringView& url)
             poolType = MEMTYPE_SHARED_POSIX;
         }
 
-        m_globalPool = iMemPool::create(objectName().toUtf8().constData(), m_config.sharedMemoryName().constData(), poolType, m_config.sharedMemorySize(), false);
+        m_globalPool = iMemPool::create(objectName().toUtf8().constData(), m_config.sharedMemoryName().constData(), poolType, m_config.sharedMemorySize(), false,
+                                        m_config.sharedMemoryOptions(), m_config.sharedMemoryNumaNode());
         ilog_info("[", objectName(), "] Created global memory pool with type:", m_globalPool->type(), " name:", m_config.sharedMemoryName().constData());
     }
 
+    delete m_poolCache;
+    m_poolCache = new iINCPoolCache(m_config.sharedMemoryCacheSize(), m_config.sharedMemoryOptions(), m_config.sharedMemoryNumaNode());
+
     // Start IO thread before creating devices (so moveToThread works immediately)
     if (m_config.enableIOThread()) {
         m_ioThread = new iThread();
@@ -87,6 +103,9 @@ int iINCServer::listenOn(const iStringView& url)
         m_ioThread->start();
     }
 
+    m_engine->setIOUringEnabled(m_config.enableIOUring());
+    m_engine->setEdgeTriggered(m_config.enableEdgeTriggered());
+
     // Create listening devices for each URL, connect signals, and start monitoring
     iString urlStr = url.toString();
     IX_ASSERT(m_listenDevices.empty());
@@ -151,6 +170,14 @@ void iINCServer::close()
         conn->deleteLater();
     }
 
+    // Their connections are gone, so are the batches still waiting for replies
+    {
+        iScopedLock<iMutex> lock(m_batchLock);
+        for (MethodBatchMap::iterator it = m_methodBatches.begin(); it != m_methodBatches.end(); ++it)
+            delete it->second;
+        m_methodBatches.clear();
+    }
+
     // Close listening devices
     for (size_t i = 0; i < m_listenDevices.size(); ++i) {
         iObject::disconnect(m_listenDevices[i], IX_NULLPTR, this, IX_NULLPTR);
@@ -159,6 +186,7 @@ void iINCServer::close()
         m_listenDevices[i]->deleteLater();
     }
     m_listenDevices.clear();
+    if (m_poolCache) m_poolCache->clear();
 
     m_listening = false;
     ilog_info("[", objectName(), "] Server closed");
@@ -169,6 +197,9 @@ struct __Action
     iString eventName;
     xuint16 version;
     iByteArray data;
+    xuint64 batchKey;   ///< non-zero: resume this method batch instead of broadcasting
+
+    __Action() : version(0), batchKey(0) {}
 };
 
 void iINCServer::broadcastEvent(const iStringView& eventName, xuint16 version, const iByteArray& data)
@@ -190,6 +221,11 @@ void iINCServer::broadcastEvent(const iStringView& eventName, xuint16 version, c
 void iINCServer::handleCustomer(xintptr action)
 {
     __Action* evt = reinterpret_cast<__Action*>(action);
+    if (evt->batchKey) {
+        runMethodBatch(evt->batchKey);
+        delete evt;
+        return;
+    }
 
     for (ConnectionMap::iterator it = m_connections.begin(); it != m_connections.end(); ++it) {
         iINCConnection* conn = it->second;
@@ -233,6 +269,8 @@ void iINCServer::handleNewConnection(iINCDevice* incDevice)
     localData.nodeName = objectName();
     localData.protocolVersion = m_config.protocolVersionCurrent();
     localData.capabilities = iINCHandshakeData::CAP_STREAM;
+    if (m_config.enableMethodIds()) localData.capabilities |= iINCHandshakeData::CAP_METHOD_ID;
+    if (m_config.enableMethodBatch()) localData.capabilities |= iINCHandshakeData::CAP_METHOD_BATCH;
     handshake->setLocalData(localData);
     conn->setHandshakeHandler(handshake);
 
@@ -298,6 +336,24 @@ void iINCServer::onClientDisconnected(iINCConnection* conn)
     }
 
     ilog_info("[", conn->peerName(), "] Client disconnected, ID:", conn->connectionId());
+
+    {
+        iScopedLock<iMutex> lock(m_batchLock);
+        MethodBatchMap::iterator batchIt = m_methodBatches.begin();
+        while (batchIt != m_methodBatches.end()) {
+            if (batchIt->second->conn != conn) {
+                ++batchIt;
+                continue;
+            }
+
+            delete batchIt->second;
+            m_methodBatches.erase(batchIt++);
+        }
+    }
+
+    // Park a per-client segment for the next connection of this client
+    if (m_poolCache) m_poolCache->release(conn->mempool());
+
     conn->clearChannels();
     conn->deleteLater();
 }
@@ -343,6 +399,9 @@ void iINCServer::onConnectionMessageReceived(iINCConnection* conn, const iINCMes
         case INC_MSG_METHOD_CALL:
             handleMethodCall(conn, msg);
             break;
+        case INC_MSG_METHOD_BIND:
+            handleMethodBind(conn, msg);
+            break;
         case INC_MSG_STREAM_OPEN:
             handleStreamOpen(conn, msg);
             break;
@@ -366,13 +425,59 @@ void iINCServer::onConnectionMessageReceived(iINCConnection* conn, const iINCMes
     }
 }
 
+xuint32 iINCServer::registerMethod(const iStringView& method, MethodHandler handler, void* userData)
+{
+    if (m_listening) {
+        ilog_warn("[", objectName(), "] registerMethod() must be called before listenOn()");
+        return 0;
+    }
+
+    xuint32 id = internMethod(iString(method));
+    if (0 == id) return 0;
+
+    MethodEntry& entry = m_methodTable[id - 1];
+    entry.handler = handler;
+    entry.userData = userData;
+    return id;
+}
+
+xuint32 iINCServer::internMethod(const iString& method)
+{
+    if (method.isEmpty()) return 0;
+
+    MethodIdMap::const_iterator it = m_methodIds.find(method);
+    if (it != m_methodIds.end()) return it->second;
+
+    if (m_methodTable.size() >= INC_METHOD_TABLE_MAX) {
+        ilog_warn("[", objectName(), "] Method table full, cannot intern \"", method, "\"");
+        return 0;
+    }
+
+    MethodEntry entry;
+    entry.name = method;
+    entry.handler = IX_NULLPTR;
+    entry.userData = IX_NULLPTR;
+    m_methodTable.push_back(entry);
+
+    xuint32 id = static_cast<xuint32>(m_methodTable.size());
+    m_methodIds.insert(std::make_pair(method, id));
+    return id;
+}
+
 void iINCServer::handleMethodCall(iINCConnection* conn, const iINCMessage& msg)
 {
+    if (msg.flags() & INC_MSG_FLAG_BATCH) {
+        handleMethodBatch(conn, msg);
+        return;
+    }
+
     xuint16 version;
+    xuint32 methodId = 0;
     iString method;
     iByteArray args;
+    bool byId = (msg.flags() & INC_MSG_FLAG_METHOD_ID);
     if (!msg.payload().getUint16(version)
-        || !msg.payload().getString(method)
+        || !(byId ? msg.payload().getUint32(methodId) : msg.payload().getString(method))
         || !msg.payload().getBytes(args)
         || !msg.payload().eof()) {
         ilog_error("[", conn->peerName(), "][", msg.channelID(), "][", msg.sequenceNumber(),
@@ -381,7 +486,211 @@ void iINCServer::handleMethodCall(iINCConnection* conn, const iINCMessage& msg)
         return;
     }
 
-    handleMethod(conn, msg.sequenceNumber(), method, version, args);
+    dispatchMethod(conn, msg.sequenceNumber(), version, byId, methodId, method, args);
+}
+
+void iINCServer::dispatchMethod(iINCConnection* conn, xuint32 seqNum, xuint16 version, bool byId, xuint32 methodId, const iString& method, const iByteArray& args)
+{
+    if (!byId) {
+        MethodIdMap::const_iterator it = m_methodIds.find(method);
+        if (it == m_methodIds.end()) {
+            handleMethod(conn, seqNum, method, version, args);
+            return;
+        }
+
+        methodId = it->second;
+    } else if (methodId & INC_LOCAL_METHOD_ID_BIT) {
+        const iString name = conn->localMethod(methodId & ~INC_LOCAL_METHOD_ID_BIT);
+        if (!name.isEmpty()) {
+            handleMethod(conn, seqNum, name, version, args);
+            return;
+        }
+    }
+
+    if ((0 == methodId) || (methodId > m_methodTable.size())) {
+        ilog_warn("[", conn->peerName(), "][", conn->connectionId(), "][", seqNum,
+                    "] Unknown method id:", methodId);
+        sendMethodReply(conn, seqNum, INC_ERROR_UNKNOWN_METHOD, iByteArray());
+        return;
+    }
+
+    const MethodEntry& entry = m_methodTable[methodId - 1];
+    if (entry.handler) {
+        entry.handler(this, conn, seqNum, version, args, entry.userData);
+    } else {
+        handleMethod(conn, seqNum, entry.name, version, args);
+    }
+}
+
+void iINCServer::handleMethodBatch(iINCConnection* conn, const iINCMessage& msg)
+{
+    if (!m_config.enableMethodBatch()) {
+        ilog_warn("[", conn->peerName(), "][", msg.channelID(), "][", msg.sequenceNumber(),
+                    "] Method batches are disabled");
+        sendMethodReply(conn, msg.sequenceNumber(), INC_ERROR_INVALID_STATE, iByteArray());
+        return;
+    }
+
+    xuint32 count = 0;
+    bool valid = msg.payload().getUint32(count) && (count > 0) && (count <= iINCMessageHeader::MAX_BATCH_CALLS);
+
+    MethodBatch* batch = new MethodBatch(conn, msg.sequenceNumber());
+    if (valid) batch->calls.resize(count);
+    for (xuint32 idx = 0; valid && (idx < count); ++idx) {
+        MethodBatch::Call& call = batch->calls[idx];
+        call.byId = false;
+        call.methodId = 0;
+        valid = msg.payload().getUint16(call.version)
+                && msg.payload().getBool(call.byId)
+                && (call.byId ? msg.payload().getUint32(call.methodId) : msg.payload().getString(call.method))
+                && msg.payload().getBytes(call.args);
+    }
+
+    const xuint64 key = (static_cast<xuint64>(conn->connectionId()) << 32) | msg.sequenceNumber();
+    if (valid && msg.payload().eof()) {
+        batch->reply.payload().putInt32(INC_OK);
+        batch->reply.payload().putUint32(count);
+        iScopedLock<iMutex> lock(m_batchLock);
+        valid = m_methodBatches.insert(std::make_pair(key, batch)).second;
+    } else {
+        valid = false;
+    }
+
+    if (!valid) {
+        ilog_error("[", conn->peerName(), "][", msg.channelID(), "][", msg.sequenceNumber(),
+                    "] Failed to parse method batch");
+        delete batch;
+        sendMethodReply(conn, msg.sequenceNumber(), INC_ERROR_INVALID_MESSAGE, iByteArray());
+        return;
+    }
+
+    runMethodBatch(key);
+}
+
+void iINCServer::runMethodBatch(xuint64 key)
+{
+    iScopedLock<iMutex> lock(m_batchLock);
+    MethodBatchMap::iterator it = m_methodBatches.find(key);
+    if (it == m_methodBatches.end()) return;
+
+    MethodBatch* batch = it->second;
+    batch->running = true;
+    while (batch->replied < batch->calls.size()) {
+        if (batch->dispatched > batch->replied) {
+            // Previous call replies asynchronously, recordBatchReply() resumes us
+            batch->running = false;
+            return;
+        }
+
+        // Copy out: a handler closing the connection frees the batch
+        const MethodBatch::Call call = batch->calls[batch->dispatched++];
+        iINCConnection* conn = batch->conn;
+        lock.unlock();
+        dispatchMethod(conn, static_cast<xuint32>(key), call.version, call.byId, call.methodId, call.method, call.args);
+        lock.relock();
+
+        // The handler may have closed the connection, which drops its batches
+        it = m_methodBatches.find(key);
+        if ((it == m_methodBatches.end()) || (it->second != batch)) return;
+    }
+
+    m_methodBatches.erase(it);
+    lock.unlock();
+
+    batch->conn->sendMessage(batch->reply);
+    delete batch;
+}
+
+bool iINCServer::recordBatchReply(iINCConnection* conn, xuint32 seqNum, xint32 errorCode, const iByteArray& result)
+{
+    const xuint64 key = (static_cast<xuint64>(conn->connectionId()) << 32) | seqNum;
+    iScopedLock<iMutex> lock(m_batchLock);
+    if (m_methodBatches.empty()) return false;
+
+    MethodBatchMap::iterator it = m_methodBatches.find(key);
+    if (it == m_methodBatches.end()) return false;
+
+    MethodBatch* batch = it->second;
+    if (batch->replied >= batch->dispatched) {
+        ilog_warn("[", conn->peerName(), "][", conn->connectionId(), "][", seqNum,
+                    "] Unexpected reply inside method batch, dropped");
+        return true;
+    }
+
+    // Keep room for the (error, empty result) records still to come, so the
+    // aggregated reply always fits into one frame
+    const xsizetype recordSize = 5 + 6; // int32 tag + empty bytes tag
+    const xsizetype pending = static_cast<xsizetype>(batch->calls.size() - batch->replied - 1) * recordSize + 5;
+    const xsizetype room = batch->reply.payload().remainingBuffer(iINCMessageHeader::MAX_MESSAGE_SIZE);
+    if (result.size() + pending > room) {
+        ilog_warn("[", conn->peerName(), "][", conn->connectionId(), "][", seqNum,
+                    "] Batched result of ", result.size(), " bytes exceeds the reply frame");
+        batch->reply.payload().putInt32(INC_ERROR_MESSAGE_TOO_LARGE);
+        batch->reply.payload().putBytes(iByteArray());
+    } else {
+        batch->reply.payload().putInt32(errorCode);
+        batch->reply.payload().putBytes(result);
+    }
+    ++batch->replied;
+
+    if (batch->running) return true;
+
+    // No IO thread left to resume on: fail the whole batch instead of leaving it parked
+    if (m_listenDevices.empty()) {
+        m_methodBatches.erase(it);
+        lock.unlock();
+
+        ilog_warn("[", conn->peerName(), "][", conn->connectionId(), "][", seqNum,
+                    "] Server stopped inside method batch, ", batch->replied, " of ", batch->calls.size(), " calls replied");
+        iINCMessage msg(INC_MSG_METHOD_REPLY, conn->connectionId(), seqNum);
+        msg.payload().putInt32(INC_ERROR_INVALID_STATE);
+        msg.payload().putBytes(iByteArray());
+        conn->sendMessage(msg);
+        delete batch;
+        return true;
+    }
+
+    // Async reply: continue the batch on the IO thread. Unlock first, a reply
+    // from the IO thread itself resumes synchronously.
+    batch->running = true;
+    lock.unlock();
+
+    __Action* action = new __Action;
+    action->batchKey = key;
+    invokeMethod(m_listenDevices[0], &iINCDevice::customer, reinterpret_cast<xintptr>(action));
+    return true;
+}
+
+void iINCServer::handleMethodBind(iINCConnection* conn, const iINCMessage& msg)
+{
+    iString method;
+    xint32 errorCode = INC_OK;
+    xuint32 methodId = 0;
+    if (!msg.payload().getString(method) || !msg.payload().eof()) {
+        ilog_error("[", conn->peerName(), "][", msg.channelID(), "][", msg.sequenceNumber(),
+                    "] Failed to parse METHOD_BIND");
+        errorCode = INC_ERROR_INVALID_MESSAGE;
+    } else if (!m_config.enableMethodIds()) {
+        errorCode = INC_ERROR_INVALID_STATE;
+    } else {
+        // Registered methods share the server table, everything else is
+        // interned on this connection only and dropped with it
+        MethodIdMap::const_iterator it = m_methodIds.find(method);
+        if (it != m_methodIds.end()) {
+            methodId = it->second;
+        } else if (!method.isEmpty()) {
+            methodId = conn->bindLocalMethod(method, INC_CONN_METHOD_IDS_MAX);
+            if (0 != methodId) methodId |= INC_LOCAL_METHOD_ID_BIT;
+        }
+
+        if (0 == methodId) errorCode = INC_ERROR_RESOURCE_UNAVAILABLE;
+    }
+
+    iINCMessage ack(INC_MSG_METHOD_BIND_ACK, msg.channelID(), msg.sequenceNumber());
+    ack.payload().putInt32(errorCode);
+    ack.payload().putUint32(methodId);
+    ack.payload().putString(method);
+    conn->sendMessage(ack);
 }
 
 void iINCServer::handleStreamOpen(iINCConnection* conn, const iINCMessage& msg)
@@ -422,8 +731,25 @@ void iINCServer::handleStreamOpen(iINCConnection* conn, const iINCMessage& msg)
             // Select the highest priority bit (lowest bit position) using iCountTrailingZeroBits
             // MEMFD (0x02, bit 1) has higher priority than POSIX (0x04, bit 2)
             negotiontedShmType = static_cast<xuint16>(1) << iCountTrailingZeroBits(negotiontedShmType);
-            iMemPool* memPool = iMemPool::create(conn->peerName().toUtf8().constData(), clientShmName.constData(), static_cast<MemType>(negotiontedShmType), m_config.sharedMemorySize(), true);
-            conn->enableMempool(iSharedDataPointer<iMemPool>(memPool));
+            // The peer name is chosen by the client, only kernel-checked
+            // credentials may select a parked segment of an earlier connection
+            xint64 peerPid = 0, peerUid = 0;
+            iByteArray owner;
+            if (conn->peerCredentials(&peerPid, &peerUid))
+                owner = iByteArray::number(peerUid) + ':' + iByteArray::number(peerPid);
+
+            iSharedDataPointer<iMemPool> memPool = conn->mempool();
+            if (memPool) {
+                // Later streams share the segment negotiated by the first one
+                negotiontedShmType = memPool->type();
+            } else if ((memPool = m_poolCache->acquire(owner, clientShmName.constData(),
+                                                        static_cast<MemType>(negotiontedShmType), m_config.sharedMemorySize()))) {
+                conn->enableMempool(memPool);
+            } else {
+                ilog_warn("[", conn->peerName(), "][", msg.channelID(), "][", msg.sequenceNumber(),
+                            "] Failed to create per-client memory pool");
+                negotiontedShmType = 0;
+            }
         } else {
             negotiontedShmType = 0;
         }
@@ -543,6 +869,8 @@ void iINCServer::handleHandshake(iINCConnection* conn, const iINCMessage& msg)
 void iINCServer::sendMethodReply(iINCConnection* conn, xuint32 seqNum, xint32 errorCode, const iByteArray& result)
 {
     IX_ASSERT(conn);
+    if (recordBatchReply(conn, seqNum, errorCode, result)) return;
+
     iINCMessage msg(INC_MSG_METHOD_REPLY, conn->connectionId(), seqNum);
     msg.payload().putInt32(errorCode);
     msg.payload().putBytes(result);
@@ -585,6 +913,7 @@ iString iINCServer::dumpMetrics(bool perConnection) const
     xuint64 binTx = 0, binRx = 0, shmHit = 0, shmMiss = 0;
     xuint64 opsNew = 0, opsDone = 0, opsTimeout = 0;
     xuint64 qDrops = 0, qPeak = 0;
+    xuint64 expInUse = 0, expPeak = 0;
     iString detail;
 
     for (ConnectionMap::const_iterator it = m_connections.begin(); it != m_connections.end(); ++it) {
@@ -602,11 +931,14 @@ iString iINCServer::dumpMetrics(bool perConnection) const
         opsTimeout += s.operationsTimeout;
         qDrops     += s.sendQueueDrops;
         if (s.sendQueuePeak > qPeak) qPeak = s.sendQueuePeak;
+        expInUse   += s.shmExportsInUse;
+        if (s.shmExportsPeak > expPeak) expPeak = s.shmExportsPeak;
 
         if (perConnection) {
             detail += iString::asprintf(
                 "\n  [%s#%u] msg tx/rx=%llu/%llu bytes tx/rx=%llu/%llu "
                 "bin tx/rx=%llu/%llu shm hit/miss=%llu/%llu "
+                "shmExports inUse/peak=%llu/%llu "
                 "ops new/done/timeout=%llu/%llu/%llu "
                 "queueDrops=%llu queuePeak=%llu",
                 it->second->peerName().toUtf8().constData(),
@@ -615,26 +947,35 @@ iString iINCServer::dumpMetrics(bool perConnection) const
                 (unsigned long long)s.bytesSent, (unsigned long long)s.bytesReceived,
                 (unsigned long long)s.binaryFramesSent, (unsigned long long)s.binaryFramesRecv,
                 (unsigned long long)s.shmHits, (unsigned long long)s.shmMisses,
+                (unsigned long long)s.shmExportsInUse, (unsigned long long)s.shmExportsPeak,
                 (unsigned long long)s.operationsCreated, (unsigned long long)s.operationsCompleted,
                 (unsigned long long)s.operationsTimeout,
                 (unsigned long long)s.sendQueueDrops, (unsigned long long)s.sendQueuePeak);
         }
     }
 
+    const iINCPoolCache::Stats cache = m_poolCache ? m_poolCache->stats() : iINCPoolCache::Stats();
+    const size_t parked = m_poolCache ? m_poolCache->parked() : 0;
     iString result = iString::asprintf(
         "INC Metrics: msg tx/rx=%llu/%llu bytes tx/rx=%llu/%llu "
         "bin tx/rx=%llu/%llu shm hit/miss=%llu/%llu "
+        "shmExports inUse/peak=%llu/%llu "
         "ops new/done/timeout=%llu/%llu/%llu "
         "queueDrops=%llu queuePeak=%llu "
-        "connections=%llu",
+        "connections=%llu "
+        "poolCache hit/miss/evict=%llu/%llu/%llu parked=%llu setupSaved=%lluus",
         (unsigned long long)msgTx, (unsigned long long)msgRx,
         (unsigned long long)bytesTx, (unsigned long long)bytesRx,
         (unsigned long long)binTx, (unsigned long long)binRx,
         (unsigned long long)shmHit, (unsigned long long)shmMiss,
+        (unsigned long long)expInUse, (unsigned long long)expPeak,
         (unsigned long long)opsNew, (unsigned long long)opsDone,
         (unsigned long long)opsTimeout,
         (unsigned long long)qDrops, (unsigned long long)qPeak,
-        (unsigned long long)m_connections.size());
+        (unsigned long long)m_connections.size(),
+        (unsigned long long)cache.hits, (unsigned long long)cache.misses,
+        (unsigned long long)cache.evictions, (unsigned long long)parked,
+        (unsigned long long)(cache.savedNs() / 1000));
     result += detail;
     return result;
 }
@@ -9,6 +9,7 @@
 /////////////////////////////////////////////////////////////////
 
 #include <core/io/ilog.h>
+#include <core/io/isharemem.h>
 #include <core/inc/iincserverconfig.h>
 
 #define ILOG_TAG "ix_inc"
@@ -30,6 +31,14 @@ iINCServerConfig::iINCServerConfig()
     #endif
     , m_sharedMemorySize(4 * 1024 * 1024)
     , m_sharedMemoryName("ix-shm")
+    , m_sharedMemoryCacheSize(4)
+    , m_sharedMemoryPrefault(false)
+    , m_sharedMemoryHugePages(false)
+    , m_sharedMemoryNumaNode(-1)
+    , m_enableMethodIds(true)
+    , m_enableMethodBatch(true)
+    , m_enableIOUring(false)
+    , m_enableEdgeTriggered(false)
     , m_encryptionRequirement(Optional)
     , m_clientTimeoutMs(60000)
     , m_exitIdleTimeMs(-1)
@@ -53,6 +62,16 @@ void iINCServerConfig::load(const iString& configFile)
     }
 }
 
+uint iINCServerConfig::sharedMemoryOptions() const
+{
+    uint options = 0;
+    if (m_sharedMemoryPrefault)
+        options |= iShareMem::CreatePopulate;
+    if (m_sharedMemoryHugePages)
+        options |= iShareMem::CreateHugePages;
+    return options;
+}
+
 iString iINCServerConfig::dump() const
 {
     static const char* policyNames[] = { "Strict", "Compatible", "Permissive" };
@@ -68,6 +87,14 @@ iString iINCServerConfig::dump() const
     result += iString::asprintf("Disable SHM: %s\n", m_disableSharedMemory ? "true" : "false");
     result += iString::asprintf("SHM Size: %d bytes\n", m_sharedMemorySize);
     result += iString::asprintf("SHM Name: %s\n", m_sharedMemoryName.constData());
+    result += iString::asprintf("SHM Cache Size: %d\n", m_sharedMemoryCacheSize);
+    result += iString::asprintf("SHM Prefault: %s\n", m_sharedMemoryPrefault ? "true" : "false");
+    result += iString::asprintf("SHM Huge Pages: %s\n", m_sharedMemoryHugePages ? "true" : "false");
+    result += iString::asprintf("SHM NUMA Node: %d\n", m_sharedMemoryNumaNode);
+    result += iString::asprintf("Method IDs: %s\n", m_enableMethodIds ? "true" : "false");
+    result += iString::asprintf("Method batches: %s\n", m_enableMethodBatch ? "true" : "false");
+    result += iString::asprintf("io_uring: %s\n", m_enableIOUring ? "true" : "false");
+    result += iString::asprintf("Edge Triggered: %s\n", m_enableEdgeTriggered ? "true" : "false");
     result += iString::asprintf("Encryption Requirement: %s\n", encryptNames[m_encryptionRequirement]);
     result += iString::asprintf("Client Timeout: %d ms\n", m_clientTimeoutMs);
     result += iString::asprintf("Exit Idle Time: %d ms\n", m_exitIdleTimeMs);
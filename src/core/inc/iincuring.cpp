@@ -0,0 +1,921 @@
+/////////////////////////////////////////////////////////////////
+/// Copyright 2018-2020
+/// All rights reserved.
+/////////////////////////////////////////////////////////////////
+/// @file    iincuring.cpp
+/// @brief   io_uring completion backend for stream INC transports
+/// @details Talks to the kernel through the raw syscalls, liburing is not required.
+/// @version 1.0
+/// @author  ncjiakechong@gmail.com
+/////////////////////////////////////////////////////////////////
+
+#include <map>
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+
+#include <core/inc/iincerror.h>
+#include <core/kernel/ieventsource.h>
+#include <core/kernel/ieventdispatcher.h>
+#include <core/thread/imutex.h>
+#include <core/thread/iscopedlock.h>
+#include <core/io/ilog.h>
+
+#include "inc/iincuring.h"
+#include "inc/itcpdevice.h"
+
+#define ILOG_TAG "ix_inc"
+
+namespace iShell {
+
+static const xuint32 URING_ENTRIES      = 256;          ///< SQ size, CQ is twice as large
+static const xuint32 URING_BUF_COUNT    = 64;           ///< provided receive buffers (power of 2)
+static const xuint32 URING_BUF_SIZE     = 16 * 1024;    ///< bytes per receive buffer
+static const xuint16 URING_BUF_GROUP    = 0;
+static const xint64  URING_SEND_BACKLOG = 4 * 1024 * 1024;  ///< per-socket queued bytes before reporting "would block"
+
+static int sys_io_uring_setup(xuint32 entries, struct io_uring_params* p)
+{ return static_cast<int>(::syscall(__NR_io_uring_setup, entries, p)); }
+
+static int sys_io_uring_enter(int fd, xuint32 toSubmit, xuint32 minComplete, xuint32 flags)
+{ return static_cast<int>(::syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, IX_NULLPTR, 0)); }
+
+static int sys_io_uring_register(int fd, xuint32 opcode, const void* arg, xuint32 nrArgs)
+{ return static_cast<int>(::syscall(__NR_io_uring_register, fd, opcode, arg, nrArgs)); }
+
+/// @brief Polls the ring's eventfd and drives submission/completion for the ring
+class iURingEventSource : public iEventSource
+{
+public:
+    iURingEventSource(iINCURing* ring, int eventFd)
+        : iEventSource(iLatin1StringView("iURingEventSource"), IX_PRIORITY_IO)
+        , m_ring(ring)
+    {
+        m_pollFd.fd = eventFd;
+        m_pollFd.events = IX_IO_IN;
+        m_pollFd.revents = 0;
+        addPoll(&m_pollFd);
+    }
+
+    ~iURingEventSource() {
+        removePoll(&m_pollFd);
+    }
+
+    bool prepare(xint64* /*timeout*/) IX_OVERRIDE {
+        if (!m_ring) return false;
+
+        // Everything queued during the last loop iteration goes out in one io_uring_enter()
+        m_ring->flush();
+        return m_ring->hasWork();
+    }
+
+    bool check() IX_OVERRIDE {
+        if (!m_ring) return false;
+        return (m_pollFd.revents & IX_IO_IN) || m_ring->hasWork();
+    }
+
+    bool dispatch() IX_OVERRIDE {
+        if (m_pollFd.revents & IX_IO_IN) {
+            eventfd_t value = 0;
+            ::eventfd_read(m_pollFd.fd, &value);
+        }
+        m_pollFd.revents = 0;
+
+        if (!m_ring) return true;
+        // the ring may delete itself (and clear m_ring) once the last device is gone
+        return m_ring->dispatch();
+    }
+
+    bool detectHang(xuint32 /*combo*/) IX_OVERRIDE {
+        // back-to-back dispatches just mean a busy ring, completions always make progress
+        return false;
+    }
+
+    iINCURing*  m_ring;
+    iPollFD     m_pollFd;
+};
+
+typedef std::map<iEventDispatcher*, iINCURing*> URingMap;
+
+static iMutex& uringLock()
+{
+    static iMutex lock;
+    return lock;
+}
+
+static URingMap& uringMap()
+{
+    static URingMap rings;
+    return rings;
+}
+
+/// Multishot RECV has no probe bit of its own: issue one on a socketpair with
+/// data pending. Kernels without it reject the flag in prep with -EINVAL; with
+/// it, the unregistered buffer group makes the request fail with -ENOBUFS.
+static bool probeMultishotRecv(int ringFd, const struct io_uring_params& params)
+{
+    size_t sqRingSize = params.sq_off.array + params.sq_entries * sizeof(xuint32);
+    size_t cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    size_t ringSize = std::max(sqRingSize, cqRingSize);
+    size_t sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+
+    void* ring = ::mmap(IX_NULLPTR, ringSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+    if (MAP_FAILED == ring) return false;
+
+    void* sqes = ::mmap(IX_NULLPTR, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES);
+    if (MAP_FAILED == sqes) {
+        ::munmap(ring, ringSize);
+        return false;
+    }
+
+    bool supported = false;
+    int pair[2] = { -1, -1 };
+    if ((0 == ::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, pair)) && (1 == ::write(pair[1], "x", 1))) {
+        char* base = static_cast<char*>(ring);
+        xuint32* sqTail = reinterpret_cast<xuint32*>(base + params.sq_off.tail);
+        xuint32 sqMask = *reinterpret_cast<xuint32*>(base + params.sq_off.ring_mask);
+        xuint32* sqArray = reinterpret_cast<xuint32*>(base + params.sq_off.array);
+        xuint32 tail = *sqTail;
+
+        struct io_uring_sqe* sqe = static_cast<struct io_uring_sqe*>(sqes) + (tail & sqMask);
+        std::memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = IORING_OP_RECV;
+        sqe->fd = pair[0];
+        sqe->flags = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = 0xFFFF;
+        sqe->ioprio = IORING_RECV_MULTISHOT;
+        sqArray[tail & sqMask] = tail & sqMask;
+        __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+
+        if (sys_io_uring_enter(ringFd, 1, 1, IORING_ENTER_GETEVENTS) >= 0) {
+            xuint32* cqHead = reinterpret_cast<xuint32*>(base + params.cq_off.head);
+            xuint32* cqTail = reinterpret_cast<xuint32*>(base + params.cq_off.tail);
+            xuint32 cqMask = *reinterpret_cast<xuint32*>(base + params.cq_off.ring_mask);
+            const struct io_uring_cqe* cqes = reinterpret_cast<const struct io_uring_cqe*>(base + params.cq_off.cqes);
+            xuint32 head = *cqHead;
+            if (head != __atomic_load_n(cqTail, __ATOMIC_ACQUIRE))
+                supported = (-EINVAL != cqes[head & cqMask].res);
+        }
+    }
+
+    if (pair[0] >= 0) ::close(pair[0]);
+    if (pair[1] >= 0) ::close(pair[1]);
+    ::munmap(sqes, sqesSize);
+    ::munmap(ring, ringSize);
+    return supported;
+}
+
+static bool probeURingSupport()
+{
+    struct io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    int fd = sys_io_uring_setup(8, &params);
+    if (fd < 0) {
+        ilog_info("io_uring unavailable (", errno, "), using epoll transport");
+        return false;
+    }
+
+    bool supported = false;
+    do {
+        if (!(params.features & IORING_FEAT_SINGLE_MMAP) || !(params.features & IORING_FEAT_NODROP))
+            break;
+
+        xuint32 nrOps = 256;
+        std::vector<char> probeBuf(sizeof(struct io_uring_probe) + nrOps * sizeof(struct io_uring_probe_op), 0);
+        struct io_uring_probe* probe = reinterpret_cast<struct io_uring_probe*>(&probeBuf[0]);
+        if (sys_io_uring_register(fd, IORING_REGISTER_PROBE, probe, nrOps) < 0)
+            break;
+
+        const int requiredOps[] = { IORING_OP_RECV, IORING_OP_SENDMSG, IORING_OP_ASYNC_CANCEL };
+        bool allOps = true;
+        for (size_t i = 0; i < sizeof(requiredOps) / sizeof(requiredOps[0]); ++i) {
+            int op = requiredOps[i];
+            if (op > probe->last_op || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED)) {
+                allOps = false;
+                break;
+            }
+        }
+
+        supported = allOps && probeMultishotRecv(fd, params);
+    } while (false);
+
+    ::close(fd);
+    ilog_info("io_uring transport ", supported ? "supported" : "not supported by this kernel");
+    return supported;
+}
+
+bool iINCURing::isSupported()
+{
+    // function-local statics are initialized exactly once, even with racing callers
+    static const bool supported = probeURingSupport();
+    return supported;
+}
+
+iINCURing* iINCURing::acquire(iEventDispatcher* dispatcher)
+{
+    if (!dispatcher || !isSupported()) return IX_NULLPTR;
+
+    iScopedLock<iMutex> lock(uringLock());
+    URingMap& rings = uringMap();
+    URingMap::iterator it = rings.find(dispatcher);
+    if (it != rings.end()) {
+        ++it->second->m_refCount;
+        return it->second;
+    }
+
+    iINCURing* ring = new iINCURing(dispatcher);
+    if (!ring->setup()) {
+        delete ring;
+        return IX_NULLPTR;
+    }
+
+    ring->m_refCount = 1;
+    rings[dispatcher] = ring;
+    return ring;
+}
+
+void iINCURing::release()
+{
+    {
+        iScopedLock<iMutex> lock(uringLock());
+        if (--m_refCount > 0) return;
+        uringMap().erase(m_dispatcher);
+    }
+
+    // a device closed from inside one of our callbacks, or sends of a closed
+    // device still draining: dispatch() finishes the job
+    if (m_processing || hasPendingRequests()) return;
+    delete this;
+}
+
+bool iINCURing::hasPendingRequests() const
+{
+    for (size_t i = 0; i < m_slots.size(); ++i) {
+        if ((m_slots[i]->inflight > 0) || !m_slots[i]->sends.empty())
+            return true;
+    }
+    return false;
+}
+
+iINCURing::iINCURing(iEventDispatcher* dispatcher)
+    : m_dispatcher(dispatcher)
+    , m_source(IX_NULLPTR)
+    , m_refCount(0)
+    , m_processing(false)
+    , m_ringFd(-1)
+    , m_eventFd(-1)
+    , m_sqRingPtr(MAP_FAILED)
+    , m_sqRingSize(0)
+    , m_cqRingPtr(MAP_FAILED)
+    , m_cqRingSize(0)
+    , m_sqes(IX_NULLPTR)
+    , m_sqesSize(0)
+    , m_sqHead(IX_NULLPTR)
+    , m_sqTail(IX_NULLPTR)
+    , m_sqMask(0)
+    , m_sqEntries(0)
+    , m_sqArray(IX_NULLPTR)
+    , m_sqLocalTail(0)
+    , m_cqHead(IX_NULLPTR)
+    , m_cqTail(IX_NULLPTR)
+    , m_cqMask(0)
+    , m_cqes(IX_NULLPTR)
+    , m_bufRing(IX_NULLPTR)
+    , m_bufRingSize(0)
+    , m_bufBase(IX_NULLPTR)
+    , m_bufTail(0)
+{
+}
+
+iINCURing::~iINCURing()
+{
+    teardown();
+}
+
+bool iINCURing::setup()
+{
+    struct io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    m_ringFd = sys_io_uring_setup(URING_ENTRIES, &params);
+    if (m_ringFd < 0) {
+        ilog_warn("io_uring_setup failed:", errno);
+        return false;
+    }
+
+    m_sqRingSize = params.sq_off.array + params.sq_entries * sizeof(xuint32);
+    m_cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    // IORING_FEAT_SINGLE_MMAP: SQ and CQ rings share one mapping
+    m_sqRingSize = std::max(m_sqRingSize, m_cqRingSize);
+    m_cqRingSize = m_sqRingSize;
+
+    m_sqRingPtr = ::mmap(IX_NULLPTR, m_sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ringFd, IORING_OFF_SQ_RING);
+    if (MAP_FAILED == m_sqRingPtr) {
+        ilog_warn("io_uring ring mmap failed:", errno);
+        return false;
+    }
+    m_cqRingPtr = m_sqRingPtr;
+
+    m_sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    void* sqes = ::mmap(IX_NULLPTR, m_sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ringFd, IORING_OFF_SQES);
+    if (MAP_FAILED == sqes) {
+        ilog_warn("io_uring sqe mmap failed:", errno);
+        return false;
+    }
+    m_sqes = static_cast<struct io_uring_sqe*>(sqes);
+
+    char* sq = static_cast<char*>(m_sqRingPtr);
+    m_sqHead = reinterpret_cast<xuint32*>(sq + params.sq_off.head);
+    m_sqTail = reinterpret_cast<xuint32*>(sq + params.sq_off.tail);
+    m_sqMask = *reinterpret_cast<xuint32*>(sq + params.sq_off.ring_mask);
+    m_sqEntries = params.sq_entries;
+    m_sqArray = reinterpret_cast<xuint32*>(sq + params.sq_off.array);
+    m_sqLocalTail = *m_sqTail;
+
+    char* cq = static_cast<char*>(m_cqRingPtr);
+    m_cqHead = reinterpret_cast<xuint32*>(cq + params.cq_off.head);
+    m_cqTail = reinterpret_cast<xuint32*>(cq + params.cq_off.tail);
+    m_cqMask = *reinterpret_cast<xuint32*>(cq + params.cq_off.ring_mask);
+    m_cqes = reinterpret_cast<struct io_uring_cqe*>(cq + params.cq_off.cqes);
+
+    // Provided buffer ring for multishot receive
+    m_bufRingSize = URING_BUF_COUNT * sizeof(struct io_uring_buf);
+    void* bufRing = ::mmap(IX_NULLPTR, m_bufRingSize, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE | MAP_POPULATE, -1, 0);
+    void* bufBase = ::mmap(IX_NULLPTR, URING_BUF_COUNT * URING_BUF_SIZE, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    if (MAP_FAILED == bufRing || MAP_FAILED == bufBase) {
+        if (MAP_FAILED != bufRing) ::munmap(bufRing, m_bufRingSize);
+        if (MAP_FAILED != bufBase) ::munmap(bufBase, URING_BUF_COUNT * URING_BUF_SIZE);
+        ilog_warn("io_uring buffer mmap failed:", errno);
+        return false;
+    }
+    m_bufRing = static_cast<struct io_uring_buf_ring*>(bufRing);
+    m_bufBase = static_cast<char*>(bufBase);
+
+    for (xuint16 bid = 0; bid < URING_BUF_COUNT; ++bid)
+        recycleBuffer(bid);
+
+    struct io_uring_buf_reg reg;
+    std::memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = reinterpret_cast<xuint64>(m_bufRing);
+    reg.ring_entries = URING_BUF_COUNT;
+    reg.bgid = URING_BUF_GROUP;
+    if (sys_io_uring_register(m_ringFd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        ilog_warn("io_uring provided buffer ring registration failed:", errno);
+        return false;
+    }
+
+    m_eventFd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_eventFd < 0 || sys_io_uring_register(m_ringFd, IORING_REGISTER_EVENTFD, &m_eventFd, 1) < 0) {
+        ilog_warn("io_uring eventfd registration failed:", errno);
+        return false;
+    }
+
+    m_source = new iURingEventSource(this, m_eventFd);
+    m_source->attach(m_dispatcher);
+    ilog_debug("io_uring ring ready, sq entries:", m_sqEntries, " fd:", m_ringFd);
+    return true;
+}
+
+void iINCURing::teardown()
+{
+    if (m_source) {
+        m_source->m_ring = IX_NULLPTR;
+        m_source->detach();
+        m_source->deref();
+        m_source = IX_NULLPTR;
+    }
+
+    int pending = 0;
+    for (size_t i = 0; i < m_slots.size(); ++i)
+        pending += m_slots[i]->inflight;
+
+    // Requests may still point into SendEntry memory: cancel them and reap before unmapping
+    if ((m_ringFd >= 0) && (pending > 0) && m_cqHead) {
+        struct io_uring_sqe* sqe = getSqe();
+        if (sqe) {
+            sqe->opcode = IORING_OP_ASYNC_CANCEL;
+            sqe->fd = -1;
+            sqe->cancel_flags = IORING_ASYNC_CANCEL_ANY | IORING_ASYNC_CANCEL_ALL;
+            sqe->user_data = makeUserData(0, 0, OP_CANCEL);
+        }
+
+        for (int round = 0; (pending > 0) && (round < 100); ++round) {
+            if (submit(1) < 0 && errno != EINTR) break;
+
+            xuint32 head = *m_cqHead;
+            xuint32 tail = __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE);
+            for (; head != tail; ++head) {
+                const struct io_uring_cqe& cqe = m_cqes[head & m_cqMask];
+                xuint32 op = static_cast<xuint32>(cqe.user_data >> 40) & 0xFF;
+                if ((OP_SEND == op) || ((OP_RECV == op) && !(cqe.flags & IORING_CQE_F_MORE)))
+                    --pending;
+            }
+            __atomic_store_n(m_cqHead, head, __ATOMIC_RELEASE);
+        }
+    }
+
+    for (size_t i = 0; i < m_slots.size(); ++i) {
+        // detached sockets whose requests never drained
+        if (m_slots[i]->fd >= 0) ::close(m_slots[i]->fd);
+        delete m_slots[i];
+    }
+    m_slots.clear();
+    m_freeSlots.clear();
+    m_dirtySlots.clear();
+    m_writeWaiters.clear();
+
+    if (m_ringFd >= 0) {
+        ::close(m_ringFd);
+        m_ringFd = -1;
+    }
+    if (m_eventFd >= 0) {
+        ::close(m_eventFd);
+        m_eventFd = -1;
+    }
+    if (m_sqes) {
+        ::munmap(m_sqes, m_sqesSize);
+        m_sqes = IX_NULLPTR;
+    }
+    if (MAP_FAILED != m_sqRingPtr) {
+        ::munmap(m_sqRingPtr, m_sqRingSize);
+        m_sqRingPtr = MAP_FAILED;
+        m_cqRingPtr = MAP_FAILED;
+    }
+    if (m_bufRing) {
+        ::munmap(m_bufRing, m_bufRingSize);
+        m_bufRing = IX_NULLPTR;
+    }
+    if (m_bufBase) {
+        ::munmap(m_bufBase, URING_BUF_COUNT * URING_BUF_SIZE);
+        m_bufBase = IX_NULLPTR;
+    }
+}
+
+xuint64 iINCURing::makeUserData(xuint32 index, xuint16 generation, OpType op)
+{
+    return (static_cast<xuint64>(op) << 40) | (static_cast<xuint64>(generation) << 24) | (index & 0xFFFFFF);
+}
+
+iINCURing::Slot* iINCURing::slotOf(xuint64 handle, xuint32* index)
+{
+    xuint32 idx = static_cast<xuint32>(handle & 0xFFFFFFFF) - 1;
+    xuint16 generation = static_cast<xuint16>(handle >> 32);
+    if (idx >= m_slots.size()) return IX_NULLPTR;
+
+    Slot* slot = m_slots[idx];
+    if (!slot->device || slot->generation != generation) return IX_NULLPTR;
+    if (index) *index = idx;
+    return slot;
+}
+
+xuint64 iINCURing::attachDevice(iTcpDevice* device, int fd)
+{
+    xuint32 index = 0;
+    if (!m_freeSlots.empty()) {
+        index = m_freeSlots.back();
+        m_freeSlots.pop_back();
+    } else if (m_slots.size() < 0xFFFFFF) {
+        index = static_cast<xuint32>(m_slots.size());
+        Slot* slot = new Slot;
+        slot->generation = 0;
+        slot->dirty = false;
+        m_slots.push_back(slot);
+    } else {
+        return 0;
+    }
+
+    Slot* slot = m_slots[index];
+    slot->device = device;
+    slot->fd = fd;
+    slot->readWanted = false;
+    slot->recvArmed = false;
+    slot->writeWanted = false;
+    slot->sendFailed = false;
+    slot->cancelPending = false;
+    slot->inflight = 0;
+    slot->sendsInFlight = 0;
+    slot->sendsAcked = 0;
+    slot->queuedBytes = 0;
+    return (static_cast<xuint64>(slot->generation) << 32) | (index + 1);
+}
+
+void iINCURing::detachDevice(xuint64 handle)
+{
+    xuint32 index = 0;
+    Slot* slot = slotOf(handle, &index);
+    if (!slot) return;
+
+    slot->device = IX_NULLPTR;
+    slot->readWanted = false;
+    slot->writeWanted = false;
+
+    // Bytes already accepted from the protocol still go out, like data left in a socket buffer
+    flushSends(index);
+
+    if (slot->recvArmed)
+        cancelRecv(index);
+
+    // Linked SENDMSGs resolve their fd only when issued, so the fd must stay
+    // open (and unrecycled) until the whole chain is reaped: retireSlot() closes it
+    submit(0);
+
+    if (0 == slot->inflight)
+        retireSlot(index);
+}
+
+void iINCURing::retireSlot(xuint32 index)
+{
+    Slot* slot = m_slots[index];
+    slot->sends.clear();
+    slot->device = IX_NULLPTR;
+    slot->cancelPending = false;
+    if (slot->fd >= 0) ::close(slot->fd);
+    slot->fd = -1;
+    slot->queuedBytes = 0;
+    // a stale m_dirtySlots entry is harmless: flushSends() on an empty queue is a no-op
+    ++slot->generation;
+    m_freeSlots.push_back(index);
+}
+
+void iINCURing::markDirty(xuint32 index)
+{
+    Slot* slot = m_slots[index];
+    if (slot->dirty) return;
+
+    slot->dirty = true;
+    m_dirtySlots.push_back(index);
+}
+
+void iINCURing::setReadEnabled(xuint64 handle, bool enable)
+{
+    xuint32 index = 0;
+    Slot* slot = slotOf(handle, &index);
+    if (!slot || (slot->readWanted == enable)) return;
+
+    slot->readWanted = enable;
+    if (enable) {
+        // the armed recv serves again, a cancel still waiting for an SQE would only stop it
+        slot->cancelPending = false;
+        if (!slot->recvArmed) armRecv(index);
+        return;
+    }
+
+    if (slot->recvArmed)
+        cancelRecv(index);
+}
+
+void iINCURing::cancelRecv(xuint32 index)
+{
+    Slot* slot = m_slots[index];
+    struct io_uring_sqe* sqe = getSqe();
+    if (!sqe) {
+        // Left armed the recv would keep inflight above 0 and the fd open for good
+        slot->cancelPending = true;
+        markDirty(index);
+        return;
+    }
+
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = makeUserData(index, slot->generation, OP_RECV);
+    sqe->user_data = makeUserData(index, slot->generation, OP_CANCEL);
+    slot->cancelPending = false;
+}
+
+void iINCURing::setWriteWanted(xuint64 handle, bool wanted)
+{
+    xuint32 index = 0;
+    Slot* slot = slotOf(handle, &index);
+    if (!slot || (slot->writeWanted == wanted)) return;
+
+    slot->writeWanted = wanted;
+    if (wanted) m_writeWaiters.push_back(index);
+}
+
+void iINCURing::armRecv(xuint32 index)
+{
+    Slot* slot = m_slots[index];
+    struct io_uring_sqe* sqe = getSqe();
+    if (!sqe) {
+        ilog_warn("[", slot->fd, "] io_uring submission queue full, receive not armed");
+        return;
+    }
+
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = slot->fd;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = URING_BUF_GROUP;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->user_data = makeUserData(index, slot->generation, OP_RECV);
+    slot->recvArmed = true;
+    ++slot->inflight;
+}
+
+xint64 iINCURing::queueSend(xuint64 handle, const iINCMessage& msg, xint64 offset)
+{
+    xuint32 index = 0;
+    Slot* slot = slotOf(handle, &index);
+    if (!slot || slot->sendFailed) return -1;
+
+    xint64 total = static_cast<xint64>(sizeof(iINCMessageHeader)) + msg.payload().size();
+    if (offset >= total) return 0;
+    if (slot->queuedBytes >= URING_SEND_BACKLOG) return 0;
+
+    slot->sends.push_back(SendEntry(msg));
+    SendEntry& entry = slot->sends.back();
+    entry.header = msg.header();
+    entry.offset = offset;
+    slot->queuedBytes += total - offset;
+    markDirty(index);
+    return total - offset;
+}
+
+void iINCURing::flushSends(xuint32 index)
+{
+    Slot* slot = m_slots[index];
+    // one chain per socket at a time, otherwise two chains could interleave on the stream
+    if (slot->sendsInFlight > 0 || slot->sends.empty()) return;
+
+    xuint32 freeEntries = m_sqEntries - (m_sqLocalTail - __atomic_load_n(m_sqHead, __ATOMIC_ACQUIRE));
+    if (freeEntries < slot->sends.size()) {
+        submit(0);
+        freeEntries = m_sqEntries - (m_sqLocalTail - __atomic_load_n(m_sqHead, __ATOMIC_ACQUIRE));
+    }
+
+    size_t count = std::min<size_t>(slot->sends.size(), freeEntries);
+    struct io_uring_sqe* prev = IX_NULLPTR;
+    for (size_t i = 0; i < count; ++i) {
+        SendEntry& entry = slot->sends[i];
+        const iByteArray& payload = entry.msg.payload().data();
+        const xint64 headerSize = static_cast<xint64>(sizeof(iINCMessageHeader));
+
+        int iovCount = 0;
+        if (entry.offset < headerSize) {
+            entry.iov[iovCount].iov_base = reinterpret_cast<char*>(&entry.header) + entry.offset;
+            entry.iov[iovCount].iov_len = static_cast<size_t>(headerSize - entry.offset);
+            ++iovCount;
+        }
+
+        xint64 payloadOffset = std::max<xint64>(0, entry.offset - headerSize);
+        if (payloadOffset < payload.size()) {
+            entry.iov[iovCount].iov_base = const_cast<char*>(payload.constData()) + payloadOffset;
+            entry.iov[iovCount].iov_len = static_cast<size_t>(payload.size() - payloadOffset);
+            ++iovCount;
+        }
+
+        std::memset(&entry.msgh, 0, sizeof(entry.msgh));
+        entry.msgh.msg_iov = entry.iov;
+        entry.msgh.msg_iovlen = iovCount;
+
+        struct io_uring_sqe* sqe = getSqe();
+        IX_ASSERT(sqe);
+        sqe->opcode = IORING_OP_SENDMSG;
+        sqe->fd = slot->fd;
+        sqe->addr = reinterpret_cast<xuint64>(&entry.msgh);
+        sqe->len = 1;
+        sqe->msg_flags = MSG_NOSIGNAL | MSG_WAITALL;
+        sqe->user_data = makeUserData(index, slot->generation, OP_SEND);
+        if (prev) prev->flags |= IOSQE_IO_LINK;
+        prev = sqe;
+    }
+
+    slot->sendsInFlight = static_cast<int>(count);
+    slot->sendsAcked = 0;
+    slot->inflight += static_cast<int>(count);
+}
+
+void iINCURing::flush()
+{
+    for (size_t i = 0; i < m_dirtySlots.size(); ++i) {
+        xuint32 index = m_dirtySlots[i];
+        Slot* slot = m_slots[index];
+        // still listed here, so a cancel that finds the queue full again waits for the next flush()
+        if (slot->cancelPending) {
+            slot->cancelPending = false;
+            if (slot->recvArmed) cancelRecv(index);
+        }
+        slot->dirty = false;
+        flushSends(index);
+        // a chain was still in flight, retry once it completes
+        if ((slot->sendsInFlight == 0 && !slot->sends.empty()) || slot->cancelPending)
+            slot->dirty = true;
+    }
+
+    std::vector<xuint32> stillDirty;
+    for (size_t i = 0; i < m_dirtySlots.size(); ++i) {
+        if (m_slots[m_dirtySlots[i]]->dirty) stillDirty.push_back(m_dirtySlots[i]);
+    }
+    m_dirtySlots.swap(stillDirty);
+
+    if (m_sqLocalTail != *m_sqTail)
+        submit(0);
+}
+
+struct io_uring_sqe* iINCURing::getSqe()
+{
+    xuint32 head = __atomic_load_n(m_sqHead, __ATOMIC_ACQUIRE);
+    if (m_sqLocalTail - head >= m_sqEntries) {
+        submit(0);
+        head = __atomic_load_n(m_sqHead, __ATOMIC_ACQUIRE);
+        if (m_sqLocalTail - head >= m_sqEntries) return IX_NULLPTR;
+    }
+
+    xuint32 idx = m_sqLocalTail & m_sqMask;
+    struct io_uring_sqe* sqe = &m_sqes[idx];
+    std::memset(sqe, 0, sizeof(*sqe));
+    m_sqArray[idx] = idx;
+    ++m_sqLocalTail;
+    return sqe;
+}
+
+int iINCURing::submit(xuint32 waitNr)
+{
+    xuint32 toSubmit = m_sqLocalTail - *m_sqTail;
+    __atomic_store_n(m_sqTail, m_sqLocalTail, __ATOMIC_RELEASE);
+    if (0 == toSubmit && 0 == waitNr) return 0;
+
+    int ret = 0;
+    do {
+        ret = sys_io_uring_enter(m_ringFd, toSubmit, waitNr, waitNr ? IORING_ENTER_GETEVENTS : 0);
+    } while (ret < 0 && errno == EINTR);
+
+    if (ret < 0 && errno != EAGAIN && errno != EBUSY)
+        ilog_warn("io_uring_enter failed:", errno);
+    return ret;
+}
+
+bool iINCURing::hasCompletions() const
+{
+    return __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE) != *m_cqHead;
+}
+
+bool iINCURing::hasWork() const
+{
+    if (hasCompletions()) return true;
+
+    for (size_t i = 0; i < m_writeWaiters.size(); ++i) {
+        const Slot* slot = m_slots[m_writeWaiters[i]];
+        if (slot->writeWanted && slot->device && (slot->queuedBytes < URING_SEND_BACKLOG))
+            return true;
+    }
+    return false;
+}
+
+bool iINCURing::dispatch()
+{
+    m_processing = true;
+    processCompletions();
+    notifyWritable();
+    m_processing = false;
+
+    if ((m_refCount > 0) || hasPendingRequests()) return true;
+
+    // the last device went away and its requests have drained
+    delete this;
+    return true;
+}
+
+void iINCURing::recycleBuffer(xuint16 bid)
+{
+    // Index from the ring base: in C++ __DECLARE_FLEX_ARRAY's empty struct shifts 'bufs' by 8 bytes
+    struct io_uring_buf* buf = reinterpret_cast<struct io_uring_buf*>(m_bufRing) + (m_bufTail & (URING_BUF_COUNT - 1));
+    buf->addr = reinterpret_cast<xuint64>(m_bufBase + static_cast<size_t>(bid) * URING_BUF_SIZE);
+    buf->len = URING_BUF_SIZE;
+    buf->bid = bid;
+    ++m_bufTail;
+    __atomic_store_n(&m_bufRing->tail, m_bufTail, __ATOMIC_RELEASE);
+}
+
+void iINCURing::processCompletions()
+{
+    xuint32 head = *m_cqHead;
+    while (head != __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE)) {
+        const struct io_uring_cqe& cqe = m_cqes[head & m_cqMask];
+        xuint64 userData = cqe.user_data;
+        xint32 res = cqe.res;
+        xuint32 flags = cqe.flags;
+
+        // release the CQE before calling out, callbacks may queue new work
+        ++head;
+        __atomic_store_n(m_cqHead, head, __ATOMIC_RELEASE);
+
+        xuint32 index = static_cast<xuint32>(userData & 0xFFFFFF);
+        xuint16 generation = static_cast<xuint16>(userData >> 24);
+        xuint32 op = static_cast<xuint32>(userData >> 40) & 0xFF;
+        bool valid = (OP_CANCEL != op) && (index < m_slots.size()) && (m_slots[index]->generation == generation);
+
+        if (!valid) {
+            if (flags & IORING_CQE_F_BUFFER)
+                recycleBuffer(static_cast<xuint16>(flags >> IORING_CQE_BUFFER_SHIFT));
+            continue;
+        }
+
+        if (OP_RECV == op) {
+            handleRecv(index, res, flags);
+        } else if (OP_SEND == op) {
+            handleSend(index, res);
+        }
+
+        Slot* slot = m_slots[index];
+        if (!slot->device && (0 == slot->inflight) && (slot->generation == generation))
+            retireSlot(index);
+    }
+}
+
+void iINCURing::handleRecv(xuint32 index, xint32 res, xuint32 flags)
+{
+    Slot* slot = m_slots[index];
+    if (!(flags & IORING_CQE_F_MORE)) {
+        slot->recvArmed = false;
+        --slot->inflight;
+    }
+
+    if (flags & IORING_CQE_F_BUFFER) {
+        xuint16 bid = static_cast<xuint16>(flags >> IORING_CQE_BUFFER_SHIFT);
+        if ((res > 0) && slot->device)
+            slot->device->uringReceived(m_bufBase + static_cast<size_t>(bid) * URING_BUF_SIZE, res);
+        recycleBuffer(bid);
+    }
+
+    // the device may have been closed by the callback
+    if (!slot->device || slot->recvArmed) return;
+
+    if (0 == res) {
+        slot->readWanted = false;
+        slot->device->uringFailed(0);
+        return;
+    }
+
+    if ((res < 0) && (-ECANCELED != res) && (-ENOBUFS != res)) {
+        slot->readWanted = false;
+        slot->device->uringFailed(res);
+        return;
+    }
+
+    // multishot ended (out of buffers, cancelled then re-enabled, or kernel limit): re-arm
+    if (slot->readWanted)
+        armRecv(index);
+}
+
+void iINCURing::handleSend(xuint32 index, xint32 res)
+{
+    Slot* slot = m_slots[index];
+    --slot->inflight;
+    IX_ASSERT(slot->sendsAcked < slot->sendsInFlight);
+
+    // linked requests complete in submission order
+    SendEntry& entry = slot->sends[slot->sendsAcked++];
+    if (res > 0) {
+        entry.offset += res;
+        slot->queuedBytes -= res;
+    } else if ((res < 0) && (-ECANCELED != res)) {
+        slot->sendFailed = true;
+    }
+
+    if (slot->sendsAcked < slot->sendsInFlight) return;
+
+    // Chain done: drop what went out completely, anything cut short is resubmitted in order
+    int done = slot->sendsInFlight;
+    slot->sendsInFlight = 0;
+    slot->sendsAcked = 0;
+    for (int i = 0; i < done && !slot->sends.empty(); ++i) {
+        const SendEntry& front = slot->sends.front();
+        xint64 total = static_cast<xint64>(sizeof(iINCMessageHeader)) + front.msg.payload().size();
+        if (front.offset < total) break;
+        slot->sends.pop_front();
+    }
+
+    if (slot->sendFailed) {
+        slot->sends.clear();
+        slot->queuedBytes = 0;
+        if (slot->device) slot->device->uringFailed(res < 0 ? res : -EPIPE);
+        return;
+    }
+
+    if (!slot->sends.empty())
+        markDirty(index);
+}
+
+void iINCURing::notifyWritable()
+{
+    if (m_writeWaiters.empty()) return;
+
+    std::vector<xuint32> waiters;
+    waiters.swap(m_writeWaiters);
+    for (size_t i = 0; i < waiters.size(); ++i) {
+        Slot* slot = m_slots[waiters[i]];
+        if (!slot->writeWanted || !slot->device) continue;
+
+        if (slot->queuedBytes >= URING_SEND_BACKLOG) {
+            m_writeWaiters.push_back(waiters[i]);
+            continue;
+        }
+
+        slot->writeWanted = false;
+        slot->device->uringWritable();
+    }
+}
+
+} // namespace iShell
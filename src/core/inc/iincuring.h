@@ -0,0 +1,169 @@
+/////////////////////////////////////////////////////////////////
+/// Copyright 2018-2020
+/// All rights reserved.
+/////////////////////////////////////////////////////////////////
+/// @file    iincuring.h
+/// @brief   io_uring completion backend for stream INC transports
+/// @version 1.0
+/// @author  ncjiakechong@gmail.com
+/////////////////////////////////////////////////////////////////
+#ifndef IINCURING_H
+#define IINCURING_H
+
+#include <deque>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+
+#include <core/inc/iincmessage.h>
+
+namespace iShell {
+
+class iTcpDevice;
+class iEventDispatcher;
+class iURingEventSource;
+
+/// @brief One io_uring instance shared by all stream devices of one event dispatcher
+/// @details Receive side: one multishot RECV per socket, data lands in a provided-buffer
+///          ring and is handed to the device without a readiness round trip.
+///          Send side: messages queued during a dispatch are flushed as one IOSQE_IO_LINK
+///          chain per socket in prepare(), so a loop iteration costs one io_uring_enter().
+///          Completions are signalled through an eventfd polled by iEventDispatcher.
+/// @note Not thread-safe: every call must come from the dispatcher's thread
+class iINCURing
+{
+public:
+    /// Probe kernel support once (ring setup, RECV/SENDMSG/ASYNC_CANCEL, multishot RECV)
+    static bool isSupported();
+
+    /// Get the ring of a dispatcher, creating it on first use
+    /// @return Referenced ring, or IX_NULLPTR if io_uring is unavailable
+    static iINCURing* acquire(iEventDispatcher* dispatcher);
+
+    /// Drop a reference obtained by acquire(); the last one destroys the ring
+    /// once the requests of detached devices have drained
+    void release();
+
+    /// Bind a connected socket to the ring
+    /// @return Handle for the other calls, 0 on failure
+    xuint64 attachDevice(iTcpDevice* device, int fd);
+
+    /// Unbind a device and take over its fd: queued sends still go out, the
+    /// receive is cancelled, and the ring closes the fd once every request on
+    /// it has completed. The caller must not close the fd itself.
+    void detachDevice(xuint64 handle);
+
+    /// Start or stop the multishot receive
+    void setReadEnabled(xuint64 handle, bool enable);
+
+    /// Request a writable notification once send backlog has room
+    void setWriteWanted(xuint64 handle, bool wanted);
+
+    /// Queue message bytes starting at offset
+    /// @return Bytes accepted (the whole remainder), 0 when the backlog is full, -1 on error
+    xint64 queueSend(xuint64 handle, const iINCMessage& msg, xint64 offset);
+
+private:
+    enum OpType {
+        OP_RECV     = 1,
+        OP_SEND     = 2,
+        OP_CANCEL   = 3
+    };
+
+    struct SendEntry {
+        iINCMessage         msg;        ///< keeps payload alive until the kernel is done
+        iINCMessageHeader   header;
+        xint64              offset;     ///< bytes of header+payload already on the wire
+        struct iovec        iov[2];
+        struct msghdr       msgh;
+
+        explicit SendEntry(const iINCMessage& m) : msg(m), offset(0) {}
+    };
+
+    struct Slot {
+        iTcpDevice*         device;     ///< IX_NULLPTR once detached
+        int                 fd;         ///< owned by the ring after detachDevice()
+        xuint16             generation;
+        bool                readWanted;
+        bool                recvArmed;
+        bool                writeWanted;
+        bool                sendFailed;
+        bool                cancelPending; ///< recv cancel waits for a free SQE, issued by flush()
+        bool                dirty;      ///< listed in m_dirtySlots
+        int                 inflight;   ///< outstanding kernel requests (recv + sends)
+        int                 sendsInFlight;
+        int                 sendsAcked;
+        xint64              queuedBytes;
+        std::deque<SendEntry> sends;    ///< front sendsInFlight entries belong to the kernel
+    };
+
+    iINCURing(iEventDispatcher* dispatcher);
+    ~iINCURing();
+
+    bool setup();
+    void teardown();
+    bool dispatch();
+
+    struct io_uring_sqe* getSqe();
+    int submit(xuint32 waitNr);
+    bool hasCompletions() const;
+    bool hasWork() const;
+    bool hasPendingRequests() const;
+
+    void armRecv(xuint32 index);
+    void cancelRecv(xuint32 index);
+    void flushSends(xuint32 index);
+    void flush();
+    void processCompletions();
+    void handleRecv(xuint32 index, xint32 res, xuint32 flags);
+    void handleSend(xuint32 index, xint32 res);
+    void notifyWritable();
+    void recycleBuffer(xuint16 bid);
+    void markDirty(xuint32 index);
+    void retireSlot(xuint32 index);
+    Slot* slotOf(xuint64 handle, xuint32* index = IX_NULLPTR);
+
+    static xuint64 makeUserData(xuint32 index, xuint16 generation, OpType op);
+
+    iEventDispatcher*   m_dispatcher;
+    iURingEventSource*  m_source;
+    int                 m_refCount;
+    bool                m_processing;   ///< inside device callbacks, defer self destruction
+
+    int                 m_ringFd;
+    int                 m_eventFd;
+    void*               m_sqRingPtr;
+    size_t              m_sqRingSize;
+    void*               m_cqRingPtr;
+    size_t              m_cqRingSize;
+    struct io_uring_sqe* m_sqes;
+    size_t              m_sqesSize;
+
+    xuint32*            m_sqHead;
+    xuint32*            m_sqTail;
+    xuint32             m_sqMask;
+    xuint32             m_sqEntries;
+    xuint32*            m_sqArray;
+    xuint32             m_sqLocalTail;  ///< tail not yet published to the kernel
+    xuint32*            m_cqHead;
+    xuint32*            m_cqTail;
+    xuint32             m_cqMask;
+    struct io_uring_cqe* m_cqes;
+
+    struct io_uring_buf_ring* m_bufRing;
+    size_t              m_bufRingSize;
+    char*               m_bufBase;
+    xuint16             m_bufTail;
+
+    std::vector<Slot*>  m_slots;        ///< stable addresses, the kernel points into SendEntry
+    std::vector<xuint32> m_freeSlots;
+    std::vector<xuint32> m_dirtySlots;  ///< slots with unsubmitted sends
+    std::vector<xuint32> m_writeWaiters;
+
+    friend class iURingEventSource;
+};
+
+} // namespace iShell
+
+#endif // IINCURING_H
@@ -9,6 +9,7 @@
 #include <cstring>
 
 #include <core/io/ilog.h>
+#include <core/io/ibinarylog.h>
 #include <core/inc/iincmessage.h>
 
 #include "core/kernel/ipoll.h"
@@ -143,12 +144,15 @@ void iRtpClientDevice::receivedPacket(const iRtpPacket& packet)
         m_rxHave = true;
     }
     if (rh.sequenceNumber != m_rxExpectSeq) {
+        ilog_trace_verbose("[", peerAddress(), "] RTP sequence gap, expected ", m_rxExpectSeq,
+                           " got ", rh.sequenceNumber, ", message dropped");
         m_rxAccum = iByteArray();
         m_rxHave = false;
         return;
     }
     m_rxExpectSeq = static_cast<xuint16>(rh.sequenceNumber + 1);
     if (m_rxAccum.size() + packet.payload().size() > kMaxReassemblyBytes) {
+        ilog_trace_verbose("[", peerAddress(), "] RTP message over ", kMaxReassemblyBytes, " bytes dropped");
         m_rxAccum = iByteArray();
         m_rxHave = false;
         return;
@@ -21,6 +21,7 @@
 #include <core/kernel/ieventsource.h>
 #include <core/kernel/ieventdispatcher.h>
 #include <core/io/ilog.h>
+#include <core/io/ibinarylog.h>
 
 #include "inc/irtpdevice.h"
 #include "inc/irtpclientdevice.h"
@@ -43,6 +44,8 @@ public:
         , m_device(device)
         , m_monitorEvents(0)
     {
+        // only ever ready through m_pollFd
+        setFlags(flags() | IX_EVENT_SOURCE_POLL_DRIVEN);
         m_pollFd.fd = -1;
         m_pollFd.events = 0;
         m_pollFd.revents = 0;
@@ -407,6 +410,8 @@ xint64 iRtpDevice::writeMessage(const iINCMessage& msg, xint64 offset)
 
     std::vector<iByteArray> pkts;
     buildPackets(msg, m_ssrc, m_txSeq, m_txTimestamp++, m_maxPayload, pkts);
+    ilog_trace_verbose("[", peerAddress(), "][", msg.channelID(), "][", msg.sequenceNumber(),
+                       "] Sending message in ", pkts.size(), " RTP packets");
     for (size_t i = 0; i < pkts.size(); ++i) {
         if (sendDatagram(pkts[i]) < 0) return -1;
     }
@@ -484,12 +489,15 @@ void iRtpDevice::processRx()
                 m_rxHave = true;
             }
             if (rh.sequenceNumber != m_rxExpectSeq) {
+                ilog_trace_verbose("[", peerAddress(), "] RTP sequence gap, expected ", m_rxExpectSeq,
+                                   " got ", rh.sequenceNumber, ", message dropped");
                 m_rxAccum = iByteArray();
                 m_rxHave = false;
                 continue;
             }
             m_rxExpectSeq = static_cast<xuint16>(rh.sequenceNumber + 1);
             if (m_rxAccum.size() + pkt.payload().size() > kMaxReassemblyBytes) {
+                ilog_trace_verbose("[", peerAddress(), "] RTP message over ", kMaxReassemblyBytes, " bytes dropped");
                 m_rxAccum = iByteArray();
                 m_rxHave = false;
                 continue;
@@ -26,6 +26,9 @@
 #include <core/io/ilog.h>
 
 #include "inc/itcpdevice.h"
+#ifdef IBUILD_HAVE_IO_URING
+#include "inc/iincuring.h"
+#endif
 
 // macOS/BSD portability: emulate the Linux-only SOCK_CLOEXEC / MSG_NOSIGNAL.
 #ifndef SOCK_CLOEXEC
@@ -68,7 +71,10 @@ public:
         , m_readBytes(0)
         , m_writeBytes(0)
         , m_monitorEvents(0)
+        , m_wantedEvents(0)
     {
+        // only ever ready through m_pollFd
+        setFlags(flags() | IX_EVENT_SOURCE_POLL_DRIVEN);
         m_pollFd.fd = -1;
         m_pollFd.events = 0;  // No events initially
         m_pollFd.revents = 0;
@@ -100,6 +106,26 @@ public:
         }
 
         m_monitorEvents = newEvents;
+        m_wantedEvents = newEvents;
+        applyEvents();
+    }
+
+    bool isEdgeTriggered() const {
+        return (m_pollFd.events & IX_IO_EDGE) != 0;
+    }
+
+    /// Registers m_wantedEvents, in the mode the device asks for once the dispatcher is known
+    void applyEvents() {
+        xint32 newEvents = m_wantedEvents;
+        iEventDispatcher* loop = dispatcher();
+        if (newEvents && loop && loop->supportsPollModes()) {
+            // Write interest stays armed, only its edges are reported
+            if (m_device->isEdgeTriggered())
+                newEvents |= IX_IO_OUT | IX_IO_EDGE;
+            if (m_device->isExclusiveAccept() && (m_device->role() == iINCDevice::ROLE_SERVER))
+                newEvents |= IX_IO_EXCLUSIVE;
+        }
+
         if (!newEvents && m_pollFd.events) {
             removePoll(&m_pollFd);
             m_pollFd.events = 0;
@@ -124,18 +150,18 @@ public:
 
     bool detectHang(xuint32 /*combo*/) IX_OVERRIDE {
         if ((m_monitorEvents & IX_IO_IN) && m_readBytes == 0) {
-            m_monitorEvents = m_pollFd.events;
+            m_monitorEvents = m_wantedEvents;
             return true;
         }
 
         if ((m_monitorEvents & IX_IO_OUT) && m_writeBytes == 0) {
-            m_monitorEvents = m_pollFd.events;
+            m_monitorEvents = m_wantedEvents;
             return true;
         }
 
         m_readBytes = 0;
         m_writeBytes = 0;
-        m_monitorEvents = m_pollFd.events;
+        m_monitorEvents = m_wantedEvents;
         return false;
     }
 
@@ -145,7 +171,7 @@ public:
 
     bool check() IX_OVERRIDE {
         bool hasError = (m_pollFd.revents & (IX_IO_ERR | IX_IO_HUP)) != 0;
-        return (m_pollFd.revents & m_pollFd.events) || hasError;
+        return (m_pollFd.revents & m_wantedEvents) || hasError;
     }
 
     bool dispatch() IX_OVERRIDE {
@@ -163,16 +189,18 @@ public:
             tcp->handleConnectionComplete();
         }
 
+        // An edge is reported once, so everything pending is taken now
+        const bool drain = isEdgeTriggered();
         if (tcp->role() == iINCDevice::ROLE_SERVER && readReady) {
-            tcp->acceptConnection();
+            while (tcp->acceptConnection() && drain && isAttached()) {}
             return true;
         }
 
         if (readReady) {
-            tcp->processRx();
+            while (tcp->processRx() && drain && isAttached() && (m_wantedEvents & IX_IO_IN)) {}
         }
 
-        if (writeReady) {
+        if (writeReady && (m_wantedEvents & IX_IO_OUT)) {
             IEMIT tcp->bytesWritten(0);
         }
 
@@ -191,6 +219,7 @@ public:
     int             m_readBytes;
     int             m_writeBytes;
     int             m_monitorEvents;
+    xint32          m_wantedEvents; ///< what the device asked for, m_pollFd.events may hold more
 };
 
 iTcpDevice::iTcpDevice(Role role, iObject *parent)
@@ -200,6 +229,11 @@ iTcpDevice::iTcpDevice(Role role, iObject *parent)
     , m_peerPort(0)
     , m_localPort(0)
     , m_eventSource(IX_NULLPTR)
+    , m_ioUringEnabled(false)
+    , m_edgeTriggered(false)
+    , m_exclusiveAccept(false)
+    , m_uring(IX_NULLPTR)
+    , m_uringHandle(0)
 {
 }
 
@@ -403,11 +437,11 @@ int iTcpDevice::listenOn(const iString& address, xuint16 port)
     return INC_OK;
 }
 
-void iTcpDevice::acceptConnection()
+bool iTcpDevice::acceptConnection()
 {
     if (role() != ROLE_SERVER || !isOpen()) {
         ilog_error("[] acceptConnection only available in listening server mode");
-        return;
+        return false;
     }
 
     struct sockaddr_storage clientAddr;
@@ -419,7 +453,7 @@ void iTcpDevice::acceptConnection()
             ilog_error("[] Accept failed:", errno);
             IEMIT errorOccurred(INC_ERROR_CONNECTION_FAILED);
         }
-        return;
+        return false;
     }
 
     // Set close-on-exec to prevent FD leak to child processes
@@ -432,6 +466,8 @@ void iTcpDevice::acceptConnection()
     // Create new device for accepted connection
     iTcpDevice* clientDevice = new iTcpDevice(ROLE_CLIENT);
     clientDevice->m_sockfd = clientFd;
+    clientDevice->m_ioUringEnabled = m_ioUringEnabled;
+    clientDevice->m_edgeTriggered = m_edgeTriggered;
     clientDevice->m_addrFamily = clientAddr.ss_family;
 
     // Extract peer info
@@ -460,6 +496,7 @@ void iTcpDevice::acceptConnection()
 
     ilog_info("[] Accepted connection from ", clientDevice->m_peerAddr, ":", clientDevice->m_peerPort);
     IEMIT newConnection(clientDevice);
+    return true;
 }
 
 xint64 iTcpDevice::bytesAvailable() const
@@ -516,6 +553,9 @@ ssize_t iTcpDevice::readImpl(char* data, xint64 maxlen)
 
 void iTcpDevice::close()
 {
+    // the ring takes the fd over and closes it once its requests drained
+    stopIOUring();
+
     if (m_eventSource) {
         m_eventSource->detach();
         m_eventSource->deref();
@@ -543,7 +583,13 @@ bool iTcpDevice::startEventMonitoring(iEventDispatcher* dispatcher)
     }
 
     m_eventSource->attach(dispatcher ? dispatcher : iEventDispatcher::instance());
+    // the registration mode depends on the dispatcher
+    static_cast<iTcpEventSource*>(m_eventSource)->applyEvents();
     ilog_debug("[", peerAddress(), "] EventSource monitoring started");
+
+    // connecting sockets switch over in handleConnectionComplete()
+    if (m_ioUringEnabled && (role() == ROLE_CLIENT) && isOpen())
+        startIOUring(m_eventSource->dispatcher());
     return true;
 }
 
@@ -554,6 +600,14 @@ void iTcpDevice::configEventAbility(bool read, bool write)
         return;
     }
 
+    #ifdef IBUILD_HAVE_IO_URING
+    if (m_uring) {
+        m_uring->setReadEnabled(m_uringHandle, read);
+        m_uring->setWriteWanted(m_uringHandle, write);
+        return;
+    }
+    #endif
+
     // Delegate to EventSource's configEventAbility
     iTcpEventSource* tcpSource = static_cast<iTcpEventSource*>(m_eventSource);
     tcpSource->configEventAbility(read, write);
@@ -753,13 +807,96 @@ void iTcpDevice::handleConnectionComplete()
     // Keep monitoring both read and write events temporarily
     // Protocol layer will adjust this after sending queued messages
     configEventAbility(true, false);
+    if (m_ioUringEnabled && m_eventSource && m_eventSource->isAttached())
+        startIOUring(m_eventSource->dispatcher());
 
     ilog_info("[] Connected to ", m_peerAddr, ":", m_peerPort);
     IEMIT connected();
 }
 
+bool iTcpDevice::startIOUring(iEventDispatcher* dispatcher)
+{
+    #ifdef IBUILD_HAVE_IO_URING
+    if (m_uring || (m_sockfd < 0) || !m_eventSource) return (IX_NULLPTR != m_uring);
+
+    iINCURing* ring = iINCURing::acquire(dispatcher);
+    if (!ring) {
+        ilog_debug("[", peerAddress(), "] io_uring unavailable, staying on epoll");
+        return false;
+    }
+
+    xuint64 handle = ring->attachDevice(this, m_sockfd);
+    if (0 == handle) {
+        ring->release();
+        return false;
+    }
+
+    // Carry the current interest over and take the socket out of the poll set
+    iTcpEventSource* tcpSource = static_cast<iTcpEventSource*>(m_eventSource);
+    bool read = (tcpSource->m_pollFd.events & IX_IO_IN) != 0;
+    bool write = (tcpSource->m_pollFd.events & IX_IO_OUT) != 0;
+    tcpSource->configEventAbility(false, false);
+
+    m_uring = ring;
+    m_uringHandle = handle;
+    m_uring->setReadEnabled(m_uringHandle, read);
+    m_uring->setWriteWanted(m_uringHandle, write);
+    ilog_debug("[", peerAddress(), "] Switched to io_uring transport");
+    return true;
+    #else
+    IX_UNUSED(dispatcher);
+    return false;
+    #endif
+}
+
+void iTcpDevice::stopIOUring()
+{
+    #ifdef IBUILD_HAVE_IO_URING
+    if (!m_uring) return;
+
+    iINCURing* ring = m_uring;
+    m_uring = IX_NULLPTR;
+    ring->detachDevice(m_uringHandle);
+    ring->release();
+    m_uringHandle = 0;
+    m_sockfd = -1;
+    #endif
+}
+
+void iTcpDevice::uringReceived(const char* data, int size)
+{
+    m_recvBuffer.append(data, size);
+    parseRxBuffer();
+}
+
+void iTcpDevice::uringFailed(int err)
+{
+    if (0 == err) {
+        ilog_info("[", peerAddress(), "] Connection closed by peer");
+    } else {
+        ilog_error("[", peerAddress(), "] io_uring socket error:", -err);
+    }
+    IEMIT errorOccurred(INC_ERROR_DISCONNECTED);
+}
+
+void iTcpDevice::uringWritable()
+{
+    IEMIT bytesWritten(0);
+}
+
 xint64 iTcpDevice::writeMessage(const iINCMessage& msg, xint64 offset)
 {
+    #ifdef IBUILD_HAVE_IO_URING
+    if (m_uring) {
+        xint64 queued = m_uring->queueSend(m_uringHandle, msg, offset);
+        if (queued < 0) {
+            ilog_error("[", peerAddress(), "] Write failed on io_uring transport");
+            IEMIT errorOccurred(INC_ERROR_DISCONNECTED);
+        }
+        return queued;
+    }
+    #endif
+
     // Serialize message
     iINCMessageHeader header = msg.header();
     const iByteArray& payload = msg.payload().data();
@@ -819,7 +956,7 @@ xint64 iTcpDevice::writeMessage(const iINCMessage& msg, xint64 offset)
     return -1;
 }
 
-void iTcpDevice::processRx()
+bool iTcpDevice::processRx()
 {
     // Bulk read: read as much as available in one recv call (up to 8KB).
     // Then parse all complete messages in a loop, keeping leftover bytes
@@ -833,13 +970,19 @@ void iTcpDevice::processRx()
 
     if (n <= 0) {
         m_recvBuffer.resize(oldSize);
-        if (n < 0) return; // Error or disconnect handled by readImpl
-        if (oldSize == 0) return; // EAGAIN and no buffered data
+        if (n < 0) return false; // Error or disconnect handled by readImpl
+        if (oldSize == 0) return false; // EAGAIN and no buffered data
         // n == 0 (EAGAIN) but have leftover data — fall through to parse
     } else {
         m_recvBuffer.resize(oldSize + n);
     }
 
+    parseRxBuffer();
+    return n > 0;
+}
+
+void iTcpDevice::parseRxBuffer()
+{
     // Parse and emit all complete messages from the buffer
     int consumed = 0;
     const int bufSize = m_recvBuffer.size();
@@ -16,6 +16,7 @@
 namespace iShell {
 
 class iEventSource;
+class iINCURing;
 
 /// @brief TCP transport for both client and server connections
 /// @details Single unified class, not split by client/server role.
@@ -51,11 +52,14 @@ public:
     int listenOn(const iString& address, xuint16 port);
 
     virtual xint64 writeMessage(const iINCMessage& msg, xint64 offset) IX_OVERRIDE;
-    void processRx();
+    /// Reads once and emits the complete messages
+    /// @return true if data was read, the socket may hold more
+    bool processRx();
 
     /// Accept pending connection (server mode only)
     /// Emits newConnection(iTcpDevice*) signal with the client device
-    void acceptConnection();
+    /// @return true if a connection was accepted
+    bool acceptConnection();
 
     // --- Common Methods ---
 
@@ -92,6 +96,24 @@ public:
     /// Set SO_KEEPALIVE option
     bool setKeepAlive(bool keepAlive);
 
+    /// Route socket I/O through the dispatcher's io_uring instead of epoll readiness
+    /// @note Takes effect when monitoring starts; silently stays on epoll if unsupported
+    void setIOUringEnabled(bool enable) { m_ioUringEnabled = enable; }
+    bool isIOUringEnabled() const { return m_ioUringEnabled; }
+
+    /// True when the connection is actually served by io_uring
+    bool isIOUringActive() const { return (IX_NULLPTR != m_uring); }
+
+    /// Register the socket edge-triggered: reads drain it until EAGAIN and write
+    /// interest stays armed, so bursts need no poll updates. Accepted connections inherit it.
+    /// @note Takes effect when monitoring starts; stays level-triggered if the dispatcher cannot
+    void setEdgeTriggered(bool enable) { m_edgeTriggered = enable; }
+    bool isEdgeTriggered() const { return m_edgeTriggered; }
+
+    /// Wake a single dispatcher when several listen on the same socket (server mode only)
+    void setExclusiveAccept(bool enable) { m_exclusiveAccept = enable; }
+    bool isExclusiveAccept() const { return m_exclusiveAccept; }
+
     // iIODevice interface
     bool isSequential() const IX_OVERRIDE { return true; }
     xint64 bytesAvailable() const IX_OVERRIDE;
@@ -112,6 +134,13 @@ private:
     bool setSocketOptions();
     void updatePeerInfo();
     void updateLocalInfo();
+    void parseRxBuffer();
+
+    bool startIOUring(iEventDispatcher* dispatcher);
+    void stopIOUring();
+    void uringReceived(const char* data, int size);
+    void uringFailed(int err);
+    void uringWritable();
 
     int                 m_sockfd;
     int                 m_addrFamily;   ///< AF_INET or AF_INET6
@@ -122,6 +151,13 @@ private:
     iEventSource*       m_eventSource;  ///< Internal EventSource (created in connectToHost/listenOn)
     iByteArray          m_recvBuffer;
 
+    bool                m_ioUringEnabled;
+    bool                m_edgeTriggered;
+    bool                m_exclusiveAccept;
+    iINCURing*          m_uring;        ///< Shared ring of the dispatcher, IX_NULLPTR in epoll mode
+    xuint64             m_uringHandle;
+
+    friend class iINCURing;
     IX_DISABLE_COPY(iTcpDevice)
 };
 
@@ -43,6 +43,8 @@ public:
         , m_writeBytes(0)
         , m_monitorEvents(0)
     {
+        // only ever ready through m_pollFd
+        setFlags(flags() | IX_EVENT_SOURCE_POLL_DRIVEN);
         m_pollFd.fd = -1;
         m_pollFd.events = 0;  // No events initially
         m_pollFd.revents = 0;
@@ -44,7 +44,10 @@ public:
         , m_readBytes(0)
         , m_writeBytes(0)
         , m_monitorEvents(0)
+        , m_wantedEvents(0)
     {
+        // only ever ready through m_pollFd
+        setFlags(flags() | IX_EVENT_SOURCE_POLL_DRIVEN);
         m_pollFd.fd = -1;
         m_pollFd.events = 0;  // No events initially
         m_pollFd.revents = 0;
@@ -76,6 +79,26 @@ public:
         }
 
         m_monitorEvents = newEvents;
+        m_wantedEvents = newEvents;
+        applyEvents();
+    }
+
+    bool isEdgeTriggered() const {
+        return (m_pollFd.events & IX_IO_EDGE) != 0;
+    }
+
+    /// Registers m_wantedEvents, in the mode the device asks for once the dispatcher is known
+    void applyEvents() {
+        xint32 newEvents = m_wantedEvents;
+        iEventDispatcher* loop = dispatcher();
+        if (newEvents && loop && loop->supportsPollModes()) {
+            // Write interest stays armed, only its edges are reported
+            if (m_device->isEdgeTriggered())
+                newEvents |= IX_IO_OUT | IX_IO_EDGE;
+            if (m_device->isExclusiveAccept() && (m_device->role() == iINCDevice::ROLE_SERVER))
+                newEvents |= IX_IO_EXCLUSIVE;
+        }
+
         if (!newEvents && m_pollFd.events) {
             removePoll(&m_pollFd);
             m_pollFd.events = 0;
@@ -100,18 +123,18 @@ public:
 
     bool detectHang(xuint32 /*combo*/) IX_OVERRIDE {
         if ((m_monitorEvents & IX_IO_IN) && m_readBytes == 0) {
-            m_monitorEvents = m_pollFd.events;
+            m_monitorEvents = m_wantedEvents;
             return true;
         }
 
         if ((m_monitorEvents & IX_IO_OUT) && m_writeBytes == 0) {
-            m_monitorEvents = m_pollFd.events;
+            m_monitorEvents = m_wantedEvents;
             return true;
         }
 
         m_readBytes = 0;
         m_writeBytes = 0;
-        m_monitorEvents = m_pollFd.events;
+        m_monitorEvents = m_wantedEvents;
         return false;
     }
 
@@ -121,7 +144,7 @@ public:
 
     bool check() IX_OVERRIDE {
         bool hasError = (m_pollFd.revents & (IX_IO_ERR | IX_IO_HUP)) != 0;
-        return (m_pollFd.revents & m_pollFd.events) || hasError;
+        return (m_pollFd.revents & m_wantedEvents) || hasError;
     }
 
     bool dispatch() IX_OVERRIDE {
@@ -139,16 +162,18 @@ public:
             unixDev->handleConnectionComplete();
         }
 
+        // An edge is reported once, so everything pending is taken now
+        const bool drain = isEdgeTriggered();
         if (unixDev->role() == iINCDevice::ROLE_SERVER && readReady) {
-            unixDev->acceptConnection();
+            while (unixDev->acceptConnection() && drain && isAttached()) {}
             return true;
         }
 
         if (readReady) {
-            unixDev->processRx();
+            while (unixDev->processRx() && drain && isAttached() && (m_wantedEvents & IX_IO_IN)) {}
         }
 
-        if (writeReady) {
+        if (writeReady && (m_wantedEvents & IX_IO_OUT)) {
             IEMIT unixDev->bytesWritten(0);
         }
 
@@ -167,6 +192,7 @@ public:
     int             m_readBytes;
     int             m_writeBytes;
     int             m_monitorEvents;
+    xint32          m_wantedEvents; ///< what the device asked for, m_pollFd.events may hold more
 };
 
 const char* iUnixDevice::SCHEME = "unix";
@@ -178,6 +204,8 @@ iUnixDevice::iUnixDevice(Role role, iObject *parent)
     , m_eventSource(IX_NULLPTR)
     , m_pendingFd(-1)
     , m_lastSentFd(-1)
+    , m_edgeTriggered(false)
+    , m_exclusiveAccept(false)
 {
 }
 
@@ -327,11 +355,11 @@ int iUnixDevice::listenOn(const iString& path)
     return INC_OK;
 }
 
-void iUnixDevice::acceptConnection()
+bool iUnixDevice::acceptConnection()
 {
     if (role() != ROLE_SERVER || !isOpen()) {
         ilog_error("[", peerAddress(), "] acceptConnection only available in listening server mode");
-        return;
+        return false;
     }
 
     int clientFd = ::accept(m_sockfd, IX_NULLPTR, IX_NULLPTR);
@@ -340,7 +368,7 @@ void iUnixDevice::acceptConnection()
             ilog_error("[", peerAddress(), "] Accept failed:", errno);
             IEMIT errorOccurred(INC_ERROR_CONNECTION_FAILED);
         }
-        return;
+        return false;
     }
 
 #if defined(IX_OS_MAC) || defined(IX_OS_BSD4)
@@ -353,6 +381,7 @@ void iUnixDevice::acceptConnection()
     iUnixDevice* clientDevice = new iUnixDevice(ROLE_CLIENT);
     clientDevice->m_sockfd = clientFd;
     clientDevice->m_socketPath = m_socketPath + " (client)";
+    clientDevice->m_edgeTriggered = m_edgeTriggered;
 
     // Set non-blocking
     clientDevice->setNonBlocking(true);
@@ -375,6 +404,7 @@ void iUnixDevice::acceptConnection()
     // Emit newConnection signal with the client device
     // NOTE: Caller (e.g., iINCServer) must call startEventMonitoring() on client device
     IEMIT newConnection(clientDevice);
+    return true;
 }
 
 xint64 iUnixDevice::bytesAvailable() const
@@ -491,6 +521,8 @@ bool iUnixDevice::startEventMonitoring(iEventDispatcher* dispatcher)
     }
 
     m_eventSource->attach(dispatcher ? dispatcher : iEventDispatcher::instance());
+    // the registration mode depends on the dispatcher
+    static_cast<iUnixEventSource*>(m_eventSource)->applyEvents();
     return true;
 }
 
@@ -532,6 +564,29 @@ bool iUnixDevice::setNonBlocking(bool nonBlocking)
     return true;
 }
 
+bool iUnixDevice::peerCredentials(xint64* pid, xint64* uid) const
+{
+    if (m_sockfd < 0) {
+        return false;
+    }
+
+    #ifdef SO_PEERCRED
+    struct ucred cred;
+    socklen_t len = sizeof(cred);
+    if (::getsockopt(m_sockfd, SOL_SOCKET, SO_PEERCRED, &cred, &len) < 0) {
+        return false;
+    }
+
+    if (pid) *pid = cred.pid;
+    if (uid) *uid = cred.uid;
+    return true;
+    #else
+    IX_UNUSED(pid);
+    IX_UNUSED(uid);
+    return false;
+    #endif
+}
+
 int iUnixDevice::getSocketError()
 {
     if (m_sockfd < 0) {
@@ -653,7 +708,7 @@ xint64 iUnixDevice::writeMessage(const iINCMessage& msg, xint64 offset)
     return -1;
 }
 
-void iUnixDevice::processRx()
+bool iUnixDevice::processRx()
 {
     // Bulk read: read as much as available in one recvmsg (up to 8KB).
     // This collapses 2-recvmsg-per-message down to 1-recvmsg-per-many-messages
@@ -667,8 +722,8 @@ void iUnixDevice::processRx()
 
     if (n <= 0) {
         m_recvBuffer.resize(oldSize);
-        if (n < 0) return; // Error or disconnect handled by readImpl
-        if (oldSize == 0) return; // EAGAIN and no buffered data
+        if (n < 0) return false; // Error or disconnect handled by readImpl
+        if (oldSize == 0) return false; // EAGAIN and no buffered data
         // n == 0 (EAGAIN) but have leftover data — fall through to parse
     } else {
         m_recvBuffer.resize(oldSize + n);
@@ -705,7 +760,7 @@ void iUnixDevice::processRx()
             IEMIT errorOccurred(INC_ERROR_PROTOCOL_ERROR);
             m_recvBuffer.clear();
             if (m_pendingFd >= 0) { ::close(m_pendingFd); m_pendingFd = -1; }
-            return;
+            return false;
         }
 
         if (payloadLength > iINCMessageHeader::MAX_MESSAGE_SIZE) {
@@ -713,7 +768,7 @@ void iUnixDevice::processRx()
             IEMIT errorOccurred(INC_ERROR_MESSAGE_TOO_LARGE);
             m_recvBuffer.clear();
             if (m_pendingFd >= 0) { ::close(m_pendingFd); m_pendingFd = -1; }
-            return;
+            return false;
         }
 
         int totalSize = static_cast<int>(sizeof(iINCMessageHeader)) + payloadLength;
@@ -744,6 +799,8 @@ void iUnixDevice::processRx()
             m_recvBuffer = m_recvBuffer.mid(consumed);
         }
     }
+
+    return n > 0;
 }
 
 bool iUnixDevice::createSocket()
@@ -49,7 +49,8 @@ public:
 
     /// Accept pending connection (server mode only)
     /// Emits newConnection(iUnixDevice*) signal with the client device
-    void acceptConnection();
+    /// @return true if a connection was accepted
+    bool acceptConnection();
 
     // --- Common Methods ---
 
@@ -89,11 +90,25 @@ public:
 
     bool isLocal() const IX_OVERRIDE { return true; }
 
+    /// Peer pid/uid from SO_PEERCRED, captured by the kernel at connect()
+    bool peerCredentials(xint64* pid, xint64* uid) const IX_OVERRIDE;
+
     /// Write message implementation
     xint64 writeMessage(const iINCMessage& msg, xint64 offset) IX_OVERRIDE;
 
     /// Process incoming data (called by EventSource)
-    void processRx();
+    /// @return true if data was read, the socket may hold more
+    bool processRx();
+
+    /// Register the socket edge-triggered: reads drain it until EAGAIN and write
+    /// interest stays armed, so bursts need no poll updates. Accepted connections inherit it.
+    /// @note Takes effect when monitoring starts; stays level-triggered if the dispatcher cannot
+    void setEdgeTriggered(bool enable) { m_edgeTriggered = enable; }
+    bool isEdgeTriggered() const { return m_edgeTriggered; }
+
+    /// Wake a single dispatcher when several listen on the same socket (server mode only)
+    void setExclusiveAccept(bool enable) { m_exclusiveAccept = enable; }
+    bool isExclusiveAccept() const { return m_exclusiveAccept; }
 
 protected:
     ssize_t readImpl(char* data, xint64 maxlen, int* fd);
@@ -111,6 +126,8 @@ private:
     iByteArray          m_recvBuffer;
     int                 m_pendingFd;
     int                 m_lastSentFd;   ///< Last FD sent via SCM_RIGHTS (-1 if none), avoids redundant dup
+    bool                m_edgeTriggered;
+    bool                m_exclusiveAccept;
 
     IX_DISABLE_COPY(iUnixDevice)
 };
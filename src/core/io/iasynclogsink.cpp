@@ -0,0 +1,450 @@
+/////////////////////////////////////////////////////////////////
+/// Copyright 2018-2020
+/// All rights reserved.
+/////////////////////////////////////////////////////////////////
+/// @file    iasynclogsink.cpp
+/// @brief   log target writing from a background thread
+/// @version 1.0
+/// @author  ncjiakechong@gmail.com
+/////////////////////////////////////////////////////////////////
+
+#include <signal.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+#include "core/io/iasynclogsink.h"
+#include "core/thread/ithread.h"
+#include "core/thread/icondition.h"
+#include "core/thread/iatomiccounter.h"
+
+/* Slot payload, longer lines go to the heap */
+#define IX_LOG_SLOT_TEXT    480
+/* Lines per writev(), well below IOV_MAX */
+#define IX_LOG_BATCH        64
+
+namespace iShell {
+
+struct iLogSlot
+{
+    iAtomicCounter<xuint32> sequence;   ///< pos: free, pos + 1: filled, Vyukov style
+    int length;
+    char* heap;
+    char text[IX_LOG_SLOT_TEXT];
+};
+
+class iAsyncLogWriter;
+
+struct iAsyncLogState
+{
+    iAsyncLogState() : slots(IX_NULLPTR), mask(0), fd(-1), policy(iAsyncLogSink::DropNewest), writer(IX_NULLPTR), writerTid(0) {}
+
+    iLogTarget previous;
+    iLogSlot* slots;
+    xuint32 mask;
+    int fd;
+    iAsyncLogSink::OverflowPolicy policy;
+
+    iAtomicCounter<xuint32> tail;       ///< next slot a logging thread claims
+    iAtomicCounter<xuint32> head;       ///< next slot the writer hands out
+    iAtomicCounter<int> consuming;      ///< 1 while a batch is written, writer or crash handler
+    iAtomicCounter<int> writerIdle;
+    iAtomicCounter<int> waiters;        ///< threads in flush() or waiting for room
+    iAtomicCounter<int> stopping;
+
+    iAtomicCounter<xint64> written;
+    iAtomicCounter<xint64> dropped;
+    iAtomicCounter<xint64> blocked;
+    iAtomicCounter<xint64> batches;
+
+    iMutex mutex;
+    iCondition dataCond;
+    iCondition spaceCond;
+
+    iAsyncLogWriter* writer;
+    int writerTid;
+};
+
+static iAsyncLogState* s_state = IX_NULLPTR;
+static iMutex s_installLock;
+
+static const int s_crashSignals[] = {SIGSEGV, SIGBUS, SIGILL, SIGFPE, SIGABRT};
+#define IX_LOG_CRASH_SIGNALS (int)(sizeof(s_crashSignals) / sizeof(s_crashSignals[0]))
+static struct sigaction s_oldActions[IX_LOG_CRASH_SIGNALS];
+
+static bool sinkHasPending(iAsyncLogState* st)
+{
+    const xuint32 pos = st->head;
+    return (xint32)(st->slots[pos & st->mask].sequence.value() - (pos + 1)) >= 0;
+}
+
+static void sinkWriteAll(int fd, struct iovec* iov, int count)
+{
+    while (count > 0) {
+        ssize_t ret = ::writev(fd, iov, count);
+        if (ret < 0) {
+            if (EINTR == errno)
+                continue;
+            return;
+        }
+
+        while ((count > 0) && ((size_t) ret >= iov->iov_len)) {
+            ret -= (ssize_t) iov->iov_len;
+            ++iov;
+            --count;
+        }
+
+        if (count > 0) {
+            iov->iov_base = static_cast<char*>(iov->iov_base) + ret;
+            iov->iov_len -= (size_t) ret;
+        }
+    }
+}
+
+/* Writes one batch, the caller holds consuming. From the crash handler the slots are
+ * only skipped: free() and the condition are not async-signal-safe. */
+static int sinkDrainBatch(iAsyncLogState* st, bool release)
+{
+    struct iovec iov[IX_LOG_BATCH];
+    const xuint32 pos = st->head;
+    int count = 0;
+
+    while (count < IX_LOG_BATCH) {
+        iLogSlot& slot = st->slots[(pos + count) & st->mask];
+        if ((xint32)(slot.sequence.value() - (pos + count + 1)) < 0)
+            break;
+
+        iov[count].iov_base = slot.heap ? slot.heap : slot.text;
+        iov[count].iov_len = (size_t) slot.length;
+        ++count;
+    }
+
+    if (0 == count)
+        return 0;
+
+    sinkWriteAll(st->fd, iov, count);
+    st->head = pos + count;
+    if (!release)
+        return count;
+
+    for (int idx = 0; idx < count; ++idx) {
+        iLogSlot& slot = st->slots[(pos + idx) & st->mask];
+        free(slot.heap);
+        slot.heap = IX_NULLPTR;
+        slot.sequence = pos + idx + st->mask + 1;
+    }
+
+    st->written += count;
+    ++st->batches;
+    if (st->waiters > 0) {
+        iMutex::ScopedLock lock(st->mutex);
+        st->spaceCond.broadcast();
+    }
+
+    return count;
+}
+
+class iAsyncLogWriter : public iThread
+{
+public:
+    iAsyncLogWriter(iAsyncLogState* state) : m_state(state) {}
+
+protected:
+    virtual void run() IX_OVERRIDE {
+        iAsyncLogState* st = m_state;
+        {
+            iMutex::ScopedLock lock(st->mutex);
+            st->writerTid = iThread::currentThreadId();
+            st->spaceCond.broadcast();
+        }
+
+        for (;;) {
+            int count = 0;
+            if (st->consuming.testAndSet(0, 1)) {
+                count = sinkDrainBatch(st, true);
+                st->consuming = 0;
+            }
+
+            if (count > 0)
+                continue;
+
+            if (st->stopping && !sinkHasPending(st))
+                break;
+
+            iMutex::ScopedLock lock(st->mutex);
+            st->writerIdle = 1;
+            if (!sinkHasPending(st) && !st->stopping)
+                st->dataCond.wait(st->mutex, 100);
+            st->writerIdle = 0;
+        }
+    }
+
+private:
+    iAsyncLogState* m_state;
+};
+
+static void sinkWaitForSpace(iAsyncLogState* st)
+{
+    ++st->blocked;
+    ++st->waiters;
+    {
+        iMutex::ScopedLock lock(st->mutex);
+        st->dataCond.signal();
+        const xuint32 pos = st->tail;
+        if ((xint32)(st->slots[pos & st->mask].sequence.value() - pos) < 0)
+            st->spaceCond.wait(st->mutex, 10);
+    }
+    --st->waiters;
+}
+
+static iLogSlot* sinkAcquire(iAsyncLogState* st, xuint32* pos)
+{
+    xuint32 cur = st->tail;
+    for (;;) {
+        iLogSlot& slot = st->slots[cur & st->mask];
+        const xint32 diff = (xint32)(slot.sequence.value() - cur);
+        if (0 == diff) {
+            if (st->tail.testAndSet(cur, cur + 1, cur)) {
+                *pos = cur;
+                return &slot;
+            }
+            continue;
+        }
+
+        if (diff > 0) {
+            cur = st->tail;
+            continue;
+        }
+
+        /* Full; the writer itself must never wait on its own ring */
+        if ((iAsyncLogSink::DropNewest == st->policy) || (iThread::currentThreadId() == st->writerTid)) {
+            ++st->dropped;
+            return IX_NULLPTR;
+        }
+
+        sinkWaitForSpace(st);
+        cur = st->tail;
+    }
+}
+
+static void sinkPublish(iAsyncLogState* st, iLogSlot* slot, xuint32 pos)
+{
+    slot->sequence = pos + 1;
+    if (st->writerIdle) {
+        iMutex::ScopedLock lock(st->mutex);
+        st->dataCond.signal();
+    }
+}
+
+/* "header body\n" into the slot, or into a heap buffer if it does not fit */
+static void sinkFill(iLogSlot* slot, const char* header, int headerLen, const char* body, int bodyLen)
+{
+    const int length = headerLen + 1 + bodyLen + 1;
+    char* dst = slot->text;
+    slot->heap = IX_NULLPTR;
+    if (length > IX_LOG_SLOT_TEXT) {
+        slot->heap = static_cast<char*>(malloc((size_t) length));
+        if (IX_NULLPTR == slot->heap) {
+            bodyLen = std::max(0, IX_LOG_SLOT_TEXT - headerLen - 2);
+        } else {
+            dst = slot->heap;
+        }
+    }
+
+    memcpy(dst, header, (size_t) headerLen);
+    dst[headerLen] = ' ';
+    memcpy(dst + headerLen + 1, body, (size_t) bodyLen);
+    dst[headerLen + 1 + bodyLen] = '\n';
+    slot->length = headerLen + 1 + bodyLen + 1;
+}
+
+static bool sinkFilter(void* user_data, const char* tag, iLogLevel level)
+{
+    iAsyncLogState* st = static_cast<iAsyncLogState*>(user_data);
+    return st->previous.filter(st->previous.user_data, tag, level);
+}
+
+static void sinkSetThreshold(void* user_data, const char* patterns, bool reset)
+{
+    iAsyncLogState* st = static_cast<iAsyncLogState*>(user_data);
+    st->previous.setThreshold(st->previous.user_data, patterns, reset);
+}
+
+static void sinkMetaCallback(void* user_data, const char* tag, iLogLevel level, const char* file, const char* function, int line, const char* msg, int size)
+{
+    iAsyncLogState* st = static_cast<iAsyncLogState*>(user_data);
+
+    xuint32 pos = 0;
+    iLogSlot* slot = sinkAcquire(st, &pos);
+    if (IX_NULLPTR != slot) {
+        char header[256];
+        const int headerLen = iLogger::formatHeader(header, sizeof(header), tag, level, file, function, line);
+        sinkFill(slot, header, headerLen, msg, std::max(size, 0));
+        sinkPublish(st, slot, pos);
+    }
+}
+
+static void sinkDataCallback(void* user_data, const char* tag, iLogLevel level, const char* file, const char* function, int line, const void* msg, int size)
+{
+    iAsyncLogState* st = static_cast<iAsyncLogState*>(user_data);
+
+    xuint32 pos = 0;
+    iLogSlot* slot = sinkAcquire(st, &pos);
+    if (IX_NULLPTR != slot) {
+        char header[256];
+        char preview[128];
+        const int headerLen = iLogger::formatHeader(header, sizeof(header), tag, level, file, function, line);
+        const int previewLen = iLogger::formatData(preview, sizeof(preview), msg, size);
+        sinkFill(slot, header, headerLen, preview, previewLen);
+        sinkPublish(st, slot, pos);
+    }
+}
+
+static void sinkCrashHandler(int signo, siginfo_t* si, void*)
+{
+    iAsyncLogState* st = s_state;
+    if (IX_NULLPTR != st) {
+        /* The writer may be mid-batch, or may be the thread that crashed */
+        bool owned = false;
+        for (int spins = 0; !owned && (spins < (1 << 20)); ++spins)
+            owned = st->consuming.testAndSet(0, 1);
+
+        while (owned && (sinkDrainBatch(st, false) > 0)) {}
+    }
+
+    for (int idx = 0; idx < IX_LOG_CRASH_SIGNALS; ++idx) {
+        if (s_crashSignals[idx] == signo)
+            sigaction(signo, &s_oldActions[idx], IX_NULLPTR);
+    }
+
+    /* A fault comes back once the instruction is retried, a sent signal does not */
+    if (si->si_code <= 0)
+        raise(signo);
+}
+
+static void sinkAtExit()
+{
+    iAsyncLogSink::uninstall();
+}
+
+bool iAsyncLogSink::install(int fd, int records, OverflowPolicy policy)
+{
+    iMutex::ScopedLock lock(s_installLock);
+    if (IX_NULLPTR != s_state)
+        return false;
+
+    xuint32 capacity = 2;
+    while ((capacity < (xuint32) records) && (capacity < (1u << 24)))
+        capacity <<= 1;
+
+    iAsyncLogState* st = new iAsyncLogState;
+    st->slots = new iLogSlot[capacity];
+    st->mask = capacity - 1;
+    st->fd = fd;
+    st->policy = policy;
+    for (xuint32 idx = 0; idx < capacity; ++idx) {
+        st->slots[idx].sequence = idx;
+        st->slots[idx].length = 0;
+        st->slots[idx].heap = IX_NULLPTR;
+    }
+    st->previous = iLogger::defaultTarget();
+
+    st->writer = new iAsyncLogWriter(st);
+    st->writer->setObjectName(iLatin1StringView("iAsyncLogWriter"));
+    st->writer->start();
+    {
+        /* Whatever the writer logs while it starts up must not land in its own ring */
+        iMutex::ScopedLock stateLock(st->mutex);
+        while (0 == st->writerTid)
+            st->spaceCond.wait(st->mutex, 10);
+    }
+    s_state = st;
+
+    static bool atExitRegistered = false;
+    if (!atExitRegistered) {
+        atExitRegistered = true;
+        atexit(&sinkAtExit);
+    }
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_sigaction = sinkCrashHandler;
+    sa.sa_flags = SA_SIGINFO;
+    sigemptyset(&sa.sa_mask);
+    for (int idx = 0; idx < IX_LOG_CRASH_SIGNALS; ++idx)
+        sigaction(s_crashSignals[idx], &sa, &s_oldActions[idx]);
+
+    iLogTarget target;
+    target.user_data = st;
+    target.setThreshold = &sinkSetThreshold;
+    target.filter = &sinkFilter;
+    target.metaCallback = &sinkMetaCallback;
+    target.dataCallback = &sinkDataCallback;
+    iLogger::setDefaultTarget(target);
+    return true;
+}
+
+void iAsyncLogSink::uninstall()
+{
+    iMutex::ScopedLock lock(s_installLock);
+    iAsyncLogState* st = s_state;
+    if (IX_NULLPTR == st)
+        return;
+
+    /* Returns once every thread that picked up the sink has finished its line */
+    iLogger::setDefaultTarget(st->previous);
+    for (int idx = 0; idx < IX_LOG_CRASH_SIGNALS; ++idx)
+        sigaction(s_crashSignals[idx], &s_oldActions[idx], IX_NULLPTR);
+
+    st->stopping = 1;
+    {
+        iMutex::ScopedLock stateLock(st->mutex);
+        st->dataCond.signal();
+    }
+    st->writer->wait();
+    s_state = IX_NULLPTR;
+
+    delete st->writer;
+    delete[] st->slots;
+    delete st;
+}
+
+bool iAsyncLogSink::isInstalled()
+{
+    return IX_NULLPTR != s_state;
+}
+
+void iAsyncLogSink::flush()
+{
+    iAsyncLogState* st = s_state;
+    if ((IX_NULLPTR == st) || (iThread::currentThreadId() == st->writerTid))
+        return;
+
+    const xuint32 target = st->tail;
+    ++st->waiters;
+    {
+        iMutex::ScopedLock lock(st->mutex);
+        st->dataCond.signal();
+        while ((xint32)(st->head.value() - target) < 0)
+            st->spaceCond.wait(st->mutex, 10);
+    }
+    --st->waiters;
+}
+
+iAsyncLogSink::Stats iAsyncLogSink::stats()
+{
+    Stats stats = {0, 0, 0, 0};
+    iAsyncLogState* st = s_state;
+    if (IX_NULLPTR == st)
+        return stats;
+
+    stats.written = st->written;
+    stats.dropped = st->dropped;
+    stats.blocked = st->blocked;
+    stats.batches = st->batches;
+    return stats;
+}
+
+} // namespace iShell
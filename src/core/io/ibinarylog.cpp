@@ -0,0 +1,812 @@
+/////////////////////////////////////////////////////////////////
+/// Copyright 2018-2020
+/// All rights reserved.
+/////////////////////////////////////////////////////////////////
+/// @file    ibinarylog.cpp
+/// @brief   compact binary log records, rendered to text offline
+/// @version 1.0
+/// @author  ncjiakechong@gmail.com
+/////////////////////////////////////////////////////////////////
+
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <vector>
+#include <algorithm>
+#include <fcntl.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "core/io/ibinarylog.h"
+#include "core/thread/ithread.h"
+#include "core/thread/imutex.h"
+#include "core/utils/idatetime.h"
+#include "core/kernel/icoreapplication.h"
+
+/*
+ * File layout, integers are LEB128 varints:
+ *   header  "IXBLOG\0" version pid base_ns
+ *   site    'S' id level tag file line function
+ *   event   'E' id ns_since_base tid args_size args
+ * Strings are a length and the bytes, every argument is a type tag and its value.
+ */
+#define IX_BLOG_MAGIC       "IXBLOG"
+#define IX_BLOG_VERSION     1
+#define IX_BLOG_BUFFER      (64 * 1024)
+#define IX_BLOG_THREAD_BUF  (8 * 1024)
+
+#define IX_BLOG_SITE        'S'
+#define IX_BLOG_EVENT       'E'
+
+#define IX_BLOG_ARG_BOOL    'b'
+#define IX_BLOG_ARG_CHAR    'c'
+#define IX_BLOG_ARG_INT     'i'
+#define IX_BLOG_ARG_UINT    'u'
+#define IX_BLOG_ARG_HEX     'x'
+#define IX_BLOG_ARG_DOUBLE  'd'
+#define IX_BLOG_ARG_PTR     'p'
+#define IX_BLOG_ARG_STR     's'
+
+namespace iShell {
+
+iAtomicCounter<int> iBinaryLog::s_active(0);
+
+/* Records of one thread, handed to the file in one piece. Only the owner appends;
+ * whoever drains it holds s_blogLock first and then the buffer lock. */
+struct iBinaryLogBuffer
+{
+    iMutex lock;
+    int generation;         ///< log file the buffered records belong to
+    xint64 base;            ///< its base timestamp
+    int used;
+    char data[IX_BLOG_THREAD_BUF];
+};
+
+static iMutex s_blogLock;
+static int s_blogFd = -1;
+static iAtomicCounter<int> s_blogGeneration(0);
+static int s_blogNextSite = 0;
+static xint64 s_blogBase = 0;
+static xint64 s_blogSize = 0;
+static char* s_blogBuffer = IX_NULLPTR;
+static int s_blogBuffered = 0;
+static std::vector<iBinaryLogBuffer*> s_blogThreadBuffers;
+
+static pthread_once_t s_blogKeyOnce = PTHREAD_ONCE_INIT;
+static pthread_key_t s_blogKey;
+
+static xint64 blogNow()
+{
+#ifdef IX_OS_UNIX
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return (xint64) now.tv_sec * 1000000000 + now.tv_nsec;
+#else
+    return iDateTime::currentMSecsSinceEpoch() * 1000000;
+#endif
+}
+
+static int blogPutVarint(char* dst, xuint64 value)
+{
+    int len = 0;
+    while (value >= 0x80) {
+        dst[len++] = char((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    dst[len++] = char(value);
+    return len;
+}
+
+static const char* blogBasename(const char* file)
+{
+    const char* base = file;
+    for (const char* it = file; *it; ++it) {
+        if (('/' == *it) || ('\\' == *it))
+            base = it + 1;
+    }
+    return base;
+}
+
+static void blogWrite(const char* data, int size)
+{
+    while ((size > 0) && (s_blogFd >= 0)) {
+        ssize_t ret = ::write(s_blogFd, data, (size_t) size);
+        if ((ret < 0) && (EINTR == errno))
+            continue;
+        if (ret <= 0)
+            return;
+
+        data += ret;
+        size -= (int) ret;
+    }
+}
+
+static void blogWriteTo(int fd, std::string& text)
+{
+    const char* data = text.data();
+    size_t size = text.size();
+    while (size > 0) {
+        ssize_t ret = ::write(fd, data, size);
+        if ((ret < 0) && (EINTR == errno))
+            continue;
+        if (ret <= 0)
+            break;
+
+        data += ret;
+        size -= (size_t) ret;
+    }
+    text.clear();
+}
+
+static void blogFlushLocked()
+{
+    blogWrite(s_blogBuffer, s_blogBuffered);
+    s_blogBuffered = 0;
+}
+
+static void blogAppendLocked(const char* data, int size)
+{
+    if (s_blogBuffered + size > IX_BLOG_BUFFER)
+        blogFlushLocked();
+
+    if (size > IX_BLOG_BUFFER) {
+        blogWrite(data, size);
+    } else {
+        memcpy(s_blogBuffer + s_blogBuffered, data, (size_t) size);
+        s_blogBuffered += size;
+    }
+    s_blogSize += size;
+}
+
+/* Moves the records of buffer to the file and rebinds it to the current one,
+ * records left over from an earlier file are dropped */
+static void blogDrainLocked(iBinaryLogBuffer* buffer)
+{
+    iMutex::ScopedLock lock(buffer->lock);
+    if ((buffer->generation == s_blogGeneration.value()) && (s_blogFd >= 0))
+        blogAppendLocked(buffer->data, buffer->used);
+
+    buffer->generation = s_blogGeneration.value();
+    buffer->base = s_blogBase;
+    buffer->used = 0;
+}
+
+static void blogDrainAllLocked()
+{
+    for (std::vector<iBinaryLogBuffer*>::iterator it = s_blogThreadBuffers.begin(); it != s_blogThreadBuffers.end(); ++it)
+        blogDrainLocked(*it);
+}
+
+static void blogReleaseBuffer(void* data)
+{
+    iBinaryLogBuffer* buffer = static_cast<iBinaryLogBuffer*>(data);
+    iMutex::ScopedLock lock(s_blogLock);
+    blogDrainLocked(buffer);
+    s_blogThreadBuffers.erase(std::remove(s_blogThreadBuffers.begin(), s_blogThreadBuffers.end(), buffer),
+                              s_blogThreadBuffers.end());
+    delete buffer;
+}
+
+static void blogCreateKey()
+{
+    pthread_key_create(&s_blogKey, blogReleaseBuffer);
+}
+
+static iBinaryLogBuffer* blogThreadBuffer()
+{
+    pthread_once(&s_blogKeyOnce, blogCreateKey);
+    iBinaryLogBuffer* buffer = static_cast<iBinaryLogBuffer*>(pthread_getspecific(s_blogKey));
+    if (buffer)
+        return buffer;
+
+    buffer = new iBinaryLogBuffer;
+    buffer->generation = 0;
+    buffer->base = 0;
+    buffer->used = 0;
+    pthread_setspecific(s_blogKey, buffer);
+
+    iMutex::ScopedLock lock(s_blogLock);
+    s_blogThreadBuffers.push_back(buffer);
+    return buffer;
+}
+
+static int blogPutString(char* dst, const char* str, int size)
+{
+    int len = blogPutVarint(dst, (xuint64) size);
+    memcpy(dst + len, str, (size_t) size);
+    return len + size;
+}
+
+bool iBinaryLog::open(const char* path)
+{
+    iMutex::ScopedLock lock(s_blogLock);
+    /* the previous file is finished first, path may well be the same one */
+    if (s_blogFd >= 0) {
+        s_active = 0;
+        blogDrainAllLocked();
+        blogFlushLocked();
+        ::close(s_blogFd);
+        s_blogFd = -1;
+        s_blogSize = 0;
+    }
+
+    int fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+        return false;
+
+    if (IX_NULLPTR == s_blogBuffer)
+        s_blogBuffer = new char[IX_BLOG_BUFFER];
+
+    s_blogFd = fd;
+    s_blogBuffered = 0;
+    s_blogSize = 0;
+    s_blogBase = blogNow();
+    ++s_blogGeneration;
+
+    char header[32];
+    int len = 0;
+    memcpy(header, IX_BLOG_MAGIC, sizeof(IX_BLOG_MAGIC));
+    len += sizeof(IX_BLOG_MAGIC);
+    header[len++] = IX_BLOG_VERSION;
+    len += blogPutVarint(header + len, (xuint64) iCoreApplication::applicationPid());
+    len += blogPutVarint(header + len, (xuint64) s_blogBase);
+    blogAppendLocked(header, len);
+
+    s_active = 1;
+    return true;
+}
+
+void iBinaryLog::close()
+{
+    iMutex::ScopedLock lock(s_blogLock);
+    s_active = 0;
+    if (s_blogFd < 0)
+        return;
+
+    blogDrainAllLocked();
+    blogFlushLocked();
+    ::close(s_blogFd);
+    s_blogFd = -1;
+    s_blogSize = 0;
+}
+
+void iBinaryLog::flush()
+{
+    iMutex::ScopedLock lock(s_blogLock);
+    blogDrainAllLocked();
+    blogFlushLocked();
+}
+
+xint64 iBinaryLog::size()
+{
+    iMutex::ScopedLock lock(s_blogLock);
+    if (s_blogFd < 0)
+        return 0;
+
+    xint64 size = s_blogSize;
+    for (std::vector<iBinaryLogBuffer*>::iterator it = s_blogThreadBuffers.begin(); it != s_blogThreadBuffers.end(); ++it) {
+        iMutex::ScopedLock bufferLock((*it)->lock);
+        if ((*it)->generation == s_blogGeneration.value())
+            size += (*it)->used;
+    }
+    return size;
+}
+
+void iBinaryLog::commit(iBinaryLogSite* site, xint64 timestamp, const char* args, int size)
+{
+    const int generation = s_blogGeneration.value();
+
+    /* A site is written once per file, before its first record. It goes straight
+     * to the shared buffer, so it precedes whatever any thread buffers for it. */
+    if (__atomic_load_n(&site->generation, __ATOMIC_ACQUIRE) != generation) {
+        iMutex::ScopedLock lock(s_blogLock);
+        if ((s_blogFd < 0) || (generation != s_blogGeneration.value()))
+            return;
+
+        if (site->generation != generation) {
+            if (0 == site->id)
+                site->id = ++s_blogNextSite;
+
+            const char* file = blogBasename(site->file);
+            const int tagLen = (int) strlen(site->tag);
+            const int fileLen = (int) strlen(file);
+            const int functionLen = (int) strlen(site->function);
+            char stackDef[512];
+            const int capacity = 4 * 10 + 2 + tagLen + fileLen + functionLen;
+            char* def = (capacity <= (int) sizeof(stackDef)) ? stackDef : new char[capacity];
+
+            int len = 0;
+            def[len++] = IX_BLOG_SITE;
+            len += blogPutVarint(def + len, (xuint64) site->id);
+            def[len++] = char(site->level);
+            len += blogPutString(def + len, site->tag, tagLen);
+            len += blogPutString(def + len, file, fileLen);
+            len += blogPutVarint(def + len, (xuint64) site->line);
+            len += blogPutString(def + len, site->function, functionLen);
+            blogAppendLocked(def, len);
+            if (def != stackDef)
+                delete[] def;
+
+            __atomic_store_n(&site->generation, generation, __ATOMIC_RELEASE);
+        }
+    }
+
+    /* The record itself only takes the lock of this thread's buffer */
+    iBinaryLogBuffer* buffer = blogThreadBuffer();
+    const int need = 48 + size;
+    buffer->lock.lock();
+    if ((buffer->generation != generation) || (buffer->used + need > IX_BLOG_THREAD_BUF)) {
+        buffer->lock.unlock();
+        {
+            iMutex::ScopedLock lock(s_blogLock);
+            blogDrainLocked(buffer);
+        }
+        buffer->lock.lock();
+        if (buffer->generation != generation) {
+            buffer->lock.unlock();
+            return;
+        }
+    }
+
+    char* header = buffer->data + buffer->used;
+    int len = 0;
+    header[len++] = IX_BLOG_EVENT;
+    len += blogPutVarint(header + len, (xuint64) site->id);
+    len += blogPutVarint(header + len, (xuint64) std::max(timestamp - buffer->base, xint64(0)));
+    len += blogPutVarint(header + len, (xuint64) iThread::currentThreadId());
+    len += blogPutVarint(header + len, (xuint64) size);
+    memcpy(header + len, args, (size_t) size);
+    buffer->used += len + size;
+    buffer->lock.unlock();
+}
+
+iBinaryLogRecord::iBinaryLogRecord(iBinaryLogSite* site)
+    : m_site(site)
+    , m_timestamp(blogNow())
+    , m_len(0)
+{
+}
+
+iBinaryLogRecord::~iBinaryLogRecord()
+{
+    iBinaryLog::commit(m_site, m_timestamp, m_buf, m_len);
+}
+
+bool iBinaryLogRecord::reserve(int size)
+{
+    return m_len + size <= (int) sizeof(m_buf);
+}
+
+void iBinaryLogRecord::putVarint(unsigned long long value)
+{
+    m_len += blogPutVarint(m_buf + m_len, value);
+}
+
+void iBinaryLogRecord::append(bool value)
+{
+    if (!reserve(2))
+        return;
+
+    m_buf[m_len++] = IX_BLOG_ARG_BOOL;
+    m_buf[m_len++] = char(value ? 1 : 0);
+}
+
+void iBinaryLogRecord::append(char value)
+{
+    if (!reserve(2))
+        return;
+
+    m_buf[m_len++] = IX_BLOG_ARG_CHAR;
+    m_buf[m_len++] = value;
+}
+
+void iBinaryLogRecord::append(unsigned char value)
+{
+    append(char(value));
+}
+
+void iBinaryLogRecord::append(long long value)
+{
+    if (!reserve(11))
+        return;
+
+    /* zigzag, so that small negative numbers stay short */
+    m_buf[m_len++] = IX_BLOG_ARG_INT;
+    putVarint(((unsigned long long) value << 1) ^ (unsigned long long) (value >> 63));
+}
+
+void iBinaryLogRecord::append(unsigned long long value)
+{
+    if (!reserve(11))
+        return;
+
+    m_buf[m_len++] = IX_BLOG_ARG_UINT;
+    putVarint(value);
+}
+
+void iBinaryLogRecord::appendHex(unsigned long long value)
+{
+    if (!reserve(11))
+        return;
+
+    m_buf[m_len++] = IX_BLOG_ARG_HEX;
+    putVarint(value);
+}
+
+void iBinaryLogRecord::append(double value)
+{
+    if (!reserve(1 + (int) sizeof(double)))
+        return;
+
+    m_buf[m_len++] = IX_BLOG_ARG_DOUBLE;
+    memcpy(m_buf + m_len, &value, sizeof(double));
+    m_len += sizeof(double);
+}
+
+void iBinaryLogRecord::append(const void* value)
+{
+    if (!reserve(11))
+        return;
+
+    m_buf[m_len++] = IX_BLOG_ARG_PTR;
+    putVarint((unsigned long long) reinterpret_cast<xuintptr>(value));
+}
+
+void iBinaryLogRecord::append(const char* value, int size)
+{
+    /* Strings are cut to what is left of the record */
+    const int room = (int) sizeof(m_buf) - m_len - 1 - 3;
+    if (room < 0)
+        return;
+
+    size = std::min(std::max(size, 0), room);
+    m_buf[m_len++] = IX_BLOG_ARG_STR;
+    putVarint((unsigned long long) size);
+    memcpy(m_buf + m_len, value, (size_t) size);
+    m_len += size;
+}
+
+iBinaryLogRecord& operator<<(iBinaryLogRecord& rec, bool value)
+{
+    rec.append(value);
+    return rec;
+}
+
+iBinaryLogRecord& operator<<(iBinaryLogRecord& rec, char value)
+{
+    rec.append(value);
+    return rec;
+}
+
+iBinaryLogRecord& operator<<(iBinaryLogRecord& rec, unsigned char value)
+{
+    rec.append(value);
+    return rec;
+}
+
+iBinaryLogRecord& operator<<(iBinaryLogRecord& rec, short value)
+{
+    rec.append((long long) value);
+    return rec;
+}
+
+iBinaryLogRecord& operator<<(iBinaryLogRecord& rec, unsigned short value)
+{
+    rec.append((unsigned long long) value);
+    return rec;
+}
+
+iBinaryLogRecord& operator<<(iBinaryLogRecord& rec, int value)
+{
+    rec.append((long long) value);
+    return rec;
+}
+
+iBinaryLogRecord& operator<<(iBinaryLogRecord& rec, unsigned int value)
+{
+    rec.append((unsigned long long) value);
+    return rec;
+}
+
+iBinaryLogRecord& operator<<(iBinaryLogRecord& rec, long value)
+{
+    rec.append((long long) value);
+    return rec;
+}
+
+iBinaryLogRecord& operator<<(iBinaryLogRecord& rec, unsigned long value)
+{
+    rec.append((unsigned long long) value);
+    return rec;
+}
+
+iBinaryLogRecord& operator<<(iBinaryLogRecord& rec, long long value)
+{
+    rec.append(value);
+    return rec;
+}
+
+iBinaryLogRecord& operator<<(iBinaryLogRecord& rec, unsigned long long value)
+{
+    rec.append(value);
+    return rec;
+}
+
+iBinaryLogRecord& operator<<(iBinaryLogRecord& rec, iHexUInt8 value)
+{
+    rec.appendHex(value.value);
+    return rec;
+}
+
+iBinaryLogRecord& operator<<(iBinaryLogRecord& rec, iHexUInt16 value)
+{
+    rec.appendHex(value.value);
+    return rec;
+}
+
+iBinaryLogRecord& operator<<(iBinaryLogRecord& rec, iHexUInt32 value)
+{
+    rec.appendHex(value.value);
+    return rec;
+}
+
+iBinaryLogRecord& operator<<(iBinaryLogRecord& rec, iHexUInt64 value)
+{
+    rec.appendHex(value.value);
+    return rec;
+}
+
+iBinaryLogRecord& operator<<(iBinaryLogRecord& rec, float value)
+{
+    rec.append(double(value));
+    return rec;
+}
+
+iBinaryLogRecord& operator<<(iBinaryLogRecord& rec, double value)
+{
+    rec.append(value);
+    return rec;
+}
+
+iBinaryLogRecord& operator<<(iBinaryLogRecord& rec, const char* value)
+{
+    rec.append(value, value ? (int) strlen(value) : 0);
+    return rec;
+}
+
+iBinaryLogRecord& operator<<(iBinaryLogRecord& rec, const std::string& value)
+{
+    rec.append(value.data(), (int) value.size());
+    return rec;
+}
+
+iBinaryLogRecord& operator<<(iBinaryLogRecord& rec, const iString& value)
+{
+    iByteArray utf8 = value.toUtf8();
+    rec.append(utf8.constData(), (int) utf8.size());
+    return rec;
+}
+
+iBinaryLogRecord& operator<<(iBinaryLogRecord& rec, const iStringView& value)
+{
+    iByteArray utf8 = value.toUtf8();
+    rec.append(utf8.constData(), (int) utf8.size());
+    return rec;
+}
+
+iBinaryLogRecord& operator<<(iBinaryLogRecord& rec, const iLatin1StringView& value)
+{
+    rec.append(value.data(), (int) value.size());
+    return rec;
+}
+
+iBinaryLogRecord& operator<<(iBinaryLogRecord& rec, const void* value)
+{
+    rec.append(value);
+    return rec;
+}
+
+/////////////////////////////////////////////////////////////////
+// decoder
+/////////////////////////////////////////////////////////////////
+
+struct iBinaryLogReader
+{
+    const char* pos;
+    const char* end;
+
+    bool varint(xuint64* value) {
+        xuint64 result = 0;
+        for (int shift = 0; (pos < end) && (shift < 64); shift += 7) {
+            const xuint8 byte = (xuint8) *pos++;
+            result |= (xuint64) (byte & 0x7F) << shift;
+            if (0 == (byte & 0x80)) {
+                *value = result;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool string(std::string* value) {
+        xuint64 len = 0;
+        if (!varint(&len) || (len > (xuint64) (end - pos)))
+            return false;
+
+        value->assign(pos, (size_t) len);
+        pos += len;
+        return true;
+    }
+};
+
+struct iBinaryLogSiteDef
+{
+    int level;
+    int line;
+    std::string tag;
+    std::string file;
+    std::string function;
+};
+
+/* Renders the arguments as iLogger::append() does */
+static bool blogRenderArgs(iBinaryLogReader reader, std::string* out)
+{
+    char buf[64];
+    while (reader.pos < reader.end) {
+        const char type = *reader.pos++;
+        xuint64 value = 0;
+        int len = 0;
+        switch (type) {
+        case IX_BLOG_ARG_BOOL:
+        case IX_BLOG_ARG_CHAR:
+            if (reader.pos >= reader.end)
+                return false;
+            if (IX_BLOG_ARG_BOOL == type)
+                len = snprintf(buf, sizeof(buf), "%hhd", (char) *reader.pos);
+            else
+                len = snprintf(buf, sizeof(buf), "%c", *reader.pos);
+            ++reader.pos;
+            break;
+        case IX_BLOG_ARG_INT:
+            if (!reader.varint(&value))
+                return false;
+            len = snprintf(buf, sizeof(buf), "%lld", (long long) ((value >> 1) ^ (~(value & 1) + 1)));
+            break;
+        case IX_BLOG_ARG_UINT:
+            if (!reader.varint(&value))
+                return false;
+            len = snprintf(buf, sizeof(buf), "%llu", (unsigned long long) value);
+            break;
+        case IX_BLOG_ARG_HEX:
+            if (!reader.varint(&value))
+                return false;
+            len = snprintf(buf, sizeof(buf), "0x%llx", (unsigned long long) value);
+            break;
+        case IX_BLOG_ARG_PTR:
+            if (!reader.varint(&value))
+                return false;
+            len = snprintf(buf, sizeof(buf), "%p", reinterpret_cast<void*>((xuintptr) value));
+            break;
+        case IX_BLOG_ARG_DOUBLE: {
+            double number = 0;
+            if (reader.end - reader.pos < (xint64) sizeof(double))
+                return false;
+            memcpy(&number, reader.pos, sizeof(double));
+            reader.pos += sizeof(double);
+            len = snprintf(buf, sizeof(buf), "%f", number);
+            break;
+        }
+        case IX_BLOG_ARG_STR: {
+            std::string str;
+            if (!reader.string(&str))
+                return false;
+            out->append(str);
+            continue;
+        }
+        default:
+            return false;
+        }
+
+        out->append(buf, (size_t) std::min(std::max(len, 0), (int) sizeof(buf) - 1));
+    }
+
+    return true;
+}
+
+xint64 iBinaryLog::decode(const char* path, int outFd)
+{
+    int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return -1;
+
+    std::string content;
+    char chunk[64 * 1024];
+    ssize_t ret;
+    while (((ret = ::read(fd, chunk, sizeof(chunk))) > 0) || ((ret < 0) && (EINTR == errno))) {
+        if (ret > 0)
+            content.append(chunk, (size_t) ret);
+    }
+    ::close(fd);
+
+    iBinaryLogReader reader = {content.data(), content.data() + content.size()};
+    xuint64 pid = 0;
+    xuint64 base = 0;
+    if ((content.size() < sizeof(IX_BLOG_MAGIC) + 1)
+        || (0 != memcmp(reader.pos, IX_BLOG_MAGIC, sizeof(IX_BLOG_MAGIC)))
+        || (IX_BLOG_VERSION != reader.pos[sizeof(IX_BLOG_MAGIC)]))
+        return -1;
+
+    reader.pos += sizeof(IX_BLOG_MAGIC) + 1;
+    if (!reader.varint(&pid) || !reader.varint(&base))
+        return -1;
+
+    static const char levels[ILOG_LEVEL_MAX] = {'E', 'W', 'N', 'I', 'D', 'V'};
+    std::vector<iBinaryLogSiteDef> sites;
+    std::string out;
+    xint64 records = 0;
+
+    while (reader.pos < reader.end) {
+        iBinaryLogReader record = reader;
+        const char kind = *record.pos++;
+        xuint64 id = 0;
+
+        if (IX_BLOG_SITE == kind) {
+            iBinaryLogSiteDef def;
+            xuint64 line = 0;
+            if (!record.varint(&id) || (record.pos >= record.end))
+                break;
+            def.level = *record.pos++;
+            if (!record.string(&def.tag) || !record.string(&def.file) || !record.varint(&line) || !record.string(&def.function))
+                break;
+            def.line = (int) line;
+            if (id >= sites.size())
+                sites.resize((size_t) id + 1);
+            sites[(size_t) id] = def;
+            reader = record;
+            continue;
+        }
+
+        if (IX_BLOG_EVENT != kind)
+            return -1;
+
+        xuint64 delta = 0;
+        xuint64 tid = 0;
+        xuint64 size = 0;
+        if (!record.varint(&id) || !record.varint(&delta) || !record.varint(&tid) || !record.varint(&size)
+            || (size > (xuint64) (record.end - record.pos)))
+            break;
+        if ((0 == id) || (id >= sites.size()) || sites[(size_t) id].tag.empty())
+            return -1;
+
+        const iBinaryLogSiteDef& def = sites[(size_t) id];
+        const xint64 stamp = (xint64) (base + delta);
+        const time_t seconds = (time_t) (stamp / 1000000000);
+        struct tm local;
+        localtime_r(&seconds, &local);
+
+        char header[512];
+        const char level = ((0 <= def.level) && (def.level < ILOG_LEVEL_MAX)) ? levels[def.level] : '-';
+        int len = snprintf(header, sizeof(header), "%02d:%02d:%02d:%03d %5lld %5d %s:%c %s:%d:%s ",
+                           local.tm_hour, local.tm_min, local.tm_sec, (int) (stamp / 1000000 % 1000),
+                           (long long int) pid, (int) tid, def.tag.c_str(), level,
+                           def.file.c_str(), def.line, def.function.c_str());
+        out.append(header, (size_t) std::min(std::max(len, 0), (int) sizeof(header) - 1));
+
+        iBinaryLogReader args = {record.pos, record.pos + size};
+        if (!blogRenderArgs(args, &out))
+            return -1;
+        out.push_back('\n');
+        record.pos += size;
+        reader = record;
+        ++records;
+
+        if (out.size() >= sizeof(chunk))
+            blogWriteTo(outFd, out);
+    }
+
+    blogWriteTo(outFd, out);
+    return records;
+}
+
+} // namespace iShell
@@ -1074,8 +1074,9 @@ iByteArray iIODevice::read(xint64 maxSize, xint64* readErr)
         && (m_openMode & iIODevice::Text) == 0) {
         iByteArray result = m_buffer.read(maxSize);
 
+        // the buffer hands out one block per call, which may be shorter
         if (!isSequential4Mode())
-            m_pos += maxSize;
+            m_pos += result.length();
         if (m_buffer.isEmpty())
             readData(0, IX_NULLPTR);
         return result;
@@ -1499,6 +1500,135 @@ iByteArray iIODevice::peek(xint64 maxSize, xint64* readErr)
     return readImpl(maxSize, true, readErr);
 }
 
+/*!
+    Reads at most \a maxSize bytes from the device and appends them to \a chunks
+    as the segments they are held in, the buffer blocks or the chunks returned by
+    readData(). Nothing is coalesced, each segment shares its memory block.
+
+    Returns the number of bytes appended, or -1 if an error occurred before
+    anything was read.
+
+    \sa read(), peekChunks()
+*/
+xint64 iIODevice::readChunks(std::list<iByteArray>& chunks, xint64 maxSize)
+{
+    CHECK_MAXLEN(readChunks, xint64(-1));
+    CHECK_READABLE(readChunks, xint64(-1));
+
+    xint64 readSoFar = 0;
+    while (readSoFar < maxSize) {
+        xint64 readErr = 0;
+        iByteArray chunk = readImpl(maxSize - readSoFar, false, &readErr);
+        if (chunk.isEmpty()) {
+            if (readErr < 0 && readSoFar == 0)
+                return xint64(-1);
+            break;
+        }
+
+        readSoFar += chunk.length();
+        chunks.push_back(chunk);
+    }
+
+    return readSoFar;
+}
+
+/*!
+    Same as readChunks() but leaves the read position untouched, the segments
+    stay available for the next read.
+
+    \sa peek(), readChunks()
+*/
+xint64 iIODevice::peekChunks(std::list<iByteArray>& chunks, xint64 maxSize)
+{
+    CHECK_MAXLEN(peekChunks, xint64(-1));
+    CHECK_READABLE(peekChunks, xint64(-1));
+
+    if (!m_transactionStarted) {
+        startTransaction();
+        xint64 ret = readChunks(chunks, maxSize);
+        rollbackTransaction();
+        return ret;
+    }
+
+    // nested in the caller's transaction, restore its read position only
+    const xint64 savedPos = m_pos;
+    const xint64 savedTransactionPos = m_transactionPos;
+    xint64 ret = readChunks(chunks, maxSize);
+    if (isSequential4Mode())
+        m_transactionPos = savedTransactionPos;
+    else
+        seekBuffer(savedPos);
+
+    return ret;
+}
+
+/*!
+    Writes the segments of \a chunks to the device in order, through
+    writeChunksData(). Returns the number of bytes that were actually written,
+    or -1 if an error occurred.
+
+    \sa write(), writeChunksData()
+*/
+xint64 iIODevice::writeChunks(const std::list<iByteArray>& chunks)
+{
+    CHECK_WRITABLE(writeChunks, xint64(-1));
+
+    const bool sequential = isSequential4Mode();
+    // Make sure the device is positioned correctly.
+    if (m_pos != m_devicePos && !sequential && !seek(m_pos))
+        return xint64(-1);
+
+    // the default writeChunksData() already advances per segment
+    const xint64 startPos = m_pos;
+    xint64 written = writeChunksData(chunks);
+    const xint64 advance = startPos + written - m_pos;
+    if (!sequential && written > 0 && advance > 0) {
+        m_pos += advance;
+        m_devicePos += advance;
+        m_buffer.skip(advance);
+    }
+    return written;
+}
+
+/*!
+    Writes the segments of \a chunks to the device. Returns the number of bytes
+    written, or -1 if an error occurred before anything was written.
+
+    The default implementation calls writeData() once per segment, advancing
+    pos() in between, and stops at the first short write. Devices that can take a vector at once (writev(),
+    a message queue) reimplement it to pass the segments through without copying.
+
+    The INC stream devices (iTcpDevice, iUnixDevice) are not among them: they
+    carry framed iINCMessage traffic through writeMessage(), which already
+    sends header and payload as one vector, and reject raw reads and writes.
+
+    \sa writeChunks(), writeData()
+*/
+xint64 iIODevice::writeChunksData(const std::list<iByteArray>& chunks)
+{
+    xint64 written = 0;
+    for (std::list<iByteArray>::const_iterator it = chunks.begin(); it != chunks.end(); ++it) {
+        if (it->isEmpty())
+            continue;
+
+        xint64 ret = writeData(*it);
+        if (ret < 0)
+            return (written > 0) ? written : ret;
+
+        // random-access devices write each segment at the position left by the previous one
+        if (!isSequential4Mode()) {
+            m_pos += ret;
+            m_devicePos += ret;
+            m_buffer.skip(ret);
+        }
+        written += ret;
+        if (ret < it->length())
+            break;
+    }
+
+    return written;
+}
+
 /*!
     Skips up to \a maxSize bytes from the device. Returns the number of bytes
     actually skipped, or -1 on error.
@@ -9,12 +9,18 @@
 /////////////////////////////////////////////////////////////////
 #include <cstdio>
 #include <cstring>
+#include <ctime>
 
 #include "core/io/ilog.h"
 #include "core/utils/idatetime.h"
 #include "core/thread/ithread.h"
 #include "core/kernel/icoreapplication.h"
 
+#ifdef IX_OS_UNIX
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
 namespace iShell {
 
 static inline const char* ilog_path_basename(const char* file_name)
@@ -56,33 +62,129 @@ static void ilog_default_set_threshold(void*, const char* patterns, bool reset)
 
 static void ilog_default_meta_callback(void*, const char* tag, iLogLevel level, const char* file, const char* function, int line, const char* msg, int)
 {
-    static const char log_level_arr[ILOG_LEVEL_MAX] = {'E', 'W', 'N', 'I', 'D', 'V'};
-    char cur_level = '-';
+    char meta_buf[256];
+    iLogger::formatHeader(meta_buf, sizeof(meta_buf), tag, level, file, function, line);
 
-    if ((0 <= level) && (level < ILOG_LEVEL_MAX)) {
-        cur_level = log_level_arr[level];
+    fprintf(stdout, "%s %s\n", meta_buf, msg);
+    fflush(stdout);
+}
+
+static void ilog_default_data_callback(void*, const char* tag, iLogLevel level, const char* file, const char* function, int line, const void* msg, int size)
+{
+    char meta_buf[128];
+    int meta_len = iLogger::formatHeader(meta_buf, sizeof(meta_buf), tag, level, file, function, line);
+    if (meta_len < static_cast<int>(sizeof(meta_buf)) - 1) {
+        meta_buf[meta_len++] = ' ';
+        iLogger::formatData(meta_buf + meta_len, sizeof(meta_buf) - meta_len, msg, size);
     }
 
-    /* __FILE__ might be a file name or an absolute path or a
-     * relative path, irrespective of the exact compiler used,
-     * in which case we want to shorten it to the filename for
-     * readability. */
-    if (file[0] == '.' || file[0] == '/' || file[0] == '\\' || (file[0] != '\0' && file[1] == ':')) {
-        file = ilog_path_basename (file);
+    fprintf(stdout, "%s\n", meta_buf);
+    fflush(stdout);
+}
+
+#if defined(IX_HAVE_CXX11) && defined(IX_OS_UNIX)
+#define IX_LOG_CACHED_HEADER 1
+
+#ifdef CLOCK_REALTIME_COARSE
+#define IX_LOG_CLOCK CLOCK_REALTIME_COARSE
+#else
+#define IX_LOG_CLOCK CLOCK_REALTIME
+#endif
+
+/* "HH:MM:SS" of the last second a thread logged in, so that the local time
+ * conversion runs once per second and thread instead of once per line */
+struct iLogClock
+{
+    time_t second;
+    char hms[8];
+};
+
+/* "  pid   tid" of a thread, formatted again in a forked child */
+struct iLogIds
+{
+    int forkGeneration;
+    int len;
+    char text[32];
+};
+
+static thread_local iLogClock s_logClock = {-1, {0}};
+static thread_local iLogIds s_logIds = {-1, 0, {0}};
+static iAtomicCounter<int> s_forkGeneration(0);
+
+static void ilog_after_fork()
+{
+    ++s_forkGeneration;
+}
+#endif
+
+/* "HH:MM:SS:mmm", buf holds 13 bytes at least */
+static void ilog_format_time(char* buf)
+{
+#ifdef IX_LOG_CACHED_HEADER
+    struct timespec now;
+    clock_gettime(IX_LOG_CLOCK, &now);
+
+    iLogClock& clock = s_logClock;
+    if (clock.second != now.tv_sec) {
+        struct tm local;
+        localtime_r(&now.tv_sec, &local);
+        clock.hms[0] = char('0' + local.tm_hour / 10);
+        clock.hms[1] = char('0' + local.tm_hour % 10);
+        clock.hms[2] = ':';
+        clock.hms[3] = char('0' + local.tm_min / 10);
+        clock.hms[4] = char('0' + local.tm_min % 10);
+        clock.hms[5] = ':';
+        clock.hms[6] = char('0' + local.tm_sec / 10);
+        clock.hms[7] = char('0' + local.tm_sec % 10);
+        clock.second = now.tv_sec;
     }
 
-    char meta_buf[256] = {0};
+    const int msec = static_cast<int>(now.tv_nsec / 1000000);
+    memcpy(buf, clock.hms, sizeof(clock.hms));
+    buf[8] = ':';
+    buf[9] = char('0' + msec / 100);
+    buf[10] = char('0' + msec / 10 % 10);
+    buf[11] = char('0' + msec % 10);
+    buf[12] = '\0';
+#else
     iTime current = iDateTime::currentDateTime().time();
-    snprintf(meta_buf, sizeof(meta_buf), "%02d:%02d:%02d:%03d %5lld %5d %s:%c %s:%d:%s",
-                    current.hour(), current.minute(), current.second(), current.msec(),
-                    (long long int)iCoreApplication::applicationPid(), iThread::currentThreadId(),
-                    tag, cur_level, file, line, function);
+    snprintf(buf, 13, "%02d:%02d:%02d:%03d", current.hour(), current.minute(), current.second(), current.msec());
+#endif
+}
 
-    fprintf(stdout, "%s %s\n", meta_buf, msg);
-    fflush(stdout);
+/* "  pid   tid" */
+static void ilog_format_ids(char* buf, int size)
+{
+#ifdef IX_LOG_CACHED_HEADER
+    static int forkHook = pthread_atfork(IX_NULLPTR, IX_NULLPTR, &ilog_after_fork);
+    IX_UNUSED(forkHook);
+
+    iLogIds& ids = s_logIds;
+    const int generation = s_forkGeneration;
+    if (ids.forkGeneration != generation) {
+        ids.len = snprintf(ids.text, sizeof(ids.text), "%5lld %5d", (long long int)getpid(), iThread::currentThreadId());
+        ids.len = std::min(std::max(ids.len, 0), static_cast<int>(sizeof(ids.text)) - 1);
+        ids.forkGeneration = generation;
+    }
+
+    const int len = std::min(ids.len, size - 1);
+    memcpy(buf, ids.text, (size_t) len);
+    buf[len] = '\0';
+#else
+    snprintf(buf, size, "%5lld %5d", (long long int)iCoreApplication::applicationPid(), iThread::currentThreadId());
+#endif
 }
 
-static void ilog_default_data_callback(void*, const char* tag, iLogLevel level, const char* file, const char* function, int line, const void* msg, int size)
+/* snprintf returns the length it wanted, not the length it wrote */
+static inline int ilog_clamp_len(int len, int size)
+{
+    if (len < 0)
+        return 0;
+
+    return std::min(len, size - 1);
+}
+
+int iLogger::formatHeader(char* buf, int size, const char* tag, iLogLevel level, const char* file, const char* function, int line)
 {
     static const char log_level_arr[ILOG_LEVEL_MAX] = {'E', 'W', 'N', 'I', 'D', 'V'};
     char cur_level = '-';
@@ -99,60 +201,137 @@ static void ilog_default_data_callback(void*, const char* tag, iLogLevel level,
         file = ilog_path_basename (file);
     }
 
-    int  meta_len = 0;
-    char meta_buf[128];
-    const uchar* data = static_cast<const uchar*>(msg);
-    iTime current = iDateTime::currentDateTime().time();
-    meta_len = snprintf(meta_buf, sizeof(meta_buf), "%02d:%02d:%02d:%03d %5lld %5d %s:%c %s:%d:%s ",
-                    current.hour(), current.minute(), current.second(), current.msec(),
-                    (long long int)iCoreApplication::applicationPid(), iThread::currentThreadId(),
-                    tag, cur_level, file, line, function);
-
-    int limit_len = std::min(4, size);
-    for (int idx = 0; idx < limit_len && (meta_len < static_cast<int>(sizeof(meta_buf))); ++idx) {
-        meta_len = snprintf(meta_buf + meta_len, sizeof(meta_buf) - meta_len, "0x%hhx ", data[idx]) + meta_len;
+    char stamp[16];
+    char ids[32];
+    ilog_format_time(stamp);
+    ilog_format_ids(ids, sizeof(ids));
+    int len = snprintf(buf, size, "%s %s %s:%c %s:%d:%s", stamp, ids, tag, cur_level, file, line, function);
+    return ilog_clamp_len(len, size);
+}
+
+int iLogger::formatData(char* buf, int size, const void* data, int dataSize)
+{
+    const uchar* bytes = static_cast<const uchar*>(data);
+    int len = 0;
+    if (size <= 0)
+        return 0;
+
+    buf[0] = '\0';
+    int limit_len = std::min(4, dataSize);
+    for (int idx = 0; idx < limit_len && (len < size - 1); ++idx) {
+        len += ilog_clamp_len(snprintf(buf + len, size - len, idx ? " 0x%hhx" : "0x%hhx", bytes[idx]), size - len);
     }
 
-    if (size > 8 && (meta_len < static_cast<int>(sizeof(meta_buf)))) {
-        meta_len = snprintf(meta_buf + meta_len, sizeof(meta_buf) - meta_len, "... ") + meta_len;
+    if (dataSize > 8 && (len < size - 1)) {
+        len += ilog_clamp_len(snprintf(buf + len, size - len, " ..."), size - len);
     }
 
-    --meta_len;
-    limit_len = std::min(4, size - limit_len);
-    for (int idx = 0; idx < limit_len && (meta_len < static_cast<int>(sizeof(meta_buf))); ++idx) {
-        meta_len = snprintf(meta_buf + meta_len, sizeof(meta_buf) - meta_len, " 0x%hhx", data[size - limit_len + idx]) + meta_len;
+    limit_len = std::min(4, dataSize - limit_len);
+    for (int idx = 0; idx < limit_len && (len < size - 1); ++idx) {
+        len += ilog_clamp_len(snprintf(buf + len, size - len, " 0x%hhx", bytes[dataSize - limit_len + idx]), size - len);
     }
 
-    fprintf(stdout, "%s\n", meta_buf);
-    fflush(stdout);
+    return len;
 }
 
-iLogTarget iLogger::s_target = {IX_NULLPTR, &ilog_default_set_threshold, &ilog_default_filter, &ilog_default_meta_callback, &ilog_default_data_callback};
+static const iLogTarget s_defaultTarget = {IX_NULLPTR, &ilog_default_set_threshold, &ilog_default_filter, &ilog_default_meta_callback, &ilog_default_data_callback};
 
-iLogTarget iLogger::setDefaultTarget(const iLogTarget& target)
+/* The current target, never changed in place: setDefaultTarget() publishes a new copy.
+ * Null stands for s_defaultTarget, so logging works before static construction. */
+static iAtomicPointer<const iLogTarget> s_target;
+
+/* Every call into a target runs inside a read section counted on the epoch the thread
+ * saw, so setDefaultTarget() can tell when nobody uses a replaced target any more. */
+static iAtomicCounter<int> s_targetEpoch(0);
+static iAtomicCounter<int> s_targetReaders[2];
+static iMutex s_targetLock;
+
+class iLogTargetRef
+{
+public:
+    iLogTargetRef() : m_epoch(s_targetEpoch.value() & 1) {
+        ++s_targetReaders[m_epoch];
+        const iLogTarget* target = s_target.load();
+        m_target = target ? target : &s_defaultTarget;
+    }
+    ~iLogTargetRef() { --s_targetReaders[m_epoch]; }
+
+    const iLogTarget* operator->() const { return m_target; }
+
+private:
+    int m_epoch;
+    const iLogTarget* m_target;
+};
+iAtomicCounter<int> iLogger::s_generation(1);
+iLogger::TagSlot iLogger::s_tagCache[iLogger::TagSlots];
+
+void iLogger::invalidateFilterCache()
 {
-    iLogTarget oldTarget = s_target;
+    int generation = s_generation;
+    int next = (generation + 1) & 0x7FFFFFF;
+    while (!s_generation.testAndSet(generation, next ? next : 1, generation))
+        next = (generation + 1) & 0x7FFFFFF;
+}
 
-    if (!target.setThreshold || !target.filter || !target.metaCallback || !target.dataCallback) {
-        s_target.user_data = IX_NULLPTR;
-        s_target.filter = &ilog_default_filter;
-        s_target.setThreshold = &ilog_default_set_threshold;
-        s_target.metaCallback = &ilog_default_meta_callback;
-        s_target.dataCallback = &ilog_default_data_callback;
-        return oldTarget;
+int iLogger::cachedThreshold(const char* tag)
+{
+    const int generation = s_generation;
+    int threshold = ILOG_VERBOSE;
+    {
+        iLogTargetRef target;
+        while ((threshold >= ILOG_ERROR) && !target->filter(target->user_data, tag, static_cast<iLogLevel>(threshold)))
+            --threshold;
     }
 
-    s_target.filter = target.filter;
-    s_target.user_data = target.user_data;
-    s_target.setThreshold = target.setThreshold;
-    s_target.metaCallback = target.metaCallback;
-    s_target.dataCallback = target.dataCallback;
+    /* Claim the slot so that a reader never pairs a tag with the state of another one */
+    TagSlot& slot = s_tagCache[tagSlot(tag)];
+    int state = slot.state;
+    if ((state < 0) || !slot.state.testAndSet(state, -1))
+        return threshold;
+
+    slot.tag.store(tag);
+    slot.state = (generation << 4) | (threshold + 1);
+    return threshold;
+}
+
+iLogTarget iLogger::setDefaultTarget(const iLogTarget& target)
+{
+    const iLogTarget* next = IX_NULLPTR;
+    if (target.setThreshold && target.filter && target.metaCallback && target.dataCallback)
+        next = new iLogTarget(target);
+
+    iMutex::ScopedLock lock(s_targetLock);
+    const iLogTarget* previous = s_target.fetchAndStore(next);
+    invalidateFilterCache();
+
+    /* A section that still holds the previous target started before the swap, on either
+     * epoch. Flip twice and drain the epoch left behind each time; sections starting after
+     * a flip count on the other epoch and already see the new target. */
+    for (int phase = 0; phase < 2; ++phase) {
+        const int epoch = s_targetEpoch.value() & 1;
+        s_targetEpoch = epoch ^ 1;
+        while (s_targetReaders[epoch].value() > 0)
+            iThread::yieldCurrentThread();
+    }
+
+    iLogTarget oldTarget = previous ? *previous : s_defaultTarget;
+    delete previous;
     return oldTarget;
 }
 
+iLogTarget iLogger::defaultTarget()
+{
+    iLogTargetRef target;
+    return *target.operator->();
+}
+
 void iLogger::setThreshold(const char* patterns, bool reset)
 {
-    s_target.setThreshold(s_target.user_data, patterns, reset);
+    {
+        iLogTargetRef target;
+        target->setThreshold(target->user_data, patterns, reset);
+    }
+    invalidateFilterCache();
 }
 
 iLogger::iLogger()
@@ -170,7 +349,7 @@ iLogger::~iLogger()
 
 bool iLogger::start(const char *tag, iLogLevel level, const char* file, const char* function, int line)
 {
-    if (!s_target.filter(s_target.user_data, tag, level))
+    if (!isEnabled(tag, level))
         return false;
 
     m_tags = tag;
@@ -184,12 +363,13 @@ bool iLogger::start(const char *tag, iLogLevel level, const char* file, const ch
 
 void iLogger::end()
 {
-    s_target.metaCallback(s_target.user_data, m_tags, m_level, m_file, m_function, m_line, m_buff.data(), m_buff.size());
+    iLogTargetRef target;
+    target->metaCallback(target->user_data, m_tags, m_level, m_file, m_function, m_line, m_buff.data(), m_buff.size());
 }
 
 void iLogger::asprintf(const char* tag, iLogLevel level, const char* file, const char* function, int line, const char *format, ...)
 {
-    if (!s_target.filter(s_target.user_data, tag, level))
+    if (!isEnabled(tag, level))
         return;
 
     va_list ap;
@@ -198,15 +378,17 @@ void iLogger::asprintf(const char* tag, iLogLevel level, const char* file, const
     int log_len = vsnprintf(log_buf, sizeof(log_buf), format, ap);
     va_end(ap);
 
-    s_target.metaCallback(s_target.user_data, tag, level, file, function, line, log_buf, log_len);
+    iLogTargetRef target;
+    target->metaCallback(target->user_data, tag, level, file, function, line, log_buf, log_len);
 }
 
 void iLogger::binaryData(const char* tag, iLogLevel level, const char* file, const char* function, int line, const void* data, int size)
 {
-    if (!s_target.filter(s_target.user_data, tag, level))
+    if (!isEnabled(tag, level))
         return;
 
-    s_target.dataCallback(s_target.user_data, tag, level, file, function, line, data, size);
+    iLogTargetRef target;
+    target->dataCallback(target->user_data, tag, level, file, function, line, data, size);
 }
 
 void iLogger::append(bool value)
@@ -0,0 +1,231 @@
+/////////////////////////////////////////////////////////////////
+/// Copyright 2018-2020
+/// All rights reserved.
+/////////////////////////////////////////////////////////////////
+/// @file    imappedfile.cpp
+/// @brief   read-only file device backed by a memory mapping
+/// @version 1.0
+/// @author  ncjiakechong@gmail.com
+/////////////////////////////////////////////////////////////////
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include "core/io/imappedfile.h"
+#include "core/io/imemblock.h"
+#include "core/thread/iatomiccounter.h"
+#include "utils/itools_p.h"
+#include "core/io/ilog.h"
+
+/* Minimum window prefetched ahead of sequential reads */
+#define IX_MAPPEDFILE_READAHEAD (1024 * 1024)
+
+#define ILOG_TAG "ix_utils"
+
+namespace iShell {
+
+/* One mmap() of a file, shared by the device and every slice handed out */
+struct iFileMapping
+{
+    void* addr;
+    size_t size;
+    iAtomicCounter<int> refs;
+
+    iFileMapping(void* a, size_t s) : addr(a), size(s), refs(1) {}
+
+    void deref() {
+        if (--refs > 0)
+            return;
+
+        if (IX_NULLPTR != addr)
+            munmap(addr, size);
+        delete this;
+    }
+};
+
+static void sliceFree(void*, void* userData)
+{
+    static_cast<iFileMapping*>(userData)->deref();
+}
+
+iMappedFile::iMappedFile(iObject* parent)
+    : iIODevice(parent)
+    , m_mapping(IX_NULLPTR)
+    , m_filePos(0)
+    , m_prefetchedEnd(0)
+    , m_accessHint(NormalAccess)
+{
+}
+
+iMappedFile::iMappedFile(const iString& name, iObject* parent)
+    : iIODevice(parent)
+    , m_fileName(name)
+    , m_mapping(IX_NULLPTR)
+    , m_filePos(0)
+    , m_prefetchedEnd(0)
+    , m_accessHint(NormalAccess)
+{
+}
+
+iMappedFile::~iMappedFile()
+{
+    close();
+}
+
+void iMappedFile::setFileName(const iString& name)
+{
+    if (isOpen())
+        ilog_warn("[", m_fileName, "] file is already opened");
+
+    m_fileName = name;
+}
+
+bool iMappedFile::open(OpenMode mode)
+{
+    if (isOpen()) {
+        ilog_warn("[", m_fileName, "] file is already opened");
+        return false;
+    }
+
+    if (mode & WriteOnly) {
+        setErrorString(iLatin1StringView("Mapped files are read-only"));
+        return false;
+    }
+
+    const iByteArray path = m_fileName.toLocal8Bit();
+    int fd = ::open(path.constData(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        setErrorString(iString::fromUtf8(iByteArrayView(strerror(errno))));
+        return false;
+    }
+
+    struct stat st;
+    if ((fstat(fd, &st) < 0) || !S_ISREG(st.st_mode)
+        || ((xuint64) st.st_size > (xuint64) ((size_t) -1))) {
+        setErrorString(iLatin1StringView("Not a regular file or too large to map"));
+        ::close(fd);
+        return false;
+    }
+
+    void* addr = IX_NULLPTR;
+    const size_t length = (size_t) st.st_size;
+    if (length > 0) {
+        addr = mmap(IX_NULLPTR, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (MAP_FAILED == addr) {
+            setErrorString(iString::fromUtf8(iByteArrayView(strerror(errno))));
+            ::close(fd);
+            return false;
+        }
+    }
+
+    /* The mapping stays valid without the descriptor */
+    ::close(fd);
+
+    m_mapping = new iFileMapping(addr, length);
+    m_filePos = 0;
+    m_prefetchedEnd = 0;
+    applyAccessHint();
+
+    return iIODevice::open(mode | Unbuffered);
+}
+
+void iMappedFile::close()
+{
+    if (!isOpen())
+        return;
+
+    iIODevice::close();
+
+    /* Slices still in use keep their own reference */
+    m_mapping->deref();
+    m_mapping = IX_NULLPTR;
+    m_filePos = 0;
+}
+
+xint64 iMappedFile::size() const
+{
+    return m_mapping ? (xint64) m_mapping->size : xint64(0);
+}
+
+bool iMappedFile::seek(xint64 pos)
+{
+    if (!iIODevice::seek(pos))
+        return false;
+
+    m_filePos = pos;
+    return true;
+}
+
+void iMappedFile::setAccessHint(AccessHint hint)
+{
+    m_accessHint = hint;
+    applyAccessHint();
+}
+
+void iMappedFile::applyAccessHint()
+{
+    if ((IX_NULLPTR == m_mapping) || (IX_NULLPTR == m_mapping->addr))
+        return;
+
+    int advice = MADV_NORMAL;
+    switch (m_accessHint) {
+    case SequentialAccess: advice = MADV_SEQUENTIAL; break;
+    case RandomAccess: advice = MADV_RANDOM; break;
+    default: break;
+    }
+
+    if (madvise(m_mapping->addr, m_mapping->size, advice) < 0)
+        ilog_debug("[", m_fileName, "] madvise ", advice, " failed: ", errno);
+}
+
+bool iMappedFile::willNeed(xint64 offset, xint64 length)
+{
+    if ((IX_NULLPTR == m_mapping) || (IX_NULLPTR == m_mapping->addr)
+        || (offset < 0) || (length <= 0) || (offset >= (xint64) m_mapping->size))
+        return false;
+
+    const size_t pageSize = ix_page_size();
+    const size_t begin = (size_t) offset & ~(pageSize - 1);
+    const size_t end = std::min((size_t) (offset + length), m_mapping->size);
+    return madvise((xuint8*) m_mapping->addr + begin, end - begin, MADV_WILLNEED) == 0;
+}
+
+iByteArray iMappedFile::readData(xint64 maxlen, xint64* readErr)
+{
+    if (IX_NULLPTR == m_mapping) {
+        if (readErr) *readErr = -1;
+        return iByteArray();
+    }
+
+    const xint64 fileSize = (xint64) m_mapping->size;
+    if ((maxlen <= 0) || (m_filePos >= fileSize))
+        return iByteArray();
+
+    const xint64 length = std::min(maxlen, fileSize - m_filePos);
+    char* data = (char*) m_mapping->addr + m_filePos;
+
+    /* Prefetch the next window once a read gets close to the previous one's end */
+    if ((SequentialAccess == m_accessHint) && (m_filePos + 2 * length >= m_prefetchedEnd)) {
+        const xint64 window = std::max(4 * length, xint64(IX_MAPPEDFILE_READAHEAD));
+        willNeed(m_filePos + length, window);
+        m_prefetchedEnd = m_filePos + length + window;
+    }
+
+    ++m_mapping->refs;
+    iMemBlock* block = iMemBlock::new4User(IX_NULLPTR, data, (size_t) length, sliceFree, m_mapping, true);
+    m_filePos += length;
+
+    return iByteArray(iByteArray::DataPointer(static_cast<iTypedArrayData<char>*>(block), data, length));
+}
+
+xint64 iMappedFile::writeData(const iByteArray&)
+{
+    setErrorString(iLatin1StringView("Mapped files are read-only"));
+    return -1;
+}
+
+} // namespace iShell
@@ -13,6 +13,7 @@
 #include "core/io/isharemem.h"
 #include "core/io/imemtrap.h"
 #include "core/io/imemblock.h"
+#include "core/io/imemtracker.h"
 #include "utils/itools_p.h"
 #include "core/io/ilog.h"
 #include "io/imemchunk.h"
@@ -25,10 +26,12 @@
  * it for the first time. */
 #define IX_MEMPOOL_SLOTS_MAX 1024
 #define IX_MEMPOOL_SLOT_SIZE (64*1024)
+/* Smallest size class, classes double up to the largest one below half the segment */
+#define IX_MEMPOOL_CLASS_MIN 256
 
-#define IX_MEMEXPORT_SLOTS_MAX 128
+#define IX_MEMEXPORT_SLOTS_MAX 2048
 
-#define IX_MEMIMPORT_SLOTS_MAX 160
+#define IX_MEMIMPORT_SLOTS_MAX 2080
 #define IX_MEMIMPORT_SEGMENTS_MAX 16
 
 #define ILOG_TAG "ix_utils"
@@ -205,9 +208,217 @@ static inline xsizetype calculateBlockSize(size_t elementCount, size_t elementSi
     }
 }
 
+/* Thread-local caches of the small heap blocks behind iByteArray/iString/iVector. Every chunk
+ * carries a header naming the arena it came from. The owner thread recycles its chunks directly;
+ * any other thread pushes them onto the owner's remote list, which the owner takes over in one
+ * swap once a local class runs dry. Only the owner pops, so the lock-free list has no ABA.
+ * Arenas of exited threads are parked for the next new thread instead of being freed, so a
+ * late remote free never writes into freed memory. */
+#define IX_ARENA_CLASS_MIN 128
+#define IX_ARENA_CLASSES 5
+#define IX_ARENA_DEPTH 64
+
+static inline size_t arenaClassSize(int arenaClass)
+{
+    return (size_t) IX_ARENA_CLASS_MIN << (arenaClass - 1);
+}
+
+#if defined(IBUILD_ARRAY_ARENA) && defined(IX_HAVE_CXX11)
+struct iArrayArena;
+
+/* In front of the iMemBlock of every arena chunk, two words keep the block aligned */
+struct iArenaChunk
+{
+    iArrayArena* arena;     ///< owner, fixed for the lifetime of the chunk
+    xintptr arenaClass;
+};
+
+/* While a chunk waits on a remote list its link lives where the iMemBlock was */
+static inline iArenaChunk*& arenaNext(iArenaChunk* chunk)
+{
+    return *reinterpret_cast<iArenaChunk**>(chunk + 1);
+}
+
+struct iArrayArena
+{
+    iArenaChunk* chunks[IX_ARENA_CLASSES][IX_ARENA_DEPTH];  ///< owner thread only
+    int count[IX_ARENA_CLASSES];
+    iAtomicPointer<iArenaChunk> remote;                     ///< freed by other threads
+    iArrayArena* nextParked;                                ///< under arenaLock()
+
+    iArrayArena() : remote(IX_NULLPTR), nextParked(IX_NULLPTR) { memset(count, 0, sizeof(count)); }
+};
+
+static iAtomicCounter<int> s_arenaEnabled(0);
+
+/* 0: not created yet, 1: alive, 2: destroyed on thread exit */
+static thread_local int s_arenaState = 0;
+static thread_local iArrayArena* s_arena = IX_NULLPTR;
+
+static iMutex& arenaLock()
+{
+    static iMutex s_lock;
+    return s_lock;
+}
+
+/* Arenas whose thread exited, waiting for the next thread */
+static iArrayArena* s_parkedArenas = IX_NULLPTR;
+
+/* Owner only: moves the chunks other threads handed back into the local cache */
+static void arenaTakeRemote(iArrayArena* arena)
+{
+    iArenaChunk* chunk = arena->remote.fetchAndStore(IX_NULLPTR);
+    while (IX_NULLPTR != chunk) {
+        iArenaChunk* next = arenaNext(chunk);
+        const int idx = (int) chunk->arenaClass - 1;
+        if (arena->count[idx] < IX_ARENA_DEPTH)
+            arena->chunks[idx][arena->count[idx]++] = chunk;
+        else
+            ::free(chunk);
+        chunk = next;
+    }
+}
+
+/* Empties the cache on thread exit and parks the arena, chunks still out keep pointing at it */
+struct iArrayArenaReaper
+{
+    ~iArrayArenaReaper() {
+        iArrayArena* arena = s_arena;
+        s_arenaState = 2;
+        s_arena = IX_NULLPTR;
+
+        arenaTakeRemote(arena);
+        for (int idx = 0; idx < IX_ARENA_CLASSES; ++idx) {
+            while (arena->count[idx] > 0)
+                ::free(arena->chunks[idx][--arena->count[idx]]);
+        }
+
+        iScopedLock<iMutex> _lock(arenaLock());
+        arena->nextParked = s_parkedArenas;
+        s_parkedArenas = arena;
+    }
+};
+
+static iArrayArena* arenaLocal()
+{
+    if (1 == s_arenaState)
+        return s_arena;
+
+    if (2 == s_arenaState)
+        return IX_NULLPTR;
+
+    static thread_local iArrayArenaReaper s_reaper;
+    IX_UNUSED(s_reaper);
+
+    iArrayArena* arena = IX_NULLPTR;
+    {
+        iScopedLock<iMutex> _lock(arenaLock());
+        arena = s_parkedArenas;
+        if (IX_NULLPTR != arena)
+            s_parkedArenas = arena->nextParked;
+    }
+
+    s_arena = (IX_NULLPTR != arena) ? arena : new iArrayArena;
+    s_arenaState = 1;
+    return s_arena;
+}
+
+/* arenaClass is set to 1 + the size class of the chunk, or 0 when it comes from malloc() */
+static void* arenaAlloc(size_t size, int* arenaClass)
+{
+    IX_COMPILER_VERIFY(0 == sizeof(iArenaChunk) % IX_ALIGNOF(iMemBlock));
+    *arenaClass = 0;
+    if ((0 == s_arenaEnabled.value()) || (size > arenaClassSize(IX_ARENA_CLASSES)))
+        return ::malloc(size);
+
+    iArrayArena* arena = arenaLocal();
+    if (IX_NULLPTR == arena)
+        return ::malloc(size);
+
+    int cls = 1;
+    while (arenaClassSize(cls) < size)
+        ++cls;
+
+    const int idx = cls - 1;
+    if ((0 == arena->count[idx]) && (IX_NULLPTR != arena->remote.load()))
+        arenaTakeRemote(arena);
+
+    iArenaChunk* chunk = IX_NULLPTR;
+    if (arena->count[idx] > 0) {
+        chunk = arena->chunks[idx][--arena->count[idx]];
+    } else {
+        chunk = static_cast<iArenaChunk*>(::malloc(sizeof(iArenaChunk) + arenaClassSize(cls)));
+        if (IX_NULLPTR == chunk)
+            return IX_NULLPTR;
+
+        chunk->arena = arena;
+        chunk->arenaClass = cls;
+    }
+
+    *arenaClass = cls;
+    return chunk + 1;
+}
+
+static void arenaFree(void* ptr, int arenaClass)
+{
+    if (0 == arenaClass) {
+        ::free(ptr);
+        return;
+    }
+
+    iArenaChunk* chunk = static_cast<iArenaChunk*>(ptr) - 1;
+    iArrayArena* arena = chunk->arena;
+    if ((1 == s_arenaState) && (arena == s_arena)) {
+        if (arena->count[arenaClass - 1] < IX_ARENA_DEPTH)
+            arena->chunks[arenaClass - 1][arena->count[arenaClass - 1]++] = chunk;
+        else
+            ::free(chunk);
+        return;
+    }
+
+    /* Another thread's chunk goes back to its owner, this thread's cache would only hoard it */
+    iArenaChunk* head = IX_NULLPTR;
+    do {
+        head = arena->remote.load();
+        arenaNext(chunk) = head;
+    } while (!arena->remote.testAndSet(head, chunk));
+}
+
+void iMemBlock::setArenaEnabled(bool enabled)
+{
+    s_arenaEnabled = enabled ? 1 : 0;
+}
+
+bool iMemBlock::isArenaEnabled()
+{
+    return 0 != s_arenaEnabled.value();
+}
+#else
+static inline void* arenaAlloc(size_t size, int* arenaClass)
+{
+    *arenaClass = 0;
+    return ::malloc(size);
+}
+
+static inline void arenaFree(void* ptr, int)
+{
+    ::free(ptr);
+}
+
+void iMemBlock::setArenaEnabled(bool)
+{
+}
+
+bool iMemBlock::isArenaEnabled()
+{
+    return false;
+}
+#endif
+
 iMemBlock::iMemBlock(iMemPool* pool, Type type, ArrayOptions options, void* data, size_t length, size_t capacity)
     : m_readOnly(false)
     , m_isSilence(false)
+    , m_arenaClass(0)
     , m_type(type)
     , m_options(options)
     , m_length(length)
@@ -255,8 +466,9 @@ void iMemBlock::doFree()
             /* We could attach it to unused_memblocks, but that would
              * probably waste some considerable amount of memory */
             void* ptr = this;
+            const int arenaClass = m_arenaClass;
             this->~iMemBlock();
-            ::free(ptr);
+            arenaFree(ptr, arenaClass);
             break;
         }
 
@@ -308,7 +520,7 @@ void iMemBlock::doFree()
 
             /* Publish the slot only after its old block header is fully
              * destroyed, so another thread cannot reuse it concurrently. */
-            while (!pool->m_freeSlots.push(slot)) {}
+            pool->freeSlot(slot);
 
             break;
         }
@@ -365,9 +577,11 @@ iMemBlock* iMemBlock::newOne(iMemPool* pool, size_t elementCount, size_t element
         return IX_NULLPTR;
     }
 
-    void* slot = ::malloc(allocSize);
+    int arenaClass = 0;
+    void* slot = arenaAlloc(allocSize, &arenaClass);
     void* ptr = reinterpret_cast<void*>((xuintptr(slot) + sizeof(iMemBlock) + alignment -1) & ~(alignment - 1));
     block = new (slot) iMemBlock(pool, MEMBLOCK_APPENDED, options, ptr, allocSize - headerSize, capacity);
+    block->m_arenaClass = (xuint8) arenaClass;
 
     return block;
 }
@@ -395,12 +609,13 @@ iMemBlock* iMemBlock::new4Pool(iMemPool* pool, size_t elementCount, size_t eleme
     xsizetype allocSize = calculateBlockSize(elementCount, elementSize, headerSize, options);
     xsizetype capacity = (allocSize - headerSize) / elementSize;   // Element capacity (without extra bytes)
     allocSize = reserveExtraBytes(allocSize);
-    if ((allocSize < 0) || ((allocSize - (xsizetype)headerSize) < 0) || (allocSize > static_cast<xsizetype>(pool->m_blockSize))) {  // handle overflow. cannot allocate reliably
+    if ((allocSize < 0) || ((allocSize - (xsizetype)headerSize) < 0)) {  // handle overflow. cannot allocate reliably
         return IX_NULLPTR;
     }
 
-    if (static_cast<xsizetype>(pool->m_blockSize) >= allocSize) {
-        iMemPool::Slot* slot = pool->allocateSlot();
+    const size_t slotSizeMax = pool->slotSizeMax();
+    if (slotSizeMax >= static_cast<size_t>(allocSize)) {
+        iMemPool::Slot* slot = pool->allocateSlot(allocSize);
         if (IX_NULLPTR == slot)
             return IX_NULLPTR;
 
@@ -408,8 +623,8 @@ iMemBlock* iMemBlock::new4Pool(iMemPool* pool, size_t elementCount, size_t eleme
         iMemBlock* block = new (pool->slotData(slot)) iMemBlock(pool, MEMBLOCK_POOL, DefaultAllocationFlags,
                                                         ptr, allocSize - headerSize, capacity);
         return block;
-    } else if (pool->m_blockSize >= (allocSize - headerSize)) {
-        iMemPool::Slot* slot = pool->allocateSlot();
+    } else if (slotSizeMax >= static_cast<size_t>(allocSize - headerSize)) {
+        iMemPool::Slot* slot = pool->allocateSlot(allocSize - headerSize);
          if (IX_NULLPTR == slot)
             return IX_NULLPTR;
 
@@ -422,7 +637,7 @@ iMemBlock* iMemBlock::new4Pool(iMemPool* pool, size_t elementCount, size_t eleme
         return block;
     } else {
         iLogger::asprintf(ILOG_TAG, iShell::ILOG_INFO, __FILE__, __FUNCTION__, __LINE__,
-                        "%s pool to alloc too large memory block: %llu > %zu", pool->m_name, (long long unsigned int)(allocSize - headerSize), pool->m_blockSize);
+                        "%s pool to alloc too large memory block: %llu > %zu", pool->m_name, (long long unsigned int)(allocSize - headerSize), slotSizeMax);
         pool->m_stat.nTooLargeForPool++;
         return IX_NULLPTR;
     }
@@ -482,7 +697,20 @@ iMemBlock* iMemBlock::reallocate(iMemBlock* block, size_t elementCount, size_t e
     xptrdiff offset = reinterpret_cast<char *>(block->m_data.load()) - reinterpret_cast<char *>(block);
     IX_ASSERT(offset < allocSize);
 
-    iMemBlock* newBlock = static_cast<iMemBlock *>(::realloc(static_cast<void *>(block), allocSize));
+    iMemBlock* newBlock = block;
+    const int arenaClass = block->m_arenaClass;
+    if (0 == arenaClass) {
+        newBlock = static_cast<iMemBlock *>(::realloc(static_cast<void *>(block), allocSize));
+    } else if (arenaClassSize(arenaClass) < (size_t) allocSize) {
+        /* Outgrew its chunk, the header moves along with the data like realloc() does */
+        int newClass = 0;
+        void* chunk = arenaAlloc(allocSize, &newClass);
+        memcpy(chunk, block, std::min((size_t) (offset + block->m_length), (size_t) allocSize));
+        arenaFree(block, arenaClass);
+        newBlock = static_cast<iMemBlock *>(chunk);
+        newBlock->m_arenaClass = (xuint8) newClass;
+    }
+
     newBlock->m_data = reinterpret_cast<char *>(newBlock) + offset;
     newBlock->m_options = options;
     newBlock->m_length = allocSize - headerSize;
@@ -511,6 +739,11 @@ void iMemBlock::statAdd()
     m_pool->m_stat.nAllocatedByType[m_type] ++;
     m_pool->m_stat.nAccumulatedByType[m_type] ++;
 
+    #ifdef IBUILD_MEM_TRACKING
+    if (iMemTracker::isActive())
+        iMemTracker::recordAlloc(this);
+    #endif
+
     /* iLogger::asprintf(ILOG_TAG, iShell::ILOG_VERBOSE, __FILE__, __FUNCTION__, __LINE__,
                         "%s pool: add length %zu, allocatedSize %d, accumulatedSize %d",
                         m_pool->m_name, m_length, m_pool->m_stat.allocatedSize.value(),
@@ -533,6 +766,11 @@ void iMemBlock::statRemove()
 
     m_pool->m_stat.nAllocatedByType[m_type]--;
 
+    #ifdef IBUILD_MEM_TRACKING
+    if (iMemTracker::isActive() || iMemTracker::hasLiveBlocks())
+        iMemTracker::recordFree(this);
+    #endif
+
     /* iLogger::asprintf(ILOG_TAG, iShell::ILOG_VERBOSE, __FILE__, __FUNCTION__, __LINE__,
                     "%s pool: remove length %zu, allocatedSize %d, accumulatedSize %d",
                     m_pool->m_name, m_length, m_pool->m_stat.allocatedSize.value(),
@@ -601,8 +839,8 @@ void iMemBlock::makeLocal()
 {
     m_pool->m_stat.nAllocatedByType[m_type]--;
 
-    if (m_length <= m_pool->m_blockSize) {
-        iMemPool::Slot* slot = m_pool->allocateSlot();
+    if (m_length <= m_pool->slotSizeMax()) {
+        iMemPool::Slot* slot = m_pool->allocateSlot(m_length);
 
         if (slot) {
             void* new_data = m_pool->slotData(slot);
@@ -694,7 +932,7 @@ void iMemBlock::replaceImport()
  *
  * TODO-1: Transform the global core mempool to a per-client one
  * TODO-2: Remove global mempools support */
-iMemPool* iMemPool::create(const char* name, const char* prefix, MemType type, size_t size, bool perClient)
+iMemPool* iMemPool::create(const char* name, const char* prefix, MemType type, size_t size, bool perClient, uint shmOptions, int numaNode)
 {
     const size_t page_size = ix_page_size();
     size_t block_size = ix_page_align(IX_MEMPOOL_SLOT_SIZE);
@@ -711,18 +949,64 @@ iMemPool* iMemPool::create(const char* name, const char* prefix, MemType type, s
             n_blocks = 2;
     }
 
-    iShareMem* memory = iShareMem::create(prefix, type, n_blocks * block_size, 0700);
+    iShareMem* memory = iShareMem::create(prefix, type, n_blocks * block_size, 0700, shmOptions, numaNode);
     if (IX_NULLPTR == memory)
         return IX_NULLPTR;
 
     iMemPool* pool = new iMemPool(name, memory, block_size, n_blocks, perClient);
     iLogger::asprintf(ILOG_TAG, iShell::ILOG_DEBUG, __FILE__, __FUNCTION__, __LINE__,
-                        "%s pool using %d type with %u slots of size %zu each, total size is %zu, maximum usable slot size is %zu",
-                        pool->m_name, type, pool->m_nBlocks, pool->m_blockSize, pool->m_nBlocks * pool->m_blockSize, pool->blockSizeMax());
+                        "%s pool using %d type with %u blocks of size %zu each, total size is %zu, %d size classes, maximum usable slot size is %zu",
+                        pool->m_name, type, pool->m_nBlocks, pool->m_blockSize, pool->m_nBlocks * pool->m_blockSize, pool->m_nClasses, pool->blockSizeMax());
 
     return pool;
 }
 
+/* Slots one thread holds back for one pool. Only that thread touches them,
+ * except on thread exit and pool destruction, both under magazineLock() */
+struct iMemPool::Magazine
+{
+    iMemPool* pool;
+    ThreadCache* owner;
+    int ownerIdx;
+
+    int nClasses;   ///< cached classes, the pool's m_nMagazineClasses
+    int nHits;      ///< not folded into the pool's Stat yet
+    int nMisses;
+    int count[SizeClassesMax];
+    Slot** slots;   ///< MagazineSize entries per cached class
+
+    Magazine* _next;
+    Magazine* _prev;
+};
+
+/* Magazines of the calling thread, at most one per pool */
+struct iMemPool::ThreadCache
+{
+    struct Entry {
+        iAtomicPointer<iMemPool> pool;  ///< cleared by the pool's destructor from any thread
+        Magazine* mag;
+
+        Entry() : mag(IX_NULLPTR) {}
+    };
+
+    Entry entries[MagazinePools];
+    int nextEvict;
+
+    ThreadCache() : nextEvict(0) {}
+    ~ThreadCache();
+};
+
+static iMutex& magazineLock()
+{
+    static iMutex s_lock;
+    return s_lock;
+}
+
+#ifdef IX_HAVE_CXX11
+/* 0: not created yet, 1: alive, 2: destroyed on thread exit */
+static thread_local int s_threadCacheState = 0;
+#endif
+
 iMemPool* iMemPool::fakeAdaptor()
 {
     static iSharedDataPointer<iMemPool> s_fakeMemPool(new iMemPool("FakePool", new iShareMem("ix-shm"), 256, 0, false));
@@ -738,8 +1022,11 @@ iMemPool::iMemPool(const char* name, iShareMem* memory, size_t block_size, xuint
     , m_memory(memory)
     , m_imports(IX_NULLPTR)
     , m_exports(IX_NULLPTR)
-    , m_freeSlots(n_blocks)
+    , m_nClasses(0)
+    , m_blockInfo(IX_NULLPTR)
     , m_cacheHeads(128)
+    , m_nMagazineClasses(0)
+    , m_magazines(IX_NULLPTR)
     , m_nInit(0)
     , m_semaphore(0)
     , m_mutex(iMutex::Recursive)
@@ -755,6 +1042,31 @@ iMemPool::iMemPool(const char* name, iShareMem* memory, size_t block_size, xuint
     m_stat.exportedSize = 0;
     m_stat.nTooLargeForPool = 0;
     m_stat.nPoolFull = 0;
+    m_stat.nClassFallback = 0;
+    m_stat.nMagazineHits = 0;
+    m_stat.nMagazineMisses = 0;
+    m_stat.nReclaimed = 0;
+    m_stat.reclaimedSize = 0;
+
+    /* Classes inside one segment block, the block itself, then spans of up to half the segment */
+    size_t classSize = IX_MEMPOOL_CLASS_MIN;
+    for (; (classSize < block_size) && (m_nClasses < SizeClassesMax - 1); classSize <<= 1)
+        m_classes[m_nClasses++].size = classSize;
+    m_classes[m_nClasses++].size = block_size;
+    for (xuint32 span = 2; (span <= n_blocks / 2) && (m_nClasses < SizeClassesMax); span <<= 1)
+        m_classes[m_nClasses++].size = block_size * span;
+
+    /* Slots spanning several segment blocks are too few to be worth caching per thread */
+    #ifdef IX_HAVE_CXX11
+    while ((n_blocks > 0) && (m_nMagazineClasses < m_nClasses) && (m_classes[m_nMagazineClasses].size <= block_size))
+        ++m_nMagazineClasses;
+    #endif
+
+    m_blockInfo = new BlockInfo[n_blocks > 0 ? n_blocks : 1];
+    for (xuint32 idx = 0; idx < n_blocks; ++idx) {
+        m_blockInfo[idx].head = idx;
+        m_blockInfo[idx].sizeClass = 0;
+    }
 
     if (name) {
         strncpy(const_cast<char*>(m_name), name, std::min(sizeof(m_name) - 1, strlen(name)));
@@ -770,6 +1082,10 @@ iMemPool::iMemPool(const char* name, iShareMem* memory, size_t block_size, xuint
 
 iMemPool::~iMemPool()
 {
+    /* Blocks released from here on go straight to the free lists */
+    const int nMagazineClasses = m_nMagazineClasses;
+    m_nMagazineClasses = 0;
+
     iScopedLock<iMutex> _lock(m_mutex);
 
     while (m_imports) {
@@ -782,35 +1098,40 @@ iMemPool::~iMemPool()
 
     _lock.unlock();
 
+    if (nMagazineClasses > 0) {
+        iScopedLock<iMutex> _magLock(magazineLock());
+        while (m_magazines) {
+            Magazine* mag = m_magazines;
+            mag->owner->entries[mag->ownerIdx].pool = IX_NULLPTR;
+            mag->owner->entries[mag->ownerIdx].mag = IX_NULLPTR;
+            drainMagazine(mag);
+        }
+    }
+
     if (m_stat.nAllocated > 0) {
         /* Ouch, somebody is retaining a memory block reference! */
-        iFreeList<Slot*> list(m_nBlocks);
-
-        /* Let's try to find at least one of those leaked memory blocks */
-        for (uint idx = 0; idx < (uint)m_nInit; ++idx) {
-            Slot* slot = (Slot*) ((xuint8*)m_memory->data() + (m_blockSize * (size_t) idx));
-
+        for (int idx = 0; idx < m_nClasses; ++idx) {
+            int nFree = 0;
+            iFreeList<Slot*> list(0);
             Slot* k = IX_NULLPTR;
-            while ((k = m_freeSlots.pop(IX_NULLPTR))) {
+            while ((k = m_classes[idx].freeSlots.pop(IX_NULLPTR))) {
                 while (!list.push(k)) {}
-
-                if (slot == k)
-                    break;
+                ++nFree;
             }
+            while ((k = list.pop(IX_NULLPTR)))
+                while (!m_classes[idx].freeSlots.push(k)) {}
+            nFree += m_classes[idx].nReclaimed.value();
 
-            if (!k)
+            if (nFree < m_classes[idx].nSlots.value())
                 iLogger::asprintf(ILOG_TAG, iShell::ILOG_ERROR, __FILE__, __FUNCTION__, __LINE__,
-                            "%s pool REF: Leaked memory block %p idx: %u", m_name, slot, idx);
-
-            while ((k = list.pop(IX_NULLPTR)))
-                while (!m_freeSlots.push(k)) {}
+                            "%s pool REF: Leaked %d slots of size %zu", m_name, m_classes[idx].nSlots.value() - nFree, m_classes[idx].size);
         }
 
         iLogger::asprintf(ILOG_TAG, iShell::ILOG_ERROR, __FILE__, __FUNCTION__, __LINE__,
                         "%s pool destroyed but not all memory blocks freed! remain %d", m_name, m_stat.nAllocated);
     }
 
-    while(m_freeSlots.pop(IX_NULLPTR)) {}
+    delete[] m_blockInfo;
     delete m_memory;
 
     void* buffer = IX_NULLPTR;
@@ -822,51 +1143,283 @@ iMemPool::~iMemPool()
 /* No lock necessary */
 size_t iMemPool::blockSizeMax() const
 {
-    return m_blockSize - IX_ALIGN(sizeof(iMemBlock));
+    return slotSizeMax() - IX_ALIGN(sizeof(iMemBlock));
 }
 
-/* No lock necessary */
+/* Free lists need no lock, magazines are walked under magazineLock() while their owners leave the pool alone */
 void iMemPool::vacuum()
 {
-    Slot* slot = IX_NULLPTR;
-    iFreeList<Slot*> list(m_nBlocks);
-    while ((slot = m_freeSlots.pop(IX_NULLPTR))) {
-        while (!list.push(slot)) {}
+    trim(0, (size_t) -1);
+
+    for (int idx = 0; idx < m_nClasses; ++idx) {
+        SizeClass& sizeClass = m_classes[idx];
+        iFreeList<Slot*> list(0);
+        Slot* slot = IX_NULLPTR;
+
+        while ((slot = sizeClass.freeSlots.pop(IX_NULLPTR))) {
+            scrubSlot(slot, sizeClass.size, false);
+            while (!list.push(slot)) {}
+        }
+        while ((slot = list.pop(IX_NULLPTR)))
+            while (!sizeClass.freeSlots.push(slot)) {}
+
+        while ((slot = sizeClass.reclaimedSlots.pop(IX_NULLPTR))) {
+            scrubSlot(slot, sizeClass.size, true);
+            while (!list.push(slot)) {}
+        }
+        while ((slot = list.pop(IX_NULLPTR)))
+            while (!sizeClass.reclaimedSlots.push(slot)) {}
+    }
+
+    iScopedLock<iMutex> _magLock(magazineLock());
+    for (Magazine* mag = m_magazines; mag; mag = mag->_next) {
+        for (int idx = 0; idx < mag->nClasses; ++idx) {
+            Slot** slots = mag->slots + idx * MagazineSize;
+            for (int k = 0; k < mag->count[idx]; ++k)
+                scrubSlot(slots[k], m_classes[idx].size, false);
+        }
+    }
+}
+
+/* No lock necessary. Zeroes a free slot; of a punched one only what the punch
+ * left behind: the partial pages at its edges, and the rest too unless the
+ * kernel dropped those pages for good (MADV_REMOVE) */
+void iMemPool::scrubSlot(Slot* slot, size_t size, bool punched)
+{
+    xuint8* data = (xuint8*) slot;
+    const size_t offset = (size_t) (data - (xuint8*) m_memory->data());
+    if (!punched || !m_memory->punch(offset, size, true)) {
+        memset(data, 0, size);
+        return;
     }
 
-    while ((slot = list.pop(IX_NULLPTR))) {
-        m_memory->punch((size_t) ((xuint8*) slot - (xuint8*) m_memory->data()), m_blockSize);
+    const size_t page_size = m_memory->pageSize();
+    const size_t begin = std::min(((offset + page_size - 1) / page_size) * page_size, offset + size);
+    const size_t end = std::max(((offset + size) / page_size) * page_size, begin);
+    memset(data, 0, begin - offset);
+    memset(data + (end - offset), 0, offset + size - end);
+}
+
+/* No lock necessary */
+size_t iMemPool::trim(size_t residentTarget, size_t maxBytes)
+{
+    if ((m_memory->size() <= 0) || (IX_NULLPTR == m_memory->data()))
+        return 0;
+
+    const size_t page_size = m_memory->pageSize();
+    size_t resident = residentSize();
+    size_t reclaimed = 0;
+    int nReclaimed = 0;
+
+    /* Largest classes first, they return the most memory per madvise() */
+    for (int idx = m_nClasses - 1; idx >= 0; --idx) {
+        SizeClass& sizeClass = m_classes[idx];
+        /* Slots smaller than a page (a huge page on hugetlb segments) share their pages with live ones */
+        if (sizeClass.size < page_size)
+            break;
+
+        while ((resident > residentTarget) && (reclaimed < maxBytes)) {
+            Slot* slot = sizeClass.freeSlots.pop(IX_NULLPTR);
+            if (IX_NULLPTR == slot)
+                break;
+
+            m_memory->punch((size_t) ((xuint8*) slot - (xuint8*) m_memory->data()), sizeClass.size);
 
-        while (!m_freeSlots.push(slot)) {}
+            /* Kept apart so that allocations prefer slots that are still resident */
+            ++sizeClass.nReclaimed;
+            while (!sizeClass.reclaimedSlots.push(slot)) {}
+
+            reclaimed += sizeClass.size;
+            resident -= std::min(resident, sizeClass.size);
+            ++nReclaimed;
+        }
     }
+
+    m_stat.nReclaimed += nReclaimed;
+    m_stat.reclaimedSize += (xint64) reclaimed;
+    return reclaimed;
 }
 
 /* No lock necessary */
-iMemPool::Slot* iMemPool::allocateSlot()
+size_t iMemPool::residentSize() const
 {
-    Slot* slot = m_freeSlots.pop(IX_NULLPTR);
+    size_t carved = m_blockSize * (size_t) std::min((xuint32) m_nInit.value(), m_nBlocks);
+    for (int idx = 0; idx < m_nClasses; ++idx) {
+        const size_t punched = m_classes[idx].size * (size_t) m_classes[idx].nReclaimed.value();
+        carved -= std::min(carved, punched);
+    }
+
+    return carved;
+}
+
+/* No lock necessary */
+void iMemPool::populate()
+{
+    if ((m_memory->size() <= 0) || (IX_NULLPTR == m_memory->data()))
+        return;
+
+    m_memory->populate(0, m_blockSize * (size_t) m_nBlocks);
+
+    /* Every page is resident again */
+    for (int idx = 0; idx < m_nClasses; ++idx) {
+        SizeClass& sizeClass = m_classes[idx];
+        Slot* slot = IX_NULLPTR;
+        while ((slot = sizeClass.reclaimedSlots.pop(IX_NULLPTR))) {
+            --sizeClass.nReclaimed;
+            while (!sizeClass.freeSlots.push(slot)) {}
+        }
+    }
+}
+
+/* No lock necessary */
+int iMemPool::sizeClassFor(size_t size) const
+{
+    for (int idx = 0; idx < m_nClasses; ++idx) {
+        if (m_classes[idx].size >= size)
+            return idx;
+    }
+
+    return -1;
+}
+
+/* No lock necessary. Takes fresh segment blocks for a class, the first slot is returned */
+iMemPool::Slot* iMemPool::carveSlot(int sizeClass)
+{
+    if ((m_memory->size() <= 0) || (IX_NULLPTR == m_memory->data()))
+        return IX_NULLPTR;
+
+    SizeClass& cls = m_classes[sizeClass];
+    const xuint32 span = (cls.size > m_blockSize) ? (xuint32) (cls.size / m_blockSize) : 1;
+    const int nSlots = (cls.size > m_blockSize) ? 1 : (int) (m_blockSize / cls.size);
+
+    /* Every slot of the class has to fit in its free list */
+    int carved = cls.nSlots.value();
+    do {
+        if (carved + nSlots > (int) iFreeListDefaultConstants::MaxIndex)
+            return IX_NULLPTR;
+    } while (!cls.nSlots.testAndSet(carved, carved + nSlots, carved));
+
+    int idx = m_nInit.value();
+    do {
+        if ((xuint32) idx + span > m_nBlocks) {
+            cls.nSlots -= nSlots;
+            return IX_NULLPTR;
+        }
+    } while (!m_nInit.testAndSet(idx, idx + (int) span, idx));
+
+    for (xuint32 k = 0; k < span; ++k) {
+        m_blockInfo[idx + k].head = (xuint32) idx;
+        m_blockInfo[idx + k].sizeClass = (xuint8) sizeClass;
+    }
+
+    /* Pushed backwards so that allocations walk the block in address order */
+    xuint8* base = (xuint8*) m_memory->data() + (m_blockSize * (size_t) idx);
+    for (int k = nSlots - 1; k > 0; --k) {
+        while (!cls.freeSlots.push((Slot*) (base + cls.size * (size_t) k))) {}
+    }
+
+    return (Slot*) base;
+}
+
+/* No lock necessary. Resident slots first, reclaimed ones fault their pages back in */
+iMemPool::Slot* iMemPool::popFreeSlot(int sizeClass)
+{
+    SizeClass& cls = m_classes[sizeClass];
+    Slot* slot = cls.freeSlots.pop(IX_NULLPTR);
     if (IX_NULLPTR != slot)
         return slot;
 
-    if ((m_memory->size() <= 0) || (IX_NULLPTR == m_memory->data()))
+    slot = cls.reclaimedSlots.pop(IX_NULLPTR);
+    if (IX_NULLPTR != slot)
+        --cls.nReclaimed;
+
+    return slot;
+}
+
+/* No lock necessary */
+iMemPool::Slot* iMemPool::allocateSlot(size_t size)
+{
+    const int sizeClass = sizeClassFor(size);
+    if (sizeClass < 0)
+        return IX_NULLPTR;
+
+    Magazine* mag = (sizeClass < m_nMagazineClasses) ? magazine() : IX_NULLPTR;
+    if (IX_NULLPTR != mag) {
+        Slot** slots = mag->slots + sizeClass * MagazineSize;
+        int& count = mag->count[sizeClass];
+        if (count > 0) {
+            ++mag->nHits;
+            return slots[--count];
+        }
+
+        /* Refill a batch, the first slot popped ends up on top */
+        ++mag->nMisses;
+        Slot* batch[MagazineBatch];
+        int n = 0;
+        while ((n < MagazineBatch) && (IX_NULLPTR != (batch[n] = popFreeSlot(sizeClass))))
+            ++n;
+        for (int k = 0; k < n; ++k)
+            slots[k] = batch[n - 1 - k];
+        count = n;
+        foldMagazineStat(mag);
+
+        if (count > 0)
+            return slots[--count];
+    }
+
+    Slot* slot = popFreeSlot(sizeClass);
+    if (IX_NULLPTR != slot)
         return slot;
 
-    int idx = m_nInit++;
+    slot = carveSlot(sizeClass);
+    if (IX_NULLPTR != slot)
+        return slot;
 
-    /* The free list was empty, we have to allocate a new entry */
-    if ((unsigned) idx >= m_nBlocks) {
-        m_nInit--;
-    } else {
-        slot = (Slot*) ((xuint8*) m_memory->data() + (m_blockSize * (size_t) idx));
+    /* Segment used up: bounded waste, borrow from a slightly larger class */
+    for (int idx = sizeClass + 1; (idx < m_nClasses) && (idx <= sizeClass + SizeClassFallback); ++idx) {
+        if ((IX_NULLPTR != mag) && (idx < mag->nClasses) && (mag->count[idx] > 0))
+            slot = mag->slots[idx * MagazineSize + (--mag->count[idx])];
+        else
+            slot = popFreeSlot(idx);
+        if (IX_NULLPTR != slot) {
+            m_stat.nClassFallback++;
+            return slot;
+        }
     }
 
-    if (IX_NULLPTR == slot && (m_nBlocks > 0)) {
-        iLogger::asprintf(ILOG_TAG, iShell::ILOG_INFO, __FILE__, __FUNCTION__, __LINE__, "%s pool full", m_name);
+    if (m_nBlocks > 0) {
+        iLogger::asprintf(ILOG_TAG, iShell::ILOG_INFO, __FILE__, __FUNCTION__, __LINE__, "%s pool full for size %zu", m_name, size);
         m_stat.nPoolFull++;
-        return slot;
     }
 
-    return slot;
+    return IX_NULLPTR;
+}
+
+/* No lock necessary */
+void iMemPool::freeSlot(Slot* slot)
+{
+    const uint idx = slotIdx(slot);
+    IX_ASSERT(idx < m_nBlocks);
+    const int sizeClass = m_blockInfo[idx].sizeClass;
+    SizeClass& cls = m_classes[sizeClass];
+
+    Magazine* mag = (sizeClass < m_nMagazineClasses) ? magazine() : IX_NULLPTR;
+    if (IX_NULLPTR != mag) {
+        Slot** slots = mag->slots + sizeClass * MagazineSize;
+        int& count = mag->count[sizeClass];
+        if (count >= MagazineSize) {
+            /* Hand the coldest batch back, keep the recently freed ones */
+            for (int k = 0; k < MagazineBatch; ++k)
+                while (!cls.freeSlots.push(slots[k])) {}
+            memmove(slots, slots + MagazineBatch, (MagazineSize - MagazineBatch) * sizeof(Slot*));
+            count -= MagazineBatch;
+        }
+
+        slots[count++] = slot;
+        return;
+    }
+
+    while (!cls.freeSlots.push(slot)) {}
 }
 
 /* No lock necessary, totally redundant anyway */
@@ -891,7 +1444,125 @@ iMemPool::Slot* iMemPool::slotByPtr(const void* ptr) const
     if (idx == (uint) -1)
         return IX_NULLPTR;
 
-    return (Slot*) ((xuint8*) m_memory->data() + (idx * m_blockSize));
+    const BlockInfo& info = m_blockInfo[idx];
+    const size_t size = m_classes[info.sizeClass].size;
+    xuint8* block = (xuint8*) m_memory->data() + ((size_t) info.head * m_blockSize);
+    if (size >= m_blockSize)
+        return (Slot*) block;
+
+    return (Slot*) (block + (((size_t) ((const xuint8*) ptr - block)) / size) * size);
+}
+
+/* Thread exit: every slot goes back to its pool */
+iMemPool::ThreadCache::~ThreadCache()
+{
+    #ifdef IX_HAVE_CXX11
+    s_threadCacheState = 2;
+    #endif
+
+    iScopedLock<iMutex> _lock(magazineLock());
+    for (int idx = 0; idx < MagazinePools; ++idx) {
+        Magazine* mag = entries[idx].mag;
+        if (IX_NULLPTR == mag)
+            continue;
+
+        entries[idx].pool = IX_NULLPTR;
+        entries[idx].mag = IX_NULLPTR;
+        mag->pool->drainMagazine(mag);
+    }
+}
+
+iMemPool::ThreadCache* iMemPool::threadCache()
+{
+    #ifdef IX_HAVE_CXX11
+    if (2 == s_threadCacheState)
+        return IX_NULLPTR;
+
+    static thread_local ThreadCache s_cache;
+    s_threadCacheState = 1;
+    return &s_cache;
+    #else
+    return IX_NULLPTR;
+    #endif
+}
+
+/* No lock necessary, the caller holds a reference so the pool cannot go away */
+iMemPool::Magazine* iMemPool::magazine()
+{
+    ThreadCache* cache = threadCache();
+    if (IX_NULLPTR == cache)
+        return IX_NULLPTR;
+
+    for (int idx = 0; idx < MagazinePools; ++idx) {
+        if (cache->entries[idx].pool.load() == this)
+            return cache->entries[idx].mag;
+    }
+
+    return attachMagazine(cache);
+}
+
+iMemPool::Magazine* iMemPool::attachMagazine(ThreadCache* cache)
+{
+    iScopedLock<iMutex> _lock(magazineLock());
+    if (m_nMagazineClasses <= 0)
+        return IX_NULLPTR;
+
+    int idx = 0;
+    while ((idx < MagazinePools) && (IX_NULLPTR != cache->entries[idx].mag))
+        ++idx;
+
+    if (idx >= MagazinePools) {
+        /* Every entry is taken, round-robin eviction */
+        idx = cache->nextEvict;
+        cache->nextEvict = (cache->nextEvict + 1) % MagazinePools;
+
+        Magazine* old = cache->entries[idx].mag;
+        cache->entries[idx].pool = IX_NULLPTR;
+        cache->entries[idx].mag = IX_NULLPTR;
+        old->pool->drainMagazine(old);
+    }
+
+    Magazine* mag = new Magazine;
+    mag->pool = this;
+    mag->owner = cache;
+    mag->ownerIdx = idx;
+    mag->nClasses = m_nMagazineClasses;
+    mag->nHits = 0;
+    mag->nMisses = 0;
+    memset(mag->count, 0, sizeof(mag->count));
+    mag->slots = new Slot*[m_nMagazineClasses * MagazineSize];
+    mag->_next = IX_NULLPTR;
+    mag->_prev = IX_NULLPTR;
+    IX_LLIST_PREPEND(Magazine, m_magazines, mag);
+
+    cache->entries[idx].mag = mag;
+    cache->entries[idx].pool = this;
+    return mag;
+}
+
+/* magazineLock() held. Returns every slot to the free lists and deletes the magazine */
+void iMemPool::drainMagazine(Magazine* mag)
+{
+    IX_ASSERT(mag->pool == this);
+    for (int sizeClass = 0; sizeClass < mag->nClasses; ++sizeClass) {
+        Slot** slots = mag->slots + sizeClass * MagazineSize;
+        for (int k = mag->count[sizeClass] - 1; k >= 0; --k)
+            while (!m_classes[sizeClass].freeSlots.push(slots[k])) {}
+    }
+
+    foldMagazineStat(mag);
+    IX_LLIST_REMOVE(Magazine, m_magazines, mag);
+    delete[] mag->slots;
+    delete mag;
+}
+
+/* Hits are counted locally and published on refills, keeping the fast path off shared cache lines */
+void iMemPool::foldMagazineStat(Magazine* mag)
+{
+    mag->pool->m_stat.nMagazineHits += mag->nHits;
+    mag->pool->m_stat.nMagazineMisses += mag->nMisses;
+    mag->nHits = 0;
+    mag->nMisses = 0;
 }
 
 /* No lock necessary */
@@ -1107,63 +1778,67 @@ int iMemImport::processRevoke(uint blockId)
 
 /* For sending blocks to other nodes */
 iMemExport::iMemExport(iMemPool* pool, iMemExportRevokeCb cb, void* userdata)
-    : m_baseIdx(0)
+    : m_slots(IX_MEMEXPORT_SLOTS_MAX)
     , m_nInit(0)
-    , m_freeSlots(IX_NULLPTR)
-    , m_usedSlots(IX_NULLPTR)
-    , m_mutex(iMutex::Recursive)
+    , m_inUse(0)
+    , m_peakInUse(0)
     , m_pool(pool)
     , m_revokeCb(cb)
     , m_userdata(userdata)
     , _next(IX_NULLPTR)
     , _prev(IX_NULLPTR)
 {
+    IX_COMPILER_VERIFY(IX_MEMEXPORT_SLOTS_MAX <= SlotIndexMask);
     IX_ASSERT(m_pool && cb && m_pool->isShared());
-    static iAtomicCounter<uint> export_baseidx(0);
-
-    for (int idx = 0; idx < IMEMEXPORT_SLOTS_MAX; ++idx) {
-        m_slots[idx]._next = IX_NULLPTR;
-        m_slots[idx]._prev = IX_NULLPTR;
-        m_slots[idx].block = IX_NULLPTR;
-    }
 
     iScopedLock<iMutex> _poolLock(m_pool->m_mutex);
     IX_LLIST_PREPEND(iMemExport, m_pool->m_exports, this);
-    m_baseIdx = export_baseidx++;
 }
 
 iMemExport::~iMemExport()
 {
-    iScopedLock<iMutex> _lock(m_mutex);
-    while (m_usedSlots)
-        processRelease((uint) (m_usedSlots - m_slots + m_baseIdx));
-    _lock.unlock();
+    const int nInit = m_nInit.value();
+    for (int idx = 0; idx < nInit; ++idx) {
+        Slot& slot = m_slots[idx];
+        if (slot.block.load())
+            processRelease((slot.generation.value() << SlotIndexBits) | (uint) idx);
+    }
 
     iScopedLock<iMutex> _poolLock(m_pool->m_mutex);
     IX_LLIST_REMOVE(iMemExport, m_pool->m_exports, this);
 }
 
-/* Self-locked */
-int iMemExport::processRelease(uint id)
+int iMemExport::capacity()
 {
-    iScopedLock<iMutex> _lock(m_mutex);
-    if (id < m_baseIdx)
-        return -1;
+    return IX_MEMEXPORT_SLOTS_MAX;
+}
 
-    id -= m_baseIdx;
-    if (id >= m_nInit)
+/* Lock-free, the generation swap decides which caller owns the release */
+int iMemExport::processRelease(uint id)
+{
+    const int idx = (int) (id & SlotIndexMask);
+    const uint generation = id >> SlotIndexBits;
+    if (idx >= m_nInit.value())
         return -1;
 
-    if (!m_slots[id].block)
-        return -1;
+    Slot& slot = m_slots[idx];
+    uint nextGeneration = (generation + 1) & (~0u >> SlotIndexBits);
+    if (0 == nextGeneration)
+        nextGeneration = 1;
 
-    iMemBlock* b = m_slots[id].block;
-    m_slots[id].block = IX_NULLPTR;
+    uint current = generation;
+    while (!slot.generation.testAndSet(generation, nextGeneration, current)) {
+        if (current != generation)
+            return -1;
+    }
 
-    IX_LLIST_REMOVE(Slot, m_usedSlots, &m_slots[id]);
-    IX_LLIST_PREPEND(Slot, m_freeSlots, &m_slots[id]);
+    iMemBlock* b = slot.block.load();
+    if (!b)
+        return -1;
 
-    _lock.unlock();
+    slot.block.store(IX_NULLPTR);
+    m_slots.release(idx);
+    --m_inUse;
 
     --m_pool->m_stat.nExported;
     m_pool->m_stat.exportedSize -= (int) b->m_length;
@@ -1172,22 +1847,21 @@ int iMemExport::processRelease(uint id)
     return 0;
 }
 
-/* Self-locked */
+/* Called with the pool lock held */
 void iMemExport::revokeBlocks(iMemImport* imp)
 {
     IX_ASSERT(imp);
-    iScopedLock<iMutex> _lock(m_mutex);
-    Slot* next = IX_NULLPTR;
-    for (Slot* slot = m_usedSlots; slot; slot = next) {
-        next = slot->_next;
-
-        if (slot->block->m_type != iMemBlock::MEMBLOCK_IMPORTED ||
-            slot->block->m_imported.segment->import != imp)
+    const int nInit = m_nInit.value();
+    for (int idx = 0; idx < nInit; ++idx) {
+        Slot& slot = m_slots[idx];
+        iMemBlock* block = slot.block.load();
+        if (!block || block->m_type != iMemBlock::MEMBLOCK_IMPORTED ||
+            block->m_imported.segment->import != imp)
             continue;
 
-        uint idx = (uint) (slot - m_slots + m_baseIdx);
-        m_revokeCb(this, idx, m_userdata);
-        processRelease(idx);
+        uint id = (slot.generation.value() << SlotIndexBits) | (uint) idx;
+        m_revokeCb(this, id, m_userdata);
+        processRelease(id);
     }
 }
 
@@ -1213,7 +1887,7 @@ iMemBlock* iMemExport::sharedCopy(iMemPool* pool, iMemBlock* block) const
     return next;
 }
 
-/* Self-locked */
+/* Lock-free */
 int iMemExport::put(iMemBlock* block, MemType* type, uint* blockId, uint* shmId, int* memfd_fd, size_t* offset, size_t* size)
 {
     IX_ASSERT(block && type && blockId && shmId && offset && size);
@@ -1222,24 +1896,24 @@ int iMemExport::put(iMemBlock* block, MemType* type, uint* blockId, uint* shmId,
     if (IX_NULLPTR == block)
         return -1;
 
-    iScopedLock<iMutex> _lock(m_mutex);
-    Slot* slot = IX_NULLPTR;
-    if (m_freeSlots) {
-        slot = m_freeSlots;
-        IX_LLIST_REMOVE(Slot, m_freeSlots, slot);
-    } else if (m_nInit < IX_MEMEXPORT_SLOTS_MAX) {
-        slot = &m_slots[m_nInit++];
-    } else {
-        _lock.unlock();
+    const int idx = m_slots.next();
+    if (idx < 0) {
+        ilog_info("export table full with ", m_inUse.value(), " blocks in flight");
         block->deref();
         return -1;
     }
 
-    IX_LLIST_PREPEND(Slot, m_usedSlots, slot);
-    slot->block = block;
-    *blockId = (uint) (slot - m_slots + m_baseIdx);
+    Slot& slot = m_slots[idx];
+    slot.block.store(block);
+    *blockId = (slot.generation.value() << SlotIndexBits) | (uint) idx;
+
+    int nInit = m_nInit.value();
+    while (idx >= nInit && !m_nInit.testAndSet(nInit, idx + 1, nInit)) {}
+
+    const int inUse = ++m_inUse;
+    int peak = m_peakInUse.value();
+    while (inUse > peak && !m_peakInUse.testAndSet(peak, inUse, peak)) {}
 
-    _lock.unlock();
     ilog_verbose("Got block id ", *blockId);
 
     iShareMem* memory = IX_NULLPTR;
@@ -16,6 +16,11 @@
 
 #define ILOG_TAG "ix_utils"
 
+/* Dropped list items kept per queue */
+#define IX_MBQ_FREE_ITEMS_MAX 32
+/* Chunks the producer can stage ahead of the consumer, a power of two */
+#define IX_MBQ_STAGING_SIZE 256
+
 namespace iShell {
 
 struct iMBQListItem {
@@ -25,6 +30,19 @@ struct iMBQListItem {
     iByteArray chunk;
 };
 
+/* Single-producer/single-consumer ring. head is only written by the consumer,
+ * tail only by the producer. stagedBytes and length let the producer apply
+ * maxlength without touching the consumer's indexes. */
+struct iMBQStaging {
+    iByteArray chunks[IX_MBQ_STAGING_SIZE];
+    iAtomicCounter<xuint32> head;
+    iAtomicCounter<xuint32> tail;
+    iAtomicCounter<xint64> stagedBytes;
+    iAtomicCounter<xint64> length;      ///< published by the consumer
+
+    iMBQStaging() : head(0), tail(0), stagedBytes(0), length(0) {}
+};
+
 iMemBlockQueue::iMemBlockQueue(const iLatin1StringView& name, xint64 idx, size_t maxlength, size_t tlength, size_t base,
     size_t prebuf, size_t minreq, size_t maxrewind, iByteArray *silence)
     : m_blocks(IX_NULLPTR)
@@ -32,6 +50,8 @@ iMemBlockQueue::iMemBlockQueue(const iLatin1StringView& name, xint64 idx, size_t
     , m_currentRead(IX_NULLPTR)
     , m_currentWrite(IX_NULLPTR)
     , m_nBlocks(0)
+    , m_nFreeItems(0)
+    , m_freeItems(IX_NULLPTR)
     , m_maxLength(maxlength)
     , m_tLength(tlength)
     , m_base(base)
@@ -44,6 +64,7 @@ iMemBlockQueue::iMemBlockQueue(const iLatin1StringView& name, xint64 idx, size_t
     , m_mcalign(IX_NULLPTR)
     , m_missing(0)
     , m_requested(0)
+    , m_staging(IX_NULLPTR)
     , m_name(name)
 {
     ilog_verbose("[", m_name, "] requested: maxlength=", maxlength,
@@ -71,9 +92,27 @@ iMemBlockQueue::~iMemBlockQueue()
 {
     makeSilence();
 
+    while (m_freeItems) {
+        iMBQListItem* q = m_freeItems;
+        m_freeItems = q->_next;
+        delete q;
+    }
+
+    delete m_staging;
     delete m_mcalign;
 }
 
+iMBQListItem* iMemBlockQueue::newItem()
+{
+    iMBQListItem* q = m_freeItems;
+    if (IX_NULLPTR == q)
+        return new iMBQListItem();
+
+    m_freeItems = q->_next;
+    m_nFreeItems--;
+    return q;
+}
+
 void iMemBlockQueue::fixCurrentRead()
 {
     if (!m_blocks) {
@@ -155,7 +194,14 @@ void iMemBlockQueue::dropBlock(iMBQListItem *q)
         m_currentRead = q->_next;
 
     q->chunk.clear();
-    delete q;
+    if (m_nFreeItems < IX_MBQ_FREE_ITEMS_MAX) {
+        q->_prev = IX_NULLPTR;
+        q->_next = m_freeItems;
+        m_freeItems = q;
+        m_nFreeItems++;
+    } else {
+        delete q;
+    }
 
     m_nBlocks--;
 }
@@ -211,13 +257,81 @@ xint64 iMemBlockQueue::readIndexChanged(xint64 oldReadIndex)
     return delta;
 }
 
+bool iMemBlockQueue::canStage(size_t l) const
+{
+    return m_staging->length.value() + m_staging->stagedBytes.value() + (xint64) l <= (xint64) m_maxLength;
+}
+
 xint64 iMemBlockQueue::push(const iByteArray& uchunk)
 {
+    if (IX_NULLPTR == m_staging)
+        return pushChunk(uchunk);
+
     IX_ASSERT(uchunk.length() > 0);
     IX_ASSERT(uchunk.length() % m_base == 0);
+
+    const xuint32 tail = m_staging->tail.value();
+    if ((tail - m_staging->head.value() >= IX_MBQ_STAGING_SIZE) || !canStage(uchunk.length()))
+        return -1;
+
+    /* Published by the tail store, the consumer clears the slot before moving head past it */
+    m_staging->chunks[tail & (IX_MBQ_STAGING_SIZE - 1)] = uchunk;
+    m_staging->stagedBytes += (xint64) uchunk.length();
+    m_staging->tail = tail + 1;
+    return (xint64) uchunk.length();
+}
+
+void iMemBlockQueue::setSingleProducerSingleConsumer(bool enabled)
+{
+    if (enabled == (IX_NULLPTR != m_staging))
+        return;
+
+    if (enabled) {
+        m_staging = new iMBQStaging;
+        publishLength();
+        return;
+    }
+
+    collectStaged();
+    delete m_staging;
+    m_staging = IX_NULLPTR;
+}
+
+void iMemBlockQueue::collectStaged()
+{
+    if (IX_NULLPTR == m_staging)
+        return;
+
+    xuint32 head = m_staging->head.value();
+    const xuint32 tail = m_staging->tail.value();
+    for (; head != tail; ++head) {
+        iByteArray& slot = m_staging->chunks[head & (IX_MBQ_STAGING_SIZE - 1)];
+        iByteArray chunk = slot;
+        slot.clear();
+
+        /* push() already accepted the chunk against maxlength, it goes in even if a
+         * seek or a smaller maxlength left no room since. The new length is published
+         * before the chunk leaves stagedBytes, so that the producer never sees less
+         * than the queue really holds. */
+        pushChunk(chunk, false);
+        publishLength();
+        m_staging->stagedBytes -= (xint64) chunk.length();
+        m_staging->head = head + 1;
+    }
+}
+
+void iMemBlockQueue::publishLength()
+{
+    if (m_staging)
+        m_staging->length = (xint64) length();
+}
+
+xint64 iMemBlockQueue::pushChunk(const iByteArray& uchunk, bool checkLength)
+{
+    IX_ASSERT(uchunk.length() > 0);
     IX_ASSERT(uchunk.length() % m_base == 0);
 
-    if (!canPush(uchunk.length()))
+    if (checkLength && !canPush(uchunk.length()))
         return -1;
 
     xint64 old = m_writeIndex;
@@ -264,7 +378,7 @@ xint64 iMemBlockQueue::push(const iByteArray& uchunk)
             if (m_writeIndex + (xint64) chunk.length() < q->index + (xint64) q->chunk.length()) {
 
                 /* We need to save the end of this memchunk */
-                iMBQListItem *p = new iMBQListItem();
+                iMBQListItem *p = newItem();
                 p->chunk = q->chunk;
 
                 /* Calculate offset */
@@ -332,7 +446,7 @@ xint64 iMemBlockQueue::push(const iByteArray& uchunk)
         IX_ASSERT(!m_blocks || (m_writeIndex + (xint64)chunk.length() <= m_blocks->index));
     }
 
-    iMBQListItem* n = new iMBQListItem();
+    iMBQListItem* n = newItem();
     n->chunk = chunk;
     n->index = m_writeIndex;
     m_writeIndex += (xint64) n->chunk.length();
@@ -384,6 +498,8 @@ bool iMemBlockQueue::updatePreBuf()
 /// memchunk should deref after return
 int iMemBlockQueue::peek(iByteArray& chunk)
 {
+    collectStaged();
+
     /* We need to pre-buffer */
     if (updatePreBuf())
         return -1;
@@ -489,7 +605,9 @@ int iMemBlockQueue::peekFixedSize(size_t block_size, iByteArray& chunk)
 
 int iMemBlockQueue::peekIterator(IteratorFunc func, void* userdata)
 {
-        /* We need to pre-buffer */
+    collectStaged();
+
+    /* We need to pre-buffer */
     if (updatePreBuf())
         return -1;
 
@@ -522,6 +640,7 @@ int iMemBlockQueue::peekIterator(IteratorFunc func, void* userdata)
 xint64 iMemBlockQueue::drop(size_t length)
 {
     IX_ASSERT(length % m_base == 0);
+    collectStaged();
 
     xint64 old = m_readIndex;
     while (length > 0) {
@@ -557,6 +676,7 @@ xint64 iMemBlockQueue::drop(size_t length)
     }
 
     dropBacklog();
+    publishLength();
     return readIndexChanged(old);
 }
 
@@ -568,6 +688,7 @@ xint64 iMemBlockQueue::rewind(size_t length)
     xint64 old = m_readIndex;
     m_readIndex -= (xint64) length;
 
+    publishLength();
     return readIndexChanged(old);
 }
 
@@ -602,6 +723,7 @@ void iMemBlockQueue::seek(xint64 offset, SeekMode seek, bool account) {
     }
 
     dropBacklog();
+    publishLength();
     writeIndexChanged(old, account);
 }
 
@@ -613,6 +735,7 @@ void iMemBlockQueue::flushWrite(bool account)
     m_writeIndex = m_readIndex;
 
     preBufForce();
+    publishLength();
     writeIndexChanged(old, account);
 }
 
@@ -624,6 +747,7 @@ void iMemBlockQueue::flushRead()
     m_readIndex = m_writeIndex;
 
     preBufForce();
+    publishLength();
     readIndexChanged(old);
 }
 
@@ -632,7 +756,8 @@ int iMemBlockQueue::pushAlign(const iByteArray& chunk)
     if (m_base == 1)
         return push(chunk);
 
-    if (!canPush(m_mcalign->csize(chunk.length())))
+    const size_t csize = m_mcalign->csize(chunk.length());
+    if (m_staging ? !canStage(csize) : !canPush(csize))
         return -1;
 
     /* Note: m_mcalign->push() uses zero-copy optimization.
@@ -656,6 +781,7 @@ int iMemBlockQueue::pushAlign(const iByteArray& chunk)
 
 size_t iMemBlockQueue::popMissing()
 {
+    collectStaged();
     ilog_verbose("memblockq[", m_name, "] pop: ", m_missing);
 
     if (m_missing <= 0)
@@ -0,0 +1,237 @@
+/////////////////////////////////////////////////////////////////
+/// Copyright 2018-2020
+/// All rights reserved.
+/////////////////////////////////////////////////////////////////
+/// @file    imemreclaimer.cpp
+/// @brief   background trimming of iMemPool segments
+/// @version 1.0
+/// @author  ncjiakechong@gmail.com
+/////////////////////////////////////////////////////////////////
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "core/io/imemreclaimer.h"
+#include "core/kernel/ideadlinetimer.h"
+#include "core/io/ilog.h"
+
+#define IX_RECLAIM_IDLE_MS      5000
+#define IX_RECLAIM_BATCH        (4 * 1024 * 1024)
+
+#define ILOG_TAG "ix_utils"
+
+namespace iShell {
+
+static inline xint64 reclaimerNow()
+{
+    return iDeadlineTimer::current(PreciseTimer).deadlineNSecs();
+}
+
+iMemReclaimer::iMemReclaimer(int priority)
+    : iEventSource(iLatin1StringView("iMemReclaimer"), priority)
+    , m_idleInterval(IX_RECLAIM_IDLE_MS)
+    , m_batchSize(IX_RECLAIM_BATCH)
+    , m_nextTick(0)
+    , m_trimming(false)
+    , m_pressureEvents(0)
+    , m_reclaimedSize(0)
+{
+    m_pressureFd.fd = -1;
+    m_pressureFd.events = 0;
+    m_pressureFd.revents = 0;
+}
+
+iMemReclaimer::~iMemReclaimer()
+{
+    unwatchPressure();
+}
+
+void iMemReclaimer::addPool(iMemPool* pool, size_t residentTarget)
+{
+    if (IX_NULLPTR == pool)
+        return;
+
+    for (std::list<Entry>::iterator it = m_entries.begin(); it != m_entries.end(); ++it) {
+        if (it->pool.data() != pool)
+            continue;
+
+        it->target = residentTarget;
+        return;
+    }
+
+    Entry entry;
+    entry.pool = pool;
+    entry.target = residentTarget;
+    entry.lastAccumulated = pool->getStat().nAccumulated;
+    entry.lastActive = reclaimerNow();
+    entry.trimming = false;
+    m_entries.push_back(entry);
+}
+
+void iMemReclaimer::removePool(iMemPool* pool)
+{
+    for (std::list<Entry>::iterator it = m_entries.begin(); it != m_entries.end(); ++it) {
+        if (it->pool.data() != pool)
+            continue;
+
+        m_entries.erase(it);
+        return;
+    }
+}
+
+void iMemReclaimer::setIdleInterval(xint64 msecs)
+{
+    m_idleInterval = std::max(msecs, xint64(1));
+    m_nextTick = 0;
+}
+
+void iMemReclaimer::setBatchSize(size_t bytes)
+{
+    m_batchSize = std::max(bytes, (size_t) 1);
+}
+
+bool iMemReclaimer::watchPressure(const char* path, int stallUs, int windowUs)
+{
+    unwatchPressure();
+
+    int fd = ::open(path, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) {
+        ilog_info("open ", path, " failed: ", errno);
+        return false;
+    }
+
+    /* The trigger lives as long as the descriptor, POLLPRI fires on each threshold breach */
+    char trigger[64];
+    const int len = snprintf(trigger, sizeof(trigger), "some %d %d", stallUs, windowUs);
+    if (::write(fd, trigger, (size_t) len + 1) < 0) {
+        ilog_info("PSI trigger '", trigger, "' on ", path, " refused: ", errno);
+        ::close(fd);
+        return false;
+    }
+
+    m_pressureFd.fd = fd;
+    m_pressureFd.events = IX_IO_PRI;
+    m_pressureFd.revents = 0;
+    addPoll(&m_pressureFd);
+    return true;
+}
+
+void iMemReclaimer::unwatchPressure()
+{
+    if (m_pressureFd.fd < 0)
+        return;
+
+    removePoll(&m_pressureFd);
+    ::close(m_pressureFd.fd);
+    m_pressureFd.fd = -1;
+    m_pressureFd.events = 0;
+    m_pressureFd.revents = 0;
+}
+
+bool iMemReclaimer::prepare(xint64* timeout)
+{
+    if (m_entries.empty()) {
+        *timeout = -1;
+        return false;
+    }
+
+    const xint64 now = reclaimerNow();
+    if (m_trimming || (now >= m_nextTick)) {
+        *timeout = 0;
+        return true;
+    }
+
+    *timeout = m_nextTick - now;
+    return false;
+}
+
+bool iMemReclaimer::check()
+{
+    if (m_pressureFd.revents & (IX_IO_PRI | IX_IO_ERR))
+        return true;
+
+    return !m_entries.empty() && (m_trimming || (reclaimerNow() >= m_nextTick));
+}
+
+bool iMemReclaimer::dispatch()
+{
+    const int revents = m_pressureFd.revents;
+    m_pressureFd.revents = 0;
+
+    if (revents & IX_IO_ERR) {
+        /* The cgroup went away or the kernel dropped the trigger */
+        ilog_warn("memory pressure trigger failed, no longer watching");
+        unwatchPressure();
+    } else if (revents & IX_IO_PRI) {
+        ++m_pressureEvents;
+        relievePressure();
+    }
+
+    const xint64 now = reclaimerNow();
+    if (m_trimming || (now >= m_nextTick))
+        tick(now);
+
+    return true;
+}
+
+/* Back-to-back dispatches only happen while trimming, and each one reclaims something */
+bool iMemReclaimer::detectHang(xuint32)
+{
+    return false;
+}
+
+/* One step of the idle policy, at most m_batchSize bytes per pool */
+void iMemReclaimer::tick(xint64 now)
+{
+    const xint64 idleNs = m_idleInterval * 1000 * 1000;
+    m_trimming = false;
+    m_nextTick = now + idleNs / 2;
+
+    std::list<Entry>::iterator it = m_entries.begin();
+    while (it != m_entries.end()) {
+        /* Nobody else uses the pool any more */
+        if (1 == it->pool->count()) {
+            it = m_entries.erase(it);
+            continue;
+        }
+
+        Entry& entry = *it++;
+        const int accumulated = entry.pool->getStat().nAccumulated;
+        if (accumulated != entry.lastAccumulated) {
+            entry.lastAccumulated = accumulated;
+            entry.lastActive = now;
+            entry.trimming = false;
+            continue;
+        }
+
+        if (now - entry.lastActive < idleNs)
+            continue;
+
+        /* Hysteresis: start above target + 1/4, then go all the way down to target */
+        const size_t resident = entry.pool->residentSize();
+        if (!entry.trimming && (resident <= entry.target + entry.target / 4))
+            continue;
+
+        const size_t reclaimed = entry.pool->trim(entry.target, m_batchSize);
+        m_reclaimedSize += (xint64) reclaimed;
+        entry.trimming = (reclaimed > 0) && (entry.pool->residentSize() > entry.target);
+        m_trimming = m_trimming || entry.trimming;
+    }
+}
+
+void iMemReclaimer::relievePressure()
+{
+    xint64 reclaimed = 0;
+    for (std::list<Entry>::iterator it = m_entries.begin(); it != m_entries.end(); ++it) {
+        reclaimed += (xint64) it->pool->trim(it->target, (size_t) -1);
+        it->trimming = false;
+    }
+
+    m_reclaimedSize += reclaimed;
+    ilog_info("memory pressure, reclaimed ", reclaimed, " bytes from ", m_entries.size(), " pools");
+}
+
+} // namespace iShell
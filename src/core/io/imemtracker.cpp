@@ -0,0 +1,406 @@
+/////////////////////////////////////////////////////////////////
+/// Copyright 2018-2020
+/// All rights reserved.
+/////////////////////////////////////////////////////////////////
+/// @file    imemtracker.cpp
+/// @brief   opt-in allocation tracking of iMemBlock
+/// @version 1.0
+/// @author  ncjiakechong@gmail.com
+/////////////////////////////////////////////////////////////////
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <map>
+#include <vector>
+#if __cplusplus >= 201103L
+#include <unordered_map>
+#endif
+
+#if defined(__GLIBC__)
+#include <execinfo.h>
+#include <dlfcn.h>
+#include <cxxabi.h>
+#define IX_HAVE_BACKTRACE 1
+#endif
+
+#include "core/io/imemtracker.h"
+#include "core/io/imemblock.h"
+#include "core/kernel/ideadlinetimer.h"
+#include "core/thread/imutex.h"
+#include "core/thread/iscopedlock.h"
+
+/* Frames kept per sampled allocation, after dropping the tracker's own */
+#define IX_TRACKER_FRAMES   24
+#define IX_TRACKER_SKIP     3
+
+namespace iShell {
+
+iAtomicCounter<int> iMemTracker::s_active(0);
+iAtomicCounter<int> iMemTracker::s_liveBlocks(0);
+
+namespace {
+
+/* An allocation site: everything a folded stack line is made of */
+struct SiteKey {
+    std::string pool;
+    int type;
+    std::vector<const char*> tags;  ///< outermost first
+    std::vector<void*> frames;      ///< innermost first, as backtrace() returns them
+
+    bool operator<(const SiteKey& other) const {
+        if (type != other.type) return type < other.type;
+        if (pool != other.pool) return pool < other.pool;
+        if (tags != other.tags) return tags < other.tags;
+        return frames < other.frames;
+    }
+};
+
+typedef std::map<SiteKey, iMemTracker::Usage> SiteMap;
+typedef std::map<std::string, iMemTracker::Usage> PoolMap;
+typedef std::map<std::pair<std::string, int>, iMemTracker::Usage> PoolTypeMap;
+
+struct LiveBlock {
+    size_t size;
+    xint64 bornNs;
+    iMemTracker::Usage* site;
+    iMemTracker::Usage* pool;
+    iMemTracker::Usage* poolType;
+    int type;
+};
+
+#if __cplusplus >= 201103L
+typedef std::unordered_map<const iMemBlock*, LiveBlock> LiveMap;
+#else
+typedef std::map<const iMemBlock*, LiveBlock> LiveMap;
+#endif
+
+struct TrackerData {
+    iMutex lock;
+    int sampleEvery;
+    SiteMap sites;
+    PoolMap pools;
+    PoolTypeMap poolTypes;
+    iMemTracker::Usage types[iMemTracker::BlockTypes];
+    iMemTracker::Usage total;
+    LiveMap live;
+    std::string signalPath;
+
+    TrackerData() : sampleEvery(0) {}
+};
+
+TrackerData& trackerData()
+{
+    static TrackerData s_data;
+    return s_data;
+}
+
+volatile sig_atomic_t s_dumpRequested = 0;
+
+#ifdef IX_HAVE_CXX11
+thread_local const iMemTracker::Scope* s_scope = IX_NULLPTR;
+thread_local int s_sampleCountdown = 0;
+#endif
+
+void accountAlloc(iMemTracker::Usage& usage, size_t size)
+{
+    ++usage.liveCount;
+    usage.liveBytes += (xint64) size;
+    usage.peakBytes = std::max(usage.peakBytes, usage.liveBytes);
+    ++usage.totalCount;
+    usage.totalBytes += (xint64) size;
+}
+
+void accountFree(iMemTracker::Usage& usage, size_t size, xint64 lifetimeNs)
+{
+    --usage.liveCount;
+    usage.liveBytes -= (xint64) size;
+    ++usage.freedCount;
+    usage.lifetimeNs += lifetimeNs;
+}
+
+/* Accounts the release of a live block, the caller holds data.lock */
+void settle(TrackerData& data, LiveMap::iterator it, xint64 now)
+{
+    const LiveBlock& entry = it->second;
+    const xint64 lifetime = now - entry.bornNs;
+    accountFree(*entry.site, entry.size, lifetime);
+    accountFree(*entry.pool, entry.size, lifetime);
+    accountFree(*entry.poolType, entry.size, lifetime);
+    accountFree(data.types[entry.type], entry.size, lifetime);
+    accountFree(data.total, entry.size, lifetime);
+}
+
+/* Folded stack frames must not contain the separator */
+void appendFrame(std::string& line, const char* frame)
+{
+    line += ';';
+    for (; *frame; ++frame)
+        line += (';' == *frame) ? ':' : *frame;
+}
+
+void appendSymbol(std::string& line, void* addr)
+{
+    char buf[32];
+    #ifdef IX_HAVE_BACKTRACE
+    Dl_info info;
+    if (dladdr(addr, &info) && info.dli_sname) {
+        int status = 0;
+        char* demangled = abi::__cxa_demangle(info.dli_sname, IX_NULLPTR, IX_NULLPTR, &status);
+        appendFrame(line, (0 == status && demangled) ? demangled : info.dli_sname);
+        free(demangled);
+        return;
+    }
+    #endif
+
+    snprintf(buf, sizeof(buf), "%p", addr);
+    appendFrame(line, buf);
+}
+
+void dumpRequestHandler(int)
+{
+    s_dumpRequested = 1;
+}
+
+} // namespace
+
+iMemTracker::Scope::Scope(const char* tag)
+    : m_tag(tag)
+    , m_parent(IX_NULLPTR)
+{
+    #ifdef IX_HAVE_CXX11
+    m_parent = s_scope;
+    s_scope = this;
+    #endif
+}
+
+iMemTracker::Scope::~Scope()
+{
+    #ifdef IX_HAVE_CXX11
+    s_scope = m_parent;
+    #endif
+}
+
+bool iMemTracker::start(int sampleEvery)
+{
+    #ifdef IBUILD_MEM_TRACKING
+    TrackerData& data = trackerData();
+    iScopedLock<iMutex> _lock(data.lock);
+    data.sampleEvery = std::max(sampleEvery, 0);
+    s_active = 1;
+    return true;
+    #else
+    IX_UNUSED(sampleEvery);
+    return false;
+    #endif
+}
+
+void iMemTracker::stop()
+{
+    TrackerData& data = trackerData();
+    iScopedLock<iMutex> _lock(data.lock);
+    s_active = 0;
+}
+
+void iMemTracker::reset()
+{
+    TrackerData& data = trackerData();
+    iScopedLock<iMutex> _lock(data.lock);
+    data.live.clear();
+    s_liveBlocks = 0;
+    data.sites.clear();
+    data.pools.clear();
+    data.poolTypes.clear();
+    for (int idx = 0; idx < BlockTypes; ++idx)
+        data.types[idx] = Usage();
+    data.total = Usage();
+}
+
+const char* iMemTracker::typeName(BlockType type)
+{
+    switch (type) {
+    case PoolType: return "POOL";
+    case PoolExternalType: return "POOL_EXTERNAL";
+    case AppendedType: return "APPENDED";
+    case UserType: return "USER";
+    case FixedType: return "FIXED";
+    case ImportedType: return "IMPORTED";
+    default: break;
+    }
+
+    return "ANY";
+}
+
+iMemTracker::Usage iMemTracker::usage(const char* pool, BlockType type)
+{
+    TrackerData& data = trackerData();
+    iScopedLock<iMutex> _lock(data.lock);
+
+    if (IX_NULLPTR == pool)
+        return ((type > AnyType) && (type < BlockTypes)) ? data.types[type] : data.total;
+
+    if (type <= AnyType) {
+        PoolMap::const_iterator it = data.pools.find(pool);
+        return (it != data.pools.end()) ? it->second : Usage();
+    }
+
+    PoolTypeMap::const_iterator it = data.poolTypes.find(std::make_pair(std::string(pool), (int) type));
+    return (it != data.poolTypes.end()) ? it->second : Usage();
+}
+
+std::string iMemTracker::dumpFolded(bool live)
+{
+    TrackerData& data = trackerData();
+    iScopedLock<iMutex> _lock(data.lock);
+
+    /* Sites only differing in frames that do not resolve collapse into one line */
+    std::map<std::string, xint64> lines;
+    for (SiteMap::const_iterator it = data.sites.begin(); it != data.sites.end(); ++it) {
+        const xint64 bytes = live ? it->second.liveBytes : it->second.totalBytes;
+        if (bytes <= 0)
+            continue;
+
+        const SiteKey& key = it->first;
+        std::string line;
+        appendFrame(line, key.pool.empty() ? "(unnamed)" : key.pool.c_str());
+        appendFrame(line, typeName((BlockType) key.type));
+        for (size_t idx = 0; idx < key.tags.size(); ++idx)
+            appendFrame(line, key.tags[idx]);
+        for (size_t idx = key.frames.size(); idx > 0; --idx)
+            appendSymbol(line, key.frames[idx - 1]);
+
+        lines[line.substr(1)] += bytes;
+    }
+
+    std::string result;
+    char count[32];
+    for (std::map<std::string, xint64>::const_iterator it = lines.begin(); it != lines.end(); ++it) {
+        snprintf(count, sizeof(count), " %lld\n", (long long) it->second);
+        result += it->first;
+        result += count;
+    }
+
+    return result;
+}
+
+bool iMemTracker::dumpFolded(const char* path, bool live)
+{
+    const std::string folded = dumpFolded(live);
+    FILE* file = fopen(path, "w");
+    if (IX_NULLPTR == file)
+        return false;
+
+    const bool ok = (fwrite(folded.data(), 1, folded.size(), file) == folded.size());
+    return (0 == fclose(file)) && ok;
+}
+
+bool iMemTracker::dumpOnSignal(int signo, const char* path)
+{
+    TrackerData& data = trackerData();
+    {
+        iScopedLock<iMutex> _lock(data.lock);
+        data.signalPath = path ? path : "";
+    }
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = dumpRequestHandler;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    return 0 == sigaction(signo, &action, IX_NULLPTR);
+}
+
+void iMemTracker::serveDumpRequest()
+{
+    s_dumpRequested = 0;
+
+    std::string path;
+    {
+        TrackerData& data = trackerData();
+        iScopedLock<iMutex> _lock(data.lock);
+        path = data.signalPath;
+    }
+
+    if (!path.empty())
+        dumpFolded(path.c_str());
+}
+
+void iMemTracker::recordAlloc(const iMemBlock* block)
+{
+    if (s_dumpRequested)
+        serveDumpRequest();
+
+    SiteKey key;
+    key.pool = block->m_pool->name();
+    key.type = block->m_type;
+
+    #ifdef IX_HAVE_CXX11
+    for (const Scope* scope = s_scope; scope; scope = scope->parent())
+        key.tags.insert(key.tags.begin(), scope->tag());
+    #endif
+
+    TrackerData& data = trackerData();
+    #if defined(IX_HAVE_BACKTRACE) && defined(IX_HAVE_CXX11)
+    /* Unwinding is the expensive part, keep it outside the lock */
+    const int sampleEvery = data.sampleEvery;
+    if ((sampleEvery > 0) && (--s_sampleCountdown <= 0)) {
+        s_sampleCountdown = sampleEvery;
+        void* frames[IX_TRACKER_FRAMES + IX_TRACKER_SKIP];
+        const int n = backtrace(frames, IX_TRACKER_FRAMES + IX_TRACKER_SKIP);
+        if (n > IX_TRACKER_SKIP)
+            key.frames.assign(frames + IX_TRACKER_SKIP, frames + n);
+    }
+    #endif
+
+    const size_t size = block->m_length;
+    const xint64 now = iDeadlineTimer::current(PreciseTimer).deadlineNSecs();
+
+    iScopedLock<iMutex> _lock(data.lock);
+    if (0 == s_active.value())
+        return;
+
+    /* A release that went unrecorded must not stay live under the new block */
+    LiveMap::iterator stale = data.live.find(block);
+    if (stale != data.live.end())
+        settle(data, stale, now);
+    else
+        ++s_liveBlocks;
+
+    LiveBlock entry;
+    entry.size = size;
+    entry.bornNs = now;
+    entry.type = key.type;
+    entry.pool = &data.pools[key.pool];
+    entry.poolType = &data.poolTypes[std::make_pair(key.pool, key.type)];
+    entry.site = &data.sites[key];
+
+    accountAlloc(*entry.site, size);
+    accountAlloc(*entry.pool, size);
+    accountAlloc(*entry.poolType, size);
+    accountAlloc(data.types[entry.type], size);
+    accountAlloc(data.total, size);
+    data.live[block] = entry;
+}
+
+void iMemTracker::recordFree(const iMemBlock* block)
+{
+    if (s_dumpRequested)
+        serveDumpRequest();
+
+    const xint64 now = iDeadlineTimer::current(PreciseTimer).deadlineNSecs();
+    TrackerData& data = trackerData();
+    iScopedLock<iMutex> _lock(data.lock);
+
+    /* Created before start() or after a reset() */
+    LiveMap::iterator it = data.live.find(block);
+    if (it == data.live.end())
+        return;
+
+    settle(data, it, now);
+    data.live.erase(it);
+    --s_liveBlocks;
+}
+
+} // namespace iShell
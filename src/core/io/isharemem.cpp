@@ -10,6 +10,7 @@
 /// @author  ncjiakechong@gmail.com
 /////////////////////////////////////////////////////////////////
 
+#include <algorithm>
 #include <stdlib.h>
 #include <unistd.h>
 #include <fcntl.h>
@@ -21,6 +22,9 @@
 #include <sys/mman.h>
 #include <dirent.h>
 #include <signal.h>
+#ifdef IX_OS_LINUX
+#include <sys/syscall.h>
+#endif
 
 #include "core/io/isharemem.h"
 #include "core/thread/iatomiccounter.h"
@@ -37,6 +41,22 @@
 #define MADV_REMOVE 9
 #endif
 
+#if defined(IX_OS_LINUX) && !defined(MADV_POPULATE_WRITE)
+#define MADV_POPULATE_WRITE 23
+#endif
+
+#ifndef MAP_POPULATE
+#define MAP_POPULATE 0
+#endif
+
+#if defined(IX_OS_LINUX) && !defined(MADV_HUGEPAGE)
+#define MADV_HUGEPAGE 14
+#endif
+
+#if defined(IX_OS_LINUX) && !defined(MPOL_PREFERRED)
+#define MPOL_PREFERRED 1
+#endif
+
 #if defined(IX_OS_LINUX) && !defined(__ANDROID__)
 /* On Linux we know that the shared memory blocks are files in
  * /dev/shm. We can use that information to list all blocks and
@@ -93,7 +113,48 @@ static char* segmentName(char *fn, size_t l, const char* name, unsigned id)
     return fn;
 }
 
-iShareMem* iShareMem::createPrivateMem(const char* prefix, size_t size)
+/* Size of the default huge page, 2 MiB unless /proc/meminfo says otherwise */
+static size_t ix_huge_page_size()
+{
+    static size_t s_hugePageSize = 0;
+    if (s_hugePageSize)
+        return s_hugePageSize;
+
+    size_t result = 2 * 1024 * 1024;
+    #ifdef IX_OS_LINUX
+    FILE* fp = fopen("/proc/meminfo", "r");
+    if (fp) {
+        char line[128];
+        unsigned long kb = 0;
+        while (fgets(line, sizeof(line), fp)) {
+            if (1 == sscanf(line, "Hugepagesize: %lu kB", &kb)) {
+                result = (size_t) kb * 1024;
+                break;
+            }
+        }
+        fclose(fp);
+    }
+    #endif
+
+    s_hugePageSize = result;
+    return result;
+}
+
+static inline size_t alignToHugePage(size_t size)
+{
+    const size_t hugeSize = ix_huge_page_size();
+    return ((size + hugeSize - 1) / hugeSize) * hugeSize;
+}
+
+/* MAP_POPULATE faults pages in before any advice applies, use it only without advice */
+static inline bool canPopulateOnMap(iShareMem::CreateOptions options, int numaNode)
+{
+    return (options & iShareMem::CreatePopulate) && (MAP_POPULATE != 0)
+        && !(options & (iShareMem::CreateHugePages | iShareMem::CreateTransparentHugePages))
+        && (numaNode < 0);
+}
+
+iShareMem* iShareMem::createPrivateMem(const char* prefix, size_t size, CreateOptions options, int numaNode)
 {
     IX_ASSERT(size > 0);
     iShareMem* shm = new iShareMem(prefix);
@@ -101,23 +162,48 @@ iShareMem* iShareMem::createPrivateMem(const char* prefix, size_t size)
     shm->m_size = size;
 
     #if defined(MAP_ANONYMOUS)
-    shm->m_ptr = mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_ANONYMOUS|MAP_PRIVATE, -1, (off_t) 0);
+    const int populate = canPopulateOnMap(options, numaNode) ? MAP_POPULATE : 0;
+    shm->m_ptr = MAP_FAILED;
+
+    #ifdef MAP_HUGETLB
+    if (options & CreateHugePages) {
+        const size_t hugeSize = alignToHugePage(size);
+        shm->m_ptr = mmap(NULL, hugeSize, PROT_READ|PROT_WRITE, MAP_ANONYMOUS|MAP_PRIVATE|MAP_HUGETLB|populate, -1, (off_t) 0);
+        if (MAP_FAILED != shm->m_ptr) {
+            shm->m_size = hugeSize;
+            shm->m_hugePages = true;
+        } else {
+            ilog_info("huge page mapping unavailable (", errno, "), falling back to normal pages");
+        }
+    }
+    #endif
+
+    if (MAP_FAILED == shm->m_ptr)
+        shm->m_ptr = mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_ANONYMOUS|MAP_PRIVATE|populate, -1, (off_t) 0);
+
     if (MAP_FAILED == shm->m_ptr) {
         ilog_info("mmap() failed: ", errno);
+        shm->m_ptr = IX_NULLPTR;
+        shm->m_size = 0;
         delete shm;
-        shm = IX_NULLPTR;
+        return IX_NULLPTR;
     }
+
+    if (!populate)
+        shm->applyOptions(options, numaNode);
     #elif defined(IX_HAVE_POSIX_MEMALIGN)
     {
         int r = posix_memalign(&shm->m_ptr, ix_page_size(), size);
         if (r < 0) {
             ilog_warn("posix_memalign() failed: ", r);
             delete shm;
-            shm = IX_NULLPTR;
+            return IX_NULLPTR;
         }
     }
+    shm->applyOptions(options, numaNode);
     #else
     shm->m_ptr = ::malloc(size);
+    shm->applyOptions(options, numaNode);
     #endif
 
     return shm;
@@ -131,7 +217,7 @@ static void ix_random(void *ret_data, size_t length) {
         *p = (xuint8) rand();
 }
 
-iShareMem* iShareMem::createSharedMem(const char* prefix, MemType type, size_t size, mode_t mode)
+iShareMem* iShareMem::createSharedMem(const char* prefix, MemType type, size_t size, mode_t mode, CreateOptions options, int numaNode)
 {
     /* Each time we create a new SHM area, let's first drop all stale ones */
     cleanup(prefix);
@@ -167,7 +253,14 @@ iShareMem* iShareMem::createSharedMem(const char* prefix, MemType type, size_t s
              shm->m_doUnlink = false;
         }
         #elif defined(IX_HAVE_MEMFD)
-        shm->m_memfd = memfd_create(shm->m_prefix, MFD_ALLOW_SEALING);
+        #ifdef MFD_HUGETLB
+        if (options & CreateHugePages) {
+            shm->m_memfd = memfd_create(shm->m_prefix, MFD_ALLOW_SEALING|MFD_HUGETLB);
+            shm->m_hugePages = (shm->m_memfd >= 0);
+        }
+        #endif
+        if (shm->m_memfd < 0)
+            shm->m_memfd = memfd_create(shm->m_prefix, MFD_ALLOW_SEALING);
         #else
         ilog_warn("MEMTYPE_SHARED_MEMFD not supported on this platform.");
         delete shm;
@@ -189,6 +282,14 @@ iShareMem* iShareMem::createSharedMem(const char* prefix, MemType type, size_t s
 
     shm->m_type = type;
     shm->m_size = size + SHMMarkerSize(type);
+    if (shm->m_hugePages)
+        shm->m_size = alignToHugePage(shm->m_size);
+
+    #ifndef MAP_NORESERVE
+    #define MAP_NORESERVE 0
+    #endif
+
+    const int populate = canPopulateOnMap(options, numaNode) ? MAP_POPULATE : 0;
 
     #ifdef __ANDROID__
     // ASharedMemory_create already set the size, and ftruncate might fail on it (EINVAL) for MEMFD (Ashmem)
@@ -201,16 +302,36 @@ iShareMem* iShareMem::createSharedMem(const char* prefix, MemType type, size_t s
         return IX_NULLPTR;
     }
 
-    #ifndef MAP_NORESERVE
-    #define MAP_NORESERVE 0
+    // hugetlbfs reserves its pages at mmap() time, so no MAP_NORESERVE there:
+    // a short pool fails here and falls back instead of SIGBUS on first touch
+    int flags = MAP_SHARED | populate | (shm->m_hugePages ? 0 : MAP_NORESERVE);
+    shm->m_ptr = mmap(NULL, ix_page_align(shm->m_size), PROT_READ|PROT_WRITE, flags, shm->m_memfd, (off_t) 0);
+
+    #if defined(IX_HAVE_MEMFD) && !defined(__ANDROID__)
+    if ((MAP_FAILED == shm->m_ptr) && shm->m_hugePages) {
+        ilog_info("huge page segment unavailable (", errno, "), falling back to normal pages");
+        close(shm->m_memfd);
+        shm->m_hugePages = false;
+        shm->m_size = size + SHMMarkerSize(type);
+        shm->m_memfd = memfd_create(shm->m_prefix, MFD_ALLOW_SEALING);
+        if ((shm->m_memfd >= 0) && (ftruncate(shm->m_memfd, (off_t) shm->m_size) >= 0)) {
+            flags = MAP_SHARED | MAP_NORESERVE | populate;
+            shm->m_ptr = mmap(NULL, ix_page_align(shm->m_size), PROT_READ|PROT_WRITE, flags, shm->m_memfd, (off_t) 0);
+        }
+    }
     #endif
 
-    if ((shm->m_ptr = mmap(NULL, ix_page_align(shm->m_size), PROT_READ|PROT_WRITE, MAP_SHARED|MAP_NORESERVE, shm->m_memfd, (off_t) 0)) == MAP_FAILED) {
+    if (MAP_FAILED == shm->m_ptr) {
         ilog_info("shm mmap() failed: ", errno);
+        shm->m_ptr = IX_NULLPTR;
+        shm->m_size = 0;
         delete shm;
         return IX_NULLPTR;
     }
 
+    if (!populate)
+        shm->applyOptions(options, numaNode);
+
     if (type == MEMTYPE_SHARED_POSIX) {
         /* We store our PID at the end of the shm block, so that we
          * can check for dead shm segments later */
@@ -235,16 +356,16 @@ iShareMem* iShareMem::createSharedMem(const char* prefix, MemType type, size_t s
     return shm;
 }
 
-iShareMem* iShareMem::create(const char* prefix, MemType type, size_t size, mode_t mode) {
+iShareMem* iShareMem::create(const char* prefix, MemType type, size_t size, mode_t mode, CreateOptions options, int numaNode) {
     IX_ASSERT((size > 0) && (size <= MAX_SHM_SIZE));
     IX_ASSERT(!(mode & ~0777) && (mode >= 0600));
 
     /* Round up to make it page aligned */
     size = ix_page_align(size);
     if (type == MEMTYPE_PRIVATE)
-        return createPrivateMem(prefix, size);
+        return createPrivateMem(prefix, size, options, numaNode);
 
-    return createSharedMem(prefix, type, size, mode);
+    return createSharedMem(prefix, type, size, mode, options, numaNode);
 }
 
 iShareMem::iShareMem(const char* prefix)
@@ -254,6 +375,7 @@ iShareMem::iShareMem(const char* prefix)
     , m_ptr(IX_NULLPTR)
     , m_size(0)
     , m_doUnlink(false)
+    , m_hugePages(false)
     , m_memfd(-1)
 {
     if (prefix) {
@@ -316,7 +438,12 @@ void iShareMem::freePrivateMem()
     #endif
 }
 
-void iShareMem::punch(size_t offset, size_t size)
+size_t iShareMem::pageSize() const
+{
+    return m_hugePages ? ix_huge_page_size() : ix_page_size();
+}
+
+bool iShareMem::punch(size_t offset, size_t size, bool zero)
 {
     IX_ASSERT(m_ptr && (m_size > 0) && (offset + size <= m_size));
     #ifdef MAP_FAILED
@@ -326,35 +453,97 @@ void iShareMem::punch(size_t offset, size_t size)
     /* You're welcome to implement this as NOOP on systems that don't
      * support it */
 
-    /* Align the pointer up to multiples of the page size */
-    void* ptr = (xuint8*) m_ptr + offset;
-    const size_t page_size = ix_page_size();
-    size_t o = (size_t) ((xuint8*) ptr - (xuint8*) ix_page_align_ptr(ptr));
+    /* Shrink the range to whole pages, hugetlb mappings reject anything
+     * that is not aligned to their huge page size with EINVAL */
+    const size_t page_size = pageSize();
+    const size_t begin = ((offset + page_size - 1) / page_size) * page_size;
+    const size_t end = ((offset + size) / page_size) * page_size;
+    if (end <= begin)
+        return true;
 
-    if (o > 0) {
-        size_t delta = page_size - o;
-        ptr = (xuint8*) ptr + delta;
-        size -= delta;
-    }
-
-    /* Align the size down to multiples of page size */
-    size = (size / page_size) * page_size;
+    void* ptr = (xuint8*) m_ptr + begin;
+    size = end - begin;
 
     #ifdef MADV_REMOVE
     if (madvise(ptr, size, MADV_REMOVE) >= 0)
-        return;
+        return true;
     #endif
 
+    /* MADV_FREE keeps the old contents until the kernel runs short of memory */
     #ifdef MADV_FREE
-    if (madvise(ptr, size, MADV_FREE) >= 0)
-        return;
+    if (!zero && (madvise(ptr, size, MADV_FREE) >= 0))
+        return false;
     #endif
 
+    /* Private pages fault back in zero-filled, shared ones from their file */
     #ifdef MADV_DONTNEED
-    madvise(ptr, size, MADV_DONTNEED);
+    return (madvise(ptr, size, MADV_DONTNEED) >= 0) && (MEMTYPE_PRIVATE == m_type);
     #elif defined(POSIX_MADV_DONTNEED)
     posix_madvise(ptr, size, POSIX_MADV_DONTNEED);
     #endif
+    return false;
+}
+
+void iShareMem::populate(size_t offset, size_t size)
+{
+    IX_ASSERT(m_ptr && (m_size > 0) && (offset + size <= m_size));
+    #ifdef MAP_FAILED
+    IX_ASSERT(m_ptr != MAP_FAILED);
+    #endif
+
+    /* Align the range out to whole pages, the mapping covers whole ones */
+    const size_t page_size = pageSize();
+    const size_t first = (offset / page_size) * page_size;
+    const size_t last = std::min(((offset + size + page_size - 1) / page_size) * page_size, m_size);
+    xuint8* begin = (xuint8*) m_ptr + first;
+    size = last - first;
+
+    /* Allocates backing pages without touching the data (Linux 5.14+) */
+    #ifdef MADV_POPULATE_WRITE
+    if (madvise(begin, size, MADV_POPULATE_WRITE) >= 0)
+        return;
+    #endif
+
+    /* Older kernels: only a read-ahead hint, pages still fault on first write */
+    #ifdef MADV_WILLNEED
+    madvise(begin, size, MADV_WILLNEED);
+    #elif defined(POSIX_MADV_WILLNEED)
+    posix_madvise(begin, size, POSIX_MADV_WILLNEED);
+    #endif
+}
+
+void iShareMem::applyOptions(CreateOptions options, int numaNode)
+{
+    IX_ASSERT(m_ptr && (m_size > 0));
+    const size_t length = ix_page_align(m_size);
+
+    /* hugetlb segments are huge already, the rest may be promoted by THP */
+    #ifdef MADV_HUGEPAGE
+    if (!m_hugePages && (options & (CreateHugePages | CreateTransparentHugePages))) {
+        if (madvise(m_ptr, length, MADV_HUGEPAGE) < 0)
+            ilog_debug("madvise(MADV_HUGEPAGE) failed: ", errno);
+    }
+    #endif
+
+    /* Preferred, not strict, so allocation still succeeds when the node is full */
+    #if defined(IX_OS_LINUX) && defined(SYS_mbind)
+    if (numaNode >= 0) {
+        unsigned long nodeMask[16];
+        memset(nodeMask, 0, sizeof(nodeMask));
+        if ((size_t) numaNode < sizeof(nodeMask) * 8) {
+            nodeMask[numaNode / (sizeof(unsigned long) * 8)] = 1UL << (numaNode % (sizeof(unsigned long) * 8));
+            if (syscall(SYS_mbind, m_ptr, length, MPOL_PREFERRED, nodeMask, sizeof(nodeMask) * 8 + 1, 0) < 0)
+                ilog_info("mbind() to NUMA node ", numaNode, " failed: ", errno);
+        } else {
+            ilog_info("NUMA node ", numaNode, " out of range, ignored");
+        }
+    }
+    #else
+    IX_UNUSED(numaNode);
+    #endif
+
+    if (options & CreatePopulate)
+        populate(0, m_size);
 }
 
 int iShareMem::doAttach(MemType type, uint id, xintptr memfd, bool writable, bool for_cleanup)
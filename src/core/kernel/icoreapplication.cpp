@@ -248,40 +248,26 @@ void iCoreApplication::postEvent(iObject *receiver, iEvent *event, int priority)
         return;
     }
 
+    // no lock: the event goes to the inbox of the receiver's thread, which
+    // sorts it in the next time it looks at its posted events
     iThreadData *data = receiver->m_threadData.load();
-    if (!data) {
-        // posting during destruction? just delete the event to prevent a leak
-        delete event;
-        return;
-    }
-
-    // lock the post event mutex
-    data->postEventList.mutex.lock();
-
-    // if object has moved to another thread, follow it
-    while (data != receiver->m_threadData.load()) {
-        data->postEventList.mutex.unlock();
-
-        data = receiver->m_threadData.load();
+    for (;;) {
         if (!data) {
             // posting during destruction? just delete the event to prevent a leak
             delete event;
             return;
         }
 
-        data->postEventList.mutex.lock();
-    }
+        // if object has moved to another thread, follow it
+        ++data->postEventList.pushing;
+        iThreadData *current = receiver->m_threadData.load();
+        if (current == data)
+            break;
 
-    // if this is one of the compressible events, do compression
-    if (receiver->m_postedEvents
-        && s_self && s_self->compressEvent(event, receiver, &data->postEventList)) {
-        data->postEventList.mutex.unlock();
-        return;
+        --data->postEventList.pushing;
+        data = current;
     }
 
-    if (event->type() == iEvent::DeferredDelete)
-        receiver->m_deleteLaterCalled = true;
-
     if (event->type() == iEvent::DeferredDelete && data == iThreadData::current()) {
         // remember the current running eventloop for DeferredDelete
         // events posted in the receiver's thread.
@@ -307,22 +293,49 @@ void iCoreApplication::postEvent(iObject *receiver, iEvent *event, int priority)
         deleteEvent->sl = scopeLevel;
     }
 
-    iPostEvent pe(receiver, event, priority);
-    bool needWake = data->postEventList.empty();
-    data->postEventList.addEvent(pe);
     event->m_posted = true;
-    ++receiver->m_postedEvents;
+    data->postEventList.pushIncoming(receiver, event, priority);
     data->canWait = 0;
-    data->postEventList.mutex.unlock();
 
-    if (needWake && data->dispatcher.load())
-        data->dispatcher.load()->wakeUp();
+    // a dispatcher that is not about to block finds the inbox by itself
+    iEventDispatcher* dispatcher = data->dispatcher.load();
+    if (data->parked.value() && dispatcher)
+        dispatcher->wakeUp();
+
+    --data->postEventList.pushing;
+}
+
+void iCoreApplication::takePostedEvents(iThreadData *data)
+{
+    iPostEvent pe;
+    iEvent* event = data->postEventList.takeIncoming();
+    while (event) {
+        event = iPostEventList::nextIncoming(event, &pe);
+
+        // pushed before the receiver moved to another thread
+        if (pe.receiver->m_threadData.load() != data) {
+            postEvent(pe.receiver, pe.event, pe.priority);
+            continue;
+        }
+
+        // if this is one of the compressible events, do compression
+        if (pe.receiver->m_postedEvents
+            && s_self && s_self->compressEvent(pe.event, pe.receiver, &data->postEventList))
+            continue;
+
+        if (pe.event->type() == iEvent::DeferredDelete)
+            pe.receiver->m_deleteLaterCalled = true;
+
+        data->postEventList.addEvent(pe);
+        ++pe.receiver->m_postedEvents;
+    }
 }
 
 void iCoreApplication::removePostedEvents(iObject *receiver, int eventType)
 {
     iThreadData *data = receiver ? receiver->m_threadData : iThreadData::current();
     iScopedLock<iMutex> locker(data->postEventList.mutex);
+    takePostedEvents(data);
 
     // the iObject destructor calls this function directly. this can
     // happen while the event loop is in the middle of posting events,
@@ -375,6 +388,7 @@ void iCoreApplication::sendPostedEvents(iObject *receiver, int event_type)
 
     ++threadData->postEventList.recursion;
     iScopedLock<iMutex> locker(threadData->postEventList.mutex);
+    takePostedEvents(threadData);
 
     // by default, we assume that the event dispatcher can go to sleep after
     // processing all events. if any new events are posted while we send
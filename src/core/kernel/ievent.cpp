@@ -40,10 +40,12 @@ int iEvent::registerEventType(int hint)
 
 iEvent::iEvent(unsigned short type)
     : m_type(type), m_posted(false), m_accept(true)
+    , m_nextPosted(IX_NULLPTR), m_postReceiver(IX_NULLPTR), m_postPriority(0)
 {}
 
 iEvent::iEvent(const iEvent &other)
     : m_type(other.m_type), m_posted(other.m_posted), m_accept(other.m_accept)
+    , m_nextPosted(IX_NULLPTR), m_postReceiver(IX_NULLPTR), m_postPriority(0)
 {}
 
 iEvent& iEvent::operator=(const iEvent &other)
@@ -105,4 +105,16 @@ void iEventDispatcher::startingUp()
 void iEventDispatcher::closingDown()
 {}
 
+bool iEventDispatcher::supportsPollModes() const
+{ return false; }
+
+bool iEventDispatcher::setBusyPollBudget(xint64)
+{ return false; }
+
+xint64 iEventDispatcher::busyPollBudget() const
+{ return 0; }
+
+iEventDispatcher::BusyPollStats iEventDispatcher::busyPollStats() const
+{ return BusyPollStats(); }
+
 } // namespace iShell
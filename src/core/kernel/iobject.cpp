@@ -22,6 +22,7 @@
 #include "core/kernel/ieventdispatcher.h"
 #include "thread/iorderedmutexlocker_p.h"
 #include "core/utils/ivarlengtharray.h"
+#include "core/utils/ifreelist.h"
 #include "thread/ithread_p.h"
 #include "core/io/ilog.h"
 
@@ -35,6 +36,11 @@ public:
     iMetaCallEvent(iSemaphore* semph = IX_NULLPTR);
     ~iMetaCallEvent();
 
+    // queued calls recycle their events through a lock-free pool so the
+    // steady-state post path does not reach the global allocator
+    static void* operator new(size_t size);
+    static void operator delete(void* ptr);
+
     void* arg(_iConnection* conn, void* arg, _iConnection::ArgumentWrapper wrapper, _iConnection::ArgumentDeleter deleter, bool userWrapper = true);
     iSemaphore* semaphore;
     _iConnection* connection;
@@ -64,6 +70,49 @@ iMetaCallEvent::~iMetaCallEvent()
         semaphore->release();
 }
 
+namespace {
+// the pool is only used between its own construction and destruction, events
+// created or freed during static init/teardown fall back to the global heap
+bool s_metaCallPoolAlive = false;
+
+struct iMetaCallEventPool
+{
+    static void cleanup(iFreeList<void*>* list) {
+        void* ptr;
+        while ((ptr = list->pop(IX_NULLPTR)) != IX_NULLPTR)
+            ::operator delete(ptr);
+    }
+
+    iMetaCallEventPool() : events(256, &cleanup) { s_metaCallPoolAlive = true; }
+    ~iMetaCallEventPool() { s_metaCallPoolAlive = false; }
+
+    iFreeList<void*> events;
+};
+
+iMetaCallEventPool s_metaCallPool;
+}
+
+void* iMetaCallEvent::operator new(size_t size)
+{
+    if (s_metaCallPoolAlive && (sizeof(iMetaCallEvent) == size)) {
+        void* ptr = s_metaCallPool.events.pop(IX_NULLPTR);
+        if (ptr) return ptr;
+    }
+
+    return ::operator new(size);
+}
+
+void iMetaCallEvent::operator delete(void* ptr)
+{
+    if (IX_NULLPTR == ptr)
+        return;
+
+    if (s_metaCallPoolAlive && s_metaCallPool.events.push(ptr))
+        return;
+
+    ::operator delete(ptr);
+}
+
 void* iMetaCallEvent::arg(_iConnection* conn, void* arg, _iConnection::ArgumentWrapper wrapper, _iConnection::ArgumentDeleter deleter, bool userWrapper) {
     IX_ASSERT(!connection);
     connection = conn;
@@ -183,7 +232,8 @@ iObject::~iObject()
     // Remove all posted events ASAP to prevent them from being delivered
     // to a partially destructed object. This must be done before emitting
     // destroyed() signal as the signal handlers might post new events.
-    if (m_postedEvents)
+    iThreadData* threadData = m_threadData.load();
+    if (m_postedEvents || (threadData && threadData->postEventList.hasIncoming()))
         iCoreApplication::removePostedEvents(this, iEvent::None);
 
     isharedpointer::ExternalRefCountData *refcount = m_refCount.load();
@@ -404,6 +454,12 @@ bool iObject::moveToThread(iThread *targetThread)
     // move the object
     setThreadData_helper(currentData, targetData);
 
+    // a postEvent() that chose currentData before the move may still push there:
+    // let it finish, then hand what it pushed on to targetData
+    while (currentData->postEventList.pushing.value() > 0)
+        iThread::yieldCurrentThread();
+    iCoreApplication::takePostedEvents(currentData);
+
     locker.unlock();
 
     // now currentData can commit suicide if it wants to
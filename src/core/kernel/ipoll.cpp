@@ -31,6 +31,10 @@
 
 #ifdef IX_OS_LINUX
 #include <sys/epoll.h>
+
+#ifndef EPOLLEXCLUSIVE
+#define EPOLLEXCLUSIVE (1u << 28)
+#endif
 #endif
 
 #if defined(IX_OS_MACOS) || defined(IX_OS_FREEBSD) || defined(IX_OS_DARWIN) || defined(IX_OS_BSD4)
@@ -101,7 +105,7 @@ static int poll_rest (iPollFD *msg_fd,
         return (recursed_result == -1) ? -1 : 1 + recursed_result;
     } else if (ready >= WAIT_OBJECT_0 && ready < WAIT_OBJECT_0 + nhandles) {
         f = handle_to_fd[ready - WAIT_OBJECT_0];
-        f->revents = f->events;
+        f->revents = f->events & ~(IX_IO_EDGE | IX_IO_EXCLUSIVE);
 
         /* If no timeout and polling several handles, recurse to poll
         * the rest of them.
@@ -135,6 +139,10 @@ public:
 
     int removeFd(iPollFD* fd) {
         m_disabledFds.erase(fd);
+        for (size_t idx = 0; idx < m_ready.size(); ++idx) {
+            if (m_ready[idx] == fd)
+                m_ready[idx] = IX_NULLPTR;
+        }
         for (std::vector<iPollFD*>::iterator it = m_fds.begin(); it != m_fds.end(); ++it) {
             if (*it == fd) {
                 m_fds.erase(it);
@@ -215,18 +223,29 @@ public:
             retval = poll_rest (msg_fd, handles, handle_to_fd, nhandles, timeout);
         }
 
-        if (retval == -1) {
-            for (size_t idx = 0; idx < nfds; ++idx) {
-                iPollFD* f = m_fds[idx];
+        m_ready.clear();
+        for (size_t idx = 0; idx < nfds; ++idx) {
+            iPollFD* f = m_fds[idx];
+            if (retval == -1)
                 f->revents = 0;
-            }
+            else if (f->revents)
+                m_ready.push_back(f);
         }
 
         return retval;
     }
+
+    int readyCount() const {
+        return (int)m_ready.size();
+    }
+
+    iPollFD* readyFd(int index) const {
+        return m_ready[index];
+    }
     
 private:
     std::vector<iPollFD*> m_fds;
+    std::vector<iPollFD*> m_ready;
     std::unordered_set<iPollFD*> m_disabledFds;
 };
 
@@ -253,6 +272,10 @@ public:
 
     int removeFd(iPollFD* fd) {
         m_disabledFds.erase(fd);
+        for (size_t i = 0; i < m_ready.size(); ++i) {
+            if (m_ready[i] == fd)
+                m_ready[i] = IX_NULLPTR;
+        }
         for (std::list<iPollFD*>::iterator it = m_fds.begin(); it != m_fds.end(); ++it) {
             if (*it != fd) continue;
 
@@ -284,7 +307,7 @@ public:
         for (std::list<iPollFD*>::iterator it = m_fds.begin(); it != m_fds.end(); ++it, ++i) {
             bool disabledFd = !m_disabledFds.empty() && (m_disabledFds.count(*it) > 0);
             m_pollFds[i].fd = !disabledFd ? (*it)->fd : -1;
-            m_pollFds[i].events = !disabledFd ? (*it)->events : 0;
+            m_pollFds[i].events = !disabledFd ? ((*it)->events & ~(IX_IO_EDGE | IX_IO_EXCLUSIVE)) : 0;
             m_pollFds[i].revents = 0;
         }
 
@@ -307,17 +330,30 @@ public:
         ret = ::poll(m_pollFds.data(), nfds, ms);
         #endif
 
+        m_ready.clear();
         if (ret <= 0) return ret;
 
         i = 0;
         for (std::list<iPollFD*>::iterator it = m_fds.begin(); it != m_fds.end(); ++it, ++i) {
+            if (!m_pollFds[i].revents) continue;
+
             (*it)->revents = m_pollFds[i].revents;
+            m_ready.push_back(*it);
         }
         return ret;
     }
 
+    int readyCount() const {
+        return (int)m_ready.size();
+    }
+
+    iPollFD* readyFd(int index) const {
+        return m_ready[index];
+    }
+
 private:
    std::list<iPollFD*> m_fds;
+   std::vector<iPollFD*> m_ready;
    std::vector<iPollFD> m_pollFds;
    std::unordered_set<iPollFD*> m_disabledFds;
 };
@@ -326,7 +362,7 @@ private:
 #if defined(IX_OS_LINUX)
 class iPollerEpoll {
 public:
-    iPollerEpoll() : m_epfd(-1) {
+    iPollerEpoll() : m_epfd(-1), m_nready(0) {
         m_epfd = epoll_create1(EPOLL_CLOEXEC);
         if (m_epfd < 0) {
              ilog_error("epoll_create1 failed");
@@ -339,55 +375,50 @@ public:
     }
 
     int addFd(iPollFD* fd) {
-        m_fds.push_back(fd);
-        struct epoll_event ev;
-        ev.events = fd->events; 
-        ev.data.ptr = fd;
-        return epoll_ctl(m_epfd, EPOLL_CTL_ADD, fd->fd, &ev);
+        return ctl(EPOLL_CTL_ADD, fd, epollEvents(fd->events));
     }
 
     int removeFd(iPollFD* fd) {
-        for (std::list<iPollFD*>::iterator it = m_fds.begin(); it != m_fds.end(); ++it) {
-            if (*it == fd) {
-                m_fds.erase(it);
-                break;
-            }
+        // The fd may still be in the results of the last wait(), only those are looked at
+        for (int i = 0; i < m_nready; ++i) {
+            if (m_events[i].data.ptr == fd)
+                m_events[i].data.ptr = IX_NULLPTR;
         }
         return epoll_ctl(m_epfd, EPOLL_CTL_DEL, fd->fd, IX_NULLPTR);
     }
 
     int updateFd(iPollFD* fd) {
-        struct epoll_event ev;
-        ev.events = fd->events;
-        ev.data.ptr = fd;
-        return epoll_ctl(m_epfd, EPOLL_CTL_MOD, fd->fd, &ev);
+        return modify(fd, epollEvents(fd->events));
     }
 
     int disableFd(iPollFD* fd) {
-        struct epoll_event ev;
-        ev.events = 0;
-        ev.data.ptr = fd;
-        return epoll_ctl(m_epfd, EPOLL_CTL_MOD, fd->fd, &ev);
+        // EPOLLEXCLUSIVE fds cannot be modified, they leave the set while disabled
+        if (fd->events & IX_IO_EXCLUSIVE)
+            return epoll_ctl(m_epfd, EPOLL_CTL_DEL, fd->fd, IX_NULLPTR);
+
+        return ctl(EPOLL_CTL_MOD, fd, 0);
     }
 
     int enableFd(iPollFD* fd) {
-        struct epoll_event ev;
-        ev.events = fd->events;
-        ev.data.ptr = fd;
-        return epoll_ctl(m_epfd, EPOLL_CTL_MOD, fd->fd, &ev);
+        if (fd->events & IX_IO_EXCLUSIVE)
+            return ctl(EPOLL_CTL_ADD, fd, epollEvents(fd->events));
+
+        return ctl(EPOLL_CTL_MOD, fd, epollEvents(fd->events));
     }
 
     int wait(xint64 timeout) {
-        // Clear revents for all fds
-        for (std::list<iPollFD*>::iterator it = m_fds.begin(); it != m_fds.end(); ++it) {
-            (*it)->revents = 0;
-        }
-
+        // Only the fds epoll reports are touched, whatever the number registered
         int ms = -1;
         if (timeout >= 0) {
              ms = (timeout + 999999LL) / 1000000LL;
         }
 
+        // The results are reused below, resize before they are filled
+        if (m_nready >= (int)m_events.size()) {
+            m_events.resize(m_events.size() * 2);
+        }
+
+        m_nready = 0;
         int nfds = epoll_wait(m_epfd, m_events.data(), m_events.size(), ms);
         if (nfds < 0) return -1;
 
@@ -396,17 +427,48 @@ public:
             if (fd) fd->revents = m_events[i].events;
         }
 
-        if (nfds >= (int)m_events.size()) {
-            m_events.resize(m_events.size() + 4);
-        }
-
+        m_nready = nfds;
         return nfds;
     }
 
+    int readyCount() const {
+        return m_nready;
+    }
+
+    iPollFD* readyFd(int index) const {
+        return (iPollFD*)m_events[index].data.ptr;
+    }
+
 private:
+    static xuint32 epollEvents(short events) {
+        xuint32 result = (xuint32)(events & ~(IX_IO_EDGE | IX_IO_EXCLUSIVE));
+        if (events & IX_IO_EDGE) result |= EPOLLET;
+        if (events & IX_IO_EXCLUSIVE) result |= EPOLLEXCLUSIVE;
+        return result;
+    }
+
+    int ctl(int op, iPollFD* fd, xuint32 events) {
+        struct epoll_event ev;
+        ev.events = events;
+        ev.data.ptr = fd;
+        return epoll_ctl(m_epfd, op, fd->fd, &ev);
+    }
+
+    // An exclusive registration cannot be modified, nor made exclusive afterwards
+    int modify(iPollFD* fd, xuint32 events) {
+        if (!(events & EPOLLEXCLUSIVE)) {
+            int ret = ctl(EPOLL_CTL_MOD, fd, events);
+            if (0 == ret || EINVAL != errno)
+                return ret;
+        }
+
+        epoll_ctl(m_epfd, EPOLL_CTL_DEL, fd->fd, IX_NULLPTR);
+        return ctl(EPOLL_CTL_ADD, fd, events);
+    }
+
     int m_epfd;
+    int m_nready;
     std::vector<struct epoll_event> m_events;
-    std::list<iPollFD*> m_fds;
 };
 #endif 
 
@@ -436,9 +498,10 @@ public:
     // per-fd disable/enable dance the dispatcher performs on every loop
     // iteration (for priority filtering) into one syscall instead of 2*N.
     int addFd(iPollFD* fd) {
+        const unsigned int mode = EV_ADD | ((fd->events & IX_IO_EDGE) ? EV_CLEAR : 0);
         fd->revents = 0;
-        queueChange(fd->fd, EVFILT_READ,  EV_ADD | ((fd->events & IX_IO_IN)  ? EV_ENABLE : EV_DISABLE), fd);
-        queueChange(fd->fd, EVFILT_WRITE, EV_ADD | ((fd->events & IX_IO_OUT) ? EV_ENABLE : EV_DISABLE), fd);
+        queueChange(fd->fd, EVFILT_READ,  mode | ((fd->events & IX_IO_IN)  ? EV_ENABLE : EV_DISABLE), fd);
+        queueChange(fd->fd, EVFILT_WRITE, mode | ((fd->events & IX_IO_OUT) ? EV_ENABLE : EV_DISABLE), fd);
         return 0;
     }
 
@@ -462,8 +525,10 @@ public:
     }
 
     int updateFd(iPollFD* fd) {
-        queueChange(fd->fd, EVFILT_READ,  (fd->events & IX_IO_IN)  ? EV_ENABLE : EV_DISABLE, fd);
-        queueChange(fd->fd, EVFILT_WRITE, (fd->events & IX_IO_OUT) ? EV_ENABLE : EV_DISABLE, fd);
+        // EV_ADD on an existing filter switches EV_CLEAR as well
+        const unsigned int mode = EV_ADD | ((fd->events & IX_IO_EDGE) ? EV_CLEAR : 0);
+        queueChange(fd->fd, EVFILT_READ,  mode | ((fd->events & IX_IO_IN)  ? EV_ENABLE : EV_DISABLE), fd);
+        queueChange(fd->fd, EVFILT_WRITE, mode | ((fd->events & IX_IO_OUT) ? EV_ENABLE : EV_DISABLE), fd);
         return 0;
     }
 
@@ -480,10 +545,6 @@ public:
     }
 
     int wait(xint64 timeout) {
-        // Clear revents only for the fds that actually reported events last
-        // round, instead of walking the whole fd set on every wait.
-        for (size_t i = 0; i < m_active.size(); ++i)
-            m_active[i]->revents = 0;
         m_active.clear();
 
         struct timespec ts;
@@ -505,6 +566,14 @@ public:
         m_changes.clear();
         if (nfds < 0) return -1;
 
+        // A fd can be reported once per filter: reset the reported ones first,
+        // the revents of fds not reported are left to whoever handles them
+        for (int i = 0; i < nfds; ++i) {
+            iPollFD* fd = (iPollFD*)m_events[i].udata;
+            if (fd && !(m_events[i].flags & EV_ERROR))
+                fd->revents = 0;
+        }
+
         int ready = 0;
         for (int i = 0; i < nfds; ++i) {
             // EV_ERROR entries are receipts for changelist operations that
@@ -540,6 +609,14 @@ public:
         return ready;
     }
 
+    int readyCount() const {
+        return (int)m_active.size();
+    }
+
+    iPollFD* readyFd(int index) const {
+        return m_active[index];
+    }
+
 private:
     void queueChange(int ident, int filter, unsigned int flags, iPollFD* udata) {
         struct kevent kev;
@@ -574,6 +651,14 @@ typedef iPollerPoll iPollerImpl;
 
 iPoller::iPoller() : m_impl(new iPollerImpl()) {}
 
+bool iPoller::hasEdgeTriggered() {
+#if defined(IX_OS_LINUX) || defined(IX_OS_MACOS) || defined(IX_OS_FREEBSD) || defined(IX_OS_DARWIN) || defined(IX_OS_BSD4)
+    return true;
+#else
+    return false;
+#endif
+}
+
 iPoller::~iPoller() {
     delete static_cast<iPollerImpl*>(m_impl);
 }
@@ -602,4 +687,12 @@ int iPoller::wait(xint64 timeout) {
     return static_cast<iPollerImpl*>(m_impl)->wait(timeout);
 }
 
+int iPoller::readyCount() const {
+    return static_cast<const iPollerImpl*>(m_impl)->readyCount();
+}
+
+iPollFD* iPoller::readyFd(int index) const {
+    return static_cast<const iPollerImpl*>(m_impl)->readyFd(index);
+}
+
 } // namespace iShell
@@ -8,6 +8,8 @@
 /// @author  ncjiakechong@gmail.com
 /////////////////////////////////////////////////////////////////
 
+#include <algorithm>
+
 #include "core/global/imacro.h"
 #include "core/io/ilog.h"
 #include "core/kernel/iobject.h"
@@ -42,11 +44,21 @@ static xint64 roundToSecs(xint64 interval)
 
 iTimerInfoList::iTimerInfoList()
     : m_currentTime(0)
+    , m_sequence(0)
+    , m_firstTimerId(0)
+    , m_firstTimerInterval(0)
 {}
 
 iTimerInfoList::~iTimerInfoList()
 {
+    for (TimerHeap::iterator it = m_timers.begin(); it != m_timers.end(); ++it) {
+        m_nodeAllocator.destroy(*it);
+        m_nodeAllocator.deallocate(*it, 1);
+    }
+
     m_timers.clear();
+    m_timerIds.clear();
+    m_timerObjects.clear();
 }
 
 xint64 iTimerInfoList::updateCurrentTime()
@@ -56,26 +68,142 @@ xint64 iTimerInfoList::updateCurrentTime()
 }
 
 /*
-  insert timer info into list
+  4-ary heap helpers, the parent of slot i is (i - 1) / 4 and
+  its children are 4 * i + 1 ... 4 * i + 4
 */
-std::list<iTimerInfoList::TimerInfo>::iterator iTimerInfoList::timerInsert(const TimerInfo& ti)
+void iTimerInfoList::siftUp(int index)
 {
-    if (m_timers.empty() || ti.timeout >= m_timers.back().timeout) {
-        m_timers.push_back(ti);
-        return --m_timers.end();
+    TimerInfo* t = m_timers[index];
+    while (index > 0) {
+        int parent = (index - 1) / 4;
+        if (!timerBefore(t, m_timers[parent]))
+            break;
+
+        m_timers[index] = m_timers[parent];
+        m_timers[index]->heapIndex = index;
+        index = parent;
     }
 
-    TimerContainer::iterator insert_it = m_timers.begin();
-    while (insert_it != m_timers.end()) {
-        if (ti.timeout < insert_it->timeout) {
-            return m_timers.insert(insert_it, ti);
+    m_timers[index] = t;
+    t->heapIndex = index;
+}
+
+void iTimerInfoList::siftDown(int index)
+{
+    const int count = static_cast<int>(m_timers.size());
+    TimerInfo* t = m_timers[index];
+    for (;;) {
+        int first = 4 * index + 1;
+        if (first >= count)
+            break;
+
+        int best = first;
+        int last = std::min(first + 4, count);
+        for (int child = first + 1; child < last; ++child) {
+            if (timerBefore(m_timers[child], m_timers[best]))
+                best = child;
         }
 
-        ++insert_it;
+        if (!timerBefore(m_timers[best], t))
+            break;
+
+        m_timers[index] = m_timers[best];
+        m_timers[index]->heapIndex = index;
+        index = best;
+    }
+
+    m_timers[index] = t;
+    t->heapIndex = index;
+}
+
+void iTimerInfoList::heapPush(TimerInfo* t)
+{
+    // equal timeouts fire in the order they were (re)inserted
+    t->sequence = m_sequence++;
+    m_timers.push_back(t);
+    siftUp(static_cast<int>(m_timers.size()) - 1);
+}
+
+void iTimerInfoList::heapUpdate(TimerInfo* t)
+{
+    t->sequence = m_sequence++;
+    siftDown(t->heapIndex);
+    siftUp(t->heapIndex);
+}
+
+void iTimerInfoList::heapRemove(TimerInfo* t)
+{
+    int index = t->heapIndex;
+    IX_ASSERT(index >= 0 && index < static_cast<int>(m_timers.size()) && m_timers[index] == t);
+
+    TimerInfo* last = m_timers.back();
+    m_timers.pop_back();
+    t->heapIndex = -1;
+    if (last == t)
+        return;
+
+    m_timers[index] = last;
+    last->heapIndex = index;
+    siftDown(index);
+    siftUp(last->heapIndex);
+}
+
+void iTimerInfoList::removeTimer(TimerInfo* t)
+{
+    if (t->id == m_firstTimerId)
+        m_firstTimerId = 0;
+
+    heapRemove(t);
+    m_timerIds.erase(t->id);
+
+    std::pair<TimerObjectMap::iterator, TimerObjectMap::iterator> range = m_timerObjects.equal_range(t->obj);
+    for (TimerObjectMap::iterator it = range.first; it != range.second; ++it) {
+        if (it->second == t) {
+            m_timerObjects.erase(it);
+            break;
+        }
     }
 
-    m_timers.push_back(ti);
-    return --m_timers.end();
+    // the destructor clears activateRef of a timer that is being fired
+    m_nodeAllocator.destroy(t);
+    m_nodeAllocator.deallocate(t, 1);
+}
+
+/*
+  Returns the earliest timer in the subtree at \a index that is not
+  being activated, active timers are rare so only their children are visited
+*/
+const iTimerInfoList::TimerInfo* iTimerInfoList::firstWaitingTimer(int index) const
+{
+    const int count = static_cast<int>(m_timers.size());
+    if (index >= count)
+        return IX_NULLPTR;
+
+    const TimerInfo* t = m_timers[index];
+    if (!t->activateRef)
+        return t;
+
+    const TimerInfo* best = IX_NULLPTR;
+    for (int child = 4 * index + 1; child < std::min(4 * index + 5, count); ++child) {
+        const TimerInfo* candidate = firstWaitingTimer(child);
+        if (candidate && (!best || timerBefore(candidate, best)))
+            best = candidate;
+    }
+
+    return best;
+}
+
+int iTimerInfoList::countExpired(int index, xint64 currentTime) const
+{
+    const int count = static_cast<int>(m_timers.size());
+    if ((index >= count) || (currentTime < m_timers[index]->timeout))
+        return 0;
+
+    int expired = 1;
+    for (int child = 4 * index + 1; child < std::min(4 * index + 5, count); ++child)
+        expired += countExpired(child, currentTime);
+
+    return expired;
 }
 
 static void calculateCoarseTimerTimeout(iTimerInfoList::TimerInfo &t, xint64 currentTime)
@@ -218,14 +346,7 @@ bool iTimerInfoList::timerWait(xint64 &tm)
     xint64 currentTime = updateCurrentTime();
 
     // Find first waiting timer not already active
-    const TimerInfo *t = IX_NULLPTR;
-    for (TimerContainer::const_iterator it = m_timers.begin(); it != m_timers.end(); ++it) {
-        if (!it->activateRef) {
-            t = &(*it);
-            break;
-        }
-    }
-
+    const TimerInfo *t = firstWaitingTimer(0);
     if (!t)
       return false;
 
@@ -248,19 +369,17 @@ bool iTimerInfoList::timerWait(xint64 &tm)
 xint64 iTimerInfoList::timerRemainingTime(int timerId)
 {
     xint64 currentTime = updateCurrentTime();
-    for (TimerContainer::const_iterator it = m_timers.begin(); it != m_timers.end(); ++it) {
-        if (it->id != timerId) continue;
-
-        // time to wait
-        if (currentTime < it->timeout) {
-            return it->timeout - currentTime;
-        } else {
-            return 0;
-        }
+    TimerIdMap::const_iterator it = m_timerIds.find(timerId);
+    if (it == m_timerIds.end()) {
+        ilog_warn("timer id %i not found", timerId);
+        return -1;
     }
 
-    ilog_warn("timer id %i not found", timerId);
-    return -1;
+    // time to wait
+    if (currentTime < it->second->timeout)
+        return it->second->timeout - currentTime;
+
+    return 0;
 }
 
 void iTimerInfoList::registerTimer(int timerId, xint64 interval, TimerType timerType, iObject *object, xintptr userdata)
@@ -306,54 +425,45 @@ void iTimerInfoList::registerTimer(int timerId, xint64 interval, TimerType timer
         break;
     }
 
-    timerInsert(t);
+    TimerIdMap::iterator exist = m_timerIds.find(timerId);
+    if (exist != m_timerIds.end()) {
+        ilog_warn("timer id ", timerId, " registered twice");
+        removeTimer(exist->second);
+    }
+
+    TimerInfo* node = m_nodeAllocator.allocate(1);
+    m_nodeAllocator.construct(node, t);
+    heapPush(node);
+    m_timerIds.insert(TimerIdMap::value_type(timerId, node));
+    m_timerObjects.insert(TimerObjectMap::value_type(object, node));
 }
 
 bool iTimerInfoList::unregisterTimer(int timerId)
 {
     iEventDispatcher::releaseTimerId(timerId);
-    TimerContainer::iterator it = m_timers.begin();
-    while (it != m_timers.end()) {
-        if (it->id == timerId) {
-            // found it
-            if (it->id == m_firstTimerInfo.id)
-                m_firstTimerInfo = TimerInfo();
-            if (it->activateRef)
-                *(it->activateRef) = IX_NULLPTR;
-
-            it = m_timers.erase(it);
-
-            return true;
-        }
-
-        ++it;
-    }
+    TimerIdMap::iterator it = m_timerIds.find(timerId);
+    if (it == m_timerIds.end())
+        return false; // id not found
 
-    // id not found
-    return false;
+    removeTimer(it->second);
+    return true;
 }
 
 bool iTimerInfoList::unregisterTimers(iObject *object, bool releaseId)
 {
-    if (m_timers.size() <= 0)
+    if (m_timers.empty())
         return false;
 
-    TimerContainer::iterator it = m_timers.begin();
-    while (it != m_timers.end()) {
-        if (it->obj == object) {
-            // object found
-            if (releaseId)
-                iEventDispatcher::releaseTimerId(it->id);
-            if (it->id == m_firstTimerInfo.id)
-                m_firstTimerInfo = TimerInfo();
-            if (it->activateRef)
-                *(it->activateRef) = IX_NULLPTR;
-
-            it = m_timers.erase(it);
-            continue;
-        }
+    std::pair<TimerObjectMap::iterator, TimerObjectMap::iterator> range = m_timerObjects.equal_range(object);
+    std::vector<TimerInfo*> timers;
+    for (TimerObjectMap::iterator it = range.first; it != range.second; ++it)
+        timers.push_back(it->second);
+
+    for (std::vector<TimerInfo*>::iterator it = timers.begin(); it != timers.end(); ++it) {
+        if (releaseId)
+            iEventDispatcher::releaseTimerId((*it)->id);
 
-        ++it;
+        removeTimer(*it);
     }
 
     return true;
@@ -361,12 +471,18 @@ bool iTimerInfoList::unregisterTimers(iObject *object, bool releaseId)
 
 std::list<iEventDispatcher::TimerInfo> iTimerInfoList::registeredTimers(iObject *object) const
 {
+    // report in firing order, like the timers are activated
+    std::vector<const TimerInfo*> timers;
+    std::pair<TimerObjectMap::const_iterator, TimerObjectMap::const_iterator> range = m_timerObjects.equal_range(object);
+    for (TimerObjectMap::const_iterator it = range.first; it != range.second; ++it)
+        timers.push_back(it->second);
+
+    std::sort(timers.begin(), timers.end(), &iTimerInfoList::timerBefore);
+
     std::list<iEventDispatcher::TimerInfo> list;
-    for (TimerContainer::const_iterator it = m_timers.begin(); it != m_timers.end(); ++it) {
-        if (it->obj == object) {
-            iEventDispatcher::TimerInfo insert(it->id, it->interval, it->timerType, it->userdata);
-            list.push_back(insert);
-        }
+    for (std::vector<const TimerInfo*>::const_iterator it = timers.begin(); it != timers.end(); ++it) {
+        iEventDispatcher::TimerInfo insert((*it)->id, (*it)->interval, (*it)->timerType, (*it)->userdata);
+        list.push_back(insert);
     }
 
     return list;
@@ -377,52 +493,44 @@ std::list<iEventDispatcher::TimerInfo> iTimerInfoList::registeredTimers(iObject
 */
 int iTimerInfoList::activateTimers()
 {
-    if (m_timers.size() <= 0)
+    if (m_timers.empty())
         return 0; // nothing to do
 
-    int n_act = 0, maxCount = 0;
-    m_firstTimerInfo = TimerInfo();
+    int n_act = 0;
+    m_firstTimerId = 0;
+    m_firstTimerInterval = 0;
 
     xint64 currentTime = updateCurrentTime();
 
     // Find out how many timer have expired
-    for (TimerContainer::const_iterator it = m_timers.begin(); it != m_timers.end(); ++it) {
-        if (currentTime < it->timeout)
-            break;
-        maxCount++;
-    }
+    int maxCount = countExpired(0, currentTime);
 
     //fire the timers.
     while (maxCount--) {
-        if (m_timers.size() <= 0)
+        if (m_timers.empty())
             break;
 
-        TimerInfo currentTimerInfo = m_timers.front();
-        if (currentTime < currentTimerInfo.timeout)
+        TimerInfo* tracker = m_timers.front();
+        if (currentTime < tracker->timeout)
             break; // no timer has expired
 
-        if (0 == m_firstTimerInfo.id) {
-            m_firstTimerInfo = currentTimerInfo;
-        } else if (m_firstTimerInfo.id == currentTimerInfo.id) {
+        if (0 == m_firstTimerId) {
+            m_firstTimerId = tracker->id;
+            m_firstTimerInterval = tracker->interval;
+        } else if (m_firstTimerId == tracker->id) {
             // avoid sending the same timer multiple times
             break;
-        } else if (currentTimerInfo.interval <= m_firstTimerInfo.interval) {
-            m_firstTimerInfo = currentTimerInfo;
+        } else if (tracker->interval <= m_firstTimerInterval) {
+            m_firstTimerId = tracker->id;
+            m_firstTimerInterval = tracker->interval;
         }
 
-        // remove from list
-        m_timers.pop_front();
-
-        // determine next timeout time
-        calculateNextTimeout(currentTimerInfo, currentTime);
-
-        // reinsert timer
-        TimerContainer::iterator cur_it = timerInsert(currentTimerInfo);
-        IX_ASSERT(cur_it != m_timers.end());
-        if (cur_it->interval > 0)
+        // determine next timeout time and move it behind the timers due with it
+        calculateNextTimeout(*tracker, currentTime);
+        heapUpdate(tracker);
+        if (tracker->interval > 0)
             n_act++;
 
-        TimerInfo *tracker = &(*cur_it);
         if (!tracker->activateRef) {
             // send event, but don't allow it to recurse
             tracker->activateRef = &tracker;
@@ -435,7 +543,8 @@ int iTimerInfoList::activateTimers()
         }
     }
 
-    m_firstTimerInfo = TimerInfo();
+    m_firstTimerId = 0;
+    m_firstTimerInterval = 0;
     return n_act;
 }
 
@@ -443,7 +552,7 @@ bool iTimerInfoList::existTimeout()
 {
     if (m_timers.empty())
         return false;
-    if (m_currentTime < m_timers.front().timeout)
+    if (m_currentTime < m_timers.front()->timeout)
         return false;
 
     return true;
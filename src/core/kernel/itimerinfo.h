@@ -10,6 +10,13 @@
 #ifndef ITIMERINFO_H
 #define ITIMERINFO_H
 
+#include <vector>
+#ifdef IX_HAVE_CXX11
+#include <unordered_map>
+#else
+#include <map>
+#endif
+
 #include <core/global/inamespace.h>
 #include <core/kernel/ieventdispatcher.h>
 #include "thread/icacheallocator.h"
@@ -30,8 +37,10 @@ public:
         xint64 timeout;  // - when to actually fire
         iObject *obj;     // - object to receive event
         TimerInfo **activateRef; // - ref from activateTimers
+        xuint64 sequence; // - insertion order, keeps equal timeouts FIFO
+        int heapIndex;    // - slot in the timer heap
 
-        TimerInfo() : id(0), userdata(0), timerType(PreciseTimer), interval(0), timeout(0), obj(IX_NULLPTR), activateRef(IX_NULLPTR) {}
+        TimerInfo() : id(0), userdata(0), timerType(PreciseTimer), interval(0), timeout(0), obj(IX_NULLPTR), activateRef(IX_NULLPTR), sequence(0), heapIndex(-1) {}
         ~TimerInfo() { id = 0; obj = IX_NULLPTR; if (activateRef) *activateRef = IX_NULLPTR; }
     };
 
@@ -54,17 +63,41 @@ public:
     bool existTimeout();
 
 private:
-    // Pool the timer-list nodes through the project's lock-free cache allocator,
-    // so arming/stopping a timer recycles a node instead of hitting the heap.
-    typedef std::list<TimerInfo, iCacheAllocator<TimerInfo> > TimerContainer;
-
-    TimerContainer::iterator timerInsert(const TimerInfo&);
+    // Timers live in a 4-ary min-heap ordered by (timeout, sequence). The nodes
+    // are pooled through the project's lock-free cache allocator and never move,
+    // so activateRef and the id/object indexes can point at them directly.
+    typedef std::vector<TimerInfo*> TimerHeap;
+    #ifdef IX_HAVE_CXX11
+    typedef std::unordered_map<int, TimerInfo*> TimerIdMap;
+    typedef std::unordered_multimap<iObject*, TimerInfo*> TimerObjectMap;
+    #else
+    typedef std::map<int, TimerInfo*> TimerIdMap;
+    typedef std::multimap<iObject*, TimerInfo*> TimerObjectMap;
+    #endif
+
+    static inline bool timerBefore(const TimerInfo* a, const TimerInfo* b)
+    { return (a->timeout < b->timeout) || ((a->timeout == b->timeout) && (a->sequence < b->sequence)); }
+
+    void heapPush(TimerInfo* t);
+    void heapRemove(TimerInfo* t);
+    void heapUpdate(TimerInfo* t);
+    void siftUp(int index);
+    void siftDown(int index);
+    void removeTimer(TimerInfo* t);
+    const TimerInfo* firstWaitingTimer(int index) const;
+    int countExpired(int index, xint64 currentTime) const;
 
     xint64 m_currentTime; // nanosecond
+    xuint64 m_sequence;
+
+    // state used by activateTimers() to avoid firing the same timer twice
+    int m_firstTimerId;
+    xint64 m_firstTimerInterval;
 
-    // state variables used by activateTimers()
-    TimerInfo m_firstTimerInfo;
-    TimerContainer m_timers;
+    TimerHeap m_timers;
+    TimerIdMap m_timerIds;
+    TimerObjectMap m_timerObjects;
+    iCacheAllocator<TimerInfo, 256> m_nodeAllocator;
 };
 
 } // namespace iShell
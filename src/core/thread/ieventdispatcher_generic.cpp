@@ -9,6 +9,9 @@
 /////////////////////////////////////////////////////////////////
 
 #include <limits>       // std::numeric_limits
+#if defined(_MSC_VER)
+#include <intrin.h>     // _mm_pause
+#endif
 
 #include "core/kernel/icoreapplication.h"
 #include "core/kernel/ieventsource.h"
@@ -16,6 +19,7 @@
 #include "core/thread/ithread.h"
 #include "core/io/ilog.h"
 #include "core/kernel/ipoll.h"
+#include "core/kernel/ideadlinetimer.h"
 
 #include "thread/ieventdispatcher_generic.h"
 #include "thread/ithread_p.h"
@@ -39,7 +43,7 @@ public:
             return false;
 
         const bool canWait = data->canWaitLocked();
-        return ((!canWait) || (serialNumber.value() != lastSerialNumber));
+        return ((!canWait) || (serialNumber.value() != lastSerialNumber) || data->postEventList.hasIncoming());
     }
 
     virtual bool check() IX_OVERRIDE
@@ -98,6 +102,14 @@ iEventDispatcher_generic::iEventDispatcher_generic(iObject *parent)
     , m_nextSeq(0)
     , m_postSource(IX_NULLPTR)
     , m_timerSource(IX_NULLPTR)
+    , m_busyPollBudget(0)
+    , m_spinBudgetSeen(0)
+    , m_spinWindow(0)
+    , m_spinWakeups(0)
+    , m_spinMisses(0)
+    , m_sleeps(0)
+    , m_spinNSecs(0)
+    , m_sleepNSecs(0)
 {
     m_wakeup.getPollfd(&m_wakeUpRec);
     addPoll(&m_wakeUpRec, IX_NULLPTR);
@@ -119,6 +131,17 @@ iEventDispatcher_generic::~iEventDispatcher_generic()
     m_postSource->deref();
     m_postSource = IX_NULLPTR;
 
+    for (size_t idx = 0; idx < m_pollReady.size(); ++idx)
+        m_pollReady[idx]->deref();
+    m_pollReady.clear();
+
+    while (!m_pollSources.empty()) {
+        iEventSource* source = *m_pollSources.begin();
+        int result = source->detach();
+        IX_ASSERT(result == 0);
+        (void) result;
+    }
+
     std::map<int, std::list<iEventSource*> >::iterator mapIt;
     for (mapIt = m_sources.begin(); mapIt != m_sources.end(); ++mapIt) {
         std::list<iEventSource*>& list = mapIt->second;
@@ -145,6 +168,34 @@ void iEventDispatcher_generic::interrupt()
     wakeUp();
 }
 
+bool iEventDispatcher_generic::supportsPollModes() const
+{
+    return iPoller::hasEdgeTriggered();
+}
+
+bool iEventDispatcher_generic::setBusyPollBudget(xint64 nsecs)
+{
+    m_busyPollBudget = std::max<xint64>(0, nsecs);
+    return true;
+}
+
+xint64 iEventDispatcher_generic::busyPollBudget() const
+{
+    return m_busyPollBudget.value();
+}
+
+iEventDispatcher::BusyPollStats iEventDispatcher_generic::busyPollStats() const
+{
+    BusyPollStats stats;
+    stats.spinWakeups = m_spinWakeups.value();
+    stats.spinMisses = m_spinMisses.value();
+    stats.sleeps = m_sleeps.value();
+    stats.spinNSecs = m_spinNSecs.value();
+    stats.sleepNSecs = m_sleepNSecs.value();
+    stats.window = m_spinWindow.value();
+    return stats;
+}
+
 bool iEventDispatcher_generic::processEvents(iEventLoop::ProcessEventsFlags flags, int maxPriority)
 {
     bool result = false;
@@ -223,8 +274,12 @@ int iEventDispatcher_generic::addEventSource(iEventSource* source)
     }
 
     source->ref();
-    std::list<iEventSource*>& item = m_sources[source->priority()];
-    item.push_back(source);
+    if (source->flags() & IX_EVENT_SOURCE_POLL_DRIVEN) {
+        m_pollSources.insert(source);
+    } else {
+        std::list<iEventSource*>& item = m_sources[source->priority()];
+        item.push_back(source);
+    }
     ++m_sourceCount;
     return 0;
 }
@@ -236,6 +291,12 @@ int iEventDispatcher_generic::removeEventSource(iEventSource* source)
         return -1;
     }
 
+    if (m_pollSources.erase(source) > 0) {
+        --m_sourceCount;
+        source->deref();
+        return 0;
+    }
+
     std::map<int, std::list<iEventSource*> >::iterator it;
     it = m_sources.find(source->priority());
     if (it == m_sources.end()) {
@@ -257,7 +318,7 @@ int iEventDispatcher_generic::removeEventSource(iEventSource* source)
     return 0;
 }
 
-int iEventDispatcher_generic::addPoll(iPollFD* fd, iEventSource* /*source*/)
+int iEventDispatcher_generic::addPoll(iPollFD* fd, iEventSource* source)
 {
     IX_ASSERT(fd);
     if (thread() != iThread::currentThread()) {
@@ -266,9 +327,23 @@ int iEventDispatcher_generic::addPoll(iPollFD* fd, iEventSource* /*source*/)
     }
 
     fd->revents = 0;
+    if (source)
+        m_pollOwners[fd] = source;
+
     return m_poller.addFd(fd);
 }
 
+static void erasePolls(std::vector<iPollFD*>* fds, iPollFD* fd)
+{
+    std::vector<iPollFD*>::iterator it = fds->begin();
+    while (it != fds->end()) {
+        if (*it == fd)
+            it = fds->erase(it);
+        else
+            ++it;
+    }
+}
+
 int iEventDispatcher_generic::removePoll(iPollFD* fd, iEventSource*)
 {
     if (thread() != iThread::currentThread()) {
@@ -276,11 +351,15 @@ int iEventDispatcher_generic::removePoll(iPollFD* fd, iEventSource*)
         return -1;
     }
 
+    m_pollOwners.erase(fd);
+    erasePolls(&m_parkedFds, fd);
     return m_poller.removeFd(fd);
 }
 
 int iEventDispatcher_generic::updatePoll(iPollFD* fd, iEventSource*)
 {
+    // updating re-enables a parked fd in the poller
+    erasePolls(&m_parkedFds, fd);
     return m_poller.updateFd(fd);
 }
 
@@ -296,6 +375,17 @@ bool iEventDispatcher_generic::eventPrepare(int* priority, xint64* timeout)
     int n_ready = 0;
     int current_priority = std::numeric_limits<int>::max();
 
+    /* poll driven sources have nothing to prepare, only the ones left ready count */
+    for (size_t idx = 0; idx < m_pollReady.size(); ++idx) {
+        iEventSource* source = m_pollReady[idx];
+        if (!source->isAttached())
+            continue;
+
+        ++n_ready;
+        current_timeout = 0;
+        current_priority = std::min(current_priority, source->priority());
+    }
+
     std::map<int, std::list<iEventSource*> >::const_iterator mapIt;
     for (mapIt = m_sources.begin(); mapIt != m_sources.end(); ++mapIt) {
         const int bucket_priority = mapIt->first;
@@ -348,6 +438,11 @@ bool iEventDispatcher_generic::eventPrepare(int* priority, xint64* timeout)
 }
 
 
+static void clearPollRevents(iPollFD* fd, void*)
+{
+    fd->revents = 0;
+}
+
 bool iEventDispatcher_generic::eventCheck(int max_priority, std::vector<iEventSource *> *pendingDispatches)
 {
     if (m_inCheckOrPrepare) {
@@ -357,13 +452,65 @@ bool iEventDispatcher_generic::eventCheck(int max_priority, std::vector<iEventSo
 
     if (m_wakeUpRec.revents) {
         m_wakeup.acknowledge();
+        m_wakeUpRec.revents = 0;
+    }
+
+    /* Poll driven sources: the ones left ready last time and the owners of the reported
+     * fds, so the cost follows the ready fds rather than the registered ones. The READY
+     * flag keeps a source with several fds from being checked twice. */
+    int poll_priority = std::numeric_limits<int>::max();
+    size_t kept = 0;
+    for (size_t idx = 0; idx < m_pollReady.size(); ++idx) {
+        iEventSource* source = m_pollReady[idx];
+        if (!source->isAttached()) {
+            source->setFlags(source->flags() & ~IX_EVENT_SOURCE_READY);
+            source->deref();
+            continue;
+        }
+
+        poll_priority = std::min(poll_priority, source->priority());
+        m_pollReady[kept++] = source;
+    }
+    m_pollReady.resize(kept);
+
+    const int nfds = m_poller.readyCount();
+    for (int idx = 0; idx < nfds; ++idx) {
+        iPollFD* fd = m_poller.readyFd(idx);
+        if (!fd || !fd->revents)
+            continue;
+
+        std::unordered_map<iPollFD*, iEventSource*>::const_iterator owner = m_pollOwners.find(fd);
+        if (owner == m_pollOwners.end())
+            continue;
+
+        iEventSource* source = owner->second;
+        if (!(source->flags() & IX_EVENT_SOURCE_POLL_DRIVEN) || (source->flags() & IX_EVENT_SOURCE_READY))
+            continue;
+
+        ++m_inCheckOrPrepare;
+        bool result = source->detectableCheck();
+        --m_inCheckOrPrepare;
+
+        if (!result) {
+            source->pollIterate(clearPollRevents, IX_NULLPTR);
+            continue;
+        }
+
+        source->setFlags(source->flags() | IX_EVENT_SOURCE_READY);
+        source->ref();
+        m_pollReady.push_back(source);
+        poll_priority = std::min(poll_priority, source->priority());
     }
 
+    /* The other sources are swept by priority, up to the first bucket holding a ready one */
     int n_ready = 0;
     std::map<int, std::list<iEventSource*> >::const_iterator mapIt;
     for (mapIt = m_sources.begin(); mapIt != m_sources.end(); ++mapIt) {
         const int bucket_priority = mapIt->first;
 
+        if (bucket_priority > poll_priority)
+            break;
+
         if ((n_ready > 0) && (bucket_priority > max_priority))
             break;
 
@@ -382,8 +529,10 @@ bool iEventDispatcher_generic::eventCheck(int max_priority, std::vector<iEventSo
             if (result)
                 source->setFlags(source->flags() | IX_EVENT_SOURCE_READY);
 
-            if (!(source->flags() & IX_EVENT_SOURCE_READY))
+            if (!(source->flags() & IX_EVENT_SOURCE_READY)) {
+                source->pollIterate(clearPollRevents, IX_NULLPTR);
                 continue;
+            }
 
             ++n_ready;
             max_priority = bucket_priority;
@@ -394,6 +543,20 @@ bool iEventDispatcher_generic::eventCheck(int max_priority, std::vector<iEventSo
         }
     }
 
+    /* Ready poll driven sources of the same priority go with them, the rest wait */
+    const int dispatch_priority = (n_ready > 0) ? max_priority : poll_priority;
+    kept = 0;
+    for (size_t idx = 0; idx < m_pollReady.size(); ++idx) {
+        iEventSource* source = m_pollReady[idx];
+        if (pendingDispatches && (source->priority() == dispatch_priority)) {
+            pendingDispatches->push_back(source);
+        } else {
+            m_pollReady[kept++] = source;
+        }
+        ++n_ready;
+    }
+    m_pollReady.resize(kept);
+
     return (n_ready > 0);
 }
 
@@ -423,29 +586,49 @@ void iEventDispatcher_generic::eventDispatch(std::vector<iEventSource *>* pendin
     }
 }
 
-static void disablePollFd(iPollFD* fd, void* userdata)
+void iEventDispatcher_generic::parkPollsAbove(int priority)
 {
-    static_cast<iPoller*>(userdata)->disableFd(fd);
-}
+    if (priority >= std::numeric_limits<int>::max())
+        return;
 
-static void enablePollFd(iPollFD* fd, void* userdata)
-{
-    static_cast<iPoller*>(userdata)->enableFd(fd);
+    /* Only reported fds are parked: an idle fd costs nothing whatever its priority */
+    const int nfds = m_poller.readyCount();
+    for (int idx = 0; idx < nfds; ++idx) {
+        iPollFD* fd = m_poller.readyFd(idx);
+        if (!fd || !fd->revents)
+            continue;
+
+        std::unordered_map<iPollFD*, iEventSource*>::const_iterator owner = m_pollOwners.find(fd);
+        if ((owner == m_pollOwners.end()) || (owner->second->priority() <= priority))
+            continue;
+
+        // already waiting for dispatch, keeps what was reported
+        if (owner->second->flags() & IX_EVENT_SOURCE_READY)
+            continue;
+
+        m_poller.disableFd(fd);
+        fd->revents = 0;
+        m_parkedFds.push_back(fd);
+    }
 }
 
-void iEventDispatcher_generic::forEachPollAbove(int priority, void (*fn)(iPollFD*, void*), void* userdata)
+void iEventDispatcher_generic::unparkPolls(int priority)
 {
-    if (priority >= std::numeric_limits<int>::max())
-        return;
+    size_t kept = 0;
+    for (size_t idx = 0; idx < m_parkedFds.size(); ++idx) {
+        iPollFD* fd = m_parkedFds[idx];
+        std::unordered_map<iPollFD*, iEventSource*>::const_iterator owner = m_pollOwners.find(fd);
+        if (owner == m_pollOwners.end())
+            continue;
 
-    std::map<int, std::list<iEventSource*> >::reverse_iterator it = m_sources.rbegin();
-    std::map<int, std::list<iEventSource*> >::reverse_iterator rend = m_sources.rend();
-    for (; it != rend && it->first > priority; ++it) {
-        std::list<iEventSource*>::iterator src = it->second.begin();
-        std::list<iEventSource*>::iterator srcEnd = it->second.end();
-        for (; src != srcEnd; ++src)
-            (*src)->pollIterate(fn, userdata);
+        if (owner->second->priority() > priority) {
+            m_parkedFds[kept++] = fd;
+            continue;
+        }
+
+        m_poller.enableFd(fd);
     }
+    m_parkedFds.resize(kept);
 }
 
 bool iEventDispatcher_generic::eventIterate(bool block, bool dispatch, int maxPriority)
@@ -462,11 +645,41 @@ bool iEventDispatcher_generic::eventIterate(bool block, bool dispatch, int maxPr
     if (maxPriority < max_priority)
         max_priority = maxPriority;
 
-    forEachPollAbove(max_priority, disablePollFd, &m_poller);
-    xint32 ret = m_poller.wait(timeout);
-    forEachPollAbove(max_priority, enablePollFd, &m_poller);
+    /* fds of sources below max_priority are parked once they are reported, not before */
+    unparkPolls(max_priority);
+
+    xint32 ret = 0;
+    const xint64 budget = m_busyPollBudget.value();
+    if ((timeout == 0) || (budget <= 0) || !busyPoll(budget, &timeout, &ret)) {
+        // posting only wakes a loop that announced it may block, so check the inbox once more after that
+        iThreadData* data = IX_NULLPTR;
+        if (timeout != 0) {
+            data = iThreadData::current();
+            data->parked = 1;
+            if (data->postEventList.hasIncoming() || !data->canWaitLocked())
+                timeout = 0;
+        }
+
+        xint64 sleepStart = 0;
+        if ((timeout != 0) && (budget > 0))
+            sleepStart = iDeadlineTimer::current(PreciseTimer).deadlineNSecs();
+
+        ret = m_poller.wait(timeout);
+
+        if (data)
+            data->parked = 0;
+
+        if (sleepStart > 0) {
+            xint64 slept = iDeadlineTimer::current(PreciseTimer).deadlineNSecs() - sleepStart;
+            ++m_sleeps;
+            m_sleepNSecs = m_sleepNSecs.value() + slept;
+            adaptSpinWindow(budget, ret > 0, slept);
+        }
+    }
+
     if (ret < 0)
         ilog_warn("poll error:", ret);
+    parkPollsAbove(max_priority);
 
     std::vector<iEventSource *> pendingDispatches;
     m_pendingDispatches.swap(pendingDispatches);
@@ -485,4 +698,83 @@ bool iEventDispatcher_generic::eventIterate(bool block, bool dispatch, int maxPr
     return some_ready;
 }
 
+// lets the sibling hardware thread run while we spin
+static inline void busyPollRelax()
+{
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+    __builtin_ia32_pause();
+#elif defined(__GNUC__) && (defined(__aarch64__) || defined(__arm__))
+    __asm__ __volatile__("yield" ::: "memory");
+#elif defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+    _mm_pause();
+#endif
+}
+
+/*
+  Poll without blocking for up to the adaptive spin window. Returns true if work
+  showed up so the loop must not sleep, otherwise timeout is reduced by the time
+  spent spinning. Posters see the loop as not parked and skip the wakeup write.
+*/
+bool iEventDispatcher_generic::busyPoll(xint64 budget, xint64* timeout, xint32* ret)
+{
+    if (budget != m_spinBudgetSeen) {
+        // a new budget starts from a full window
+        m_spinBudgetSeen = budget;
+        m_spinWindow = budget;
+    }
+
+    xint64 window = m_spinWindow.value();
+    if (window <= 0)
+        return false;
+    if ((*timeout > 0) && (*timeout < window))
+        window = *timeout;
+
+    iThreadData* data = iThreadData::current();
+    const xint64 start = iDeadlineTimer::current(PreciseTimer).deadlineNSecs();
+    xint64 elapsed = 0;
+    bool arrived = false;
+    for (;;) {
+        *ret = m_poller.wait(0);
+        arrived = (*ret != 0) || data->postEventList.hasIncoming() || !data->canWaitLocked();
+
+        elapsed = iDeadlineTimer::current(PreciseTimer).deadlineNSecs() - start;
+        if (arrived || (elapsed >= window))
+            break;
+
+        busyPollRelax();
+    }
+
+    m_spinNSecs = m_spinNSecs.value() + elapsed;
+    if (arrived) {
+        ++m_spinWakeups;
+        return true;
+    }
+
+    ++m_spinMisses;
+    if (*timeout > 0)
+        *timeout = std::max<xint64>(0, *timeout - elapsed);
+
+    return false;
+}
+
+/*
+  Halt-polling style adaption after every sleep: work that arrived within the
+  budget means a larger window would have caught it, a long or idle sleep means
+  the spin was wasted. Below 1/16 of the budget spinning stops until sleeps get
+  short again.
+*/
+void iEventDispatcher_generic::adaptSpinWindow(xint64 budget, bool arrived, xint64 slept)
+{
+    xint64 window = m_spinWindow.value();
+    if (arrived && (slept <= budget)) {
+        window = (window > 0) ? std::min(window * 2, budget) : std::max<xint64>(budget / 8, 1);
+    } else if (window > 0) {
+        window /= 2;
+        if (window < budget / 16)
+            window = 0;
+    }
+
+    m_spinWindow = window;
+}
+
 } // namespace iShell
@@ -11,6 +11,8 @@
 #define IEVENTDISPATCHER_GENERIC_H
 
 #include <vector>
+#include <unordered_map>
+#include <unordered_set>
 #include <core/kernel/ipoll.h>
 #include <core/thread/iwakeup.h>
 #include <core/thread/icondition.h>
@@ -44,6 +46,12 @@ public:
     virtual void wakeUp() IX_OVERRIDE;
     virtual void interrupt() IX_OVERRIDE;
 
+    virtual bool supportsPollModes() const IX_OVERRIDE;
+
+    virtual bool setBusyPollBudget(xint64 nsecs) IX_OVERRIDE;
+    virtual xint64 busyPollBudget() const IX_OVERRIDE;
+    virtual BusyPollStats busyPollStats() const IX_OVERRIDE;
+
 protected:
     virtual int addEventSource(iEventSource* source) IX_OVERRIDE;
     virtual int removeEventSource(iEventSource* source) IX_OVERRIDE;
@@ -53,7 +61,10 @@ protected:
 
 private:
     bool eventIterate(bool block, bool dispatch, int maxPriority);
-    void forEachPollAbove(int priority, void (*fn)(iPollFD*, void*), void* userdata);
+    bool busyPoll(xint64 budget, xint64* timeout, xint32* ret);
+    void adaptSpinWindow(xint64 budget, bool arrived, xint64 slept);
+    void parkPollsAbove(int priority);
+    void unparkPolls(int priority);
     bool eventPrepare(int* priority, xint64* timeout);
     bool eventCheck(int max_priority, std::vector<iEventSource *>* pendingDispatches);
     void eventDispatch(std::vector<iEventSource *>* pendingDispatches);
@@ -70,8 +81,27 @@ private:
     iTimerEventSource* m_timerSource;
     iPoller m_poller;
 
+    /// busy-poll budget from the user, the adaptive window stays within it
+    iAtomicCounter<xint64> m_busyPollBudget;
+    xint64 m_spinBudgetSeen;
+    iAtomicCounter<xint64> m_spinWindow;
+    iAtomicCounter<xint64> m_spinWakeups;
+    iAtomicCounter<xint64> m_spinMisses;
+    iAtomicCounter<xint64> m_sleeps;
+    iAtomicCounter<xint64> m_spinNSecs;
+    iAtomicCounter<xint64> m_sleepNSecs;
+
     std::vector<iEventSource *> m_pendingDispatches;
     std::map<int, std::list<iEventSource*> > m_sources;
+
+    /// IX_EVENT_SOURCE_POLL_DRIVEN sources are kept apart and never swept,
+    /// they are found from the fds the poller reports
+    std::unordered_set<iEventSource*> m_pollSources;
+    std::unordered_map<iPollFD*, iEventSource*> m_pollOwners;
+    /// poll driven sources found ready but not dispatched yet, one ref each
+    std::vector<iEventSource*> m_pollReady;
+    /// reported fds disabled while their priority is filtered out
+    std::vector<iPollFD*> m_parkedFds;
 };
 
 } // namespace iShell
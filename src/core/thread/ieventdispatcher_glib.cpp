@@ -150,11 +150,18 @@ static gboolean postEventSourcePrepare(GSource *s, gint *timeout)
     if (!timeout) timeout = &dummy;
     *timeout =  -1;
 
+    // posting only wakes a loop that may block: from prepare() until check()
+    data->parked = (timeout != &dummy) ? 1 : 0;
+
     const bool canWait = data->canWaitLocked();
     *timeout = canWait ? -1 : 0;
 
     GPostEventSource *source = reinterpret_cast<GPostEventSource *>(s);
-    return ((!canWait) || (source->serialNumber.value() != source->lastSerialNumber));
+    const bool ready = ((!canWait) || (source->serialNumber.value() != source->lastSerialNumber)
+                        || data->postEventList.hasIncoming());
+    if (ready)
+        data->parked = 0;
+    return ready;
 }
 
 static gboolean postEventSourceCheck(GSource *source)
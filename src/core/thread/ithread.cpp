@@ -25,6 +25,7 @@ iThreadData::iThreadData(int initialRefCount)
     , loopLevel(0)
     , scopeLevel(0)
     , canWait(1)
+    , parked(0)
     , m_ref(initialRefCount)
 {}
 
@@ -46,6 +47,51 @@ iThreadData::~iThreadData()
         if (event && pe.receiver) --pe.receiver->m_postedEvents;
         delete event;
     }
+
+    // not counted in m_postedEvents yet
+    iPostEvent pe;
+    iEvent* event = postEventList.takeIncoming();
+    while (event) {
+        event = iPostEventList::nextIncoming(event, &pe);
+        delete pe.event;
+    }
+}
+
+void iPostEventList::pushIncoming(iObject *receiver, iEvent *event, int priority)
+{
+    event->m_postReceiver = receiver;
+    event->m_postPriority = priority;
+    for (;;) {
+        iEvent* head = incoming.load();
+        event->m_nextPosted = head;
+        if (incoming.testAndSet(head, event))
+            break;
+    }
+}
+
+iEvent* iPostEventList::takeIncoming()
+{
+    // the whole stack is taken at once, so a push never races with a pop
+    iEvent* event = incoming.fetchAndStore(IX_NULLPTR);
+    iEvent* ordered = IX_NULLPTR;
+    while (event) {
+        iEvent* next = event->m_nextPosted;
+        event->m_nextPosted = ordered;
+        ordered = event;
+        event = next;
+    }
+
+    return ordered;
+}
+
+iEvent* iPostEventList::nextIncoming(iEvent *event, iPostEvent *entry)
+{
+    iEvent* next = event->m_nextPosted;
+    event->m_nextPosted = IX_NULLPTR;
+    entry->receiver = event->m_postReceiver;
+    entry->event = event;
+    entry->priority = event->m_postPriority;
+    return next;
 }
 
 bool iThreadData::deref()
@@ -62,7 +62,19 @@ public:
 
     iMutex mutex;
 
-    inline iPostEventList() : std::list<iPostEvent, iCacheAllocator< iPostEvent > >(), recursion(0), startOffset(0), insertionOffset(0) { }
+    // events posted since the last takeIncoming(), newest first: any thread pushes
+    // without the mutex, its holder takes them all and sorts them in with addEvent()
+    iAtomicPointer<iEvent> incoming;
+    // producers between choosing this list and pushing to it, see iObject::moveToThread()
+    iAtomicCounter<int> pushing;
+
+    inline iPostEventList() : std::list<iPostEvent, iCacheAllocator< iPostEvent > >(), recursion(0), startOffset(0), insertionOffset(0), pushing(0) { }
+
+    inline bool hasIncoming() const { return IX_NULLPTR != incoming.load(); }
+    void pushIncoming(iObject *receiver, iEvent *event, int priority);
+    // the pushed events in push order, walk them with nextIncoming()
+    iEvent* takeIncoming();
+    static iEvent* nextIncoming(iEvent *event, iPostEvent *entry);
 
     void addEvent(const iPostEvent &ev) {
         int priority = ev.priority;
@@ -115,6 +127,7 @@ public:
     iAtomicCounter<xintptr>         threadHd;
     iAtomicPointer<iThread>         thread;
     iAtomicCounter<int>             canWait;
+    iAtomicCounter<int>             parked;     ///< dispatcher may block, posting has to wake it
 
     #if __cplusplus >= 201103L
     typedef std::unordered_map<xuintptr, void*> TLSMap;
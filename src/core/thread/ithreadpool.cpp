@@ -0,0 +1,432 @@
+/////////////////////////////////////////////////////////////////
+/// Copyright 2018-2020
+/// All rights reserved.
+/////////////////////////////////////////////////////////////////
+/// @file    ithreadpool.cpp
+/// @brief   provides a work-stealing pool of worker threads and futures
+/// @version 1.0
+/// @author  ncjiakechong@gmail.com
+/////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+
+#include "core/thread/ithreadpool.h"
+#include "core/thread/ithread.h"
+#include "core/thread/iatomicpointer.h"
+#include "core/kernel/ideadlinetimer.h"
+
+#ifdef IX_OS_WIN
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace iShell {
+
+/// Chase-Lev work-stealing deque. Only the owning worker pushes and pops at
+/// the bottom; any thread may steal from the top. All index accesses are
+/// sequentially consistent, which covers the fences the algorithm needs.
+/// Arrays replaced by grow() stay alive until the deque is destroyed since
+/// a thief may still be reading from them.
+class iWorkStealingDeque
+{
+public:
+    iWorkStealingDeque() : m_top(0), m_bottom(0), m_array(new Array(64)) {}
+    ~iWorkStealingDeque()
+    {
+        delete m_array.load();
+        for (std::vector<Array*>::iterator it = m_retired.begin(); it != m_retired.end(); ++it)
+            delete *it;
+    }
+
+    bool isEmpty() const { return m_bottom.value() <= m_top.value(); }
+
+    void push(iRunnable* task)
+    {
+        xint64 b = m_bottom.value();
+        xint64 t = m_top.value();
+        Array* a = m_array.load();
+        if (b - t > a->capacity - 1) {
+            a = a->grow(t, b);
+            m_retired.push_back(m_array.fetchAndStore(a));
+        }
+
+        a->put(b, task);
+        m_bottom = b + 1;
+    }
+
+    iRunnable* pop()
+    {
+        xint64 b = m_bottom.value() - 1;
+        Array* a = m_array.load();
+        m_bottom = b;
+        xint64 t = m_top.value();
+        if (t > b) {
+            m_bottom = b + 1;
+            return IX_NULLPTR;
+        }
+
+        iRunnable* task = a->get(b);
+        if (t == b) {
+            // last element: race the thieves for it
+            if (!m_top.testAndSet(t, t + 1))
+                task = IX_NULLPTR;
+            m_bottom = b + 1;
+        }
+        return task;
+    }
+
+    iRunnable* steal()
+    {
+        xint64 t = m_top.value();
+        xint64 b = m_bottom.value();
+        if (t >= b)
+            return IX_NULLPTR;
+
+        iRunnable* task = m_array.load()->get(t);
+        if (!m_top.testAndSet(t, t + 1))
+            return IX_NULLPTR;
+        return task;
+    }
+
+private:
+    struct Array
+    {
+        explicit Array(xint64 cap) : capacity(cap), slots(new iAtomicPointer<iRunnable>[cap]) {}
+        ~Array() { delete[] slots; }
+
+        iRunnable* get(xint64 i) const { return slots[i & (capacity - 1)].load(); }
+        void put(xint64 i, iRunnable* task) { slots[i & (capacity - 1)].store(task); }
+
+        Array* grow(xint64 top, xint64 bottom) const
+        {
+            Array* a = new Array(capacity * 2);
+            for (xint64 i = top; i < bottom; ++i)
+                a->put(i, get(i));
+            return a;
+        }
+
+        xint64 capacity;
+        iAtomicPointer<iRunnable>* slots;
+    };
+
+    iAtomicCounter<xint64> m_top;
+    iAtomicCounter<xint64> m_bottom;
+    iAtomicPointer<Array> m_array;
+    std::vector<Array*> m_retired;
+
+    IX_DISABLE_COPY(iWorkStealingDeque)
+};
+
+class iThreadPoolWorker : public iThread
+{
+    IX_OBJECT(iThreadPoolWorker)
+public:
+    iThreadPoolWorker(iThreadPool* pool, int index)
+        : m_pool(pool), m_index(index), m_seed((uint)index * 2654435761u + 1) {}
+
+    uint nextVictim()
+    {
+        // xorshift, only used to spread steal attempts
+        m_seed ^= m_seed << 13;
+        m_seed ^= m_seed >> 17;
+        m_seed ^= m_seed << 5;
+        return m_seed;
+    }
+
+    iThreadPool* m_pool;
+    int m_index;
+    uint m_seed;
+    iWorkStealingDeque m_deque;
+
+protected:
+    void run() IX_OVERRIDE;
+};
+
+void iThreadPoolWorker::run()
+{
+    iThreadPool* pool = m_pool;
+    for (;;) {
+        iRunnable* task = pool->takeTask(this);
+        if (task) {
+            pool->execute(task);
+            continue;
+        }
+
+        iMutex::ScopedLock lock(pool->m_mutex);
+        if (pool->m_stopping)
+            break;
+
+        // Announce idleness before the final check; start() bumps m_queued
+        // before reading m_idle, so one of the two sides sees the other.
+        ++pool->m_idle;
+        if (pool->m_queued.value() <= 0)
+            pool->m_wakeCond.wait(pool->m_mutex, -1);
+        --pool->m_idle;
+    }
+}
+
+iRunnable::~iRunnable()
+{}
+
+iFutureStateBase::iFutureStateBase(iThreadPool* pool)
+    : m_ref(0)
+    , m_pool(pool)
+    , m_finished(false)
+{}
+
+iFutureStateBase::~iFutureStateBase()
+{
+    for (std::list<iRunnable*>::iterator it = m_continuations.begin(); it != m_continuations.end(); ++it) {
+        if ((*it)->autoDelete())
+            delete *it;
+    }
+}
+
+bool iFutureStateBase::isFinished() const
+{
+    iMutex::ScopedLock lock(m_mutex);
+    return m_finished;
+}
+
+void iFutureStateBase::waitForFinished()
+{
+    while (!isFinished()) {
+        if (m_pool && m_pool->tryRunPendingTask())
+            continue;
+
+        iMutex::ScopedLock lock(m_mutex);
+        if (!m_finished)
+            m_cond.wait(m_mutex, -1);
+    }
+}
+
+void iFutureStateBase::reportFinished()
+{
+    std::list<iRunnable*> continuations;
+    {
+        iMutex::ScopedLock lock(m_mutex);
+        m_finished = true;
+        continuations.swap(m_continuations);
+        m_cond.broadcast();
+    }
+
+    for (std::list<iRunnable*>::iterator it = continuations.begin(); it != continuations.end(); ++it) {
+        bool autoDelete = (*it)->autoDelete();
+        (*it)->run();
+        if (autoDelete)
+            delete *it;
+    }
+}
+
+void iFutureStateBase::addContinuation(iRunnable* continuation)
+{
+    {
+        iMutex::ScopedLock lock(m_mutex);
+        if (!m_finished) {
+            m_continuations.push_back(continuation);
+            return;
+        }
+    }
+
+    bool autoDelete = continuation->autoDelete();
+    continuation->run();
+    if (autoDelete)
+        delete continuation;
+}
+
+iThreadPool::iThreadPool(int maxThreadCount, iObject* parent)
+    : iObject(parent)
+    , m_queued(0)
+    , m_pending(0)
+    , m_active(0)
+    , m_idle(0)
+    , m_stopping(false)
+{
+    if (maxThreadCount < 1)
+        maxThreadCount = idealThreadCount();
+
+    m_workers.reserve(maxThreadCount);
+    for (int i = 0; i < maxThreadCount; ++i)
+        m_workers.push_back(new iThreadPoolWorker(this, i));
+
+    // workers only start once the vector is complete, since thieves walk it
+    for (int i = 0; i < maxThreadCount; ++i)
+        m_workers[i]->start();
+}
+
+iThreadPool::~iThreadPool()
+{
+    waitForDone();
+
+    {
+        iMutex::ScopedLock lock(m_mutex);
+        m_stopping = true;
+        m_wakeCond.broadcast();
+    }
+
+    for (std::vector<iThreadPoolWorker*>::iterator it = m_workers.begin(); it != m_workers.end(); ++it) {
+        (*it)->wait();
+        delete *it;
+    }
+}
+
+iThreadPool* iThreadPool::globalInstance()
+{
+    static iMutex s_lock;
+    // leaked on purpose, the workers run until the process exits
+    static iThreadPool* s_instance = IX_NULLPTR;
+
+    iMutex::ScopedLock lock(s_lock);
+    if (!s_instance)
+        s_instance = new iThreadPool();
+
+    return s_instance;
+}
+
+int iThreadPool::idealThreadCount()
+{
+    int cores = 1;
+    #ifdef IX_OS_WIN
+    SYSTEM_INFO sysinfo;
+    GetSystemInfo(&sysinfo);
+    cores = (int)sysinfo.dwNumberOfProcessors;
+    #elif defined(_SC_NPROCESSORS_ONLN)
+    cores = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    #endif
+
+    return std::max(cores, 1);
+}
+
+iThreadPoolWorker* iThreadPool::currentWorker() const
+{
+    iThreadPoolWorker* worker = iobject_cast<iThreadPoolWorker*>(iThread::currentThread());
+    if (worker && worker->m_pool == this)
+        return worker;
+
+    return IX_NULLPTR;
+}
+
+void iThreadPool::start(iRunnable* runnable)
+{
+    IX_CHECK_PTR(runnable);
+    ++m_pending;
+    iThreadPoolWorker* self = currentWorker();
+    if (self) {
+        self->m_deque.push(runnable);
+    } else {
+        iMutex::ScopedLock lock(m_mutex);
+        m_injected.push_back(runnable);
+    }
+
+    ++m_queued;
+    if (m_idle.value() > 0) {
+        iMutex::ScopedLock lock(m_mutex);
+        m_wakeCond.signal();
+    }
+}
+
+iRunnable* iThreadPool::takeTask(iThreadPoolWorker* self)
+{
+    if (m_queued.value() <= 0)
+        return IX_NULLPTR;
+
+    iRunnable* task = IX_NULLPTR;
+    if (self)
+        task = self->m_deque.pop();
+
+    if (!task) {
+        iMutex::ScopedLock lock(m_mutex);
+        if (!m_injected.empty()) {
+            task = m_injected.front();
+            m_injected.pop_front();
+        }
+    }
+
+    if (!task) {
+        int count = (int)m_workers.size();
+        uint start = self ? self->nextVictim() : (uint)iThread::currentThreadId();
+        for (int i = 0; !task && i < count; ++i) {
+            iThreadPoolWorker* victim = m_workers[(start + (uint)i) % (uint)count];
+            if (victim != self)
+                task = victim->m_deque.steal();
+        }
+    }
+
+    if (task)
+        --m_queued;
+
+    return task;
+}
+
+void iThreadPool::execute(iRunnable* task)
+{
+    ++m_active;
+    bool autoDelete = task->autoDelete();
+    task->run();
+    if (autoDelete)
+        delete task;
+    --m_active;
+
+    if (--m_pending == 0) {
+        iMutex::ScopedLock lock(m_mutex);
+        m_doneCond.broadcast();
+    }
+}
+
+bool iThreadPool::tryRunPendingTask()
+{
+    iRunnable* task = takeTask(currentWorker());
+    if (!task)
+        return false;
+
+    execute(task);
+    return true;
+}
+
+bool iThreadPool::waitForDone(int msecs)
+{
+    IX_ASSERT(!currentWorker());
+    iDeadlineTimer timer(std::max(msecs, -1));
+    for (;;) {
+        while (tryRunPendingTask()) {}
+
+        iMutex::ScopedLock lock(m_mutex);
+        if (m_pending.value() <= 0)
+            return true;
+
+        xint64 remaining = timer.remainingTime();
+        if (remaining == 0)
+            return false;
+
+        m_doneCond.wait(m_mutex, (long)remaining);
+    }
+}
+
+int iThreadPool::chunkCount(xint64 count, xint64 grain) const
+{
+    xint64 chunks = (grain > 0) ? (count + grain - 1) / grain
+                                : std::min(count, (xint64)maxThreadCount() * 4);
+
+    return (int)std::max<xint64>(1, std::min<xint64>(chunks, 0x7fffffff));
+}
+
+void iThreadPool::runChunks(ParallelChunk* const* chunks, int count)
+{
+    iSemaphore latch;
+    for (int i = 0; i < count; ++i)
+        chunks[i]->latch = &latch;
+
+    for (int i = 1; i < count; ++i)
+        start(chunks[i]);
+
+    chunks[0]->run();
+    while (!latch.tryAcquire(count)) {
+        if (!tryRunPendingTask()) {
+            latch.acquire(count);
+            break;
+        }
+    }
+}
+
+} // namespace iShell
@@ -140,12 +140,18 @@ void iGstAppSrc::pushDataToAppSrc()
 
         if (size) {
             xint64 bufferOffset = m_stream->pos();
-            iByteArray* bufferData = new iByteArray(m_stream->read(size));
-            xint64 bytesRead = bufferData->size();
-
-            GstBuffer* buffer = gst_buffer_new_wrapped_full(GST_MEMORY_FLAG_READONLY,
-                                bufferData->data(), bytesRead, 0, bytesRead,
-                                bufferData, freeBuffer);
+            // Hand the stream's segments to GStreamer as they are, one wrapped
+            // memory each, instead of coalescing them into a single copy
+            std::list<iByteArray> chunks;
+            xint64 bytesRead = std::max<xint64>(m_stream->readChunks(chunks, size), 0);
+
+            GstBuffer* buffer = gst_buffer_new();
+            for (std::list<iByteArray>::const_iterator it = chunks.begin(); it != chunks.end(); ++it) {
+                iByteArray* bufferData = new iByteArray(*it);
+                gst_buffer_append_memory(buffer, gst_memory_new_wrapped(GST_MEMORY_FLAG_READONLY,
+                                         const_cast<char*>(bufferData->constData()), bufferData->size(),
+                                         0, bufferData->size(), bufferData, freeBuffer));
+            }
             buffer->offset = bufferOffset;
             buffer->offset_end =  buffer->offset + bytesRead - 1;
 
@@ -169,6 +175,8 @@ void iGstAppSrc::pushDataToAppSrc()
                     ilog_warn("appsrc: push buffer resend");
                 }
                 #endif
+            } else {
+                gst_buffer_unref(buffer);
             }
         } else if (!m_sequential) {
             sendEOS();
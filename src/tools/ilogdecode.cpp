@@ -0,0 +1,28 @@
+/////////////////////////////////////////////////////////////////
+/// Copyright 2018-2020
+/// All rights reserved.
+/////////////////////////////////////////////////////////////////
+/// @file    ilogdecode.cpp
+/// @brief   renders a binary log written by iBinaryLog as text
+/// @version 1.0
+/// @author  ncjiakechong@gmail.com
+/////////////////////////////////////////////////////////////////
+
+#include <cstdio>
+
+#include <core/io/ibinarylog.h>
+
+int main(int argc, char** argv)
+{
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s <binary log>\n", argv[0]);
+        return 2;
+    }
+
+    if (iShell::iBinaryLog::decode(argv[1], 1) < 0) {
+        fprintf(stderr, "%s: not a binary log or corrupt\n", argv[1]);
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,173 @@
+/**
+ * @file test_iincpoolcache.cpp
+ * @brief Unit tests for iINCPoolCache (per-client segment reuse)
+ */
+
+#include <gtest/gtest.h>
+#include "inc/iincpoolcache.h"
+#include <core/inc/iincserverconfig.h>
+#include <core/io/imemblock.h>
+#include <core/io/isharemem.h>
+#include <core/inc/iinccontextconfig.h>
+
+using namespace iShell;
+
+namespace {
+
+const size_t kPoolSize = 256 * 1024;
+
+} // namespace
+
+TEST(INCPoolCacheTest, ConfigDefaults) {
+    iINCServerConfig config;
+    EXPECT_EQ(4, config.sharedMemoryCacheSize());
+    EXPECT_FALSE(config.sharedMemoryPrefault());
+    config.setSharedMemoryCacheSize(0);
+    config.setSharedMemoryPrefault(true);
+    EXPECT_EQ(0, config.sharedMemoryCacheSize());
+    EXPECT_TRUE(config.dump().contains(iString("SHM Prefault: true")));
+}
+
+TEST(INCPoolCacheTest, BackingOptionsFromConfig) {
+    iINCServerConfig server;
+    EXPECT_FALSE(server.sharedMemoryHugePages());
+    EXPECT_EQ(-1, server.sharedMemoryNumaNode());
+    EXPECT_EQ(0u, server.sharedMemoryOptions());
+    server.setSharedMemoryPrefault(true);
+    server.setSharedMemoryHugePages(true);
+    server.setSharedMemoryNumaNode(0);
+    EXPECT_EQ(uint(iShareMem::CreatePopulate | iShareMem::CreateHugePages), server.sharedMemoryOptions());
+    EXPECT_TRUE(server.dump().contains(iString("SHM NUMA Node: 0")));
+
+    iINCContextConfig context;
+    EXPECT_EQ(0u, context.sharedMemoryOptions());
+    EXPECT_EQ(-1, context.sharedMemoryNumaNode());
+    context.setSharedMemoryHugePages(true);
+    EXPECT_EQ(uint(iShareMem::CreateHugePages), context.sharedMemoryOptions());
+
+    // Huge pages fall back to normal ones when none are reserved
+    iINCPoolCache cache(1, server.sharedMemoryOptions(), server.sharedMemoryNumaNode());
+    iSharedDataPointer<iMemPool> pool = cache.acquire(iByteArray("client"), "ix-test", MEMTYPE_PRIVATE, kPoolSize);
+    ASSERT_TRUE(pool);
+    iSharedDataPointer<iMemBlock> block(iMemBlock::new4Pool(pool.data(), 1024));
+    EXPECT_TRUE(block);
+}
+
+TEST(INCPoolCacheTest, ReleasedPoolIsReusedBySameClient) {
+    iINCPoolCache cache(2);
+
+    iSharedDataPointer<iMemPool> pool = cache.acquire(iByteArray("client"), "ix-test", MEMTYPE_PRIVATE, kPoolSize);
+    ASSERT_TRUE(pool);
+    EXPECT_TRUE(pool->isPerClient());
+    const iMemPool* first = pool.data();
+
+    cache.release(pool);
+    pool.reset();
+    EXPECT_EQ(1u, cache.parked());
+
+    pool = cache.acquire(iByteArray("client"), "ix-test", MEMTYPE_PRIVATE, kPoolSize);
+    ASSERT_TRUE(pool);
+    EXPECT_EQ(first, pool.data());
+    EXPECT_EQ(0u, cache.parked());
+    EXPECT_EQ(1u, cache.stats().hits);
+    EXPECT_EQ(1u, cache.stats().misses);
+}
+
+TEST(INCPoolCacheTest, KeyMismatchCreatesNewPool) {
+    iINCPoolCache cache(4);
+
+    iSharedDataPointer<iMemPool> pool = cache.acquire(iByteArray("clientA"), "ix-test", MEMTYPE_PRIVATE, kPoolSize);
+    ASSERT_TRUE(pool);
+    cache.release(pool);
+    pool.reset();
+
+    // Segments never move between clients, nor between sizes of the same client
+    iSharedDataPointer<iMemPool> other = cache.acquire(iByteArray("clientB"), "ix-test", MEMTYPE_PRIVATE, kPoolSize);
+    ASSERT_TRUE(other);
+    iSharedDataPointer<iMemPool> bigger = cache.acquire(iByteArray("clientA"), "ix-test", MEMTYPE_PRIVATE, 2 * kPoolSize);
+    ASSERT_TRUE(bigger);
+    EXPECT_EQ(0u, cache.stats().hits);
+    EXPECT_EQ(3u, cache.stats().misses);
+    EXPECT_EQ(1u, cache.parked());
+}
+
+TEST(INCPoolCacheTest, BusyPoolIsNotReused) {
+    iINCPoolCache cache(4);
+
+    iSharedDataPointer<iMemPool> pool = cache.acquire(iByteArray("client"), "ix-test", MEMTYPE_PRIVATE, kPoolSize);
+    ASSERT_TRUE(pool);
+    cache.release(pool);
+
+    // A block still references the parked pool
+    iSharedDataPointer<iMemBlock> block(iMemBlock::new4Pool(pool.data(), 128));
+    ASSERT_TRUE(block);
+    pool.reset();
+
+    iSharedDataPointer<iMemPool> next = cache.acquire(iByteArray("client"), "ix-test", MEMTYPE_PRIVATE, kPoolSize);
+    ASSERT_TRUE(next);
+    EXPECT_NE(block->pool().data(), next.data());
+    EXPECT_EQ(0u, cache.stats().hits);
+}
+
+TEST(INCPoolCacheTest, CapacityBoundsParkedPools) {
+    iINCPoolCache cache(1);
+
+    iSharedDataPointer<iMemPool> a = cache.acquire(iByteArray("a"), "ix-test", MEMTYPE_PRIVATE, kPoolSize);
+    iSharedDataPointer<iMemPool> b = cache.acquire(iByteArray("b"), "ix-test", MEMTYPE_PRIVATE, kPoolSize);
+    ASSERT_TRUE(a);
+    ASSERT_TRUE(b);
+    cache.release(a);
+    cache.release(b);
+    EXPECT_EQ(1u, cache.parked());
+    EXPECT_EQ(1u, cache.stats().evictions);
+
+    // Unknown pools and a disabled cache park nothing
+    iINCPoolCache disabled(0);
+    iSharedDataPointer<iMemPool> c = disabled.acquire(iByteArray("c"), "ix-test", MEMTYPE_PRIVATE, kPoolSize);
+    ASSERT_TRUE(c);
+    disabled.release(c);
+    disabled.release(a);
+    EXPECT_EQ(0u, disabled.parked());
+}
+
+TEST(INCPoolCacheTest, UnauthenticatedClientIsNeverParked) {
+    iINCPoolCache cache(2);
+
+    // No kernel-checked identity: the segment must not outlive its connection
+    iSharedDataPointer<iMemPool> pool = cache.acquire(iByteArray(), "ix-test", MEMTYPE_PRIVATE, kPoolSize);
+    ASSERT_TRUE(pool);
+    cache.release(pool);
+    pool.reset();
+    EXPECT_EQ(0u, cache.parked());
+
+    pool = cache.acquire(iByteArray(), "ix-test", MEMTYPE_PRIVATE, kPoolSize);
+    ASSERT_TRUE(pool);
+    EXPECT_EQ(0u, cache.stats().hits);
+    EXPECT_EQ(2u, cache.stats().misses);
+}
+
+TEST(INCPoolCacheTest, PrefaultedSharedSegmentKeepsDescriptor) {
+    iINCPoolCache cache(2, iShareMem::CreatePopulate);
+
+    iSharedDataPointer<iMemPool> pool = cache.acquire(iByteArray("client"), "ix-test", MEMTYPE_SHARED_MEMFD, kPoolSize);
+    if (!pool) pool = cache.acquire(iByteArray("client"), "ix-test", MEMTYPE_SHARED_POSIX, kPoolSize);
+    if (!pool) GTEST_SKIP() << "No shared memory support";
+
+    const MemType type = pool->type();
+    const int fd = pool->fd();
+    iSharedDataPointer<iMemBlock> block(iMemBlock::new4Pool(pool.data(), 1024));
+    ASSERT_TRUE(block);
+    block.reset();
+
+    cache.release(pool);
+    pool.reset();
+
+    // Reuse hands out the same mapping, memfd segments keep their descriptor for SCM_RIGHTS
+    pool = cache.acquire(iByteArray("client"), "ix-test", type, kPoolSize);
+    ASSERT_TRUE(pool);
+    EXPECT_EQ(1u, cache.stats().hits);
+    EXPECT_EQ(fd, pool->fd());
+
+    block = iMemBlock::new4Pool(pool.data(), 1024);
+    EXPECT_TRUE(block);
+}
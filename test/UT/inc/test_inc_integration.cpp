@@ -27,6 +27,7 @@
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <unistd.h>
+#include <atomic>
 
 #define ILOG_TAG "INCIntegrationTest"
 
@@ -45,10 +46,14 @@ public:
     iString lastMethodName;
     iByteArray lastMethodArgs;
     iINCConnection* lastConnection = nullptr;  // Store last connection for testing
+    int fastCallCount = 0;  // Calls dispatched to the registered "echo.fast" handler
+    xuint32 fastMethodId = 0;
+    std::atomic<int> methodCallsById{0};  // METHOD_CALL frames that carried INC_MSG_FLAG_METHOD_ID
 
     TestEchoServer(iObject* parent = IX_NULLPTR)
         : iINCServer(iString("TestEchoServer"), parent)
     {
+        fastMethodId = registerMethod(iString("echo.fast"), &TestEchoServer::handleFastEcho, this);
     }
 
 public:
@@ -58,6 +63,23 @@ public:
     }
 
 protected:
+    void onConnectionMessageReceived(iINCConnection* conn, const iINCMessage& msg) override
+    {
+        if ((INC_MSG_METHOD_CALL == msg.type()) && (msg.flags() & INC_MSG_FLAG_METHOD_ID))
+            methodCallsById++;
+        iINCServer::onConnectionMessageReceived(conn, msg);
+    }
+
+    static void handleFastEcho(iINCServer* server, iINCConnection* conn, xuint32 seqNum,
+                               xuint16 version, const iByteArray& args, void* userData)
+    {
+        IX_UNUSED(server);
+        IX_UNUSED(version);
+        TestEchoServer* self = static_cast<TestEchoServer*>(userData);
+        self->fastCallCount++;
+        self->sendMethodReply(conn, seqNum, INC_OK, args);
+    }
+
     void handleMethod(iINCConnection* conn, xuint32 seqNum, const iString& method,
                      xuint16 version, const iByteArray& args) override
     {
@@ -66,10 +88,21 @@ protected:
         lastMethodArgs = args;
         lastConnection = conn;  // Store for testing
 
+        // Reply later from the server thread, exercises asynchronous replies
+        if (method == iString("echo.deferred")) {
+            iObject::invokeMethod(this, &TestEchoServer::replyDeferred, conn, seqNum, args, iShell::QueuedConnection);
+            return;
+        }
+
         // Echo back the args as result
         sendMethodReply(conn, seqNum, INC_OK, args);
     }
 
+    void replyDeferred(iINCConnection* conn, xuint32 seqNum, iByteArray args)
+    {
+        sendMethodReply(conn, seqNum, INC_OK, args);
+    }
+
     void handleBinaryData(iINCConnection* conn, xuint32 channelId,
                           xuint32 seqNum, bool broadcast, xint64 pos,
                           const iByteArray& data) override
@@ -100,6 +133,11 @@ public:
         return callMethod(method, version, args, timeout);
     }
 
+    iSharedDataPointer<iINCOperation> callBatch(const std::vector<MethodCall>& calls, xint64 timeout = 30000)
+    {
+        return callMethods(calls, timeout);
+    }
+
     // Slot for connecting with cached URL
     void doConnect() {
         if (!m_cachedUrl.isEmpty()) {
@@ -145,6 +183,8 @@ public:
     bool eventReceived = false;  // Track if event was received
     iString receivedEventName;  // Store received event name
     iByteArray receivedEventData;  // Store received event data
+    bool batchDecoded = false;  // batchResults() accepted the batch reply
+    std::vector<iINCContext::MethodResult> batchResults;  // Per-call results of a batch
 
     iMutex mutex;
     iCondition condition;
@@ -254,6 +294,16 @@ public:
         helper->condition.broadcast();
     }
 
+    static void batchFinished(iINCOperation* op, void* userData)
+    {
+        TestHelper* helper = static_cast<TestHelper*>(userData);
+        iScopedLock<iMutex> lock(helper->mutex);
+        helper->errorCode = op->errorCode();
+        helper->batchDecoded = iINCContext::batchResults(op, helper->batchResults);
+        helper->testCompleted = true;
+        helper->condition.broadcast();
+    }
+
     void onEventReceived(const iString& eventName, xuint16 version, const iByteArray& data) {
         ilog_info("[Helper] onEventReceived called, event:", eventName.toUtf8().constData(),
                   "version:", version, "data size:", data.size());
@@ -581,6 +631,74 @@ public:
         ilog_info("[Worker] Sent 5 sequential method calls");
     }
 
+    void sendRepeatedCalls(iString methodName, int count) {
+        ilog_info("[Worker] sendRepeatedCalls called in thread:", iThread::currentThreadId());
+
+        if (!client || client->state() != iINCContext::STATE_CONNECTED) {
+            ilog_error("[Worker] Client not ready");
+            return;
+        }
+
+        {
+            iScopedLock<iMutex> lock(helper->mutex);
+            helper->callCount = 0;
+            helper->operations.clear();
+        }
+
+        iByteArray testData("repeat");
+        for (int i = 0; i < count; i++) {
+            iSharedDataPointer<iINCOperation> op = client->call(methodName, 1, testData);
+            if (op) {
+                op->setFinishedCallback(&TestHelper::operationFinishedCount, helper);
+
+                iScopedLock<iMutex> lock(helper->mutex);
+                helper->operations.push_back(op);
+            }
+        }
+    }
+
+    void sendMethodBatch() {
+        if (!client || client->state() != iINCContext::STATE_CONNECTED) {
+            ilog_error("[Worker] Client not ready");
+            return;
+        }
+
+        std::vector<iINCContext::MethodCall> calls;
+        calls.push_back(iINCContext::MethodCall(iString("echoTest"), 1, iByteArray("first")));
+        calls.push_back(iINCContext::MethodCall(iString("echo.deferred"), 1, iByteArray("second")));
+        calls.push_back(iINCContext::MethodCall(iString("echo.fast"), 1, iByteArray("third")));
+        calls.push_back(iINCContext::MethodCall(iString("echo.deferred"), 1, iByteArray("fourth")));
+
+        iSharedDataPointer<iINCOperation> op = client->callBatch(calls);
+        if (op) {
+            op->setFinishedCallback(&TestHelper::batchFinished, helper);
+
+            iScopedLock<iMutex> lock(helper->mutex);
+            helper->operations.clear();
+            helper->operations.push_back(op);
+        }
+    }
+
+    void sendOversizedBatch() {
+        if (!client || client->state() != iINCContext::STATE_CONNECTED) {
+            ilog_error("[Worker] Client not ready");
+            return;
+        }
+
+        // Two calls that fit a frame each, but not together
+        iByteArray args(40 * 1024, 'x');
+        std::vector<iINCContext::MethodCall> calls;
+        calls.push_back(iINCContext::MethodCall(iString("echoTest"), 1, args));
+        calls.push_back(iINCContext::MethodCall(iString("echoTest"), 1, args));
+
+        iSharedDataPointer<iINCOperation> op = client->callBatch(calls);
+
+        iScopedLock<iMutex> lock(helper->mutex);
+        helper->methodCallSucceeded = bool(op);
+        helper->testCompleted = true;
+        helper->condition.broadcast();
+    }
+
     void sendPingPong() {
         ilog_info("[Worker] sendPingPong called in thread:", iThread::currentThreadId());
 
@@ -1708,6 +1826,100 @@ TEST_P(INCIntegrationTest, MultipleMethodCalls) {
     EXPECT_EQ(5, helper->callCount);
 }
 
+/**
+ * Test: Method id interning - first round goes by name and binds, later rounds go by id
+ */
+TEST_P(INCIntegrationTest, MethodIdDispatch) {
+    ASSERT_TRUE(startServer());
+    ASSERT_TRUE(connectClient());
+    EXPECT_NE(0u, getServer()->fastMethodId);
+
+    {
+        iScopedLock<iMutex> lock(helper->mutex);
+        helper->errorCode = INC_OK;
+    }
+
+    // Registered method: both the by-name and the by-id path reach the dedicated handler
+    for (int round = 0; round < 2; ++round) {
+        {
+            iScopedLock<iMutex> lock(helper->mutex);
+            helper->callCount = 0;
+        }
+        iObject::invokeMethod(worker, &INCTestWorker::sendRepeatedCalls, iString("echo.fast"), 3);
+        ASSERT_TRUE(helper->waitForCallCount(3, 8000));
+    }
+
+    // Unregistered method: interned on bind, id calls still reach handleMethod() with the name
+    for (int round = 0; round < 2; ++round) {
+        {
+            iScopedLock<iMutex> lock(helper->mutex);
+            helper->callCount = 0;
+        }
+        iObject::invokeMethod(worker, &INCTestWorker::sendRepeatedCalls, iString("echo.bound"), 3);
+        ASSERT_TRUE(helper->waitForCallCount(3, 8000));
+    }
+
+    iScopedLock<iMutex> lock(helper->mutex);
+    EXPECT_EQ(INC_OK, helper->errorCode);
+    EXPECT_EQ(6, getServer()->fastCallCount);
+    EXPECT_EQ(6, getServer()->methodCallCount);
+    EXPECT_EQ(iString("echo.bound"), getServer()->lastMethodName);
+    // Bind acks arrive before the first round's replies, so at least the
+    // second round of both methods went out by id
+    EXPECT_GE(getServer()->methodCallsById.load(), 6);
+}
+
+/**
+ * Test: Batched calls run in order and complete with one aggregated reply
+ */
+TEST_P(INCIntegrationTest, MethodBatch) {
+    ASSERT_TRUE(startServer());
+    ASSERT_TRUE(connectClient());
+
+    {
+        iScopedLock<iMutex> lock(helper->mutex);
+        helper->testCompleted = false;
+        helper->batchDecoded = false;
+        helper->errorCode = -1;
+    }
+
+    iObject::invokeMethod(worker, &INCTestWorker::sendMethodBatch);
+    ASSERT_TRUE(helper->waitForCondition(8000));
+
+    iScopedLock<iMutex> lock(helper->mutex);
+    EXPECT_EQ(INC_OK, helper->errorCode);
+    ASSERT_TRUE(helper->batchDecoded);
+    ASSERT_EQ(4u, helper->batchResults.size());
+    const char* expected[] = {"first", "second", "third", "fourth"};
+    for (size_t idx = 0; idx < helper->batchResults.size(); ++idx) {
+        EXPECT_EQ(INC_OK, helper->batchResults[idx].errorCode);
+        EXPECT_EQ(iByteArray(expected[idx]), helper->batchResults[idx].data);
+    }
+    EXPECT_EQ(1, getServer()->fastCallCount);
+    EXPECT_EQ(3, getServer()->methodCallCount);
+}
+
+/**
+ * Test: A batch that does not fit into one frame is refused on the client side
+ */
+TEST_P(INCIntegrationTest, MethodBatchOversized) {
+    ASSERT_TRUE(startServer());
+    ASSERT_TRUE(connectClient());
+
+    {
+        iScopedLock<iMutex> lock(helper->mutex);
+        helper->testCompleted = false;
+        helper->methodCallSucceeded = true;
+    }
+
+    iObject::invokeMethod(worker, &INCTestWorker::sendOversizedBatch);
+    ASSERT_TRUE(helper->waitForCondition(5000));
+
+    iScopedLock<iMutex> lock(helper->mutex);
+    EXPECT_FALSE(helper->methodCallSucceeded);
+    EXPECT_EQ(0, getServer()->methodCallCount);
+}
+
 /**
  * Test: Ping-pong functionality
  */
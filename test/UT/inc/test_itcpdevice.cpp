@@ -7,7 +7,12 @@
 #include <gtest/gtest.h>
 #include "inc/itcpdevice.h"
 #include <core/inc/iincerror.h>
+#include <core/inc/iincmessage.h>
+#include <core/kernel/icoreapplication.h>
+#include <core/kernel/ieventdispatcher.h>
+#include <core/kernel/ieventloop.h>
 #include <core/kernel/iobject.h>
+#include <core/utils/idatetime.h>
 
 #include <sys/socket.h>
 #include <netinet/in.h>
@@ -15,6 +20,7 @@
 #include <unistd.h>
 #include <poll.h>
 #include <cstring>
+#include <vector>
 
 extern bool g_testINC;
 
@@ -51,7 +57,9 @@ class ConnectionReceiver : public iObject
 public:
     ConnectionReceiver() : acceptedDevice(IX_NULLPTR) {}
     void onNewConnection(iINCDevice* dev) { acceptedDevice = static_cast<iTcpDevice*>(dev); }
+    void onMessage(iINCMessage msg) { messages.push_back(msg); }
     iTcpDevice* acceptedDevice;
+    std::vector<iINCMessage> messages;
 };
 
 // Poll the listening server until an incoming connection is accepted or a
@@ -310,3 +318,67 @@ TEST_F(TCPDeviceTest, IsSequential) {
     iTcpDevice client(iINCDevice::ROLE_CLIENT);
     EXPECT_TRUE(client.isSequential());
 }
+
+// --- edge-triggered ---
+
+TEST_F(TCPDeviceTest, EdgeTriggeredDrainsBurst) {
+    if (!iCoreApplication::instance()) {
+        static int argc = 1;
+        static char* argv[] = {(char*)"test"};
+        new iCoreApplication(argc, argv);
+    }
+    iEventDispatcher* dispatcher = iEventDispatcher::instance();
+    ASSERT_TRUE(dispatcher != IX_NULLPTR);
+    xuint16 port = findAvailablePort();
+    ASSERT_GT(port, 0);
+
+    ConnectionReceiver receiver;
+    iTcpDevice server(iINCDevice::ROLE_SERVER);
+    server.setEdgeTriggered(true);
+    ASSERT_EQ(server.listenOn("127.0.0.1", port), INC_OK);
+    iObject::connect(&server, &iTcpDevice::newConnection, &receiver, &ConnectionReceiver::onNewConnection);
+    ASSERT_TRUE(server.startEventMonitoring(dispatcher));
+
+    iTcpDevice client(iINCDevice::ROLE_CLIENT);
+    client.setEdgeTriggered(true);
+    ASSERT_EQ(client.connectToHost("127.0.0.1", port), INC_OK);
+    ASSERT_TRUE(client.startEventMonitoring(dispatcher));
+
+    iEventLoop loop;
+    iTime timer;
+    timer.start();
+    while ((!receiver.acceptedDevice || !client.isOpen()) && timer.elapsed() < 5000)
+        loop.processEvents();
+    ASSERT_NE(receiver.acceptedDevice, (iTcpDevice*)IX_NULLPTR);
+    ASSERT_TRUE(client.isOpen());
+
+    iTcpDevice* accepted = receiver.acceptedDevice;
+    EXPECT_TRUE(accepted->isEdgeTriggered());
+    iObject::connect(accepted, &iINCDevice::messageReceived, &receiver, &ConnectionReceiver::onMessage);
+    ASSERT_TRUE(accepted->startEventMonitoring(dispatcher));
+
+    // More than one receive buffer arrives before the loop runs: a single
+    // readiness report has to bring in all of it
+    const int kMessages = 3;
+    const int kPayload = 3000;
+    for (int i = 0; i < kMessages; ++i) {
+        iINCMessage msg(INC_MSG_METHOD_CALL, 1, static_cast<xuint32>(i + 1));
+        msg.payload().setData(iByteArray(kPayload, static_cast<char>('a' + i)));
+        const xint64 total = static_cast<xint64>(sizeof(iINCMessageHeader)) + kPayload;
+        ASSERT_EQ(total, client.writeMessage(msg, 0));
+    }
+
+    timer.start();
+    while (receiver.messages.size() < static_cast<size_t>(kMessages) && timer.elapsed() < 5000)
+        loop.processEvents();
+    ASSERT_EQ(static_cast<size_t>(kMessages), receiver.messages.size());
+    for (int i = 0; i < kMessages; ++i) {
+        EXPECT_EQ(static_cast<xuint32>(i + 1), receiver.messages[i].sequenceNumber());
+        EXPECT_EQ(kPayload, receiver.messages[i].payload().data().size());
+    }
+
+    accepted->close();
+    delete accepted;
+    client.close();
+    server.close();
+}
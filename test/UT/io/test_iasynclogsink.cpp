@@ -0,0 +1,188 @@
+/////////////////////////////////////////////////////////////////
+/// Copyright 2018-2020
+/// All rights reserved.
+/////////////////////////////////////////////////////////////////
+/// @file    test_iasynclogsink.cpp
+/// @brief   Unit tests for iAsyncLogSink
+/// @version 1.0
+/////////////////////////////////////////////////////////////////
+
+#include <gtest/gtest.h>
+#include <core/io/iasynclogsink.h>
+#include <core/thread/ithread.h>
+
+#include <unistd.h>
+#include <atomic>
+#include <string>
+#include <vector>
+
+#define ILOG_TAG "async_sink"
+
+using namespace iShell;
+
+// Reads the pipe until the write end closes
+class PipeReader : public iThread {
+public:
+    explicit PipeReader(int fd) : m_fd(fd) {}
+
+    std::string content;
+
+protected:
+    void run() override {
+        char buf[4096];
+        ssize_t ret;
+        while ((ret = ::read(m_fd, buf, sizeof(buf))) > 0)
+            content.append(buf, (size_t) ret);
+    }
+
+private:
+    int m_fd;
+};
+
+static int countLines(const std::string& text, const std::string& needle) {
+    int count = 0;
+    for (size_t pos = text.find(needle); pos != std::string::npos; pos = text.find(needle, pos + 1))
+        ++count;
+    return count;
+}
+
+class AsyncLogSinkTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        ASSERT_EQ(0, pipe(fds));
+    }
+
+    void TearDown() override {
+        iAsyncLogSink::uninstall();
+        if (fds[1] >= 0)
+            close(fds[1]);
+        close(fds[0]);
+    }
+
+    // Uninstalls, closes the write end and returns all that was written
+    std::string finish(PipeReader& reader) {
+        iAsyncLogSink::uninstall();
+        close(fds[1]);
+        fds[1] = -1;
+        reader.wait();
+        return reader.content;
+    }
+
+    int fds[2];
+};
+
+TEST_F(AsyncLogSinkTest, BlockPolicyKeepsEveryLine) {
+    PipeReader reader(fds[0]);
+    reader.start();
+
+    ASSERT_TRUE(iAsyncLogSink::install(fds[1], 16, iAsyncLogSink::Block));
+    EXPECT_TRUE(iAsyncLogSink::isInstalled());
+    EXPECT_FALSE(iAsyncLogSink::install(fds[1]));
+
+    const std::string longText(2000, 'x');
+    for (int i = 0; i < 500; ++i)
+        ilog_info("async line ", i);
+    ilog_info("long ", longText.c_str());
+    unsigned char data[] = {0xde, 0xad, 0xbe, 0xef};
+    ilog_data_info(data, (int) sizeof(data));
+
+    iAsyncLogSink::flush();
+    iAsyncLogSink::Stats stats = iAsyncLogSink::stats();
+    EXPECT_EQ(502, stats.written);
+    EXPECT_EQ(0, stats.dropped);
+    EXPECT_GT(stats.batches, 0);
+    EXPECT_LE(stats.batches, stats.written);
+
+    const std::string out = finish(reader);
+    EXPECT_FALSE(iAsyncLogSink::isInstalled());
+    EXPECT_EQ(500, countLines(out, "async line "));
+    EXPECT_NE(std::string::npos, out.find("async line 499\n"));
+    EXPECT_NE(std::string::npos, out.find(longText + "\n"));
+    EXPECT_NE(std::string::npos, out.find("async_sink:I"));
+    EXPECT_NE(std::string::npos, out.find("0xde 0xad 0xbe 0xef"));
+}
+
+TEST_F(AsyncLogSinkTest, DropPolicyCountsLostLines) {
+    // Nobody reads until the end: the pipe fills, the writer stalls and the ring overflows
+    ASSERT_TRUE(iAsyncLogSink::install(fds[1], 8, iAsyncLogSink::DropNewest));
+    const std::string text(400, 'y');
+    for (int i = 0; i < 2000; ++i)
+        ilog_info("drop ", i, " ", text.c_str());
+
+    iAsyncLogSink::Stats stats = iAsyncLogSink::stats();
+    EXPECT_GT(stats.dropped, 0);
+    EXPECT_EQ(0, stats.blocked);
+
+    PipeReader reader(fds[0]);
+    reader.start();
+    const std::string out = finish(reader);
+    EXPECT_EQ(2000 - stats.dropped, countLines(out, "drop "));
+}
+
+TEST_F(AsyncLogSinkTest, KeepsPreviousFilter) {
+    PipeReader reader(fds[0]);
+    reader.start();
+
+    ASSERT_TRUE(iAsyncLogSink::install(fds[1]));
+    // The default target filters out verbose
+    ilog_verbose("hidden line");
+    ilog_debug("shown line");
+
+    const std::string out = finish(reader);
+    EXPECT_EQ(std::string::npos, out.find("hidden line"));
+    EXPECT_NE(std::string::npos, out.find("shown line"));
+}
+
+// Swallows lines, so the loggers below stay quiet between the installs
+static std::atomic<int> s_quietLines(0);
+static void quietThreshold(void*, const char*, bool) {}
+static bool quietFilter(void*, const char*, iLogLevel) { return true; }
+static void quietMeta(void*, const char*, iLogLevel, const char*, const char*, int, const char*, int) { ++s_quietLines; }
+static void quietData(void*, const char*, iLogLevel, const char*, const char*, int, const void*, int) { ++s_quietLines; }
+
+class SpinLogger : public iThread {
+public:
+    explicit SpinLogger(std::atomic<bool>* stop) : m_stop(stop) {}
+
+protected:
+    void run() override {
+        for (int i = 0; !m_stop->load(); ++i)
+            ilog_info("spin ", i);
+    }
+
+private:
+    std::atomic<bool>* m_stop;
+};
+
+TEST_F(AsyncLogSinkTest, ReinstallWhileOtherThreadsLog) {
+    iLogTarget quiet = {nullptr, &quietThreshold, &quietFilter, &quietMeta, &quietData};
+    iLogTarget original = iLogger::setDefaultTarget(quiet);
+
+    PipeReader reader(fds[0]);
+    reader.start();
+
+    // Uninstall frees the ring while the loggers keep calling into whatever target they see
+    std::atomic<bool> stop(false);
+    std::vector<SpinLogger*> loggers;
+    for (int i = 0; i < 4; ++i) {
+        loggers.push_back(new SpinLogger(&stop));
+        loggers.back()->start();
+    }
+
+    for (int round = 0; round < 50; ++round) {
+        ASSERT_TRUE(iAsyncLogSink::install(fds[1], 64, iAsyncLogSink::DropNewest));
+        iThread::msleep(1);
+        iAsyncLogSink::uninstall();
+    }
+
+    stop = true;
+    for (size_t i = 0; i < loggers.size(); ++i) {
+        loggers[i]->wait();
+        delete loggers[i];
+    }
+
+    iLogger::setDefaultTarget(original);
+    const std::string out = finish(reader);
+    EXPECT_GT(s_quietLines.load(), 0);
+    EXPECT_NE(std::string::npos, out.find("spin "));
+}
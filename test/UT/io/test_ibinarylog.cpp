@@ -0,0 +1,179 @@
+/////////////////////////////////////////////////////////////////
+/// Copyright 2018-2020
+/// All rights reserved.
+/////////////////////////////////////////////////////////////////
+/// @file    test_ibinarylog.cpp
+/// @brief   Unit tests for iBinaryLog
+/// @version 1.0
+/////////////////////////////////////////////////////////////////
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include <core/io/ibinarylog.h>
+#include <core/utils/istring.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define ILOG_TAG "binlog"
+
+using namespace iShell;
+
+static void traceOnce(int i)
+{
+    ilog_trace_info("repeat ", i);
+}
+
+class BinaryLogTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        strcpy(logPath, "/tmp/ix_binlog_XXXXXX");
+        strcpy(textPath, "/tmp/ix_binlog_text_XXXXXX");
+        ::close(mkstemp(logPath));
+        ::close(mkstemp(textPath));
+    }
+
+    void TearDown() override {
+        iBinaryLog::close();
+        unlink(logPath);
+        unlink(textPath);
+    }
+
+    // Decodes path and returns the text, records decoded in count
+    std::string decode(const char* path, xint64* count) {
+        int fd = ::open(textPath, O_WRONLY | O_TRUNC);
+        *count = iBinaryLog::decode(path, fd);
+        ::close(fd);
+
+        std::string text;
+        char buf[4096];
+        ssize_t ret;
+        fd = ::open(textPath, O_RDONLY);
+        while ((ret = ::read(fd, buf, sizeof(buf))) > 0)
+            text.append(buf, (size_t) ret);
+        ::close(fd);
+        return text;
+    }
+
+    char logPath[64];
+    char textPath[64];
+};
+
+TEST_F(BinaryLogTest, DecodesLikeTheTextTarget) {
+    ASSERT_TRUE(iBinaryLog::open(logPath));
+    EXPECT_TRUE(iBinaryLog::isActive());
+
+    const int line = __LINE__ + 1;
+    ilog_trace_info("int ", -42, " uint ", 7u, " ll ", -1234567890123LL, " bool ", true, " char ", 'z');
+    ilog_trace_warn("hex ", iHexUInt32(0xbeef), " double ", 1.5, " str ", std::string("std"), " ", iString(u"ustr"));
+    ilog_trace_error("null ", static_cast<const void*>(IX_NULLPTR));
+    iBinaryLog::close();
+    EXPECT_FALSE(iBinaryLog::isActive());
+
+    xint64 count = 0;
+    const std::string text = decode(logPath, &count);
+    EXPECT_EQ(3, count);
+
+    char expected[128];
+    snprintf(expected, sizeof(expected), "binlog:I test_ibinarylog.cpp:%d:TestBody ", line);
+    EXPECT_NE(std::string::npos, text.find(expected)) << text;
+    EXPECT_NE(std::string::npos, text.find("int -42 uint 7 ll -1234567890123 bool 1 char z\n")) << text;
+    EXPECT_NE(std::string::npos, text.find("binlog:W ")) << text;
+    EXPECT_NE(std::string::npos, text.find("hex 0xbeef double 1.500000 str std ustr\n")) << text;
+    EXPECT_NE(std::string::npos, text.find("binlog:E ")) << text;
+    EXPECT_THAT(text.substr(0, text.find('\n')),
+                ::testing::MatchesRegex("[0-9]{2}:[0-9]{2}:[0-9]{2}:[0-9]{3} +[0-9]+ +[0-9]+ binlog:I .*"));
+}
+
+TEST_F(BinaryLogTest, SiteWrittenOncePerFile) {
+    ASSERT_TRUE(iBinaryLog::open(logPath));
+    traceOnce(0);
+    const xint64 first = iBinaryLog::size();
+    traceOnce(1);
+    const xint64 second = iBinaryLog::size() - first;
+    traceOnce(2);
+    const xint64 third = iBinaryLog::size() - first - second;
+
+    // Later records carry the site id only
+    EXPECT_GT(first, second + (xint64) strlen("test_ibinarylog.cpp"));
+    EXPECT_LT(second, 32);
+    EXPECT_LT(third, 32);
+
+    // A new file gets the definition again
+    ASSERT_TRUE(iBinaryLog::open(logPath));
+    traceOnce(3);
+    iBinaryLog::close();
+
+    xint64 count = 0;
+    const std::string text = decode(logPath, &count);
+    EXPECT_EQ(1, count);
+    EXPECT_NE(std::string::npos, text.find("traceOnce repeat 3\n")) << text;
+}
+
+TEST_F(BinaryLogTest, TruncatedAndForeignFiles) {
+    ASSERT_TRUE(iBinaryLog::open(logPath));
+    traceOnce(1);
+    traceOnce(2);
+    const xint64 size = iBinaryLog::size();
+    iBinaryLog::close();
+
+    // A record cut short at the end is skipped
+    ASSERT_EQ(0, truncate(logPath, size - 1));
+    xint64 count = 0;
+    std::string text = decode(logPath, &count);
+    EXPECT_EQ(1, count);
+    EXPECT_NE(std::string::npos, text.find("repeat 1\n"));
+    EXPECT_EQ(std::string::npos, text.find("repeat 2"));
+
+    // Not a binary log
+    FILE* file = fopen(logPath, "w");
+    ASSERT_TRUE(file != IX_NULLPTR);
+    fputs("12:00:00:000 plain text line\n", file);
+    fclose(file);
+    EXPECT_EQ(-1, iBinaryLog::decode(logPath, 1));
+    EXPECT_EQ(-1, iBinaryLog::decode("/nonexistent/ix_binlog", 1));
+}
+
+TEST_F(BinaryLogTest, FallsBackToTextTarget) {
+    EXPECT_FALSE(iBinaryLog::isActive());
+    // Nothing open: goes to the text target and must not touch the binary writer
+    ilog_trace_debug("text fallback ", 1);
+    EXPECT_EQ(0, iBinaryLog::size());
+}
+
+static void traceMany(int count)
+{
+    for (int i = 0; i < count; ++i)
+        traceOnce(i);
+}
+
+TEST_F(BinaryLogTest, ThreadBuffersReachTheFile) {
+    ASSERT_TRUE(iBinaryLog::open(logPath));
+
+    // Enough records to fill each thread's buffer several times; the threads
+    // are gone before close(), so what they left is written at their exit
+    const int perThread = 2000;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; ++i)
+        threads.push_back(std::thread(traceMany, perThread));
+    for (size_t i = 0; i < threads.size(); ++i)
+        threads[i].join();
+
+    // Records still in this thread's buffer count towards size() and are written by close()
+    const xint64 before = iBinaryLog::size();
+    traceOnce(-1);
+    EXPECT_GT(iBinaryLog::size(), before);
+    iBinaryLog::close();
+
+    xint64 count = 0;
+    const std::string text = decode(logPath, &count);
+    EXPECT_EQ(4 * perThread + 1, count);
+    EXPECT_NE(std::string::npos, text.find("repeat 1999\n"));
+    EXPECT_NE(std::string::npos, text.find("repeat -1\n"));
+}
@@ -430,3 +430,96 @@ TEST_F(IODeviceTest, UnbufferedFlag) {
     device->open(iIODevice::ReadOnly | iIODevice::Unbuffered);
     EXPECT_TRUE(device->isOpen());
 }
+
+// ===== Scatter-Gather =====
+
+// Sequential device handing out its data in fixed segments
+class ChunkedIODevice : public iIODevice {
+public:
+    bool isSequential() const override { return true; }
+
+    void feed(const iByteArray& chunk) { m_pending.push_back(chunk); }
+
+    std::list<iByteArray> m_pending;
+    std::list<iByteArray> m_written;
+
+protected:
+    iByteArray readData(xint64 maxlen, xint64* readErr) override {
+        if (readErr) *readErr = 0;
+        if (m_pending.empty() || maxlen <= 0)
+            return iByteArray();
+
+        iByteArray chunk = m_pending.front();
+        m_pending.pop_front();
+        if (chunk.size() > maxlen) {
+            m_pending.push_front(chunk.mid(maxlen));
+            chunk.truncate(maxlen);
+        }
+        return chunk;
+    }
+
+    xint64 writeData(const iByteArray& data) override {
+        m_written.push_back(data);
+        return data.size();
+    }
+};
+
+TEST_F(IODeviceTest, ReadChunksKeepsSegments) {
+    ChunkedIODevice chunked;
+    ASSERT_TRUE(chunked.open(iIODevice::ReadWrite | iIODevice::Unbuffered));
+    iByteArray first("0123456789");
+    chunked.feed(first);
+    chunked.feed(iByteArray("abcdefghij"));
+    chunked.feed(iByteArray("KLMNOPQRST"));
+
+    // A peek inside a transaction leaves the transaction position alone
+    chunked.startTransaction();
+    std::list<iByteArray> peeked;
+    EXPECT_EQ(25, chunked.peekChunks(peeked, 25));
+    ASSERT_EQ(3u, peeked.size());
+    EXPECT_EQ(first.constData(), peeked.front().constData());
+    EXPECT_EQ(iByteArray("KLMNO"), peeked.back());
+    chunked.rollbackTransaction();
+
+    std::list<iByteArray> chunks;
+    EXPECT_EQ(25, chunked.readChunks(chunks, 25));
+    ASSERT_EQ(3u, chunks.size());
+    EXPECT_EQ(iByteArray("0123456789"), chunks.front());
+    EXPECT_EQ(iByteArray("KLMNO"), chunks.back());
+
+    chunks.clear();
+    EXPECT_EQ(5, chunked.readChunks(chunks, 100));
+    EXPECT_EQ(iByteArray("PQRST"), chunks.front());
+    EXPECT_EQ(0, chunked.readChunks(chunks, 100));
+    EXPECT_EQ(-1, chunked.readChunks(chunks, -1));
+
+    // Segments reach the device one by one, nothing is concatenated
+    std::list<iByteArray> out;
+    out.push_back(iByteArray("head"));
+    out.push_back(iByteArray());
+    out.push_back(iByteArray("tail"));
+    EXPECT_EQ(8, chunked.writeChunks(out));
+    ASSERT_EQ(2u, chunked.m_written.size());
+    EXPECT_EQ(out.back().constData(), chunked.m_written.back().constData());
+}
+
+TEST_F(IODeviceTest, PeekChunksOnRandomAccessDevice) {
+    device->setBuffer(iByteArray("Hello, chunks"));
+    ASSERT_TRUE(device->open(iIODevice::ReadWrite));
+    ASSERT_TRUE(device->seek(7));
+
+    std::list<iByteArray> chunks;
+    EXPECT_EQ(6, device->peekChunks(chunks, 100));
+    EXPECT_EQ(7, device->pos());
+    chunks.clear();
+    EXPECT_EQ(6, device->readChunks(chunks, 100));
+    EXPECT_EQ(13, device->pos());
+
+    std::list<iByteArray> out;
+    out.push_back(iByteArray("HE"));
+    out.push_back(iByteArray("LLO"));
+    ASSERT_TRUE(device->seek(0));
+    EXPECT_EQ(5, device->writeChunks(out));
+    EXPECT_EQ(5, device->pos());
+    EXPECT_EQ(iByteArray("HELLO, chunks"), device->getBuffer());
+}
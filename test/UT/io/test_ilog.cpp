@@ -7,6 +7,12 @@
 #include <core/io/ilog.h>
 #include <core/utils/istring.h>
 #include <core/utils/ibytearray.h>
+#include <core/utils/idatetime.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <sys/wait.h>
+#include <unistd.h>
 
 using namespace iShell;
 
@@ -327,3 +333,91 @@ TEST_F(LoggerTest, EmptyLogMessage) {
 
     SUCCEED();
 }
+
+static int lazy_evaluations = 0;
+static int lazyArgument() {
+    return ++lazy_evaluations;
+}
+
+// Test 21: Filtered calls do not evaluate their arguments
+TEST_F(LoggerTest, FilteredArgumentsNotEvaluated) {
+    iLogTarget custom_target = {nullptr, customSetThreshold, customFilter, customMetaCallback, customDataCallback};
+    iLogger::setDefaultTarget(custom_target);
+    lazy_evaluations = 0;
+
+#define ILOG_TAG "LAZY"
+    ilog_verbose("skipped ", lazyArgument());
+    EXPECT_EQ(0, lazy_evaluations);
+    EXPECT_TRUE(captured_messages.empty());
+
+    ilog_info("kept ", lazyArgument());
+    EXPECT_EQ(1, lazy_evaluations);
+    ASSERT_EQ(1u, captured_messages.size());
+    EXPECT_EQ("kept 1", captured_messages[0]);
+    EXPECT_EQ("LAZY", last_tag);
+#undef ILOG_TAG
+}
+
+// Test 22: The filter is asked once per tag until the threshold changes
+TEST_F(LoggerTest, FilterResultCachedPerTag) {
+    iLogTarget custom_target = {nullptr, customSetThreshold, customFilter, customMetaCallback, customDataCallback};
+    iLogger::setDefaultTarget(custom_target);
+
+    static const char tag[] = "CACHED";
+    EXPECT_TRUE(iLogger::isEnabled(tag, ILOG_DEBUG));
+    const int probes = filter_calls;
+    EXPECT_GT(probes, 0);
+
+    for (int i = 0; i < 10; ++i) {
+        EXPECT_TRUE(iLogger::isEnabled(tag, ILOG_ERROR));
+        EXPECT_FALSE(iLogger::isEnabled(tag, ILOG_VERBOSE));
+    }
+    EXPECT_EQ(probes, filter_calls);
+
+    iLogger::setThreshold("CACHED:INFO", false);
+    EXPECT_TRUE(iLogger::isEnabled(tag, ILOG_DEBUG));
+    EXPECT_GT(filter_calls, probes);
+}
+
+// Test 23: Header layout and the cached wall clock
+TEST_F(LoggerTest, FormatHeaderLayout) {
+    char header[256];
+    iTime before = iDateTime::currentDateTime().time();
+    int len = iLogger::formatHeader(header, sizeof(header), "HDR", ILOG_INFO, "/some/path/file.cpp", "func", 42);
+    ASSERT_EQ((int) strlen(header), len);
+    EXPECT_THAT(std::string(header),
+                ::testing::MatchesRegex("[0-9]{2}:[0-9]{2}:[0-9]{2}:[0-9]{3} +[0-9]+ +[0-9]+ HDR:I file.cpp:42:func"));
+
+    // Same wall clock as iDateTime, give or take the coarse clock's resolution
+    int hour = 0, minute = 0, second = 0, msec = 0;
+    ASSERT_EQ(4, sscanf(header, "%d:%d:%d:%d", &hour, &minute, &second, &msec));
+    int delta = iTime(hour, minute, second, msec).msecsTo(before);
+    if (delta > 12 * 3600 * 1000)
+        delta -= 24 * 3600 * 1000;
+    EXPECT_LT(std::abs(delta), 1000);
+
+    // Truncated to the buffer
+    char small[8];
+    EXPECT_EQ(7, iLogger::formatHeader(small, sizeof(small), "HDR", ILOG_INFO, "file.cpp", "func", 42));
+    EXPECT_EQ(7u, strlen(small));
+}
+
+// Test 24: A forked child logs its own pid
+TEST_F(LoggerTest, FormatHeaderAfterFork) {
+    char header[256];
+    iLogger::formatHeader(header, sizeof(header), "HDR", ILOG_INFO, "file.cpp", "func", 1);
+
+    pid_t child = fork();
+    ASSERT_GE(child, 0);
+    if (0 == child) {
+        char mine[32];
+        snprintf(mine, sizeof(mine), " %d ", (int) getpid());
+        iLogger::formatHeader(header, sizeof(header), "HDR", ILOG_INFO, "file.cpp", "func", 1);
+        _exit(strstr(header, mine) ? 0 : 1);
+    }
+
+    int status = 0;
+    ASSERT_EQ(child, waitpid(child, &status, 0));
+    ASSERT_TRUE(WIFEXITED(status));
+    EXPECT_EQ(0, WEXITSTATUS(status));
+}
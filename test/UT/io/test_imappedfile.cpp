@@ -0,0 +1,119 @@
+/////////////////////////////////////////////////////////////////
+/// Copyright 2018-2020
+/// All rights reserved.
+/////////////////////////////////////////////////////////////////
+/// @file    test_imappedfile.cpp
+/// @brief   Unit tests for iMappedFile
+/// @version 1.0
+/////////////////////////////////////////////////////////////////
+
+#include <gtest/gtest.h>
+#include <core/io/imappedfile.h>
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+using namespace iShell;
+
+class MappedFileTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        char name[] = "/tmp/ix_mappedfile_XXXXXX";
+        int fd = mkstemp(name);
+        ASSERT_GE(fd, 0);
+        path = name;
+
+        content.resize(3 * 4096 + 123);
+        for (size_t i = 0; i < content.size(); ++i)
+            content[i] = char('A' + i % 26);
+        ASSERT_EQ((ssize_t) content.size(), ::write(fd, content.data(), content.size()));
+        ::close(fd);
+    }
+
+    void TearDown() override {
+        unlink(path.c_str());
+    }
+
+    std::string path;
+    std::string content;
+};
+
+TEST_F(MappedFileTest, ReadsAreSlicesOfTheMapping) {
+    iMappedFile file(iString::fromUtf8(iByteArrayView(path.c_str())));
+    ASSERT_TRUE(file.open(iIODevice::ReadOnly));
+    EXPECT_FALSE(file.isSequential());
+    EXPECT_EQ((xint64) content.size(), file.size());
+
+    iByteArray first = file.read(100);
+    ASSERT_EQ(100, first.size());
+    EXPECT_EQ(0, memcmp(first.constData(), content.data(), 100));
+
+    // Consecutive reads are adjacent views of one mapping, not copies
+    iByteArray second = file.read(100);
+    ASSERT_EQ(100, second.size());
+    EXPECT_EQ(first.constData() + 100, second.constData());
+
+    // A slice is read-only, changing it detaches a private copy
+    iByteArray copy = first;
+    first[0] = 'z';
+    EXPECT_NE(copy.constData(), first.constData());
+    EXPECT_EQ(content[0], copy.at(0));
+
+    // Slices outlive the device
+    file.close();
+    EXPECT_EQ(0, memcmp(second.constData(), content.data() + 100, 100));
+}
+
+TEST_F(MappedFileTest, SeekAndAccessHints) {
+    iMappedFile file;
+    file.setFileName(iString::fromUtf8(iByteArrayView(path.c_str())));
+    EXPECT_FALSE(file.open(iIODevice::ReadWrite));
+    ASSERT_TRUE(file.open(iIODevice::ReadOnly));
+
+    file.setAccessHint(iMappedFile::RandomAccess);
+    EXPECT_EQ(iMappedFile::RandomAccess, file.accessHint());
+    ASSERT_TRUE(file.seek(2 * 4096 + 7));
+    iByteArray chunk = file.read(10);
+    ASSERT_EQ(10, chunk.size());
+    EXPECT_EQ(0, memcmp(chunk.constData(), content.data() + 2 * 4096 + 7, 10));
+
+    file.setAccessHint(iMappedFile::SequentialAccess);
+    EXPECT_TRUE(file.willNeed(4096, 4096));
+    EXPECT_FALSE(file.willNeed((xint64) content.size(), 10));
+    ASSERT_TRUE(file.reset());
+
+    iByteArray all;
+    while (!file.atEnd())
+        all.append(file.read(1000));
+    EXPECT_EQ((xsizetype) content.size(), all.size());
+    EXPECT_EQ(0, memcmp(all.constData(), content.data(), content.size()));
+    EXPECT_TRUE(file.read(10).isEmpty());
+
+    EXPECT_EQ(-1, file.write(iByteArray("x")));
+}
+
+TEST_F(MappedFileTest, LargeFilePositions) {
+    if (sizeof(void*) < 8)
+        GTEST_SKIP() << "No address space for a 5 GB mapping";
+
+    // Sparse file with a marker past the 4 GB boundary
+    const xint64 offset = IX_INT64_C(4) * 1024 * 1024 * 1024 + 4096 + 3;
+    int fd = ::open(path.c_str(), O_WRONLY);
+    ASSERT_GE(fd, 0);
+    if (pwrite(fd, "marker", 6, (off_t) offset) != 6) {
+        ::close(fd);
+        GTEST_SKIP() << "Filesystem does not take a 4 GB offset";
+    }
+    ::close(fd);
+
+    iMappedFile file(iString::fromUtf8(iByteArrayView(path.c_str())));
+    ASSERT_TRUE(file.open(iIODevice::ReadOnly));
+    EXPECT_EQ(offset + 6, file.size());
+    ASSERT_TRUE(file.seek(offset));
+    EXPECT_EQ(offset, file.pos());
+    iByteArray marker = file.read(100);
+    EXPECT_EQ(iByteArray("marker"), marker);
+    EXPECT_TRUE(file.atEnd());
+}
@@ -11,6 +11,13 @@
 #include <gtest/gtest.h>
 #include <core/io/imemblock.h>
 #include <core/utils/ibytearray.h>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 using namespace iShell;
 
@@ -444,6 +451,28 @@ TEST_F(IMemPoolTest, Vacuum) {
     pool->vacuum();
 }
 
+// A vacuumed pool hands out no data of the blocks released before
+TEST_F(IMemPoolTest, VacuumScrubsFreeSlots) {
+    iSharedDataPointer<iMemPool> pool(iMemPool::create("scrub_pool", "scrub_pool", MEMTYPE_PRIVATE,
+                                       4*1024*1024, false));
+    ASSERT_NE(pool.data(), nullptr);
+
+    // 200 bytes sit below the page size (and in this thread's magazine), 100 KiB get punched
+    const size_t sizes[] = { 200, 100 * 1024 };
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i) {
+        iSharedDataPointer<iMemBlock> block(iMemBlock::new4Pool(pool.data(), sizes[i]));
+        ASSERT_FALSE(block.data() == nullptr);
+        const char* data = static_cast<const char*>(block->data().value());
+        memset(block->data().value(), 0xab, sizes[i]);
+        block.reset();
+
+        pool->vacuum();
+
+        for (size_t k = 0; k < sizes[i]; ++k)
+            ASSERT_EQ(0, data[k]) << "size " << sizes[i] << " offset " << k;
+    }
+}
+
 // Test remote writable flag
 TEST_F(IMemPoolTest, RemoteWritable) {
     iSharedDataPointer<iMemPool> pool(iMemPool::create("rw_pool", "rw_pool", MEMTYPE_PRIVATE,
@@ -519,3 +548,350 @@ TEST_F(IMemPoolTest, MultiplePools) {
         EXPECT_EQ(block2->pool().data(), pool2.data());
     }
 }
+
+static void exportRevokeNoop(iMemExport*, uint, void*) {}
+
+// Test the export table grows past its first block and recycles ids safely
+TEST_F(IMemPoolTest, ExportTableGrowsWithGenerationIds) {
+    iSharedDataPointer<iMemPool> shared(iMemPool::create("export_pool", "export_pool", MEMTYPE_SHARED_POSIX,
+                                        64*1024, false));
+    ASSERT_FALSE(shared.data() == nullptr);
+    iSharedDataPointer<iMemBlock> block(iMemBlock::new4Pool(shared.data(), 256));
+    ASSERT_FALSE(block.data() == nullptr);
+
+    iMemExport* exp = new iMemExport(shared.data(), exportRevokeNoop, nullptr);
+    const int count = 300;  // more than the old fixed table of 128
+    ASSERT_GE(iMemExport::capacity(), count);
+
+    std::vector<uint> ids;
+    for (int i = 0; i < count; ++i) {
+        MemType type;
+        uint blockId = 0, shmId = 0;
+        int memfd = -1;
+        size_t offset = 0, size = 0;
+        ASSERT_EQ(0, exp->put(block.data(), &type, &blockId, &shmId, &memfd, &offset, &size));
+        EXPECT_NE(0u, blockId);
+        ids.push_back(blockId);
+    }
+    EXPECT_EQ(count, exp->inUse());
+    EXPECT_EQ(count, exp->peakInUse());
+    EXPECT_EQ(count, shared->getStat().nExported);
+
+    EXPECT_EQ(0, exp->processRelease(ids[0]));
+    EXPECT_EQ(-1, exp->processRelease(ids[0]));
+
+    // The recycled slot gets a new generation, the stale id stays dead
+    MemType type;
+    uint reused = 0, shmId = 0;
+    int memfd = -1;
+    size_t offset = 0, size = 0;
+    ASSERT_EQ(0, exp->put(block.data(), &type, &reused, &shmId, &memfd, &offset, &size));
+    EXPECT_NE(ids[0], reused);
+    EXPECT_EQ(-1, exp->processRelease(ids[0]));
+    EXPECT_EQ(count, exp->inUse());
+
+    for (int i = 1; i < count; ++i)
+        EXPECT_EQ(0, exp->processRelease(ids[i]));
+    EXPECT_EQ(1, exp->inUse());
+
+    // Destruction releases what the peer never acknowledged
+    delete exp;
+    EXPECT_EQ(0, shared->getStat().nExported);
+    EXPECT_TRUE(block->refIsOne());
+}
+
+// Test small and large blocks share one segment through size classes
+TEST_F(IMemPoolTest, SizeClassesKeepBlocksInPool) {
+    iSharedDataPointer<iMemPool> shared(iMemPool::create("class_pool", "class_pool", MEMTYPE_SHARED_POSIX,
+                                        4*1024*1024, false));
+    ASSERT_FALSE(shared.data() == nullptr);
+    ASSERT_GT(shared->sizeClasses(), 2);
+    for (int idx = 1; idx < shared->sizeClasses(); ++idx)
+        EXPECT_EQ(shared->sizeClassSize(idx - 1) * 2, shared->sizeClassSize(idx));
+
+    // A large frame fits next to packets, it used to exceed the 64 KiB slot
+    EXPECT_GT(shared->blockSizeMax(), 1024u * 1024u);
+    iSharedDataPointer<iMemBlock> frame(iMemBlock::new4Pool(shared.data(), 1024 * 1024));
+    ASSERT_FALSE(frame.data() == nullptr);
+
+    // Far more small packets than the segment has 64 KiB blocks
+    std::vector<iSharedDataPointer<iMemBlock> > packets;
+    for (int i = 0; i < 1000; ++i) {
+        iSharedDataPointer<iMemBlock> packet(iMemBlock::new4Pool(shared.data(), 200));
+        ASSERT_FALSE(packet.data() == nullptr) << "packet " << i;
+        packets.push_back(packet);
+    }
+    EXPECT_EQ(0, shared->getStat().nTooLargeForPool);
+    EXPECT_EQ(0, shared->getStat().nPoolFull);
+
+    // Packets are packed into small slots
+    const char* first = static_cast<const char*>(packets[0]->data().value());
+    const char* second = static_cast<const char*>(packets[1]->data().value());
+    EXPECT_LE(static_cast<size_t>(second > first ? second - first : first - second), 1024u);
+
+    // A freed slot goes back to its own class and is reused
+    const void* freed = packets.back()->data().value();
+    packets.pop_back();
+    iSharedDataPointer<iMemBlock> again(iMemBlock::new4Pool(shared.data(), 200));
+    ASSERT_FALSE(again.data() == nullptr);
+    EXPECT_EQ(freed, again->data().value());
+
+    frame.reset();
+    packets.clear();
+    again.reset();
+    EXPECT_EQ(0, shared->getStat().nAllocated);
+    shared->vacuum();
+}
+
+// Test an exhausted class borrows from a larger one instead of failing
+TEST_F(IMemPoolTest, SizeClassFallback) {
+    iSharedDataPointer<iMemPool> small(iMemPool::create("fallback_pool", "fallback_pool", MEMTYPE_PRIVATE,
+                                       128*1024, false));
+    ASSERT_FALSE(small.data() == nullptr);
+
+    // Carve the whole segment into 64 KiB slots, then free them
+    std::vector<iSharedDataPointer<iMemBlock> > big;
+    for (;;) {
+        iSharedDataPointer<iMemBlock> b(iMemBlock::new4Pool(small.data(), 40 * 1024));
+        if (!b) break;
+        big.push_back(b);
+    }
+    ASSERT_EQ(2u, big.size());
+    big.clear();
+
+    // No block is left to carve 16 KiB slots from, the free 64 KiB ones serve them
+    iSharedDataPointer<iMemBlock> b(iMemBlock::new4Pool(small.data(), 12 * 1024));
+    ASSERT_FALSE(b.data() == nullptr);
+    EXPECT_EQ(1, small->getStat().nClassFallback);
+}
+
+// Test threads recycle slots through their own magazines and hand them back on exit
+TEST_F(IMemPoolTest, ThreadMagazines) {
+    iSharedDataPointer<iMemPool> shared(iMemPool::create("magazine_pool", "magazine_pool", MEMTYPE_PRIVATE,
+                                        4*1024*1024, false));
+    ASSERT_FALSE(shared.data() == nullptr);
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < 4; ++t) {
+        workers.push_back(std::thread([&shared]() {
+            std::vector<iSharedDataPointer<iMemBlock> > held;
+            for (int round = 0; round < 200; ++round) {
+                for (int i = 0; i < 8; ++i)
+                    held.push_back(iSharedDataPointer<iMemBlock>(iMemBlock::new4Pool(shared.data(), 200 + 100 * i)));
+                held.clear();
+            }
+
+            // Leave slots in the magazine for the thread exit to drain
+            for (int i = 0; i < 64; ++i)
+                held.push_back(iSharedDataPointer<iMemBlock>(iMemBlock::new4Pool(shared.data(), 1000)));
+        }));
+    }
+    for (size_t t = 0; t < workers.size(); ++t)
+        workers[t].join();
+
+    const iMemPool::Stat& stat = shared->getStat();
+    EXPECT_EQ(0, stat.nAllocated);
+    EXPECT_EQ(0, stat.nPoolFull);
+    EXPECT_GT(stat.nMagazineHits, stat.nMagazineMisses);
+
+    // This thread's magazine still holds slots when the pool goes away
+    for (int i = 0; i < 4; ++i) {
+        iSharedDataPointer<iMemBlock> b(iMemBlock::new4Pool(shared.data(), 300));
+        ASSERT_FALSE(b.data() == nullptr);
+    }
+    shared.reset();
+
+    // A new pool at the same address must not find the stale magazine
+    shared = iMemPool::create("magazine_pool", "magazine_pool", MEMTYPE_PRIVATE, 256*1024, false);
+    ASSERT_FALSE(shared.data() == nullptr);
+    iSharedDataPointer<iMemBlock> b(iMemBlock::new4Pool(shared.data(), 300));
+    ASSERT_FALSE(b.data() == nullptr);
+    EXPECT_EQ(1, shared->getStat().nMagazineMisses);
+}
+
+// Test trim() punches free slots down to a resident target and allocations bring them back
+TEST_F(IMemPoolTest, TrimToResidentTarget) {
+    iSharedDataPointer<iMemPool> shared(iMemPool::create("trim_pool", "trim_pool", MEMTYPE_PRIVATE,
+                                        4*1024*1024, false));
+    ASSERT_FALSE(shared.data() == nullptr);
+
+    // 128 KiB slots span two segment blocks and bypass the thread magazines
+    std::vector<iSharedDataPointer<iMemBlock> > held;
+    for (int i = 0; i < 8; ++i)
+        held.push_back(iSharedDataPointer<iMemBlock>(iMemBlock::new4Pool(shared.data(), 100 * 1024)));
+    held.clear();
+    EXPECT_EQ(1024u * 1024u, shared->residentSize());
+
+    // One slot at most overshoots the byte budget
+    EXPECT_EQ(128u * 1024u, shared->trim(512 * 1024, 1));
+    EXPECT_EQ(896u * 1024u, shared->residentSize());
+    EXPECT_EQ(384u * 1024u, shared->trim(512 * 1024, (size_t) -1));
+    shared->vacuum();
+    EXPECT_EQ(0u, shared->residentSize());
+    EXPECT_EQ(8, shared->getStat().nReclaimed);
+    EXPECT_EQ(1024 * 1024, shared->getStat().reclaimedSize);
+    EXPECT_EQ(0u, shared->trim(0, (size_t) -1));
+
+    // Reclaimed slots are reused before the segment is carved any further
+    iSharedDataPointer<iMemBlock> again(iMemBlock::new4Pool(shared.data(), 100 * 1024));
+    ASSERT_FALSE(again.data() == nullptr);
+    memset(again->data().value(), 0x5a, 100 * 1024);
+    EXPECT_EQ(128u * 1024u, shared->residentSize());
+
+    shared->populate();
+    EXPECT_EQ(1024u * 1024u, shared->residentSize());
+}
+
+// Test small heap blocks are recycled through the thread-local arena
+TEST_F(IMemBlockTest, ArenaReusesChunks) {
+    iMemBlock::setArenaEnabled(true);
+    if (!iMemBlock::isArenaEnabled())
+        GTEST_SKIP() << "Built without IX_ENABLE_ARRAY_ARENA";
+
+    iSharedDataPointer<iMemBlock> block(iMemBlock::newOne(nullptr, 100));
+    ASSERT_FALSE(block.data() == nullptr);
+    const iMemBlock* first = block.data();
+    block.reset();
+
+    block = iMemBlock::newOne(nullptr, 100);
+    EXPECT_EQ(first, block.data());
+
+    // Grows in place within its chunk, then moves out of it keeping the data
+    memset(block->data().value(), 'x', 100);
+    iMemBlock* grown = iMemBlock::reallocate(block.take(), 120);
+    ASSERT_FALSE(grown == nullptr);
+    EXPECT_EQ(first, grown);
+    grown = iMemBlock::reallocate(grown, 4096);
+    ASSERT_FALSE(grown == nullptr);
+    EXPECT_GE(grown->length(), 4096u);
+    EXPECT_EQ('x', static_cast<const char*>(grown->data().value())[99]);
+    block = grown;
+    grown->deref();     // the reference handed over by take()
+
+    iMemBlock::setArenaEnabled(false);
+    EXPECT_FALSE(iMemBlock::isArenaEnabled());
+}
+
+// Test a block freed on another thread goes back to the thread that allocated it
+TEST_F(IMemBlockTest, ArenaReturnsRemoteFrees) {
+    iMemBlock::setArenaEnabled(true);
+    if (!iMemBlock::isArenaEnabled())
+        GTEST_SKIP() << "Built without IX_ENABLE_ARRAY_ARENA";
+
+    std::atomic<int> step(0);
+    iMemBlock* handed = nullptr;
+    bool returned = false;
+    std::thread owner([&]() {
+        handed = iMemBlock::newOne(nullptr, 200);
+        const iMemBlock* remote = handed;
+        step = 1;
+        while (step.load() != 2) std::this_thread::yield();
+
+        // Served once the chunks already cached here run out, a parked arena may hold some
+        std::vector<iSharedDataPointer<iMemBlock> > blocks;
+        for (int i = 0; (i < 256) && !returned; ++i) {
+            blocks.push_back(iSharedDataPointer<iMemBlock>(iMemBlock::newOne(nullptr, 200)));
+            returned = (remote == blocks.back().data());
+        }
+    });
+
+    while (step.load() != 1) std::this_thread::yield();
+    ASSERT_FALSE(handed == nullptr);
+    const iMemBlock* remote = handed;
+    handed->deref();
+
+    // Not kept in this thread's cache
+    iSharedDataPointer<iMemBlock> local(iMemBlock::newOne(nullptr, 200));
+    EXPECT_NE(remote, local.data());
+
+    step = 2;
+    owner.join();
+    EXPECT_TRUE(returned);
+    iMemBlock::setArenaEnabled(false);
+}
+
+// Micro benchmark of the log/URL/tag churn: mixed sizes, FIFO lifetimes and half of
+// the blocks freed by another thread, malloc against the arena
+TEST_F(IMemBlockTest, ArenaAllocationBenchmark) {
+    const int nThreads = 4;
+    const int rounds = 100000;
+    const size_t sizes[] = { 48, 96, 160, 240, 400, 700, 1200, 1900, 3000 };
+    const size_t nSizes = sizeof(sizes) / sizeof(sizes[0]);
+
+    struct Inbox {
+        std::mutex lock;
+        std::vector<iMemBlock*> blocks;
+    };
+
+    double elapsed[2] = {0, 0};
+    std::atomic<int> corrupted(0);
+    for (int pass = 0; pass < 2; ++pass) {
+        iMemBlock::setArenaEnabled(1 == pass);
+        Inbox inbox[nThreads];
+        std::atomic<int> running(nThreads);
+
+        // Frees what the previous thread handed over, marker checked first
+        auto drain = [&corrupted](Inbox& box) {
+            std::vector<iMemBlock*> blocks;
+            {
+                std::lock_guard<std::mutex> lock(box.lock);
+                blocks.swap(box.blocks);
+            }
+            for (size_t i = 0; i < blocks.size(); ++i) {
+                if (static_cast<const char*>(blocks[i]->data().value())[0] != 'm')
+                    ++corrupted;
+                blocks[i]->deref();
+            }
+        };
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        std::vector<std::thread> threads;
+        for (int t = 0; t < nThreads; ++t) {
+            threads.push_back(std::thread([&, t]() {
+                iMemBlock* window[32] = {};
+                std::vector<iMemBlock*> batch;
+                Inbox& next = inbox[(t + 1) % nThreads];
+                for (int i = 0; i < rounds; ++i) {
+                    iMemBlock* block = iMemBlock::newOne(nullptr, sizes[(i * 7 + t) % nSizes]);
+                    static_cast<char*>(block->data().value())[0] = 'm';
+
+                    if (i & 1) {
+                        batch.push_back(block);
+                    } else {
+                        if (window[i & 31]) window[i & 31]->deref();
+                        window[i & 31] = block;
+                    }
+
+                    if (batch.size() == 64) {
+                        std::lock_guard<std::mutex> lock(next.lock);
+                        next.blocks.insert(next.blocks.end(), batch.begin(), batch.end());
+                        batch.clear();
+                    }
+                    if (0 == (i & 255)) drain(inbox[t]);
+                }
+
+                for (int k = 0; k < 32; ++k)
+                    if (window[k]) window[k]->deref();
+                {
+                    std::lock_guard<std::mutex> lock(next.lock);
+                    next.blocks.insert(next.blocks.end(), batch.begin(), batch.end());
+                }
+                --running;
+                while (running.load() > 0) drain(inbox[t]);
+                drain(inbox[t]);
+            }));
+        }
+        for (int t = 0; t < nThreads; ++t)
+            threads[t].join();
+        elapsed[pass] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        for (int t = 0; t < nThreads; ++t) {
+            EXPECT_TRUE(inbox[t].blocks.empty());
+        }
+    }
+    iMemBlock::setArenaEnabled(false);
+    EXPECT_EQ(0, corrupted.load());
+
+    std::cout << "[ BENCH    ] " << nThreads << " threads x " << rounds << " allocations, half freed remotely: malloc "
+              << elapsed[0] << " ms, arena " << elapsed[1] << " ms" << std::endl;
+}
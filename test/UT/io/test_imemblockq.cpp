@@ -1,5 +1,5 @@
 // test_imemblockq.cpp - Unit tests for iMemBlockQueue
-// Tests cover: push, peek, drop, rewind, seek, flush, attributes, splice, prebuffer
+// Tests cover: push, peek, drop, rewind, seek, flush, attributes, splice, prebuffer, SPSC mode
 
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
@@ -8,6 +8,7 @@
 #include <core/utils/ilatin1stringview.h>
 #include <core/io/imemblockq.h>
 #include <limits>
+#include <thread>
 
 using namespace iShell;
 
@@ -332,3 +333,88 @@ TEST_F(MemBlockQueueTest, FlushWrite) {
 
     delete queue;
 }
+
+// Test 19: Dropped list items are recycled by later pushes
+TEST_F(MemBlockQueueTest, ItemRecycling) {
+    iMemBlockQueue* queue = createQueue();
+    queue->preBufDisable();
+    queue->setMaxRewind(0);
+
+    for (int round = 0; round < 1000; ++round) {
+        iByteArray data(64, char('a' + round % 26));
+        ASSERT_GT(queue->push(data), 0);
+        // Overwrite the middle of it, which splits the item
+        queue->seek(-48, iMemBlockQueue::SEEK_RELATIVE, true);
+        ASSERT_GT(queue->push(iByteArray(16, 'z')), 0);
+        queue->seek(32, iMemBlockQueue::SEEK_RELATIVE, true);
+
+        iByteArray peeked;
+        ASSERT_EQ(0, queue->peek(peeked));
+        EXPECT_EQ(char('a' + round % 26), peeked.at(0));
+        queue->drop(64);
+        EXPECT_EQ(0u, queue->length());
+    }
+    EXPECT_EQ(0u, queue->getNBlocks());
+
+    delete queue;
+}
+
+// Test 20: Producer and consumer threads without an external lock
+TEST_F(MemBlockQueueTest, SingleProducerSingleConsumer) {
+    iMemBlockQueue* queue = createQueue();
+    queue->setSingleProducerSingleConsumer(true);
+    EXPECT_TRUE(queue->isSingleProducerSingleConsumer());
+
+    // Staged chunks count against maxlength before the consumer collects them
+    EXPECT_EQ(4000, queue->push(iByteArray(4000, 'x')));
+    EXPECT_EQ(-1, queue->push(iByteArray(200, 'x')));
+    EXPECT_EQ(0u, queue->length());
+    queue->collectStaged();
+    EXPECT_EQ(4000u, queue->length());
+    queue->flushRead();
+
+    const int chunks = 20000;
+    std::thread producer([queue]() {
+        for (int i = 0; i < chunks; ++i) {
+            iByteArray chunk(32, char(i & 0x7f));
+            while (queue->push(chunk) < 0)
+                std::this_thread::yield();
+        }
+    });
+
+    // Consumer: prebuf still gates the first read
+    int consumed = 0;
+    int expected = 0;
+    int offset = 0;
+    while (consumed < chunks * 32) {
+        // An empty queue arms prebuf again, the producer's tail may never fill it
+        if (consumed > 0)
+            queue->preBufDisable();
+
+        iByteArray peeked;
+        if (queue->peek(peeked) < 0 || peeked.isEmpty() || queue->length() == 0) {
+            std::this_thread::yield();
+            continue;
+        }
+        if (0 == consumed) {
+            EXPECT_GE(queue->length(), queue->getPreBuf());
+        }
+
+        const xsizetype n = std::min<xsizetype>(peeked.length(), (xsizetype) queue->length());
+        for (xsizetype k = 0; k < n; ++k) {
+            ASSERT_EQ(char(expected & 0x7f), peeked.at(k)) << "byte " << consumed + k;
+            if (++offset == 32) {
+                offset = 0;
+                ++expected;
+            }
+        }
+        queue->drop(n);
+        consumed += (int) n;
+    }
+    producer.join();
+    EXPECT_EQ(chunks, expected);
+
+    queue->setSingleProducerSingleConsumer(false);
+    EXPECT_FALSE(queue->isSingleProducerSingleConsumer());
+    delete queue;
+}
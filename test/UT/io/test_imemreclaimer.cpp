@@ -0,0 +1,92 @@
+/////////////////////////////////////////////////////////////////
+/// Copyright 2018-2020
+/// All rights reserved.
+/////////////////////////////////////////////////////////////////
+/// @file    test_imemreclaimer.cpp
+/// @brief   Unit tests for iMemReclaimer
+/// @version 1.0
+/////////////////////////////////////////////////////////////////
+
+#include <gtest/gtest.h>
+#include <core/io/imemreclaimer.h>
+
+#include <unistd.h>
+#include <vector>
+
+using namespace iShell;
+
+namespace {
+
+// Runs the source by hand, as an attached dispatcher would
+int runReclaimer(iMemReclaimer* reclaimer)
+{
+    int dispatched = 0;
+    xint64 timeout = -1;
+    while (reclaimer->detectablePrepare(&timeout) || reclaimer->detectableCheck()) {
+        reclaimer->detectableDispatch(0);
+        ++dispatched;
+    }
+    return dispatched;
+}
+
+void cycleSlots(iMemPool* pool, int count)
+{
+    std::vector<iSharedDataPointer<iMemBlock> > held;
+    for (int i = 0; i < count; ++i)
+        held.push_back(iSharedDataPointer<iMemBlock>(iMemBlock::new4Pool(pool, 100 * 1024)));
+}
+
+} // namespace
+
+TEST(MemReclaimerTest, TrimsIdlePoolsWithHysteresis) {
+    iSharedDataPointer<iMemPool> pool(iMemPool::create("reclaim_pool", "reclaim_pool", MEMTYPE_PRIVATE,
+                                      4*1024*1024, false));
+    ASSERT_FALSE(pool.data() == nullptr);
+    cycleSlots(pool.data(), 8);
+    ASSERT_EQ(1024u * 1024u, pool->residentSize());
+
+    iMemReclaimer* reclaimer = new iMemReclaimer;
+    reclaimer->setIdleInterval(20);
+    reclaimer->setBatchSize(128 * 1024);
+    reclaimer->addPool(pool.data(), 256 * 1024);
+    EXPECT_EQ(1u, reclaimer->pools());
+
+    // Not idle long enough yet
+    runReclaimer(reclaimer);
+    EXPECT_EQ(0, reclaimer->reclaimedSize());
+
+    // One batch per dispatch, back to back until the target is reached
+    usleep(50000);
+    EXPECT_EQ(6, runReclaimer(reclaimer));
+    EXPECT_EQ(256u * 1024u, pool->residentSize());
+    EXPECT_EQ(768 * 1024, reclaimer->reclaimedSize());
+    EXPECT_EQ(768 * 1024, pool->getStat().reclaimedSize);
+
+    // Allocations make the pool busy again
+    cycleSlots(pool.data(), 4);
+    usleep(50000);
+    runReclaimer(reclaimer);
+    EXPECT_EQ(512u * 1024u, pool->residentSize());
+    EXPECT_EQ(768 * 1024, reclaimer->reclaimedSize());
+
+    // Within a quarter above target nothing is trimmed
+    reclaimer->addPool(pool.data(), 448 * 1024);
+    usleep(50000);
+    runReclaimer(reclaimer);
+    EXPECT_EQ(512u * 1024u, pool->residentSize());
+
+    reclaimer->addPool(pool.data(), 384 * 1024);
+    usleep(50000);
+    runReclaimer(reclaimer);
+    EXPECT_EQ(384u * 1024u, pool->residentSize());
+
+    // A pool only the reclaimer still holds is dropped
+    pool.reset();
+    usleep(50000);
+    runReclaimer(reclaimer);
+    EXPECT_EQ(0u, reclaimer->pools());
+
+    EXPECT_FALSE(reclaimer->watchPressure("/nonexistent/memory.pressure"));
+    EXPECT_FALSE(reclaimer->isWatchingPressure());
+    reclaimer->deref();
+}
@@ -0,0 +1,148 @@
+/////////////////////////////////////////////////////////////////
+/// Copyright 2018-2020
+/// All rights reserved.
+/////////////////////////////////////////////////////////////////
+/// @file    test_imemtracker.cpp
+/// @brief   Unit tests for iMemTracker
+/// @version 1.0
+/////////////////////////////////////////////////////////////////
+
+#include <gtest/gtest.h>
+#include <core/io/imemblock.h>
+#include <core/io/imemtracker.h>
+
+#include <signal.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+using namespace iShell;
+
+class MemTrackerTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        if (!iMemTracker::start(1))
+            GTEST_SKIP() << "Built without IX_ENABLE_MEM_TRACKING";
+        iMemTracker::reset();
+        pool = iMemPool::create("tracked_pool", "tracked_pool", MEMTYPE_PRIVATE, 1024*1024, false);
+        ASSERT_FALSE(pool.data() == nullptr);
+    }
+
+    void TearDown() override {
+        iMemTracker::stop();
+        iMemTracker::reset();
+    }
+
+    iSharedDataPointer<iMemPool> pool;
+};
+
+TEST_F(MemTrackerTest, UsagePerPoolAndType) {
+    std::vector<iSharedDataPointer<iMemBlock> > held;
+    {
+        iMemTracker::Scope scope("decoder");
+        for (int i = 0; i < 4; ++i)
+            held.push_back(iSharedDataPointer<iMemBlock>(iMemBlock::new4Pool(pool.data(), 1000)));
+    }
+    static char fixed[64];
+    held.push_back(iSharedDataPointer<iMemBlock>(iMemBlock::new4Fixed(pool.data(), fixed, sizeof(fixed), true)));
+
+    iMemTracker::Usage usage = iMemTracker::usage("tracked_pool", iMemTracker::PoolType);
+    EXPECT_EQ(4, usage.liveCount);
+    EXPECT_GE(usage.liveBytes, 4000);
+    EXPECT_EQ(usage.liveBytes, usage.peakBytes);
+    EXPECT_EQ(1, iMemTracker::usage("tracked_pool", iMemTracker::FixedType).liveCount);
+    EXPECT_EQ(5, iMemTracker::usage("tracked_pool").liveCount);
+    EXPECT_EQ(0, iMemTracker::usage("no_such_pool").totalCount);
+
+    const xint64 peak = usage.liveBytes;
+    held.clear();
+    usage = iMemTracker::usage("tracked_pool", iMemTracker::PoolType);
+    EXPECT_EQ(0, usage.liveCount);
+    EXPECT_EQ(0, usage.liveBytes);
+    EXPECT_EQ(peak, usage.peakBytes);
+    EXPECT_EQ(4, usage.freedCount);
+    EXPECT_GT(usage.lifetimeNs, 0);
+
+    // Nothing is recorded once stopped, the data stays
+    iMemTracker::stop();
+    iSharedDataPointer<iMemBlock> untracked(iMemBlock::new4Pool(pool.data(), 1000));
+    EXPECT_EQ(4, iMemTracker::usage("tracked_pool", iMemTracker::PoolType).totalCount);
+}
+
+TEST_F(MemTrackerTest, ReleaseAfterStopIsAccounted) {
+    iSharedDataPointer<iMemBlock> block(iMemBlock::new4Pool(pool.data(), 1000));
+    const xint64 size = iMemTracker::usage("tracked_pool", iMemTracker::PoolType).liveBytes;
+    EXPECT_GE(size, 1000);
+
+    // A block recorded before stop() still leaves the live figures when released
+    iMemTracker::stop();
+    block.reset();
+    iMemTracker::Usage usage = iMemTracker::usage("tracked_pool", iMemTracker::PoolType);
+    EXPECT_EQ(0, usage.liveCount);
+    EXPECT_EQ(0, usage.liveBytes);
+    EXPECT_EQ(1, usage.freedCount);
+
+    // so that a block reusing its address after start() is counted once
+    ASSERT_TRUE(iMemTracker::start(1));
+    block = iMemBlock::new4Pool(pool.data(), 1000);
+    usage = iMemTracker::usage("tracked_pool", iMemTracker::PoolType);
+    EXPECT_EQ(1, usage.liveCount);
+    EXPECT_EQ(size, usage.liveBytes);
+    EXPECT_EQ(size, usage.peakBytes);
+}
+
+TEST_F(MemTrackerTest, FoldedStacks) {
+    iSharedDataPointer<iMemBlock> outer;
+    iSharedDataPointer<iMemBlock> inner;
+    {
+        iMemTracker::Scope scope("session");
+        outer = iMemBlock::new4Pool(pool.data(), 2000);
+        iMemTracker::Scope nested("frame;queue");
+        inner = iMemBlock::new4Pool(pool.data(), 3000);
+    }
+
+    const std::string folded = iMemTracker::dumpFolded();
+    EXPECT_NE(std::string::npos, folded.find("tracked_pool;POOL;session;frame:queue;")) << folded;
+    EXPECT_NE(std::string::npos, folded.find("tracked_pool;POOL;session;")) << folded;
+
+    // Every line is "frames count", the count being the bytes of the site
+    std::istringstream lines(folded);
+    std::string line;
+    xint64 sum = 0;
+    while (std::getline(lines, line)) {
+        if (0 != line.compare(0, 13, "tracked_pool;"))
+            continue;
+        const size_t space = line.rfind(' ');
+        ASSERT_NE(std::string::npos, space);
+        sum += atoll(line.c_str() + space + 1);
+    }
+    EXPECT_EQ(iMemTracker::usage("tracked_pool").liveBytes, sum);
+
+    // Freed sites only show up in the allocation-weighted dump
+    inner.reset();
+    EXPECT_EQ(std::string::npos, iMemTracker::dumpFolded().find("frame:queue"));
+    EXPECT_NE(std::string::npos, iMemTracker::dumpFolded(false).find("frame:queue"));
+}
+
+TEST_F(MemTrackerTest, DumpOnSignal) {
+    char path[] = "/tmp/ix_memtracker_XXXXXX";
+    int fd = mkstemp(path);
+    ASSERT_GE(fd, 0);
+    close(fd);
+
+    iSharedDataPointer<iMemBlock> block(iMemBlock::new4Pool(pool.data(), 500));
+    ASSERT_TRUE(iMemTracker::dumpOnSignal(SIGUSR2, path));
+    raise(SIGUSR2);
+
+    // Served on the next tracked allocation, outside the handler
+    iSharedDataPointer<iMemBlock> next(iMemBlock::new4Pool(pool.data(), 500));
+    std::ifstream file(path);
+    std::stringstream content;
+    content << file.rdbuf();
+    EXPECT_NE(std::string::npos, content.str().find("tracked_pool;POOL")) << content.str();
+
+    signal(SIGUSR2, SIG_DFL);
+    unlink(path);
+}
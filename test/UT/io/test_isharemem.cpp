@@ -12,6 +12,7 @@
 #include <core/global/inamespace.h>
 #include <cstring>
 #include <sys/mman.h> // for shm_unlink
+#include <unistd.h>
 
 using namespace iShell;
 
@@ -399,3 +400,64 @@ TEST_F(ShareMemTest, MixedTypeAllocations) {
     delete private2;
     delete posix2;
 }
+
+// === Backing Options Tests ===
+
+TEST_F(ShareMemTest, HugePagesFallBackWhenUnavailable) {
+    // Without reserved huge pages the request degrades to normal (THP advised) pages
+    iShareMem* priv = iShareMem::create("ix_test", MEMTYPE_PRIVATE, 64 * 1024, 0600,
+                                        iShareMem::CreateHugePages | iShareMem::CreatePopulate);
+    ASSERT_NE(priv, nullptr);
+    EXPECT_GE(priv->size(), 64 * 1024u);
+    memset(priv->data(), 0x5a, 64 * 1024);
+    delete priv;
+
+    iShareMem* posix = iShareMem::create("ix_test", MEMTYPE_SHARED_POSIX, 64 * 1024, 0600, iShareMem::CreateHugePages);
+    ASSERT_NE(posix, nullptr);
+    EXPECT_FALSE(posix->hugePages());
+    memset(posix->data(), 0x5a, 64 * 1024);
+    delete posix;
+}
+
+TEST_F(ShareMemTest, PunchRoundsToSegmentPageSize) {
+    iShareMem* shm = iShareMem::create("ix_test", MEMTYPE_SHARED_MEMFD, 4 * 1024 * 1024, 0600, iShareMem::CreateHugePages);
+    if (!shm) GTEST_SKIP() << "memfd not available";
+
+    const size_t page = shm->pageSize();
+    if (!shm->hugePages()) {
+        EXPECT_EQ((size_t)sysconf(_SC_PAGESIZE), page);
+    }
+    ASSERT_GE(shm->size(), 2 * page);
+    memset(shm->data(), 0x5a, shm->size());
+
+    // Less than one page keeps its contents, a whole page is released
+    char* data = static_cast<char*>(shm->data());
+    shm->punch(page / 2, page);
+    EXPECT_EQ(0x5a, data[page / 2]);
+    EXPECT_EQ(0x5a, data[page + page / 2 - 1]);
+
+    shm->punch(0, page);
+    EXPECT_EQ(0, data[0]);
+    EXPECT_EQ(0, data[page - 1]);
+    EXPECT_EQ(0x5a, data[page]);
+
+    shm->populate(page / 2, page);
+    data[page / 2] = 'x';
+    delete shm;
+}
+
+TEST_F(ShareMemTest, TransparentHugePagesAndNumaNode) {
+    // Advice and binding failures are not fatal, the mapping stays usable
+    iShareMem* shm = iShareMem::create("ix_test", MEMTYPE_PRIVATE, 4 * 1024 * 1024, 0600,
+                                       iShareMem::CreateTransparentHugePages | iShareMem::CreatePopulate, 0);
+    ASSERT_NE(shm, nullptr);
+    EXPECT_FALSE(shm->hugePages());
+    EXPECT_EQ(4 * 1024 * 1024u, shm->size());
+    static_cast<char*>(shm->data())[shm->size() - 1] = 'x';
+    delete shm;
+
+    shm = iShareMem::create("ix_test", MEMTYPE_SHARED_POSIX, 8192, 0600, 0, 4096);
+    ASSERT_NE(shm, nullptr);
+    static_cast<char*>(shm->data())[0] = 'x';
+    delete shm;
+}
@@ -12,6 +12,9 @@
 #include <core/kernel/ieventdispatcher.h>
 #include <core/global/inamespace.h>
 
+#include <thread>
+#include <vector>
+
 using namespace iShell;
 
 class ICoreApplicationTest : public ::testing::Test {
@@ -319,3 +322,95 @@ TEST_F(ICoreApplicationTest, DISABLED_ExitMethod) {
     // Application should still be valid
     EXPECT_NE(iCoreApplication::instance(), nullptr);
 }
+
+// Records the order posted events arrive in
+class SequenceEvent : public iEvent {
+public:
+    SequenceEvent(int producer, int seq) : iEvent(iEvent::User + 7), producer(producer), seq(seq) {}
+    int producer;
+    int seq;
+};
+
+class SequenceReceiver : public iObject {
+public:
+    std::vector<std::pair<int, int> > received;
+    int quitCount = 0;
+
+    bool event(iEvent* e) override {
+        if (e->type() == iEvent::User + 7) {
+            SequenceEvent* se = static_cast<SequenceEvent*>(e);
+            received.push_back(std::make_pair(se->producer, se->seq));
+            return true;
+        }
+        if (e->type() == iEvent::Quit) {
+            ++quitCount;
+            return true;
+        }
+        return iObject::event(e);
+    }
+};
+
+// Test: events posted from several threads arrive complete and in per-thread order
+TEST_F(ICoreApplicationTest, PostFromManyThreads) {
+    SequenceReceiver receiver;
+    const int kThreads = 4;
+    const int kEvents = 500;
+
+    std::vector<std::thread> producers;
+    for (int t = 0; t < kThreads; ++t) {
+        producers.push_back(std::thread([&receiver, t, kEvents]() {
+            for (int i = 0; i < kEvents; ++i)
+                iCoreApplication::postEvent(&receiver, new SequenceEvent(t, i));
+        }));
+    }
+    for (size_t t = 0; t < producers.size(); ++t)
+        producers[t].join();
+
+    iCoreApplication::sendPostedEvents(&receiver);
+    ASSERT_EQ(static_cast<size_t>(kThreads * kEvents), receiver.received.size());
+
+    std::vector<int> next(kThreads, 0);
+    for (size_t i = 0; i < receiver.received.size(); ++i) {
+        const std::pair<int, int>& r = receiver.received[i];
+        EXPECT_EQ(next[r.first], r.second);
+        next[r.first] = r.second + 1;
+    }
+}
+
+// Test: cross-thread posts are sorted by priority and compressed like local ones
+TEST_F(ICoreApplicationTest, PostFromThreadKeepsPriorityAndCompression) {
+    SequenceReceiver receiver;
+
+    std::thread producer([&receiver]() {
+        iCoreApplication::postEvent(&receiver, new SequenceEvent(0, 0), LowEventPriority);
+        iCoreApplication::postEvent(&receiver, new SequenceEvent(0, 1), NormalEventPriority);
+        iCoreApplication::postEvent(&receiver, new SequenceEvent(0, 2), HighEventPriority);
+        iCoreApplication::postEvent(&receiver, new iEvent(iEvent::Quit));
+        iCoreApplication::postEvent(&receiver, new iEvent(iEvent::Quit));
+    });
+    producer.join();
+
+    iCoreApplication::sendPostedEvents(&receiver);
+    ASSERT_EQ(3u, receiver.received.size());
+    EXPECT_EQ(2, receiver.received[0].second);
+    EXPECT_EQ(1, receiver.received[1].second);
+    EXPECT_EQ(0, receiver.received[2].second);
+    EXPECT_EQ(1, receiver.quitCount);
+}
+
+// Test: a post from another thread wakes a loop blocked waiting for events
+TEST_F(ICoreApplicationTest, PostFromThreadWakesBlockedLoop) {
+    SequenceReceiver receiver;
+    iEventLoop loop;
+
+    std::thread producer([&receiver]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        iCoreApplication::postEvent(&receiver, new SequenceEvent(0, 0));
+    });
+
+    while (receiver.received.empty())
+        loop.processEvents(iEventLoop::WaitForMoreEvents);
+    producer.join();
+
+    EXPECT_EQ(1u, receiver.received.size());
+}
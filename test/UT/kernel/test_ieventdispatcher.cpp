@@ -8,6 +8,15 @@
 #include <core/kernel/ieventdispatcher.h>
 #include <core/kernel/itimer.h>
 #include <core/thread/ithread.h>
+#include <core/kernel/ieventsource.h>
+#include <core/thread/ieventdispatcher_generic.h>
+#include <core/kernel/icoreapplication.h>
+#include <core/kernel/ievent.h>
+
+#include <unistd.h>
+#include <vector>
+#include <thread>
+#include <chrono>
 
 using namespace iShell;
 
@@ -115,3 +124,200 @@ TEST_F(EventDispatcherTest, RegisterTimerFromDifferentThread) {
     // The check is: (thread() != object->thread()) || (thread() != iThread::currentThread())
     // This is hard to trigger without actual threading
 }
+
+// Source ready only through a pipe, as the INC devices are
+class PipeSource : public iEventSource {
+public:
+    explicit PipeSource(int priority = IX_PRIORITY_IO)
+        : iEventSource(iLatin1StringView("PipeSource"), priority)
+        , checks(0)
+        , dispatches(0) {
+        setFlags(flags() | IX_EVENT_SOURCE_POLL_DRIVEN);
+        EXPECT_EQ(0, pipe(fds));
+        pollFd.fd = fds[0];
+        pollFd.events = IX_IO_IN;
+        pollFd.revents = 0;
+        addPoll(&pollFd);
+    }
+
+    void release() {
+        detach();
+        ::close(fds[0]);
+        ::close(fds[1]);
+        deref();
+    }
+
+    void notify() { EXPECT_EQ(1, ::write(fds[1], "x", 1)); }
+
+    int checks;
+    int dispatches;
+
+protected:
+    bool check() override {
+        ++checks;
+        return (pollFd.revents & IX_IO_IN) != 0;
+    }
+
+    bool dispatch() override {
+        char byte;
+        pollFd.revents = 0;
+        EXPECT_EQ(1, ::read(fds[0], &byte, 1));
+        ++dispatches;
+        return true;
+    }
+
+private:
+    int fds[2];
+    iPollFD pollFd;
+};
+
+// Ready only for the first prepare
+class OneShotSource : public iEventSource {
+public:
+    explicit OneShotSource(int priority)
+        : iEventSource(iLatin1StringView("OneShotSource"), priority)
+        , fired(false)
+        , dispatches(0) {}
+
+    bool fired;
+    int dispatches;
+
+protected:
+    bool prepare(xint64*) override { return !fired; }
+    bool check() override { return !fired; }
+    bool dispatch() override { fired = true; ++dispatches; return true; }
+};
+
+TEST_F(EventDispatcherTest, PollDrivenSourcesCheckedOnlyWhenReported) {
+    iEventDispatcher* dispatcher = iEventDispatcher::instance();
+    if (!iobject_cast<iEventDispatcher_generic*>(dispatcher))
+        GTEST_SKIP() << "generic dispatcher only";
+
+    std::vector<PipeSource*> sources;
+    for (int i = 0; i < 200; ++i) {
+        sources.push_back(new PipeSource());
+        ASSERT_EQ(0, sources.back()->attach(dispatcher));
+    }
+
+    sources[57]->notify();
+    for (int i = 0; (i < 10) && (0 == sources[57]->dispatches); ++i)
+        dispatcher->processEvents(iEventLoop::AllEvents);
+
+    EXPECT_EQ(1, sources[57]->dispatches);
+    for (int i = 0; i < 200; ++i) {
+        if (57 == i)
+            continue;
+        EXPECT_EQ(0, sources[i]->checks) << i;
+        EXPECT_EQ(0, sources[i]->dispatches) << i;
+    }
+
+    for (size_t i = 0; i < sources.size(); ++i)
+        sources[i]->release();
+}
+
+TEST_F(EventDispatcherTest, PollDrivenSourceWaitsForHigherPriority) {
+    iEventDispatcher* dispatcher = iEventDispatcher::instance();
+    if (!iobject_cast<iEventDispatcher_generic*>(dispatcher))
+        GTEST_SKIP() << "generic dispatcher only";
+
+    PipeSource* io = new PipeSource(IX_PRIORITY_IO);
+    OneShotSource* high = new OneShotSource(IX_PRIORITY_HIGH);
+    ASSERT_EQ(0, io->attach(dispatcher));
+    ASSERT_EQ(0, high->attach(dispatcher));
+
+    io->notify();
+    dispatcher->processEvents(iEventLoop::AllEvents);
+    EXPECT_EQ(1, high->dispatches);
+    EXPECT_EQ(0, io->dispatches);
+
+    for (int i = 0; (i < 10) && (0 == io->dispatches); ++i)
+        dispatcher->processEvents(iEventLoop::AllEvents);
+    EXPECT_EQ(1, io->dispatches);
+    EXPECT_EQ(1, high->dispatches);
+
+    // nothing left to read, the fd is not reported again
+    dispatcher->processEvents(iEventLoop::AllEvents);
+    EXPECT_EQ(1, io->dispatches);
+
+    high->detach();
+    high->deref();
+    io->release();
+}
+
+// Counts posted events delivered to it
+class CountingReceiver : public iObject {
+public:
+    CountingReceiver() : received(0) {}
+    int received;
+
+    bool event(iEvent* e) override {
+        if (e->type() == iEvent::User + 9) {
+            ++received;
+            return true;
+        }
+        return iObject::event(e);
+    }
+};
+
+TEST_F(EventDispatcherTest, BusyPollCatchesCrossThreadPosts) {
+    iEventDispatcher* dispatcher = iEventDispatcher::instance();
+    if (!iobject_cast<iEventDispatcher_generic*>(dispatcher))
+        GTEST_SKIP() << "generic dispatcher only";
+
+    ASSERT_TRUE(dispatcher->setBusyPollBudget(5 * 1000 * 1000LL));
+    EXPECT_EQ(dispatcher->busyPollBudget(), 5 * 1000 * 1000LL);
+    iEventDispatcher::BusyPollStats before = dispatcher->busyPollStats();
+
+    CountingReceiver receiver;
+    const int kEvents = 100;
+    std::thread producer([&receiver, kEvents]() {
+        for (int i = 0; i < kEvents; ++i) {
+            iCoreApplication::postEvent(&receiver, new iEvent(iEvent::User + 9));
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    });
+
+    for (int i = 0; (i < 100000) && (receiver.received < kEvents); ++i)
+        dispatcher->processEvents(iEventLoop::WaitForMoreEvents);
+    producer.join();
+
+    iEventDispatcher::BusyPollStats after = dispatcher->busyPollStats();
+    dispatcher->setBusyPollBudget(0);
+
+    EXPECT_EQ(receiver.received, kEvents);
+    EXPECT_GT(after.spinWakeups, before.spinWakeups);
+    EXPECT_GT(after.spinNSecs, before.spinNSecs);
+}
+
+TEST_F(EventDispatcherTest, BusyPollBacksOffWhenIdle) {
+    iEventDispatcher* dispatcher = iEventDispatcher::instance();
+    if (!iobject_cast<iEventDispatcher_generic*>(dispatcher))
+        GTEST_SKIP() << "generic dispatcher only";
+
+    // nothing but a timer wakes the loop, so every spin is wasted
+    ASSERT_TRUE(dispatcher->setBusyPollBudget(1000 * 1000LL));
+    iEventDispatcher::BusyPollStats before = dispatcher->busyPollStats();
+
+    iEventLoop loop;
+    iTimer timer;
+    int fired = 0;
+    iObject::connect(&timer, &iTimer::timeout, &loop, [&]() {
+        if (++fired >= 10)
+            loop.exit(0);
+    });
+    timer.start(5);
+    loop.exec();
+    timer.stop();
+
+    iEventDispatcher::BusyPollStats after = dispatcher->busyPollStats();
+    dispatcher->setBusyPollBudget(0);
+
+    EXPECT_GT(after.spinMisses, before.spinMisses);
+    EXPECT_GT(after.sleeps, before.sleeps);
+    EXPECT_EQ(after.window, 0);
+}
+
+TEST_F(EventDispatcherTest, BusyPollDisabledByDefault) {
+    iEventDispatcher* dispatcher = iEventDispatcher::instance();
+    EXPECT_EQ(dispatcher->busyPollBudget(), 0);
+}
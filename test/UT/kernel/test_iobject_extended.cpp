@@ -11,6 +11,7 @@
 #include <core/thread/ithread.h>
 #include <core/utils/istring.h>
 #include <thread>
+#include <vector>
 #include <chrono>
 
 using namespace iShell;
@@ -88,6 +89,12 @@ public:
         callCount++;
     }
 
+    // queued calls keep their arguments, so they take them by value
+    void onStringValue(iString str) {
+        lastString = str;
+        callCount++;
+    }
+
     // Property observer slot
     void onPropertyChanged(const iVariant& v) {
         lastPropertyValue = v;
@@ -1574,3 +1581,52 @@ TEST_F(ObjectExtendedTest, BlockSignalsDuringEmit) {
     emitter.emitValue(99);
     EXPECT_EQ(receiver.callCount, 1);  // Should not be called
 }
+
+/**
+ * Test: queued invokeMethod delivers arguments intact across recycled events
+ */
+TEST_F(ObjectExtendedTest, QueuedInvokeMethodRecyclesEvents) {
+    TestReceiver receiver;
+
+    for (int round = 0; round < 50; ++round) {
+        for (int i = 0; i < 20; ++i)
+            iObject::invokeMethod(&receiver, &TestReceiver::onValueChanged, round * 20 + i, iShell::QueuedConnection);
+        iObject::invokeMethod(&receiver, &TestReceiver::onStringValue, iString::number(round), iShell::QueuedConnection);
+
+        EXPECT_EQ(receiver.callCount, round * 21);
+        iCoreApplication::sendPostedEvents(&receiver);
+        EXPECT_EQ(receiver.callCount, (round + 1) * 21);
+        EXPECT_EQ(receiver.lastValue, round * 20 + 19);
+        EXPECT_EQ(receiver.lastString, iString::number(round));
+    }
+}
+
+/**
+ * Test: queued calls from many threads share the event pool safely
+ */
+TEST_F(ObjectExtendedTest, QueuedInvokeMethodFromManyThreads) {
+    TestReceiver receiver;
+
+    const int kThreads = 4;
+    const int kCalls = 500;
+    std::vector<std::thread> producers;
+    for (int t = 0; t < kThreads; ++t) {
+        producers.push_back(std::thread([&receiver, kCalls]() {
+            for (int i = 0; i < kCalls; ++i) {
+                iObject::invokeMethod(&receiver, &TestReceiver::onValueChanged, i);
+                iObject::invokeMethod(&receiver, &TestReceiver::onStringValue, iString("queued"));
+            }
+        }));
+    }
+
+    while (receiver.callCount < 2 * kThreads * kCalls) {
+        iCoreApplication::sendPostedEvents(&receiver);
+        std::this_thread::yield();
+    }
+    for (size_t t = 0; t < producers.size(); ++t)
+        producers[t].join();
+
+    iCoreApplication::sendPostedEvents(&receiver);
+    EXPECT_EQ(receiver.callCount, 2 * kThreads * kCalls);
+    EXPECT_EQ(receiver.lastString, iString("queued"));
+}
@@ -2,10 +2,12 @@
 #include <core/kernel/itimer.h>
 #include <core/kernel/ieventloop.h>
 #include <core/kernel/ievent.h>
+#include <core/kernel/ideadlinetimer.h>
 #include <core/thread/imutex.h>
 #include <core/thread/icondition.h>
 #include <vector>
 #include <chrono>
+#include <thread>
 
 using namespace iShell;
 
@@ -588,3 +590,115 @@ TEST_F(ITimerTest, DeleteActiveTimer) {
     // 如果没有崩溃，测试通过
     SUCCEED();
 }
+
+// ============================================================================
+// 大量定时器测试
+// ============================================================================
+
+TEST_F(ITimerTest, ManyTimersFireInDeadlineOrder) {
+    iEventLoop loop;
+    const int kTimers = 200;
+
+    // The deadline of a timer is fixed inside start(), the clock is read around
+    // it so that jitter in the start loop does not count as a misordering
+    std::vector<iTimer*> timers;
+    std::vector<xint64> earliest(kTimers), latest(kTimers);
+    std::vector<int> fired;
+    for (int i = 0; i < kTimers; ++i) {
+        iTimer* t = new iTimer();
+        t->setSingleShot(true);
+        t->setTimerType(PreciseTimer);
+        t->setInterval((i * 37) % 40 + 1);
+        iObject::connect(t, &iTimer::timeout, &loop, [&fired, &loop, i, kTimers]() {
+            fired.push_back(i);
+            if (static_cast<int>(fired.size()) == kTimers)
+                loop.exit(0);
+        });
+        timers.push_back(t);
+    }
+    for (int i = 0; i < kTimers; ++i) {
+        const xint64 interval = timers[i]->interval() * 1000LL * 1000LL;
+        earliest[i] = iDeadlineTimer::current(PreciseTimer).deadlineNSecs() + interval;
+        timers[i]->start();
+        latest[i] = iDeadlineTimer::current(PreciseTimer).deadlineNSecs() + interval;
+    }
+
+    iTimer safetyTimer;
+    safetyTimer.setSingleShot(true);
+    iObject::connect(&safetyTimer, &iTimer::timeout, &loop, [&]() { loop.exit(1); });
+    safetyTimer.start(2000);
+
+    EXPECT_EQ(loop.exec(), 0);
+    ASSERT_EQ(static_cast<int>(fired.size()), kTimers);
+    for (int i = 1; i < kTimers; ++i)
+        EXPECT_LE(earliest[fired[i - 1]], latest[fired[i]]) << "timers " << fired[i - 1] << " and " << fired[i] << " at " << i;
+
+    for (int i = 0; i < kTimers; ++i)
+        delete timers[i];
+}
+
+TEST_F(ITimerTest, StopTimersAmongMany) {
+    iEventLoop loop;
+    const int kTimers = 300;
+
+    std::vector<iTimer*> timers;
+    int stoppedFired = 0;
+    int runningFired = 0;
+    for (int i = 0; i < kTimers; ++i) {
+        iTimer* t = new iTimer();
+        t->setSingleShot(true);
+        t->setInterval(5 + i % 20);
+        if (i % 2) {
+            iObject::connect(t, &iTimer::timeout, &loop, [&stoppedFired]() { ++stoppedFired; });
+        } else {
+            iObject::connect(t, &iTimer::timeout, &loop, [&runningFired, &loop, kTimers]() {
+                if (++runningFired == kTimers / 2)
+                    loop.exit(0);
+            });
+        }
+        t->start();
+        timers.push_back(t);
+    }
+
+    // stopping reorders the heap underneath the timers that stay armed
+    for (int i = 1; i < kTimers; i += 2) {
+        timers[i]->stop();
+        EXPECT_EQ(timers[i]->remainingTime(), -1);
+    }
+    EXPECT_GT(timers[0]->remainingTime(), 0);
+
+    iTimer safetyTimer;
+    safetyTimer.setSingleShot(true);
+    iObject::connect(&safetyTimer, &iTimer::timeout, &loop, [&]() { loop.exit(1); });
+    safetyTimer.start(2000);
+
+    EXPECT_EQ(loop.exec(), 0);
+    EXPECT_EQ(runningFired, kTimers / 2);
+    EXPECT_EQ(stoppedFired, 0);
+
+    for (int i = 0; i < kTimers; ++i)
+        delete timers[i];
+}
+
+TEST_F(ITimerTest, StopDueTimerFromTimeout) {
+    iEventLoop loop;
+    iTimer first, second;
+    int secondCount = 0;
+
+    first.setSingleShot(true);
+    second.setSingleShot(true);
+    iObject::connect(&first, &iTimer::timeout, &loop, [&]() {
+        // both are due in this round, the second one must not fire any more
+        second.stop();
+        loop.exit(0);
+    });
+    iObject::connect(&second, &iTimer::timeout, &loop, [&]() { ++secondCount; });
+
+    first.start(10);
+    second.start(10);
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+
+    EXPECT_EQ(loop.exec(), 0);
+    loop.processEvents();
+    EXPECT_EQ(secondCount, 0);
+}
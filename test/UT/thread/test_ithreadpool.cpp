@@ -0,0 +1,217 @@
+/**
+ * @file test_ithreadpool.cpp
+ * @brief Unit tests for iThreadPool and iFuture
+ * @details Tests task execution, work stealing, futures, continuations
+ *          and the parallel helpers
+ */
+
+#include <gtest/gtest.h>
+#include <core/thread/ithreadpool.h>
+#include <core/thread/ithread.h>
+#include <core/kernel/icoreapplication.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace iShell;
+
+class ThreadPoolTest : public ::testing::Test {
+protected:
+    void SetUp() override {}
+    void TearDown() override {}
+};
+
+class CountingTask : public iRunnable {
+public:
+    explicit CountingTask(std::atomic<int>* c) : counter(c) {}
+    void run() override { ++(*counter); }
+
+    std::atomic<int>* counter;
+};
+
+// Spawns children from inside a worker so they land on its own deque;
+// counts the children that ran on a worker other than their spawner
+class SpawningTask : public iRunnable {
+public:
+    SpawningTask(iThreadPool* p, std::atomic<int>* c, int d, std::atomic<int>* s = IX_NULLPTR, int spawner = 0)
+        : pool(p), counter(c), depth(d), stolen(s), spawnerThread(spawner) {}
+    void run() override {
+        const int self = iThread::currentThreadId();
+        if (stolen && spawnerThread && self != spawnerThread)
+            ++(*stolen);
+        if (depth <= 0) {
+            // long enough for idle workers to wake up and steal the siblings
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        } else {
+            for (int i = 0; i < 4; ++i)
+                pool->start(new SpawningTask(pool, counter, depth - 1, stolen, self));
+        }
+        ++(*counter);
+    }
+
+    iThreadPool* pool;
+    std::atomic<int>* counter;
+    int depth;
+    std::atomic<int>* stolen;
+    int spawnerThread;
+};
+
+class ResultReceiver : public iObject {
+    IX_OBJECT(ResultReceiver)
+public:
+    ResultReceiver() : callCount(0), lastValue(0), deliveredOn(IX_NULLPTR) {}
+
+    void onResult(int value) {
+        ++callCount;
+        lastValue = value;
+        deliveredOn = iThread::currentThread();
+    }
+
+    int callCount;
+    int lastValue;
+    iThread* deliveredOn;
+};
+
+static int answer() { return 42; }
+static int square(int v) { return v * v; }
+
+/**
+ * Test: pool sizing follows the hardware unless told otherwise
+ */
+TEST_F(ThreadPoolTest, ThreadCount) {
+    EXPECT_GE(iThreadPool::idealThreadCount(), 1);
+
+    iThreadPool pool(3);
+    EXPECT_EQ(pool.maxThreadCount(), 3);
+
+    iThreadPool ideal;
+    EXPECT_EQ(ideal.maxThreadCount(), iThreadPool::idealThreadCount());
+    EXPECT_EQ(iThreadPool::globalInstance(), iThreadPool::globalInstance());
+}
+
+/**
+ * Test: every started runnable runs exactly once before waitForDone returns
+ */
+TEST_F(ThreadPoolTest, RunsAllTasks) {
+    iThreadPool pool(4);
+    std::atomic<int> counter(0);
+
+    for (int i = 0; i < 10000; ++i)
+        pool.start(new CountingTask(&counter));
+
+    EXPECT_TRUE(pool.waitForDone());
+    EXPECT_EQ(counter.load(), 10000);
+    EXPECT_EQ(pool.activeThreadCount(), 0);
+}
+
+/**
+ * Test: tasks spawned by workers are drained, including by thieves
+ */
+TEST_F(ThreadPoolTest, NestedSpawnIsStolen) {
+    iThreadPool pool(4);
+    std::atomic<int> counter(0);
+    std::atomic<int> stolen(0);
+
+    // 1 + 4 + 16 + 64 + 256 + 1024 tasks. This thread stays out of the way
+    // until they are done, waitForDone() would help and take the tree itself.
+    pool.start(new SpawningTask(&pool, &counter, 5, &stolen));
+    for (int i = 0; i < 10000 && counter.load() < 1365; ++i)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    EXPECT_TRUE(pool.waitForDone());
+    EXPECT_EQ(counter.load(), 1365);
+    EXPECT_GT(stolen.load(), 0);
+}
+
+/**
+ * Test: futures carry the return value of functions, members and callables
+ */
+TEST_F(ThreadPoolTest, FutureResults) {
+    iThreadPool pool(2);
+
+    iFuture<int> f0 = pool.run(&answer);
+    iFuture<int> f1 = pool.run(&square, 7);
+    iFuture<int> f2 = pool.run([]() { return 5; });
+
+    EXPECT_TRUE(f0.isValid());
+    EXPECT_EQ(f0.result(), 42);
+    EXPECT_EQ(f1.result(), 49);
+    EXPECT_EQ(f2.result(), 5);
+    EXPECT_TRUE(f2.isFinished());
+
+    iFuture<int> empty;
+    EXPECT_FALSE(empty.isValid());
+    EXPECT_FALSE(empty.isFinished());
+}
+
+/**
+ * Test: then() posts the result to the receiver's thread
+ */
+TEST_F(ThreadPoolTest, ThenDeliversOnReceiverThread) {
+    iThreadPool pool(2);
+    ResultReceiver receiver;
+
+    iFuture<int> future = pool.run(&square, 9);
+    future.then(&receiver, &ResultReceiver::onResult);
+    future.waitForFinished();
+    EXPECT_EQ(receiver.callCount, 0);
+
+    iCoreApplication::sendPostedEvents(&receiver);
+    EXPECT_EQ(receiver.callCount, 1);
+    EXPECT_EQ(receiver.lastValue, 81);
+    EXPECT_EQ(receiver.deliveredOn, iThread::currentThread());
+
+    // attaching after completion still goes through the event queue
+    future.then(&receiver, &ResultReceiver::onResult);
+    EXPECT_EQ(receiver.callCount, 1);
+    iCoreApplication::sendPostedEvents(&receiver);
+    EXPECT_EQ(receiver.callCount, 2);
+}
+
+/**
+ * Test: parallelFor visits every index exactly once
+ */
+TEST_F(ThreadPoolTest, ParallelForCoversRange) {
+    iThreadPool pool(4);
+    std::vector<std::atomic<int> > hits(10007);
+    for (size_t i = 0; i < hits.size(); ++i)
+        hits[i] = 0;
+
+    pool.parallelFor(0, (int)hits.size(), [&hits](int i) { ++hits[i]; });
+    pool.parallelFor(0, 100, [&hits](int i) { ++hits[i]; }, 7);
+    pool.parallelFor(5, 5, [&hits](int i) { ++hits[i]; });
+
+    for (size_t i = 0; i < hits.size(); ++i)
+        ASSERT_EQ(hits[i].load(), i < 100 ? 2 : 1) << "index " << i;
+}
+
+/**
+ * Test: parallelReduce matches the serial fold, in order
+ */
+TEST_F(ThreadPoolTest, ParallelReduce) {
+    iThreadPool pool(4);
+
+    xint64 sum = pool.parallelReduce((xint64)0, (xint64)100000, (xint64)0,
+        [](xint64 first, xint64 last, xint64& acc) { for (xint64 i = first; i < last; ++i) acc += i; },
+        [](xint64 a, xint64 b) { return a + b; });
+    EXPECT_EQ(sum, (xint64)100000 * 99999 / 2);
+
+    // concatenation is associative but not commutative
+    std::string text = pool.parallelReduce(0, 26, std::string(),
+        [](int first, int last, std::string& acc) { for (int i = first; i < last; ++i) acc += (char)('a' + i); },
+        [](const std::string& a, const std::string& b) { return a + b; }, 3);
+    EXPECT_EQ(text, "abcdefghijklmnopqrstuvwxyz");
+}
+
+/**
+ * Test: a parallelFor issued from inside a task completes without deadlock
+ */
+TEST_F(ThreadPoolTest, NestedParallelFor) {
+    iThreadPool pool(2);
+    std::atomic<int> total(0);
+
+    pool.parallelFor(0, 8, [&pool, &total](int) {
+        pool.parallelFor(0, 100, [&total](int) { ++total; });
+    });
+    EXPECT_EQ(total.load(), 800);
+}
@@ -0,0 +1,105 @@
+/**
+ * @file test_ifreelist.cpp
+ * @brief Unit tests for iFreeList
+ * @details Tests the id mode and the pointer cache mode across block boundaries
+ */
+
+#include <gtest/gtest.h>
+#include <core/utils/ifreelist.h>
+#include <thread>
+#include <vector>
+
+using namespace iShell;
+
+class IFreeListTest : public ::testing::Test {
+protected:
+    void SetUp() override {}
+    void TearDown() override {}
+};
+
+TEST_F(IFreeListTest, NextAndRelease) {
+    iFreeList<int> list;
+    int a = list.next();
+    int b = list.next();
+    EXPECT_NE(a, b);
+
+    list[a] = 10;
+    list[b] = 20;
+    EXPECT_EQ(list.at(a), 10);
+    EXPECT_EQ(list.at(b), 20);
+
+    list.release(a);
+    EXPECT_EQ(list.next(), a);
+}
+
+TEST_F(IFreeListTest, PopFromEmpty) {
+    iFreeList<void*> list(16);
+    EXPECT_EQ(list.pop(IX_NULLPTR), (void*)IX_NULLPTR);
+}
+
+TEST_F(IFreeListTest, PushIsBoundedBySize) {
+    iFreeList<void*> list(4);
+    int slots[5];
+    for (int i = 0; i < 4; ++i)
+        EXPECT_TRUE(list.push(&slots[i]));
+    EXPECT_FALSE(list.push(&slots[4]));
+}
+
+// the cache spans more than the first block; every pushed value must come back once
+TEST_F(IFreeListTest, PushPopBeyondFirstBlock) {
+    const int kCount = 300;
+    iFreeList<void*> list(kCount);
+    std::vector<char> slots(kCount, 0);
+
+    for (int i = 0; i < kCount; ++i)
+        ASSERT_TRUE(list.push(&slots[i]));
+
+    std::vector<int> seen(kCount, 0);
+    void* ptr;
+    while ((ptr = list.pop(IX_NULLPTR)) != IX_NULLPTR)
+        ++seen[static_cast<char*>(ptr) - &slots[0]];
+
+    for (int i = 0; i < kCount; ++i)
+        EXPECT_EQ(seen[i], 1) << "slot " << i;
+}
+
+TEST_F(IFreeListTest, ConcurrentPushPop) {
+    const int kThreads = 4;
+    const int kPerThread = 64;
+    iFreeList<void*> list(kThreads * kPerThread);
+    std::vector<char> slots(kThreads * kPerThread, 0);
+    std::vector<std::thread> workers;
+
+    for (int t = 0; t < kThreads; ++t) {
+        workers.push_back(std::thread([&list, &slots, t, kPerThread]() {
+            std::vector<void*> owned;
+            for (int i = 0; i < kPerThread; ++i)
+                owned.push_back(&slots[t * kPerThread + i]);
+
+            for (int round = 0; round < 20000; ++round) {
+                if (!owned.empty() && (round & 1)) {
+                    if (list.push(owned.back()))
+                        owned.pop_back();
+                } else {
+                    void* ptr = list.pop(IX_NULLPTR);
+                    if (ptr) owned.push_back(ptr);
+                }
+            }
+
+            while (!owned.empty()) {
+                if (list.push(owned.back()))
+                    owned.pop_back();
+            }
+        }));
+    }
+    for (size_t t = 0; t < workers.size(); ++t)
+        workers[t].join();
+
+    std::vector<int> seen(slots.size(), 0);
+    void* ptr;
+    while ((ptr = list.pop(IX_NULLPTR)) != IX_NULLPTR)
+        ++seen[static_cast<char*>(ptr) - &slots[0]];
+
+    for (size_t i = 0; i < seen.size(); ++i)
+        EXPECT_EQ(seen[i], 1) << "slot " << i;
+}